@@ -0,0 +1,707 @@
+#include "texcore.h"
+
+#include <poll.h>
+
+
+// Lines in the buffer the microbenchmarks run against
+#define BENCH_LINES 200000
+
+// Edits made by each editing microbenchmark
+#define BENCH_EDITS 200000
+
+// Edits that shift every row after them, so are much slower per call
+#define BENCH_ROW_EDITS 2000
+
+// Cursors edited at once, and the keys typed at them
+#define BENCH_CURSORS 10000
+#define BENCH_CURSOR_KEYS 100
+
+// Page cache budget the file is paged in with, far smaller than the file
+#define BENCH_LARGE_BUDGET (4 * 1024 * 1024)
+
+// Jumps made around the paged file
+#define BENCH_LARGE_JUMPS 2000
+
+/*--------------------------------------------------------------------------
+                                 BENCHMARK
+--------------------------------------------------------------------------*/
+
+/*
+    Writes line i of a synthetic C like file into buf, a mix of short code lines, tabs,
+    strings, comments and the occasional long line. Returns its length
+*/
+int benchLine(char *buf, int size, int i) {
+    int len = 0;
+
+    switch (i % 8) {
+        case 0:
+            return snprintf(buf, size, "/* Block %d of generated source", i / 8);
+        case 1:
+            return snprintf(buf, size, "   spans two lines */");
+        case 2:
+            return snprintf(buf, size, "static int value%d = %d;", i, i * 7);
+        case 3:
+            return snprintf(buf, size, "\tif (value%d > %d) {", i - 1, i % 97);
+        case 4:
+            return snprintf(buf, size, "\t\treturn \"string %d\"; // trailing comment", i);
+        case 5:
+            return snprintf(buf, size, "\t}");
+        case 6:
+            // Long log style line
+            for (int j = 0; j < 40 && len < size; j++)
+                len += snprintf(&buf[len], size - len, "field%d=%d ", j, i + j);
+            return len < size ? len : size - 1;
+        default:
+            return 0;
+    }
+}
+
+
+/*
+    Prints the time per operation of a microbenchmark that ran ops operations in elapsed
+    microseconds
+*/
+void benchReport(const char *name, long ops, long elapsed) {
+    if (elapsed == 0)
+        elapsed = 1;
+    printf("%-14s %9ld ops %10.2f ms %12.1f ns/op %12.0f ops/s\n", name, ops, elapsed / 1000.0,
+        elapsed * 1000.0 / ops, ops * 1000000.0 / elapsed);
+}
+
+
+/*
+    Appends lines generated rows to an empty buffer, and names it so C highlighting is used
+*/
+void benchInsertRows(texCore *tc, int lines) {
+    char buf[1024];
+
+    tc->filename = strdup("bench.c");
+    editorSelectSyntaxHighlight(tc);
+
+    long start = texNow();
+    for (int i = 0; i < lines; i++) {
+        int len = benchLine(buf, sizeof(buf), i);
+        editorInsertRow(tc, tc->numrows, buf, len);
+    }
+    benchReport("insert row", lines, texNow() - start);
+}
+
+
+/*
+    Renders every row again
+*/
+void benchUpdateRows(texCore *tc) {
+    long start = texNow();
+    for (int i = 0; i < tc->numrows; i++)
+        editorUpdateRow(tc, &tc->row[i]);
+    benchReport("update row", tc->numrows, texNow() - start);
+}
+
+
+/*
+    Highlights the whole file from the top, a window of rows at a time as scrolling does
+*/
+void benchHighlight(texCore *tc) {
+    tc->hlUpTo = 0;
+
+    long start = texNow();
+    for (int first = 0; first < tc->numrows; first += 24)
+        editorHighlightRows(tc, first, first + 23);
+    benchReport("highlight row", tc->numrows, texNow() - start);
+}
+
+
+/*
+    Converts the end and middle of every row between chars indices and screen columns
+*/
+void benchMapIndex(texCore *tc) {
+    long sum = 0;   // Keeps the conversions from being optimized away
+
+    long start = texNow();
+    for (int i = 0; i < tc->numrows; i++) {
+        erow *row = &tc->row[i];
+        sum += editorRowCxToRx(row, row->size);
+        sum += editorRowCxToRx(row, row->size / 2);
+    }
+    benchReport("cx to rx", tc->numrows * 2L, texNow() - start);
+
+    start = texNow();
+    for (int i = 0; i < tc->numrows; i++) {
+        erow *row = &tc->row[i];
+        sum += editorRowRxToCx(row, row->size);
+        sum += editorRowRxToCx(row, row->size / 2);
+    }
+    benchReport("rx to cx", tc->numrows * 2L, texNow() - start);
+
+    if (sum == -1)
+        printf("\n");
+}
+
+
+/*
+    Types and deletes chars at the start of rows spread through the file, at most one per row
+*/
+void benchEditChars(texCore *tc) {
+    int edits = tc->numrows < BENCH_EDITS ? tc->numrows : BENCH_EDITS;
+
+    long start = texNow();
+    for (int i = 0; i < edits; i++) {
+        tc->cy = (i * 7919L) % tc->numrows;
+        tc->cx = 0;
+        editorInsertChar(tc, 'x');
+    }
+    benchReport("insert char", edits, texNow() - start);
+
+    start = texNow();
+    for (int i = 0; i < edits; i++) {
+        tc->cy = (i * 7919L) % tc->numrows;
+        tc->cx = 1;
+        editorDelChar(tc);
+    }
+    benchReport("delete char", edits, texNow() - start);
+}
+
+
+/*
+    Splits rows in the middle of the file in two, then joins them back up again
+*/
+void benchEditRows(texCore *tc) {
+    int at = tc->numrows / 2;
+    int edits = tc->numrows / 4 < BENCH_ROW_EDITS ? tc->numrows / 4 : BENCH_ROW_EDITS;
+
+    long start = texNow();
+    for (int i = 0; i < edits; i++) {
+        tc->cy = at + i * 2;
+        tc->cx = tc->row[tc->cy].size / 2;
+        editorInsertNewLine(tc);
+    }
+    benchReport("split row", edits, texNow() - start);
+
+    start = texNow();
+    for (int i = 0; i < edits; i++) {
+        tc->cy = at + i + 1;
+        tc->cx = 0;
+        editorDelChar(tc);
+    }
+    benchReport("join rows", edits, texNow() - start);
+}
+
+
+/*
+    Types, deletes, splits and joins rows at cursors spread through the file, a few to a row,
+    timing each keystroke across all of them
+*/
+void benchMultiCursor(texCore *tc) {
+    int cursors = tc->numrows < BENCH_CURSORS ? tc->numrows : BENCH_CURSORS;
+    tc->cy = 0;
+    tc->cx = 0;
+    for (int i = 1; i < cursors; i++) {
+        int cy = (i / 4) * (tc->numrows / (cursors / 4 + 1));
+        editorAddCursor(tc, cy, (i % 4) * tc->row[cy].size / 4);
+    }
+    editorNormalizeCursors(tc);
+
+    long start = texNow();
+    for (int i = 0; i < BENCH_CURSOR_KEYS; i++)
+        editorInsertChar(tc, 'x');
+    benchReport("cursors insert", BENCH_CURSOR_KEYS, texNow() - start);
+
+    start = texNow();
+    for (int i = 0; i < BENCH_CURSOR_KEYS; i++)
+        editorDelChar(tc);
+    benchReport("cursors delete", BENCH_CURSOR_KEYS, texNow() - start);
+
+    start = texNow();
+    for (int i = 0; i < 10; i++)
+        editorInsertNewLine(tc);
+    benchReport("cursors split", 10, texNow() - start);
+
+    start = texNow();
+    for (int i = 0; i < 10; i++)
+        editorDelChar(tc);
+    benchReport("cursors join", 10, texNow() - start);
+
+    editorClearCursors(tc);
+}
+
+
+/*
+    Copies, cuts and pastes back half of the file as one selection, then indents and dedents it
+*/
+void benchSelection(texCore *tc) {
+    int first = 10;
+    int last = first + tc->numrows / 2;
+
+    tc->cy = first;
+    tc->cx = 0;
+    editorSelectStart(tc, SEL_LINEAR);
+    tc->cy = last;
+    long long len;
+    long start = texNow();
+    char *text = editorCopySelection(tc, &len);
+    benchReport("copy selection", 1, texNow() - start);
+
+    start = texNow();
+    editorDeleteSelection(tc);
+    benchReport("cut selection", 1, texNow() - start);
+
+    start = texNow();
+    editorInsertText(tc, text, len);
+    benchReport("paste text", 1, texNow() - start);
+    free(text);
+
+    tc->cy = first;
+    tc->cx = 0;
+    editorSelectStart(tc, SEL_LINEAR);
+    tc->cy = last;
+    start = texNow();
+    editorIndentSelection(tc, 0);
+    editorIndentSelection(tc, 1);
+    benchReport("indent selection", 2, texNow() - start);
+    editorSelectClear(tc);
+}
+
+
+/*
+    Steps through the matches of a common query, searches the whole file for one that isn't
+    there, then indexes the matches and steps through them again
+*/
+void benchFind(texCore *tc) {
+    int ro;
+    int current = -1;
+
+    long start = texNow();
+    for (int i = 0; i < BENCH_EDITS; i++)
+        current = editorFindNext(tc, "value1", current, 1, &ro);
+    benchReport("find next", BENCH_EDITS, texNow() - start);
+
+    start = texNow();
+    for (int i = 0; i < 10; i++)
+        editorFindNext(tc, "zzzz", -1, 1, &ro);
+    benchReport("find miss", 10, texNow() - start);
+
+    // The rows a query is in, indexed in slices as a client does between keys, then stepped through
+    texSearchIndex ix = {0};
+    start = texNow();
+    editorSearchIndexStart(tc, &ix, "value1");
+    while (editorSearchIndexStep(tc, &ix, 1024))
+        ;
+    benchReport("search index", tc->numrows, texNow() - start);
+
+    start = texNow();
+    for (int i = 0; i < BENCH_EDITS; i++)
+        current = editorSearchIndexFind(&ix, current, 1);
+    benchReport("index next", BENCH_EDITS, texNow() - start);
+    editorSearchIndexFree(&ix);
+}
+
+
+/*
+    Builds the soft wrap layout, then looks up rows and visual lines in it and resizes it
+*/
+void benchLayout(texCore *tc) {
+    editorLayoutResize(tc, 80);
+    long sum = 0;
+
+    long start = texNow();
+    for (int i = 0; i < 10; i++) {
+        editorLayoutInvalidate(tc);
+        editorLayoutBuild(tc);
+    }
+    benchReport("layout build", 10, texNow() - start);
+
+    int total = editorLayoutVisualLine(tc, tc->numrows);
+    start = texNow();
+    for (int i = 0; i < BENCH_EDITS; i++) {
+        int sub;
+        sum += editorLayoutVisualLine(tc, (i * 7919L) % tc->numrows);
+        sum += editorLayoutRowAtVisual(tc, (i * 7919L) % total, &sub);
+    }
+    benchReport("visual line", BENCH_EDITS * 2L, texNow() - start);
+
+    // Terminal resizes, only the rows that wrap differently are measured again
+    start = texNow();
+    for (int i = 0; i < 10; i++)
+        editorLayoutResize(tc, i % 2 ? 80 : 120);
+    benchReport("layout resize", 10, texNow() - start);
+
+    // Rows going in and out with the layout shifted around them
+    start = texNow();
+    for (int i = 0; i < BENCH_EDITS / 100; i++) {
+        int at = (i * 7919L) % tc->numrows;
+        editorInsertRow(tc, at, "layout", 6);
+        sum += editorLayoutVisualLine(tc, tc->numrows);
+        editorDelRow(tc, at);
+        sum += editorLayoutVisualLine(tc, tc->numrows);
+    }
+    benchReport("layout row in/out", BENCH_EDITS / 100, texNow() - start);
+
+    if (sum == -1)
+        printf("\n");
+}
+
+
+/*
+    Wraps the file in one block, then matches brackets through the bracket tree, near ones and
+    the outermost pair, folds every block and steps over the folds
+*/
+void benchStructure(texCore *tc) {
+    editorInsertRow(tc, 0, "{", 1);
+    editorInsertRow(tc, tc->numrows, "}", 1);
+    while (editorHighlightAhead(tc, TEX_HL_LOOKBACK / 2))
+        ;
+    long sum = 0;
+    int matchRow, matchRo;
+
+    long start = texNow();
+    for (int i = 0; i < 10; i++) {
+        editorBracketsInvalidate(tc);
+        editorBracketsBuild(tc);
+    }
+    benchReport("bracket tree", 10, texNow() - start);
+
+    // The { ending each generated if
+    start = texNow();
+    for (int i = 0; i < BENCH_EDITS; i++) {
+        int at = 1 + (i * 7919L) % (tc->numrows - 9) / 8 * 8 + 3;
+        sum += editorMatchBracket(tc, at, tc->row[at].rSize - 1, &matchRow, &matchRo);
+    }
+    benchReport("match bracket", BENCH_EDITS, texNow() - start);
+
+    start = texNow();
+    for (int i = 0; i < BENCH_EDITS; i++)
+        sum += editorMatchBracket(tc, i % 2 ? 0 : tc->numrows - 1, 0, &matchRow, &matchRo);
+    benchReport("match outer", BENCH_EDITS, texNow() - start);
+
+    // Edits inside the block keep the tree up to date a row at a time
+    start = texNow();
+    for (int i = 0; i < BENCH_EDITS / 100; i++) {
+        int at = 1 + (i * 7919L) % (tc->numrows - 2);
+        editorRowInsertChar(tc, &tc->row[at], 0, '(');
+        editorRowDelChar(tc, &tc->row[at], 0);
+        sum += editorMatchBracket(tc, 0, 0, &matchRow, &matchRo);
+    }
+    benchReport("edit and match", BENCH_EDITS / 100, texNow() - start);
+
+    // Rows going in and out inside the block, with the outer match found again after each
+    start = texNow();
+    for (int i = 0; i < BENCH_EDITS / 100; i++) {
+        int at = 1 + (i * 7919L) % (tc->numrows - 2);
+        int found;
+        editorInsertRow(tc, at, "}", 1);
+        while ((found = editorMatchBracket(tc, 0, 0, &matchRow, &matchRo)) == -1 && editorBracketsAhead(tc, TEX_HL_LOOKBACK / 2))
+            ;
+        sum += found;
+        editorDelRow(tc, at);
+        while ((found = editorMatchBracket(tc, 0, 0, &matchRow, &matchRo)) == -1 && editorBracketsAhead(tc, TEX_HL_LOOKBACK / 2))
+            ;
+        sum += found;
+    }
+    benchReport("bracket row in/out", BENCH_EDITS / 100, texNow() - start);
+
+    start = texNow();
+    int folds = 0;
+    for (int at = 4; at < tc->numrows; at += 8)
+        folds += editorFoldAt(tc, at) > 0;
+    benchReport("fold block", folds, texNow() - start);
+
+    // A screen of visible rows at a time, down the whole file
+    start = texNow();
+    int steps = 0;
+    for (int at = 0; at < tc->numrows; steps++)
+        at = editorFoldStep(tc, at, 24);
+    benchReport("fold step", steps, texNow() - start);
+
+    start = texNow();
+    editorUnfoldAll(tc);
+    benchReport("unfold all", folds, texNow() - start);
+
+    editorDelRow(tc, tc->numrows - 1);
+    editorDelRow(tc, 0);
+    if (sum == -1)
+        printf("\n");
+}
+
+
+/*
+    Builds the overview tree, draws a ruler's worth of sums from it, and inserts and deletes
+    rows with the tree shifted around them
+*/
+void benchOverview(texCore *tc) {
+    long sum = 0;
+    texOverviewNode node;
+
+    long start = texNow();
+    for (int i = 0; i < 10; i++) {
+        editorOverviewInvalidate(tc);
+        editorOverviewBuild(tc);
+    }
+    benchReport("overview tree", 10, texNow() - start);
+
+    // A 24 line ruler over the whole file each frame
+    start = texNow();
+    for (int i = 0; i < BENCH_EDITS / 100; i++) {
+        for (int y = 0; y < 24; y++) {
+            editorOverviewSum(tc, (long long) tc->numrows * y / 24, (long long) tc->numrows * (y + 1) / 24, &node);
+            sum += node.text;
+        }
+    }
+    benchReport("overview ruler", BENCH_EDITS / 100, texNow() - start);
+
+    start = texNow();
+    for (int i = 0; i < BENCH_EDITS / 100; i++) {
+        int at = (i * 7919L) % tc->numrows;
+        editorInsertRow(tc, at, "overview", 8);
+        editorDelRow(tc, at);
+    }
+    benchReport("overview row in/out", BENCH_EDITS / 100, texNow() - start);
+
+    if (sum == -1)
+        printf("\n");
+}
+
+
+/*
+    Diffs the whole file against itself as it was on disk with every hundredth row changed, then
+    types into rows spread through it with the diff brought up to date after each key
+*/
+void benchDiff(texCore *tc) {
+    editorDiffSetBase(tc);
+    for (int at = 0; at < tc->numrows; at += 100)
+        editorRowInsertChar(tc, &tc->row[at], 0, 'd');
+
+    long start = texNow();
+    for (int i = 0; i < 10; i++) {
+        editorDiffInvalidate(tc);
+        editorDiffUpdate(tc);
+    }
+    benchReport("diff file", 10, texNow() - start);
+
+    start = texNow();
+    for (int i = 0; i < BENCH_EDITS / 10; i++) {
+        int at = (i * 7919L) % tc->numrows;
+        editorRowInsertChar(tc, &tc->row[at], 0, 'd');
+        editorDiffUpdate(tc);
+    }
+    benchReport("diff after edit", BENCH_EDITS / 10, texNow() - start);
+    editorDiffSetBase(tc);
+}
+
+
+/*
+    Pipes every row through command and back into the buffer, sleeping on the pipes between pumps
+*/
+void benchFilterRun(texCore *tc, const char *name, const char *command) {
+    long start = texNow();
+    if (editorFilterStart(tc, command, 0, INT_MAX) == -1) {
+        perror("editorFilterStart");
+        return;
+    }
+    while (editorFilterPump(tc)) {
+        struct pollfd fds[3] = {
+            { tc->filter->inFd, POLLOUT, 0 },
+            { tc->filter->outFd, POLLIN, 0 },
+            { tc->filter->errFd, POLLIN, 0 }
+        };
+        int closed = (fds[0].fd == -1 && fds[1].fd == -1 && fds[2].fd == -1);
+        poll(fds, 3, closed ? 1 : 100);
+    }
+    int rows = tc->filter->added;
+    editorFilterFree(tc);
+    benchReport(name, rows, texNow() - start);
+}
+
+
+/*
+    Filters the whole buffer through cat, and through two commands at once, which leave it as
+    it was. Then sorts a copy of it, so the rows stay in order for the benchmarks after
+*/
+void benchFilter(texCore *tc) {
+    benchFilterRun(tc, "filter cat", "cat");
+    benchFilterRun(tc, "filter tac|tac", "tac | tac");
+
+    int len;
+    char *text = editorRowsToString(tc, &len);
+    texCore *copy = texCoreNew();
+    editorInsertLines(copy, 0, text, len > 0 ? len - 1 : 0);   // Without the last row's newline
+    free(text);
+    benchFilterRun(copy, "filter sort", "sort");
+    texCoreFree(copy);
+}
+
+
+/*
+    Pages a file in as a large file, then jumps to windows of rows spread through it, edits
+    them, searches the file, saves it, yanks most of it and filters it
+*/
+void benchLargeFile(char *path) {
+    texCore *tc = texCoreNew();
+
+    long start = texNow();
+    if (largeOpen(tc, path, BENCH_LARGE_BUDGET) == -1) {
+        perror("largeOpen");
+        texCoreFree(tc);
+        return;
+    }
+    while (largeProgress(tc) < 100)
+        usleep(100);
+    largeSync(tc, 0, 0);
+    benchReport("index lines", tc->numrows, texNow() - start);
+
+    // A screen of rows at each jump, freeing the last one as a client does between frames
+    start = texNow();
+    for (int i = 0; i < BENCH_LARGE_JUMPS; i++) {
+        int at = (i * 7919L) % tc->numrows;
+        largeSync(tc, at, at + 24);
+        for (int j = at; j < at + 24 && j < tc->numrows; j++)
+            editorRowAt(tc, j);
+    }
+    benchReport("page in rows", BENCH_LARGE_JUMPS * 24L, texNow() - start);
+
+    start = texNow();
+    for (int i = 0; i < BENCH_LARGE_JUMPS; i++) {
+        tc->cy = (i * 7919L) % tc->numrows;
+        tc->cx = 0;
+        largeSync(tc, tc->cy, tc->cy + 1);
+        editorInsertChar(tc, 'x');
+    }
+    benchReport("large edit", BENCH_LARGE_JUMPS, texNow() - start);
+
+    int ro;
+    start = texNow();
+    editorFindNext(tc, "zzzz", -1, 1, &ro);
+    benchReport("large find", 1, texNow() - start);
+
+    start = texNow();
+    if (editorWriteFile(tc) == -1)
+        perror("editorWriteFile");
+    benchReport("large write", 1, texNow() - start);
+
+    // All but the first and last rows, yanked as a run of the file's lines and pasted back
+    tc->cy = 1;
+    tc->cx = 0;
+    editorSelectStart(tc, SEL_LINEAR);
+    tc->cy = tc->numrows - 1;
+    start = texNow();
+    editorYank(tc);
+    benchReport("large yank", 1, texNow() - start);
+
+    editorSelectClear(tc);
+    tc->cy = 0;
+    start = texNow();
+    editorPasteYank(tc, editorYankAt(tc, 0));
+    benchReport("large paste", 1, texNow() - start);
+
+    benchFilterRun(tc, "large filter cat", "cat");
+    texCoreFree(tc);
+}
+
+
+/*
+    Saves the buffer compressed to a temporary .gz file, then decompresses it into a new buffer
+*/
+void benchGzip(texCore *tc) {
+    char path[] = "/tmp/texcoreXXXXXX.c.gz";
+    int fd = mkstemps(path, 5);
+    if (fd == -1) {
+        perror("mkstemps");
+        return;
+    }
+    close(fd);
+
+    char *name = tc->filename;
+    tc->filename = path;
+    long start = texNow();
+    for (int i = 0; i < 10; i++) {
+        if (editorWriteFile(tc) == -1)
+            perror("editorWriteFile");
+    }
+    benchReport("write gzip", 10, texNow() - start);
+    tc->filename = name;
+
+    start = texNow();
+    for (int i = 0; i < 10; i++) {
+        texCore *copy = texCoreNew();
+        if (editorOpen(copy, path) == -1)
+            perror("editorOpen");
+        texCoreFree(copy);
+    }
+    benchReport("open gzip", 10, texNow() - start);
+    unlink(path);
+}
+
+
+/*
+    Saves the buffer to a temporary file, then opens it again into a new buffer
+*/
+void benchFileIO(texCore *tc) {
+    char path[] = "/tmp/texcoreXXXXXX.c";
+    int fd = mkstemps(path, 2);
+    if (fd == -1) {
+        perror("mkstemps");
+        return;
+    }
+    close(fd);
+
+    int len;
+    long start = texNow();
+    for (int i = 0; i < 10; i++)
+        free(editorRowsToString(tc, &len));
+    benchReport("rows to string", 10, texNow() - start);
+
+    free(tc->filename);
+    tc->filename = strdup(path);
+    start = texNow();
+    for (int i = 0; i < 10; i++) {
+        if (editorWriteFile(tc) == -1)
+            perror("editorWriteFile");
+    }
+    benchReport("write file", 10, texNow() - start);
+
+    start = texNow();
+    for (int i = 0; i < 10; i++) {
+        texCore *copy = texCoreNew();
+        if (editorOpen(copy, path) == -1)
+            perror("editorOpen");
+        texCoreFree(copy);
+    }
+    benchReport("open file", 10, texNow() - start);
+
+    benchGzip(tc);
+
+    benchLargeFile(path);
+    unlink(path);
+}
+
+
+int main(int argc, char *argv[]) {
+    int lines = argc > 1 ? atoi(argv[1]) : BENCH_LINES;
+    if (lines < 8)
+        lines = 8;
+
+    texCore *tc = texCoreNew();
+    if (tc == NULL) {
+        perror("texCoreNew");
+        return EXIT_FAILURE;
+    }
+    printf("libtexcore microbenchmarks, %d lines\n", lines);
+
+    benchInsertRows(tc, lines);
+    benchUpdateRows(tc);
+    benchHighlight(tc);
+    benchMapIndex(tc);
+    benchEditChars(tc);
+    benchEditRows(tc);
+    benchMultiCursor(tc);
+    benchSelection(tc);
+    benchFind(tc);
+    benchLayout(tc);
+    benchStructure(tc);
+    benchOverview(tc);
+    benchDiff(tc);
+    benchFilter(tc);
+    benchFileIO(tc);
+
+    texCoreFree(tc);
+    return 0;
+}
@@ -0,0 +1,273 @@
+#include "texcore.h"
+
+
+/*--------------------------------------------------------------------------
+                                 CONTEXT
+--------------------------------------------------------------------------*/
+
+texCore *texCoreNew() {
+    texCore *tc = malloc(sizeof(texCore));
+    if (tc == NULL)
+        return NULL;
+
+    // Cursor at the top left of an empty, unnamed buffer
+    tc->cx = 0;
+    tc->cy = 0;
+    tc->numrows = 0;
+    tc->row = NULL;
+    tc->dirty = 0;
+    tc->filename = NULL;
+
+    tc->syntax = NULL;      // No current filetype, no highlighting
+    tc->hlUpTo = 0;         // No rows highlighted yet
+    tc->hlScratch = NULL;
+    tc->hlScratchCap = 0;
+    tc->hlDeferred = 0;
+    tc->hlLast = -1;
+
+    // No wrap width until the client sets one, layout is built when it's first needed
+    tc->wrapCols = 0;
+    tc->wrapTree = NULL;
+    tc->wrapSize = 0;
+    tc->wrapValid = 0;
+
+    // No bracket tree until a bracket is matched, and nothing folded
+    tc->brTree = NULL;
+    tc->brSize = 0;
+    tc->brValid = 0;
+    tc->brBuilt = 0;
+    tc->numFolds = 0;
+
+    // Overview tree is built when it's first drawn
+    tc->ovTree = NULL;
+    tc->ovSize = 0;
+    tc->ovValid = 0;
+
+    // Nothing on disk to differ from until a file is opened
+    tc->diskHash = NULL;
+    tc->numDisk = 0;
+    tc->diskCap = 0;
+    tc->hunks = NULL;
+    tc->numHunks = 0;
+    tc->hunksCap = 0;
+    tc->diffDirty = 0;
+    tc->diffLo = 0;
+    tc->diffHi = 0;
+    tc->diffShift = 0;
+    tc->diffAll = 0;
+    memset(&tc->changes, 0, sizeof(tc->changes));
+
+    tc->large = NULL;   // Loaded into memory until a file is paged instead
+    tc->load = NULL;
+    tc->filter = NULL;
+    tc->gzip = 0;
+    tc->loading = 0;
+
+    tc->cursors = NULL;     // Just the one cursor at cx, cy
+    tc->numCursors = 0;
+    tc->cursorsCap = 0;
+    tc->selMode = SEL_NONE;
+    tc->selCx = 0;
+    tc->selCy = 0;
+    memset(tc->yanks, 0, sizeof(tc->yanks));    // Empty yank ring
+    tc->numYanks = 0;
+    tc->yankNext = 0;
+
+    tc->hlTime = 0;
+    tc->allocs = 0;
+    tc->outOfMemory = NULL;
+    return tc;
+}
+
+
+void texCoreFree(texCore *tc) {
+    if (tc->load)
+        editorLoadDone(tc);
+    editorFilterFree(tc);
+    if (tc->large) {
+        largeFree(tc);
+    } else {
+        for (int j = 0; j < tc->numrows; j++)
+            editorFreeRow(&tc->row[j]);
+    }
+    free(tc->row);
+    free(tc->filename);
+    free(tc->hlScratch);
+    free(tc->wrapTree);
+    free(tc->brTree);
+    free(tc->ovTree);
+    free(tc->diskHash);
+    free(tc->hunks);
+    free(tc->cursors);
+    for (int i = 0; i < TEX_YANK_RING; i++)
+        editorYankFree(&tc->yanks[i]);
+    free(tc);
+}
+
+
+void texOutOfMemory(texCore *tc, size_t size) {
+    // The client gets to clean up and exit, there's no way on from a failed allocation
+    if (tc->outOfMemory)
+        tc->outOfMemory(tc, size);
+    abort();
+}
+
+
+void *texAlloc(texCore *tc, size_t size) {
+    void *p = malloc(size);
+    if (p == NULL && size > 0)
+        texOutOfMemory(tc, size);
+    tc->allocs++;
+    return p;
+}
+
+
+void *texRealloc(texCore *tc, void *ptr, size_t size) {
+    void *p = realloc(ptr, size);
+    if (p == NULL && size > 0)
+        texOutOfMemory(tc, size);
+    tc->allocs++;
+    return p;
+}
+
+
+long texNow() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+
+/*--------------------------------------------------------------------------
+                            EDITOR OPERATIONS
+--------------------------------------------------------------------------*/
+
+void editorInsertChar(texCore *tc, int c) {
+    if (tc->numCursors) {
+        editorCursorsInsertChar(tc, c);
+        return;
+    }
+
+    // Cursor is on the tilde line after EOF
+    if (tc->cy == tc->numrows)
+        editorInsertRow(tc, tc->numrows, "", 0); // Append new row to file before inserting char
+    
+    editorRowInsertChar(tc, editorRowAt(tc, tc->cy), tc->cx, c);
+    tc->cx++; // Increment cursor after inserted char
+}
+
+
+void editorInsertNewLine(texCore *tc){
+    if (tc->numCursors) {
+        editorCursorsInsertNewLine(tc);
+        return;
+    }
+
+    // If cursor is at begining of line, insert a new black row before that current line
+    if (tc->cx == 0) {
+        editorInsertRow(tc, tc->cy, "", 0);
+    } else {
+        // Split the current line into two rows
+        erow *row = editorRowAt(tc, tc->cy);
+        // Create a new row after the current one, with the correct contents
+        editorInsertRow(tc, tc->cy + 1, &row->chars[tc->cx], row->size - tc->cx);
+
+        row = editorRowAt(tc, tc->cy); // Reassign row ptr, since editorInsertRow() calls realloc()
+        row->size = tc->cx;   // Truncate row, set size to cursor pos
+        row->chars[row->size] = '\0';   // Add NULL terminator
+        editorUpdateRow(tc, row);   // Update the new row
+        editorRowEdited(tc, row);
+    }
+    // Move cursor to the start of the new line
+    tc->cy++;
+    tc->cx = 0;
+}
+
+
+void editorDelChar(texCore *tc) {
+    if (tc->numCursors) {
+        editorCursorsDelChar(tc);
+        return;
+    }
+
+    // Return if cursor is past EOF
+    if (tc->cy == tc->numrows)
+        return;
+        
+    // If cursor is at top left corner, there's nothing to delete, return
+    if (tc->cx == 0 && tc->cy == 0)
+        return;
+    
+    erow *row = editorRowAt(tc, tc->cy);
+
+    if (tc->cx > 0) {
+        tc->cx = editorRowPrevCx(row, tc->cx);
+        editorRowDelChar(tc, row, tc->cx);
+    } else {
+        /*
+            Set cx to the end of the contents of the previous row so the cursor ends
+            up where the two lines joined up
+        */
+        erow *prev = editorRowAt(tc, tc->cy - 1);
+        tc->cx = prev->size;
+        // Append the current row to the previous row
+        editorRowAppendString(tc, prev, row->chars, row->size);
+        editorDelRow(tc, tc->cy); // Delete the row being pointed to
+        tc->cy--;
+    }
+}
+
+
+void editorInsertText(texCore *tc, const char *s, long long len) {
+    if (len == 0)
+        return;
+
+    // Cursor is on the tilde line after EOF
+    if (tc->cy == tc->numrows)
+        editorInsertRow(tc, tc->numrows, "", 0);
+
+    erow *row = editorRowAt(tc, tc->cy);
+    int tailLen = row->size - tc->cx;
+    const char *nl = memchr(s, '\n', len);
+
+    // Text without a newline goes into the row in one copy
+    if (nl == NULL) {
+        row->chars = texRealloc(tc, row->chars, row->size + len + 1);
+        memmove(&row->chars[tc->cx + len], &row->chars[tc->cx], tailLen + 1);
+        memcpy(&row->chars[tc->cx], s, len);
+        row->size += len;
+        editorUpdateRow(tc, row);
+        editorRowEdited(tc, row);
+        tc->cx += len;
+        return;
+    }
+
+    // Otherwise the row is split, the first line ends it and the rest of it ends the last line
+    char *tail = texAlloc(tc, tailLen + 1);
+    memcpy(tail, &row->chars[tc->cx], tailLen + 1);
+    tc->hlDeferred = 1;
+
+    row->chars = texRealloc(tc, row->chars, tc->cx + (nl - s) + 1);
+    memcpy(&row->chars[tc->cx], s, nl - s);
+    row->size = tc->cx + (nl - s);
+    row->chars[row->size] = '\0';
+    editorUpdateRow(tc, row);
+    editorRowEdited(tc, row);
+
+    int before = tc->numrows;
+    editorInsertLines(tc, tc->cy + 1, nl + 1, s + len - (nl + 1));
+    int n = tc->numrows - before;
+
+    row = editorRowAt(tc, tc->cy + n);
+    tc->cx = row->size;
+    row->chars = texRealloc(tc, row->chars, row->size + tailLen + 1);
+    memcpy(&row->chars[row->size], tail, tailLen + 1);
+    row->size += tailLen;
+    free(tail);
+    editorUpdateRow(tc, row);
+    editorRowEdited(tc, row);
+
+    tc->hlDeferred = 0;
+    editorHighlightRange(tc, tc->cy, tc->cy + n);
+    tc->cy += n;
+}
@@ -0,0 +1,411 @@
+#include "texcore.h"
+
+
+/*--------------------------------------------------------------------------
+                            MULTIPLE CURSORS
+--------------------------------------------------------------------------*/
+
+int editorCursorCmp(const void *a, const void *b) {
+    const texCursor *x = a;
+    const texCursor *y = b;
+    if (x->cy != y->cy)
+        return x->cy < y->cy ? -1 : 1;
+    return x->cx < y->cx ? -1 : x->cx > y->cx;
+}
+
+
+int editorAddCursor(texCore *tc, int cy, int cx) {
+    // Every cursor's row has to be in memory at once
+    if (tc->large)
+        return -1;
+
+    if (tc->numCursors == tc->cursorsCap) {
+        tc->cursorsCap = tc->cursorsCap ? tc->cursorsCap * 2 : 16;
+        tc->cursors = texRealloc(tc, tc->cursors, sizeof(texCursor) * tc->cursorsCap);
+    }
+    tc->cursors[tc->numCursors].cx = cx;
+    tc->cursors[tc->numCursors].cy = cy;
+    tc->numCursors++;
+    return 0;
+}
+
+
+void editorClearCursors(texCore *tc) {
+    tc->numCursors = 0;
+}
+
+
+void editorNormalizeCursors(texCore *tc) {
+    texCursor primary = { tc->cx, tc->cy };
+    int sorted = 1;
+
+    for (int i = 0; i < tc->numCursors; i++) {
+        texCursor *c = &tc->cursors[i];
+        if (c->cy < 0)
+            c->cy = 0;
+        if (c->cy > tc->numrows)
+            c->cy = tc->numrows;
+        int size = c->cy < tc->numrows ? tc->row[c->cy].size : 0;
+        if (c->cx < 0)
+            c->cx = 0;
+        if (c->cx > size)
+            c->cx = size;
+        if (i > 0 && editorCursorCmp(&tc->cursors[i - 1], c) > 0)
+            sorted = 0;
+    }
+    // Edits keep cursors in order, so this is only needed after cursors are added
+    if (!sorted)
+        qsort(tc->cursors, tc->numCursors, sizeof(texCursor), editorCursorCmp);
+
+    // Cursors that ran into each other, or into the primary one, become one cursor
+    int n = 0;
+    for (int i = 0; i < tc->numCursors; i++) {
+        texCursor *c = &tc->cursors[i];
+        if (editorCursorCmp(c, &primary) == 0 || (n > 0 && editorCursorCmp(c, &tc->cursors[n - 1]) == 0))
+            continue;
+        tc->cursors[n++] = *c;
+    }
+    tc->numCursors = n;
+}
+
+
+int editorAddCursorsAtMatches(texCore *tc, const char *query) {
+    if (tc->large)
+        return -1;
+
+    int added = 0;
+    int len = strlen(query);
+    if (len == 0)
+        return 0;
+
+    for (int i = 0; i < tc->numrows; i++) {
+        erow *row = &tc->row[i];
+        char *match = row->render;
+        while ((match = strstr(match, query)) != NULL) {
+            editorAddCursor(tc, i, editorRowRoToCx(row, match - row->render));
+            added++;
+            match += len;
+        }
+    }
+    editorNormalizeCursors(tc);
+    return added;
+}
+
+
+int editorFirstCursorOnRow(texCore *tc, int at) {
+    int lo = 0;
+    int hi = tc->numCursors;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (tc->cursors[mid].cy < at)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+
+texCursor *editorGatherCursors(texCore *tc, int *n, int *primary) {
+    editorNormalizeCursors(tc);
+
+    // The extra cursors are sorted, so the primary one only has to be slotted in
+    texCursor cursor = { tc->cx, tc->cy };
+    int at = 0;
+    while (at < tc->numCursors && editorCursorCmp(&tc->cursors[at], &cursor) < 0)
+        at++;
+
+    texCursor *all = texAlloc(tc, sizeof(texCursor) * (tc->numCursors + 1));
+    memcpy(all, tc->cursors, sizeof(texCursor) * at);
+    all[at] = cursor;
+    memcpy(&all[at + 1], &tc->cursors[at], sizeof(texCursor) * (tc->numCursors - at));
+
+    *n = tc->numCursors + 1;
+    *primary = at;
+    return all;
+}
+
+
+void editorScatterCursors(texCore *tc, texCursor *all, int n, int primary) {
+    tc->cx = all[primary].cx;
+    tc->cy = all[primary].cy;
+
+    memcpy(tc->cursors, all, sizeof(texCursor) * primary);
+    memcpy(&tc->cursors[primary], &all[primary + 1], sizeof(texCursor) * (n - primary - 1));
+    tc->numCursors = n - 1;
+    free(all);
+    editorNormalizeCursors(tc);
+}
+
+
+void editorHighlightTouched(texCore *tc, int *rows, int n) {
+    // Too many to do on a keystroke, the client highlights them as they're drawn and between keys
+    if (n > TEX_HL_TOUCHED) {
+        if (rows[0] < tc->hlUpTo)
+            tc->hlUpTo = rows[0];
+        return;
+    }
+
+    long start = texNow();
+    int done = -1;  // Rows up to here are already highlighted, by a comment cascading down to them
+
+    for (int i = 0; i < n && rows[i] < tc->hlUpTo; i++) {
+        if (rows[i] <= done)
+            continue;
+        editorUpdateSyntax(tc, &tc->row[rows[i]]);
+        done = tc->hlLast;
+    }
+    tc->hlTime += texNow() - start;
+}
+
+
+void editorCursorsInsertChar(texCore *tc, int c) {
+    int n, primary;
+    texCursor *all = editorGatherCursors(tc, &n, &primary);
+
+    // A cursor on the tilde line after EOF types onto a new row
+    if (all[n - 1].cy == tc->numrows)
+        editorInsertRow(tc, tc->numrows, "", 0);
+
+    int *touched = texAlloc(tc, sizeof(int) * n);
+    int numTouched = 0;
+    tc->hlDeferred = 1;
+
+    // Rebuild each row once with the char typed at every cursor in it
+    int i = 0;
+    while (i < n) {
+        erow *row = &tc->row[all[i].cy];
+        int j = i;
+        while (j < n && all[j].cy == all[i].cy)
+            j++;
+
+        char *chars = texAlloc(tc, row->size + (j - i) + 1);
+        int from = 0;
+        int len = 0;
+        for (int k = i; k < j; k++) {
+            memcpy(&chars[len], &row->chars[from], all[k].cx - from);
+            len += all[k].cx - from;
+            from = all[k].cx;
+            chars[len++] = c;
+            all[k].cx = len;
+        }
+        memcpy(&chars[len], &row->chars[from], row->size - from + 1);
+
+        free(row->chars);
+        row->chars = chars;
+        row->size += j - i;
+        editorUpdateRow(tc, row);
+        editorRowEdited(tc, row);
+        touched[numTouched++] = row->idx;
+        i = j;
+    }
+
+    tc->hlDeferred = 0;
+    editorHighlightTouched(tc, touched, numTouched);
+    free(touched);
+    editorScatterCursors(tc, all, n, primary);
+}
+
+
+void editorCursorsInsertNewLine(texCore *tc) {
+    int n, primary;
+    texCursor *all = editorGatherCursors(tc, &n, &primary);
+    int tilde = (all[n - 1].cy == tc->numrows);
+    int spanEnd = all[n - 1].cy + 1 - tilde;
+
+    // Rows are moved around wholesale, folds are shown rather than followed
+    editorUnfoldAll(tc);
+
+    // Every row is copied across once, with the rows split at cursors made in place
+    erow *rows = texAlloc(tc, sizeof(erow) * (tc->numrows + n));
+    int *touched = texAlloc(tc, sizeof(int) * n * 2);
+    int numTouched = 0;
+    int hlUpTo = -1;
+    int w = 0;
+    int i = 0;
+    tc->hlDeferred = 1;
+    editorLayoutInvalidate(tc);
+    editorBracketsInvalidate(tc);
+    editorOverviewInvalidate(tc);
+    editorDiffSpan(tc, all[0].cy, spanEnd, spanEnd + n);
+    editorViewsSpan(tc, all[0].cy, spanEnd, spanEnd + n);
+
+    for (int r = 0; r < tc->numrows; r++) {
+        if (r == tc->hlUpTo)
+            hlUpTo = w;
+
+        erow *row = &tc->row[r];
+        int j = i;
+        while (j < n && all[j].cy == r)
+            j++;
+
+        rows[w] = *row;
+        rows[w].idx = w;
+        if (j == i) {
+            w++;
+            continue;
+        }
+
+        // The text after each cursor becomes a new row, and the cursor moves to its start
+        int first = w;
+        int cut = all[i].cx;
+        for (int k = i; k < j; k++) {
+            int end = k + 1 < j ? all[k + 1].cx : row->size;
+            w++;
+            editorInitRow(tc, &rows[w], w, &row->chars[all[k].cx], end - all[k].cx);
+            all[k].cy = w;
+            all[k].cx = 0;
+        }
+        // The last part ends the way the row below it was highlighted for
+        rows[w].hl_open_comment = row->hl_open_comment;
+        w++;
+
+        rows[first].size = cut;
+        rows[first].chars[cut] = '\0';
+        editorUpdateRow(tc, &rows[first]);
+        editorRowEdited(tc, &rows[first]);
+        for (int k = first; k < w; k++)
+            touched[numTouched++] = k;
+        i = j;
+    }
+
+    // A cursor on the tilde line adds one empty row, like Enter there with a single cursor
+    if (tilde) {
+        editorInitRow(tc, &rows[w], w, "", 0);
+        touched[numTouched++] = w;
+        w++;
+        all[n - 1].cy = w;
+    }
+
+    free(tc->row);
+    tc->row = rows;
+    tc->numrows = w;
+    tc->hlUpTo = hlUpTo == -1 ? w : hlUpTo;
+
+    tc->hlDeferred = 0;
+    editorHighlightTouched(tc, touched, numTouched);
+    free(touched);
+    editorScatterCursors(tc, all, n, primary);
+}
+
+
+void editorCursorsDelChar(texCore *tc) {
+    int n, primary;
+    texCursor *all = editorGatherCursors(tc, &n, &primary);
+    int *touched = texAlloc(tc, sizeof(int) * n);
+    int numTouched = 0;
+    editorUnfoldAll(tc);
+
+    // Cursors at the start of a row join it onto the one above, rather than deleting a char
+    char *joins = texAlloc(tc, n);
+    for (int k = 0; k < n; k++)
+        joins[k] = (all[k].cx == 0 && all[k].cy > 0 && all[k].cy < tc->numrows);
+
+    // Rows from the one above the first cursor to the last one with a cursor are changed
+    int spanFirst = all[0].cy > 0 ? all[0].cy - 1 : 0;
+    int spanEnd = spanFirst;
+    for (int k = 0; k < n && all[k].cy < tc->numrows; k++)
+        spanEnd = all[k].cy + 1;
+
+    // Delete the char before every cursor that isn't at the start of its row, a row at a time
+    int i = 0;
+    while (i < n && all[i].cy < tc->numrows) {
+        erow *row = &tc->row[all[i].cy];
+        int j = i;
+        while (j < n && all[j].cy == all[i].cy)
+            j++;
+
+        char *chars = texAlloc(tc, row->size + 1);
+        int from = 0;
+        int len = 0;
+        for (int k = i; k < j; k++) {
+            if (joins[k] || all[k].cx == 0)
+                continue;
+            int prev = editorRowPrevCx(row, all[k].cx);
+            if (prev < from)
+                prev = from;
+            memcpy(&chars[len], &row->chars[from], prev - from);
+            len += prev - from;
+            from = all[k].cx;
+            all[k].cx = len;
+        }
+        memcpy(&chars[len], &row->chars[from], row->size - from + 1);
+        len += row->size - from;
+
+        // The render is rebuilt once the rows are joined too
+        free(row->chars);
+        row->chars = chars;
+        row->size = len;
+        i = j;
+    }
+
+    // Join every row with a cursor at its start onto the row above, compacting the rows as it goes
+    int hlUpTo = -1;
+    int joined = 0;
+    int w = 0;
+    i = 0;
+    for (int r = 0; r < tc->numrows; r++) {
+        if (r == tc->hlUpTo)
+            hlUpTo = w;
+
+        erow *row = &tc->row[r];
+        int j = i;
+        while (j < n && all[j].cy == r)
+            j++;
+
+        if (j > i && joins[i]) {
+            erow *prev = &tc->row[w - 1];
+            int offset = prev->size;
+            prev->chars = texRealloc(tc, prev->chars, prev->size + row->size + 1);
+            memcpy(&prev->chars[prev->size], row->chars, row->size + 1);
+            prev->size += row->size;
+            // The row below the joined ones was highlighted following the lower of them
+            prev->hl_open_comment = row->hl_open_comment;
+            for (int k = i; k < j; k++) {
+                all[k].cy = w - 1;
+                all[k].cx += offset;
+            }
+            editorFreeRow(row);
+            joined++;
+        } else {
+            if (w != r) {
+                tc->row[w] = *row;
+                tc->row[w].idx = w;
+            }
+            for (int k = i; k < j; k++)
+                all[k].cy = w;
+            w++;
+        }
+        i = j;
+    }
+
+    free(joins);
+    editorDiffSpan(tc, spanFirst, spanEnd, spanEnd - joined);
+    editorViewsSpan(tc, spanFirst, spanEnd, spanEnd - joined);
+    if (joined) {
+        tc->numrows = w;
+        editorLayoutInvalidate(tc);
+        editorBracketsInvalidate(tc);
+        editorOverviewInvalidate(tc);
+    }
+    if (hlUpTo != -1)
+        tc->hlUpTo = hlUpTo;
+    else if (tc->hlUpTo > tc->numrows)
+        tc->hlUpTo = tc->numrows;
+
+    // Render each changed row once, now that it has all of its text
+    tc->hlDeferred = 1;
+    for (i = 0; i < n && all[i].cy < tc->numrows; i++) {
+        if (numTouched > 0 && touched[numTouched - 1] == all[i].cy)
+            continue;
+        erow *row = &tc->row[all[i].cy];
+        editorUpdateRow(tc, row);
+        editorRowEdited(tc, row);
+        touched[numTouched++] = all[i].cy;
+    }
+    tc->hlDeferred = 0;
+
+    editorHighlightTouched(tc, touched, numTouched);
+    free(touched);
+    editorScatterCursors(tc, all, n, primary);
+}
@@ -0,0 +1,533 @@
+#include "texcore.h"
+
+
+/*--------------------------------------------------------------------------
+                                   DIFF
+--------------------------------------------------------------------------*/
+
+unsigned long long editorHashLine(const char *s, int len) {
+    unsigned long long hash = TEX_HASH_SEED;
+    unsigned long long word;
+
+    // FNV-1a's xor and multiply a word at a time, with the high bits folded down to mix them in
+    for (; len >= 8; s += 8, len -= 8) {
+        memcpy(&word, s, 8);
+        hash = (hash ^ word) * TEX_HASH_PRIME;
+        hash ^= hash >> 32;
+    }
+    // The last few bytes along with the length, so a line ending in NULs differs from a shorter one
+    word = 0;
+    memcpy(&word, s, len);
+    hash = (hash ^ word ^ ((unsigned long long) len << 56)) * TEX_HASH_PRIME;
+    return hash ^ (hash >> 32);
+}
+
+
+void editorDiffAddBase(texCore *tc, unsigned long long hash) {
+    if (tc->numDisk == tc->diskCap) {
+        tc->diskCap = tc->diskCap ? tc->diskCap * 2 : 1024;
+        tc->diskHash = texRealloc(tc, tc->diskHash, sizeof(unsigned long long) * tc->diskCap);
+    }
+    tc->diskHash[tc->numDisk++] = hash;
+}
+
+
+void editorDiffSetBase(texCore *tc) {
+    tc->numDisk = 0;
+    for (int r = 0; r < tc->numrows && tc->large == NULL; r++)
+        editorDiffAddBase(tc, tc->row[r].hash);
+
+    // The rows are the file now, so nothing differs
+    tc->numHunks = 0;
+    tc->diffDirty = 0;
+    tc->diffAll = 0;
+}
+
+
+int editorDiffReadBase(texCore *tc) {
+    // Lines still being loaded are added to the file on disk as they come
+    if (tc->large || tc->load || tc->filename == NULL)
+        return -1;
+    int fd = open(tc->filename, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return -1;
+
+    texGzip *gz = NULL;
+    unsigned char magic[2];
+    if (pread(fd, magic, 2, 0) == 2 && magic[0] == 0x1f && magic[1] == 0x8b && (gz = gzipOpen(fd)) == NULL) {
+        close(fd);
+        return -1;
+    }
+
+    // Split into lines the way the loader splits the file into rows, carrying a partial line over
+    int cap = TEX_LOAD_SLICE * 2;
+    char *buf = texAlloc(tc, cap);
+    int len = 0;
+    int ok = 1;
+    tc->numDisk = 0;
+
+    while (1) {
+        if (len + TEX_LOAD_SLICE > cap) {
+            cap = (len + TEX_LOAD_SLICE) * 2;
+            buf = texRealloc(tc, buf, cap);
+        }
+        ssize_t n;
+        do {
+            n = gz ? gzipRead(gz, &buf[len], TEX_LOAD_SLICE) : read(fd, &buf[len], TEX_LOAD_SLICE);
+        } while (n == -1 && errno == EINTR);
+        if (n == -1) {
+            ok = 0;
+            break;
+        }
+        if (n == 0) {
+            // Last line of the file has no newline
+            while (len > 0 && buf[len - 1] == '\r')
+                len--;
+            if (len > 0)
+                editorDiffAddBase(tc, editorHashLine(buf, len));
+            break;
+        }
+
+        char *p = buf;
+        char *end = &buf[len + n];
+        char *nl;
+        while ((nl = memchr(p, '\n', end - p)) != NULL) {
+            int lineLen = nl - p;
+            while (lineLen > 0 && p[lineLen - 1] == '\r')
+                lineLen--;
+            editorDiffAddBase(tc, editorHashLine(p, lineLen));
+            p = nl + 1;
+        }
+        len = end - p;
+        memmove(buf, p, len);
+    }
+
+    free(buf);
+    gzipClose(gz);
+    close(fd);
+    editorDiffInvalidate(tc);
+    return ok ? 0 : -1;
+}
+
+
+void editorDiffInvalidate(texCore *tc) {
+    tc->diffAll = 1;
+}
+
+
+void editorDiffSpan(texCore *tc, int first, int oldEnd, int newEnd) {
+    if (tc->large || tc->loading || tc->diffAll)
+        return;
+
+    if (!tc->diffDirty) {
+        tc->diffLo = first;
+        tc->diffHi = newEnd;
+        tc->diffShift = newEnd - oldEnd;
+        tc->diffDirty = 1;
+        return;
+    }
+
+    // Rows from the end of the span on move with it, and it's never cut off from the rows already dirty
+    int moved = newEnd - oldEnd;
+    if (first < tc->diffLo)
+        tc->diffLo = first;
+    tc->diffHi = tc->diffHi + moved > newEnd ? tc->diffHi + moved : newEnd;
+    tc->diffShift += moved;
+}
+
+
+void editorDiffAddHunk(texCore *tc, texDiffHunk **hunks, int *num, int *cap, int base, int baseCount, int row, int rowCount) {
+    if (*num == *cap) {
+        *cap = *cap ? *cap * 2 : 16;
+        *hunks = texRealloc(tc, *hunks, sizeof(texDiffHunk) * *cap);
+    }
+    texDiffHunk *h = &(*hunks)[(*num)++];
+    h->base = base;
+    h->baseCount = baseCount;
+    h->row = row;
+    h->rowCount = rowCount;
+}
+
+
+int editorDiffMyers(texCore *tc, int a0, int a1, int b0, int b1, texDiffHunk **hunks, int *num, int *cap) {
+    unsigned long long *a = tc->diskHash;
+    int n = a1 - a0, m = b1 - b0;
+    int max = n + m < TEX_DIFF_MAX_D ? n + m : TEX_DIFF_MAX_D;
+
+    // The furthest x reached on each diagonal k = x - y after d edits, kept for every d to walk back
+    int *v = texAlloc(tc, sizeof(int) * (2 * max + 3));
+    int *trace = texAlloc(tc, sizeof(int) * (max + 1) * (max + 2) / 2);
+    int *end = v + max + 1;
+    int used = 0;
+    int found = -1;
+    end[1] = 0;
+
+    for (int d = 0; d <= max && found == -1; d++) {
+        for (int k = -d; k <= d; k += 2) {
+            // Down from the diagonal above, an insert, or right from the one below, a delete
+            int x = (k == -d || (k != d && end[k - 1] < end[k + 1])) ? end[k + 1] : end[k - 1] + 1;
+            int y = x - k;
+            while (x < n && y < m && a[a0 + x] == tc->row[b0 + y].hash) {
+                x++;
+                y++;
+            }
+            end[k] = x;
+            if (x >= n && y >= m) {
+                found = d;
+                break;
+            }
+        }
+        // Diagonals -d to d, every other one
+        for (int k = -d; k <= d; k += 2)
+            trace[used++] = end[k];
+    }
+
+    if (found == -1) {
+        free(v);
+        free(trace);
+        return 0;
+    }
+
+    // Walk back from the end, one edit per d, emitting each as a one line hunk
+    int x = n, y = m;
+    for (int d = found; d > 0; d--) {
+        int *prev = &trace[(d - 1) * d / 2];    // The d diagonals from 1 - d, after the 1 + 2 + ... + d - 1 before them
+        int k = x - y;
+        int down = (k == -d || (k != d && prev[(k - 1 + d - 1) / 2] < prev[(k + 1 + d - 1) / 2]));
+        int pk = down ? k + 1 : k - 1;
+        int px = prev[(pk + d - 1) / 2];
+        int py = px - pk;
+        if (down)
+            editorDiffAddHunk(tc, hunks, num, cap, a0 + px, 0, b0 + py, 1);
+        else
+            editorDiffAddHunk(tc, hunks, num, cap, a0 + px, 1, b0 + py, 0);
+        x = px;
+        y = py;
+    }
+    free(v);
+    free(trace);
+    return 1;
+}
+
+
+int editorDiffCompare(const void *a, const void *b) {
+    const texDiffHunk *x = a, *y = b;
+    if (x->row != y->row)
+        return x->row < y->row ? -1 : 1;
+    return x->base < y->base ? -1 : x->base > y->base;
+}
+
+
+int editorDiffRegion(texCore *tc, int a0, int a1, int b0, int b1, texDiffHunk **hunks, int *cap) {
+    unsigned long long *a = tc->diskHash;
+    int num = 0;
+
+    // Regions left to diff, each split at lines rare in both until it's small enough for Myers
+    int stackCap = 16;
+    int depth = 0;
+    int *stack = texAlloc(tc, sizeof(int) * 4 * stackCap);
+    stack[0] = a0;
+    stack[1] = a1;
+    stack[2] = b0;
+    stack[3] = b1;
+    depth = 1;
+
+    int tableCap = 0;
+    int *table = NULL;  // The first index in a of each line, then how often a and the rows have it
+    int scratchCap = 0;
+    int *scratch = NULL;
+    while (depth > 0) {
+        depth--;
+        a0 = stack[4 * depth];
+        a1 = stack[4 * depth + 1];
+        b0 = stack[4 * depth + 2];
+        b1 = stack[4 * depth + 3];
+
+        // Lines the same at either end aren't part of the difference
+        while (a0 < a1 && b0 < b1 && a[a0] == tc->row[b0].hash) {
+            a0++;
+            b0++;
+        }
+        while (a0 < a1 && b0 < b1 && a[a1 - 1] == tc->row[b1 - 1].hash) {
+            a1--;
+            b1--;
+        }
+        if (a0 == a1 || b0 == b1) {
+            if (a0 < a1 || b0 < b1)
+                editorDiffAddHunk(tc, hunks, &num, cap, a0, a1 - a0, b0, b1 - b0);
+            continue;
+        }
+        if ((a1 - a0) + (b1 - b0) <= TEX_DIFF_MYERS_ROWS && editorDiffMyers(tc, a0, a1, b0, b1, hunks, &num, cap))
+            continue;
+
+        // Count each line of a and how often the rows have it too, in an open addressed table
+        int size = 1;
+        while (size < 2 * (a1 - a0))
+            size *= 2;
+        if (size > tableCap) {
+            tableCap = size;
+            table = texRealloc(tc, table, sizeof(int) * 3 * tableCap);
+        }
+        if (5 * (b1 - b0) > scratchCap) {
+            scratchCap = 5 * (b1 - b0);
+            scratch = texRealloc(tc, scratch, sizeof(int) * scratchCap);
+        }
+        for (int i = 0; i < size; i++)
+            table[3 * i] = -1;
+        for (int i = a0; i < a1; i++) {
+            int slot = a[i] & (size - 1);
+            while (table[3 * slot] != -1 && a[table[3 * slot]] != a[i])
+                slot = (slot + 1) & (size - 1);
+            if (table[3 * slot] == -1) {
+                table[3 * slot] = i;
+                table[3 * slot + 1] = 0;
+                table[3 * slot + 2] = 0;
+            }
+            table[3 * slot + 1]++;
+        }
+        int *slots = scratch;   // Each row's slot, or -1 when a doesn't have its line
+        for (int j = b0; j < b1; j++) {
+            int slot = tc->row[j].hash & (size - 1);
+            while (table[3 * slot] != -1 && a[table[3 * slot]] != tc->row[j].hash)
+                slot = (slot + 1) & (size - 1);
+            slots[j - b0] = table[3 * slot] == -1 ? -1 : slot;
+            if (slots[j - b0] != -1)
+                table[3 * slot + 2]++;
+        }
+
+        /*
+            Lines once on both sides that stay in the same order on both are matched up all at
+            once, as patience diff does, by the longest increasing run of their places in a
+        */
+        int *candB = scratch + (b1 - b0);
+        int *tails = candB + (b1 - b0);
+        int *prev = tails + (b1 - b0);
+        int *chain = prev + (b1 - b0);
+        int numCand = 0, runLen = 0;
+        for (int j = b0; j < b1; j++) {
+            int slot = slots[j - b0];
+            if (slot == -1 || table[3 * slot + 1] != 1 || table[3 * slot + 2] != 1)
+                continue;
+            int at = table[3 * slot];
+            int l = 0, r = runLen;
+            while (l < r) {
+                int mid = (l + r) / 2;
+                if (table[3 * slots[candB[tails[mid]] - b0]] < at)
+                    l = mid + 1;
+                else
+                    r = mid;
+            }
+            candB[numCand] = j;
+            prev[numCand] = l > 0 ? tails[l - 1] : -1;
+            tails[l] = numCand++;
+            if (l == runLen)
+                runLen++;
+        }
+
+        if (runLen > 0) {
+            // The regions between matched lines are diffed alone, they're trimmed as they're taken
+            int k = runLen;
+            for (int c = tails[runLen - 1]; c != -1; c = prev[c])
+                chain[--k] = candB[c];
+            if (depth + runLen + 1 > stackCap) {
+                stackCap = (depth + runLen + 1) * 2;
+                stack = texRealloc(tc, stack, sizeof(int) * 4 * stackCap);
+            }
+            int pa = a0, pb = b0;
+            for (k = 0; k <= runLen; k++) {
+                int ea = k < runLen ? table[3 * slots[chain[k] - b0]] : a1;
+                int eb = k < runLen ? chain[k] : b1;
+                int part[4] = { pa, ea, pb, eb };
+                memcpy(&stack[4 * depth++], part, sizeof(part));
+                pa = ea + 1;
+                pb = eb + 1;
+            }
+            continue;
+        }
+
+        // Histogram, of the rows rarest in a, the one nearest the middle so the regions either side stay even
+        int bestA = -1, bestB = -1, bestCount = INT_MAX;
+        int middle = (b0 + b1) / 2;
+        for (int j = b0; j < b1; j++) {
+            int slot = slots[j - b0];
+            if (slot == -1)
+                continue;
+            int count = table[3 * slot + 1];
+            if (count < bestCount || (count == bestCount && abs(j - middle) < abs(bestB - middle))) {
+                bestCount = count;
+                bestA = table[3 * slot];
+                bestB = j;
+            }
+        }
+
+        // Nothing in common is one change, and a small region of only common lines is left to Myers
+        if (bestA == -1) {
+            editorDiffAddHunk(tc, hunks, &num, cap, a0, a1 - a0, b0, b1 - b0);
+            continue;
+        }
+        if (bestCount > TEX_DIFF_MAX_CHAIN && (a1 - a0) + (b1 - b0) <= TEX_DIFF_MYERS_ROWS * 8 &&
+                editorDiffMyers(tc, a0, a1, b0, b1, hunks, &num, cap))
+            continue;
+
+        // Grow the match out into a run of equal lines, the regions either side are diffed alone
+        int as = bestA, bs = bestB, ae = bestA + 1, be = bestB + 1;
+        while (as > a0 && bs > b0 && a[as - 1] == tc->row[bs - 1].hash) {
+            as--;
+            bs--;
+        }
+        while (ae < a1 && be < b1 && a[ae] == tc->row[be].hash) {
+            ae++;
+            be++;
+        }
+        if (depth + 2 > stackCap) {
+            stackCap *= 2;
+            stack = texRealloc(tc, stack, sizeof(int) * 4 * stackCap);
+        }
+        int parts[2][4] = { { a0, as, b0, bs }, { ae, a1, be, b1 } };
+        for (int p = 0; p < 2; p++) {
+            memcpy(&stack[4 * depth], parts[p], sizeof(parts[p]));
+            depth++;
+        }
+    }
+    free(stack);
+    free(table);
+    free(scratch);
+
+    // In order, with hunks that touch joined into one
+    qsort(*hunks, num, sizeof(texDiffHunk), editorDiffCompare);
+    int w = 0;
+    for (int i = 0; i < num; i++) {
+        texDiffHunk *h = &(*hunks)[i];
+        texDiffHunk *last = w ? &(*hunks)[w - 1] : NULL;
+        if (last && last->row + last->rowCount == h->row && last->base + last->baseCount == h->base) {
+            last->rowCount += h->rowCount;
+            last->baseCount += h->baseCount;
+        } else {
+            (*hunks)[w++] = *h;
+        }
+    }
+    return w;
+}
+
+
+int editorDiffUpdate(texCore *tc) {
+    if (tc->large || (!tc->diffDirty && !tc->diffAll))
+        return 0;
+
+    // The dirty rows before they moved, the first hunk ending at or after them, and the first starting after them
+    int lo = 0, hi = tc->numrows, shift = 0;
+    int i0 = 0, i1 = tc->numHunks;
+    int baseLo = 0, baseHi = tc->numDisk;
+    if (!tc->diffAll) {
+        lo = tc->diffLo;
+        shift = tc->diffShift;
+        hi = tc->diffHi - shift;
+
+        int l = 0, r = tc->numHunks;
+        while (l < r) {
+            int mid = (l + r) / 2;
+            if (tc->hunks[mid].row + tc->hunks[mid].rowCount < lo)
+                l = mid + 1;
+            else
+                r = mid;
+        }
+        i0 = l;
+        for (i1 = i0; i1 < tc->numHunks && tc->hunks[i1].row <= hi; i1++)
+            ;
+
+        // Hunks the rows touch are diffed again with them
+        if (i0 < i1) {
+            if (tc->hunks[i0].row < lo)
+                lo = tc->hunks[i0].row;
+            if (tc->hunks[i1 - 1].row + tc->hunks[i1 - 1].rowCount > hi)
+                hi = tc->hunks[i1 - 1].row + tc->hunks[i1 - 1].rowCount;
+        }
+
+        // Outside the hunks rows line up with the file at an offset, set by the last hunk before them
+        texDiffHunk *before = i0 > 0 ? &tc->hunks[i0 - 1] : NULL;
+        texDiffHunk *last = i1 > 0 ? &tc->hunks[i1 - 1] : NULL;
+        baseLo = lo - (before ? before->row + before->rowCount - before->base - before->baseCount : 0);
+        baseHi = hi - (last ? last->row + last->rowCount - last->base - last->baseCount : 0);
+    }
+
+    texDiffHunk *found = NULL;
+    int cap = 0;
+    int num = editorDiffRegion(tc, baseLo, baseHi, lo, hi + shift, &found, &cap);
+
+    // Splice the new hunks in, the ones after them move with the rows
+    int total = tc->numHunks - (i1 - i0) + num;
+    if (total > tc->hunksCap) {
+        tc->hunksCap = total * 2;
+        tc->hunks = texRealloc(tc, tc->hunks, sizeof(texDiffHunk) * tc->hunksCap);
+    }
+    if (num != i1 - i0)
+        memmove(&tc->hunks[i0 + num], &tc->hunks[i1], sizeof(texDiffHunk) * (tc->numHunks - i1));
+    for (int i = i0 + num; i < total && shift; i++)
+        tc->hunks[i].row += shift;
+    if (num)
+        memcpy(&tc->hunks[i0], found, sizeof(texDiffHunk) * num);
+    tc->numHunks = total;
+    free(found);
+
+    tc->diffDirty = 0;
+    tc->diffAll = 0;
+    return 1;
+}
+
+
+int editorDiffFindRow(texCore *tc, int at) {
+    // First hunk ending past at, or a deletion just before it
+    int l = 0, r = tc->numHunks;
+    while (l < r) {
+        int mid = (l + r) / 2;
+        texDiffHunk *h = &tc->hunks[mid];
+        if (h->row + h->rowCount > at || (h->rowCount == 0 && h->row == at))
+            r = mid;
+        else
+            l = mid + 1;
+    }
+    return l;
+}
+
+
+int editorDiffAt(texCore *tc, int at) {
+    if (tc->large)
+        return DIFF_NONE;
+
+    int i = editorDiffFindRow(tc, at);
+    if (i < tc->numHunks) {
+        texDiffHunk *h = &tc->hunks[i];
+        if (h->rowCount == 0 && h->row == at)
+            return DIFF_DELETED;
+        if (h->row <= at)
+            return h->baseCount ? DIFF_CHANGED : DIFF_ADDED;
+    }
+    // Lines deleted from the end of the file are shown on the last row
+    texDiffHunk *last = tc->numHunks ? &tc->hunks[tc->numHunks - 1] : NULL;
+    if (at == tc->numrows - 1 && last && last->rowCount == 0 && last->row == tc->numrows)
+        return DIFF_DELETED;
+    return DIFF_NONE;
+}
+
+
+int editorDiffFind(texCore *tc, int from, int direction) {
+    if (tc->numHunks == 0)
+        return -1;
+
+    // First hunk starting after from, or the last one starting before it, wrapping around
+    int l = 0, r = tc->numHunks;
+    while (l < r) {
+        int mid = (l + r) / 2;
+        if (tc->hunks[mid].row <= from)
+            l = mid + 1;
+        else
+            r = mid;
+    }
+    if (direction > 0)
+        return l < tc->numHunks ? l : 0;
+
+    int i = l - 1;
+    if (i >= 0 && tc->hunks[i].row == from)
+        i--;
+    return i >= 0 ? i : tc->numHunks - 1;
+}
@@ -0,0 +1,240 @@
+#include "texcore.h"
+
+
+/*--------------------------------------------------------------------------
+                                 FILE IO
+--------------------------------------------------------------------------*/
+
+char *editorRowsToString(texCore *tc, int *buflen) {
+    int totlen = 0;
+    int j;
+
+    // Get total length, from lengths of each row of text
+    for (j = 0; j < tc->numrows; j++)
+        totlen += tc->row[j].size + 1;
+    
+    *buflen = totlen;   // Save total length into buflen
+
+    char *buf = texAlloc(tc, totlen); // Allocate memory for the string
+    char *p = buf;
+
+    for (j = 0; j < tc->numrows; j++) {
+        // Copy contents of each row to the end of the buffer
+        memcpy(p, tc->row[j].chars, tc->row[j].size);
+        p += tc->row[j].size; // Move pointer to end of line
+        *p = '\n';  // Append newline after each row
+        p++;        // Increment pointer
+    }
+
+    return buf;
+}
+
+
+int editorOpen(texCore *tc, char *filename) {
+    if (editorOpenStart(tc, filename) == -1)
+        return -1;
+
+    // Read until EOF
+    int more;
+    while ((more = editorLoadMore(tc, LLONG_MAX)) == 1)
+        ;
+    return more;
+}
+
+
+int editorOpenStart(texCore *tc, char *filename) {
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return -1;
+
+    // Decompressed as it's read when it's gzip
+    unsigned char magic[2];
+    int gzip = (pread(fd, magic, 2, 0) == 2 && magic[0] == 0x1f && magic[1] == 0x8b);
+    texGzip *gz = gzip ? gzipOpen(fd) : NULL;
+    if (gzip && gz == NULL) {
+        close(fd);
+        errno = ENOMEM;
+        return -1;
+    }
+    tc->gzip = gzip;
+
+    free(tc->filename);   // Free prev filename
+    tc->filename = strdup(filename);  // Duplicate filename, returns identical malloc-ed string
+
+    editorSelectSyntaxHighlight(tc);  // Detect filetype
+
+    texLoader *ld = texAlloc(tc, sizeof(texLoader));
+    ld->fd = fd;
+    struct stat st;
+    ld->size = fstat(fd, &st) == 0 ? st.st_size : 0;
+    ld->gz = gz;
+    ld->cap = TEX_LOAD_SLICE * 2;
+    ld->buf = texAlloc(tc, ld->cap);
+    ld->len = 0;
+
+    tc->load = ld;
+    tc->dirty = 0;    // Reset flag so user isn't alerted after opening file
+    editorDiffSetBase(tc);  // Lines are added to the file on disk as they're loaded
+    editorViewsInvalidate(tc);
+    return 0;
+}
+
+
+/*
+    Closes the file being loaded and frees the loader
+*/
+void editorLoadDone(texCore *tc) {
+    texLoader *ld = tc->load;
+    gzipClose(ld->gz);
+    close(ld->fd);
+    free(ld->buf);
+    free(ld);
+    tc->load = NULL;
+}
+
+
+int editorLoadProgress(texCore *tc) {
+    texLoader *ld = tc->load;
+    if (ld == NULL || ld->size == 0)
+        return 100;
+
+    long long done = ld->gz ? ld->gz->in : lseek(ld->fd, 0, SEEK_CUR);
+    return done < ld->size ? done * 100 / ld->size : 100;
+}
+
+
+int editorLoadMore(texCore *tc, long long bytes) {
+    texLoader *ld = tc->load;
+    if (ld == NULL)
+        return tc->large ? largeScanFailed(tc) : 0;
+
+    // Loading isn't an edit, so leave the flag as the user's edits left it
+    int dirty = tc->dirty;
+    tc->loading = 1;
+    long long done = 0;
+    int more = 1;
+
+    while (more == 1 && done < bytes) {
+        if (ld->len + TEX_LOAD_SLICE > ld->cap) {
+            ld->cap = (ld->len + TEX_LOAD_SLICE) * 2;
+            ld->buf = texRealloc(tc, ld->buf, ld->cap);
+        }
+
+        // Never more than was asked for, so a small slice stays small
+        int want = bytes - done < TEX_LOAD_SLICE ? bytes - done : TEX_LOAD_SLICE;
+        ssize_t n;
+        do {
+            if (ld->gz)
+                n = gzipRead(ld->gz, &ld->buf[ld->len], want);
+            else
+                n = read(ld->fd, &ld->buf[ld->len], want);
+        } while (n == -1 && errno == EINTR);
+
+        if (n == -1) {
+            int err = errno;
+            editorLoadDone(tc);
+            errno = err;
+            more = -1;
+            break;
+        }
+        if (n == 0) {
+            // Last line of the file has no newline
+            while (ld->len > 0 && ld->buf[ld->len - 1] == '\r')
+                ld->len--;
+            if (ld->len > 0)
+                editorInsertRow(tc, tc->numrows, ld->buf, ld->len);
+            editorLoadDone(tc);
+            more = 0;
+            break;
+        }
+        done += n;
+
+        // Add every complete line, and carry the partial one at the end over to the next slice
+        char *p = ld->buf;
+        char *end = &ld->buf[ld->len + n];
+        char *nl;
+        while ((nl = memchr(p, '\n', end - p)) != NULL) {
+            int linelen = nl - p;
+            while (linelen > 0 && p[linelen - 1] == '\r')
+                linelen--;
+            editorInsertRow(tc, tc->numrows, p, linelen);
+            p = nl + 1;
+        }
+        ld->len = end - p;
+        memmove(ld->buf, p, ld->len);
+    }
+
+    tc->loading = 0;
+    tc->dirty = dirty;
+    return more;
+}
+
+
+long long editorWriteFile(texCore *tc) {
+    if (tc->large)
+        return largeWriteFile(tc);
+
+    // Everything has to be loaded before the file can be replaced
+    int more;
+    while ((more = editorLoadMore(tc, LLONG_MAX)) == 1)
+        ;
+    if (more == -1)
+        return -1;
+
+    if (editorSaveCompressed(tc)) {
+        int fd = open(tc->filename, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd == -1)
+            return -1;
+        long long written = -1;
+        if (ftruncate(fd, 0) != -1)
+            written = editorWriteGzip(tc, fd);
+        if (close(fd) == -1)
+            written = -1;
+        if (written != -1) {
+            tc->dirty = 0;
+            editorOverviewSaved(tc);
+            editorDiffSetBase(tc);
+        }
+        return written;
+    }
+
+    int len;
+    char *buf = editorRowsToString(tc, &len);
+
+    // Open/Create new file if it doesn't exist, for read&write, and with proper permissions
+    int fp = open(tc->filename, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+    // Error Handling
+    if (fp != -1) {
+        if (ftruncate(fp, len) != -1){
+            if (write(fp, buf, len) == len) {
+                // Successful save
+                close(fp);
+                free(buf);
+                tc->dirty = 0;    // Reset flag after saving
+                editorOverviewSaved(tc);
+                editorDiffSetBase(tc);
+                return len;
+            }
+        }
+        // Close file after succesfully saving
+        close(fp);
+    }
+    // Unsuccessful save
+    free(buf);
+    return -1;
+}
+
+
+long long editorWriteGzip(texCore *tc, int fd) {
+    texDeflate *z = gzipWriterOpen(fd);
+    if (z == NULL)
+        return -1;
+
+    for (int j = 0; j < tc->numrows; j++) {
+        erow *row = &tc->row[j];
+        if (gzipWrite(z, row->chars, row->size) == -1 || gzipWrite(z, "\n", 1) == -1)
+            break;
+    }
+    return gzipFinish(z);
+}
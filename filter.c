@@ -0,0 +1,302 @@
+#include "texcore.h"
+
+#include <signal.h>
+#include <sys/wait.h>
+
+
+/*--------------------------------------------------------------------------
+                                  FILTER
+--------------------------------------------------------------------------*/
+
+int editorFilterStart(texCore *tc, const char *command, int first, int last) {
+    // The rows have to all be there to be filtered
+    int more;
+    while ((more = editorLoadMore(tc, LLONG_MAX)) == 1)
+        ;
+    if (more == -1)
+        return -1;
+    if (last >= tc->numrows)
+        last = tc->numrows - 1;
+
+    int fds[3][2];
+    for (int i = 0; i < 3; i++) {
+        if (pipe(fds[i]) == 0)
+            continue;
+        int err = errno;
+        while (i-- > 0) {
+            close(fds[i][0]);
+            close(fds[i][1]);
+        }
+        errno = err;
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        // In a group of its own, so stopping it stops a whole pipeline
+        setpgid(0, 0);
+        signal(SIGPIPE, SIG_DFL);
+        dup2(fds[0][0], STDIN_FILENO);
+        dup2(fds[1][1], STDOUT_FILENO);
+        dup2(fds[2][1], STDERR_FILENO);
+        for (int i = 0; i < 3; i++) {
+            close(fds[i][0]);
+            close(fds[i][1]);
+        }
+        execl("/bin/sh", "sh", "-c", command, (char *) NULL);
+        _exit(127);
+    }
+
+    // Both sides set the group, so it's set before either relies on it
+    int err = errno;
+    if (pid > 0)
+        setpgid(pid, pid);
+    close(fds[0][0]);
+    close(fds[1][1]);
+    close(fds[2][1]);
+    if (pid == -1) {
+        close(fds[0][1]);
+        close(fds[1][0]);
+        close(fds[2][0]);
+        errno = err;
+        return -1;
+    }
+
+    texFilter *f = texAlloc(tc, sizeof(texFilter));
+    memset(f, 0, sizeof(*f));
+    f->pid = pid;
+    f->inFd = fds[0][1];
+    f->outFd = fds[1][0];
+    f->errFd = fds[2][0];
+    // Neither end ever waits on the other, a full pipe is left until it's drained
+    int ends[3] = { f->inFd, f->outFd, f->errFd };
+    for (int i = 0; i < 3; i++) {
+        fcntl(ends[i], F_SETFL, fcntl(ends[i], F_GETFL) | O_NONBLOCK);
+        fcntl(ends[i], F_SETFD, FD_CLOEXEC);
+    }
+
+    f->first = first;
+    f->last = last;
+    f->next = first;
+    f->inCap = TEX_FILTER_SLICE;
+    f->in = texAlloc(tc, f->inCap);
+    f->outCap = TEX_FILTER_BATCH + TEX_FILTER_SLICE;
+    f->out = texAlloc(tc, f->outCap);
+    f->running = 1;
+    f->status = -1;
+    f->sigpipe = signal(SIGPIPE, SIG_IGN);
+
+    // Output below the exact rows isn't highlighted as it's added, only once it's shown
+    if (tc->hlUpTo > first)
+        tc->hlUpTo = first;
+    tc->filter = f;
+    return 0;
+}
+
+
+int editorFilterFill(texCore *tc) {
+    texFilter *f = tc->filter;
+    f->inPos = 0;
+    f->inLen = 0;
+
+    while (f->next <= f->last && f->inLen < TEX_FILTER_SLICE) {
+        if (tc->large)
+            largeWalkRows(tc, f->next, f->last + 1);
+        erow *row = editorRowAt(tc, f->next);
+        // Only a row longer than the slice grows it
+        if (f->inLen + row->size + 1 > f->inCap) {
+            f->inCap = f->inLen + row->size + 1;
+            f->in = texRealloc(tc, f->in, f->inCap);
+        }
+        memcpy(&f->in[f->inLen], row->chars, row->size);
+        f->inLen += row->size;
+        f->in[f->inLen++] = '\n';
+        f->next++;
+    }
+    return f->inLen;
+}
+
+
+void editorFilterAdd(texCore *tc, const char *s, long long len) {
+    texFilter *f = tc->filter;
+    int numrows = tc->numrows;
+    editorInsertLines(tc, f->last + 1 + f->added, s, len);
+    f->added += tc->numrows - numrows;
+}
+
+
+void editorFilterFlush(texCore *tc) {
+    texFilter *f = tc->filter;
+    char *nl = memrchr(f->out, '\n', f->outLen);
+    if (nl == NULL)
+        return;
+
+    // Every whole line in one insert, the partial one after them waits for the rest of it
+    int len = nl - f->out;
+    editorFilterAdd(tc, f->out, len);
+    f->outLen -= len + 1;
+    memmove(f->out, nl + 1, f->outLen);
+}
+
+
+void editorFilterEnd(texCore *tc, int ok) {
+    texFilter *f = tc->filter;
+    int ends[3] = { f->inFd, f->outFd, f->errFd };
+    for (int i = 0; i < 3; i++) {
+        if (ends[i] != -1)
+            close(ends[i]);
+    }
+    f->inFd = f->outFd = f->errFd = -1;
+    signal(SIGPIPE, f->sigpipe);
+
+    // The output takes the rows' place, or goes again leaving them as they were
+    if (ok)
+        editorDelRows(tc, f->first, f->last + 1);
+    else
+        editorDelRows(tc, f->last + 1, f->last + 1 + f->added);
+
+    free(f->in);
+    free(f->out);
+    f->in = NULL;
+    f->out = NULL;
+    f->running = 0;
+}
+
+
+int editorFilterPump(texCore *tc) {
+    texFilter *f = tc->filter;
+    if (f == NULL || !f->running)
+        return 0;
+
+    // Rows go in until the pipe is full, a batch at most so the client can check for keys
+    long long budget = TEX_FILTER_BATCH;
+    while (f->inFd != -1 && budget > 0) {
+        if (f->inPos == f->inLen && editorFilterFill(tc) == 0) {
+            // Every row is written, so the command sees the end of its input
+            close(f->inFd);
+            f->inFd = -1;
+            break;
+        }
+        ssize_t n = write(f->inFd, &f->in[f->inPos], f->inLen - f->inPos);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n == -1 && errno == EAGAIN)
+            break;
+        if (n == -1) {
+            // It stopped reading, as head does, what it wrote is still its output
+            close(f->inFd);
+            f->inFd = -1;
+            break;
+        }
+        f->inPos += n;
+        f->bytesIn += n;
+        budget -= n;
+    }
+
+    budget = TEX_FILTER_BATCH;
+    while (f->outFd != -1 && budget > 0) {
+        // Only a line longer than the batch grows the buffer
+        if (f->outLen + TEX_FILTER_SLICE > f->outCap) {
+            f->outCap = (f->outLen + TEX_FILTER_SLICE) * 2;
+            f->out = texRealloc(tc, f->out, f->outCap);
+        }
+        ssize_t n = read(f->outFd, &f->out[f->outLen], TEX_FILTER_SLICE);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n == -1 && errno == EAGAIN)
+            break;
+        if (n <= 0) {
+            // The last line may have no newline
+            editorFilterFlush(tc);
+            if (f->outLen > 0)
+                editorFilterAdd(tc, f->out, f->outLen);
+            f->outLen = 0;
+            close(f->outFd);
+            f->outFd = -1;
+            break;
+        }
+        f->outLen += n;
+        f->bytesOut += n;
+        budget -= n;
+        if (f->outLen >= TEX_FILTER_BATCH)
+            editorFilterFlush(tc);
+    }
+
+    // Only the start of any errors is kept, to show
+    char buf[512];
+    for (int reads = 0; f->errFd != -1 && reads < 16; reads++) {
+        ssize_t n = read(f->errFd, buf, sizeof(buf));
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n == -1 && errno == EAGAIN)
+            break;
+        if (n <= 0) {
+            close(f->errFd);
+            f->errFd = -1;
+            break;
+        }
+        int keep = (int) sizeof(f->err) - 1 - f->errLen;
+        if (keep > n)
+            keep = n;
+        memcpy(&f->err[f->errLen], buf, keep);
+        f->errLen += keep;
+        f->err[f->errLen] = '\0';
+    }
+
+    if (f->inFd != -1 || f->outFd != -1 || f->errFd != -1)
+        return 1;
+
+    // Its output is closed, so it's exiting. Something it started may keep it going, so the
+    // client polls until it's reaped rather than waiting on it here
+    pid_t done = waitpid(f->pid, &f->status, WNOHANG);
+    if (done == 0 || (done == -1 && errno == EINTR))
+        return 1;
+    editorFilterEnd(tc, WIFEXITED(f->status) && WEXITSTATUS(f->status) == 0);
+    return 0;
+}
+
+
+void editorFilterCancel(texCore *tc) {
+    texFilter *f = tc->filter;
+    if (f == NULL || !f->running)
+        return;
+
+    // A command that ignores or traps SIGTERM is killed once its grace period is up
+    kill(-f->pid, SIGTERM);
+    long start = texNow();
+    int sig = SIGTERM;
+    int exited = 0;
+    while (!exited) {
+        siginfo_t info;
+        memset(&info, 0, sizeof(info));
+        // Left unreaped, so its group id can't be given to anything else yet
+        int r = waitid(P_PID, f->pid, &info, WEXITED | WNOHANG | WNOWAIT);
+        if (r == -1 && errno != EINTR)
+            break;
+        exited = (r == 0 && info.si_pid == f->pid);
+        if (!exited && sig == SIGTERM && texNow() - start >= TEX_FILTER_GRACE_US) {
+            sig = SIGKILL;
+            kill(-f->pid, SIGKILL);
+        }
+        if (!exited)
+            usleep(1000);
+    }
+
+    // Anything it started that's still in its group goes with it
+    if (exited) {
+        kill(-f->pid, SIGKILL);
+        while (waitpid(f->pid, NULL, 0) == -1 && errno == EINTR)
+            ;
+    }
+    f->status = -1;
+    editorFilterEnd(tc, 0);
+}
+
+
+void editorFilterFree(texCore *tc) {
+    if (tc->filter == NULL)
+        return;
+    editorFilterCancel(tc);
+    free(tc->filter);
+    tc->filter = NULL;
+}
@@ -0,0 +1,808 @@
+#include "texcore.h"
+
+
+/*--------------------------------------------------------------------------
+                                  GZIP
+--------------------------------------------------------------------------*/
+
+// Base lengths and extra bits of length symbols 257 to 285
+static const unsigned short GZIP_LEN_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115,
+    131, 163, 195, 227, 258
+};
+static const unsigned char GZIP_LEN_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+// Base distances and extra bits of distance symbols
+static const unsigned short GZIP_DIST_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537,
+    2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const unsigned char GZIP_DIST_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// Order the code lengths of the code length alphabet are stored in
+static const unsigned char GZIP_CLEN_ORDER[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+static unsigned long GZIP_CRC_TABLE[256];
+
+// Fixed Huffman codes of the literal and length symbols, reversed ready to be sent, and their lengths
+static unsigned short GZIP_FIXED_CODE[288];
+static unsigned char GZIP_FIXED_LEN[288];
+
+static pthread_once_t gzipInitOnce = PTHREAD_ONCE_INIT;
+
+
+void gzipInit() {
+    for (unsigned long n = 0; n < 256; n++) {
+        unsigned long c = n;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? 0xedb88320UL ^ (c >> 1) : c >> 1;
+        GZIP_CRC_TABLE[n] = c;
+    }
+
+    for (int sym = 0; sym < 288; sym++) {
+        int code, len;
+        if (sym < 144) {
+            code = 0x30 + sym;
+            len = 8;
+        } else if (sym < 256) {
+            code = 0x190 + sym - 144;
+            len = 9;
+        } else if (sym < 280) {
+            code = sym - 256;
+            len = 7;
+        } else {
+            code = 0xc0 + sym - 280;
+            len = 8;
+        }
+        GZIP_FIXED_CODE[sym] = gzipReverse(code, len);
+        GZIP_FIXED_LEN[sym] = len;
+    }
+}
+
+
+unsigned int gzipReverse(unsigned int code, int len) {
+    unsigned int reversed = 0;
+    for (int i = 0; i < len; i++)
+        reversed |= ((code >> i) & 1) << (len - 1 - i);
+    return reversed;
+}
+
+
+unsigned long gzipCrc(unsigned long crc, const unsigned char *s, long long len) {
+    pthread_once(&gzipInitOnce, gzipInit);
+
+    crc ^= 0xffffffffUL;
+    while (len--)
+        crc = GZIP_CRC_TABLE[(crc ^ *s++) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xffffffffUL;
+}
+
+
+int editorIsGzip(const char *filename) {
+    unsigned char magic[2];
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return 0;
+
+    int gzip = (read(fd, magic, 2) == 2 && magic[0] == 0x1f && magic[1] == 0x8b);
+    close(fd);
+    return gzip;
+}
+
+
+int editorSaveCompressed(texCore *tc) {
+    int len = tc->filename ? strlen(tc->filename) : 0;
+    return tc->gzip || (len > 3 && strcmp(&tc->filename[len - 3], ".gz") == 0);
+}
+
+
+texGzip *gzipOpen(int fd) {
+    texGzip *gz = malloc(sizeof(texGzip));
+    if (gz == NULL)
+        return NULL;
+    memset(gz, 0, sizeof(texGzip));
+
+    gz->buf = malloc(TEX_GZIP_BUF);
+    gz->window = malloc(TEX_GZIP_WINDOW);
+    if (gz->buf == NULL || gz->window == NULL) {
+        gzipClose(gz);
+        return NULL;
+    }
+    gz->fd = fd;
+    gzipReset(gz);
+    return gz;
+}
+
+
+void gzipClose(texGzip *gz) {
+    if (gz == NULL)
+        return;
+    for (int i = 0; i < gz->numPoints; i++)
+        free(gz->points[i].window);
+    free(gz->points);
+    free(gz->buf);
+    free(gz->window);
+    free(gz);
+}
+
+
+void gzipReset(texGzip *gz) {
+    gz->in = 0;
+    gz->bufLen = 0;
+    gz->bufAt = 0;
+    gz->bits = 0;
+    gz->numBits = 0;
+    gz->state = GZIP_HEADER;
+    gz->last = 0;
+    gz->stored = 0;
+    gz->copyLen = 0;
+    gz->out = 0;
+    gz->members = 0;
+    gz->crc = 0;
+    gz->memberOut = 0;
+    gz->checked = 1;
+    gz->lastPoint = 0;
+}
+
+
+int gzipByte(texGzip *gz) {
+    if (gz->bufAt == gz->bufLen) {
+        ssize_t n;
+        do {
+            n = pread(gz->fd, gz->buf, TEX_GZIP_BUF, gz->in);
+        } while (n == -1 && errno == EINTR);
+        if (n <= 0)
+            return -1;
+        gz->in += n;
+        gz->bufLen = n;
+        gz->bufAt = 0;
+    }
+    return gz->buf[gz->bufAt++];
+}
+
+
+int gzipNeed(texGzip *gz, int n) {
+    while (gz->numBits < n) {
+        int c = gzipByte(gz);
+        if (c < 0)
+            return 0;
+        gz->bits |= (unsigned long long)c << gz->numBits;
+        gz->numBits += 8;
+    }
+    return 1;
+}
+
+
+int gzipBits(texGzip *gz, int n) {
+    if (!gzipNeed(gz, n))
+        return -1;
+    int value = gz->bits & ((1ULL << n) - 1);
+    gz->bits >>= n;
+    gz->numBits -= n;
+    return value;
+}
+
+
+int gzipAlignedByte(texGzip *gz) {
+    // Whole bytes may already have been pulled into the bit buffer
+    if (gz->numBits >= 8) {
+        int c = gz->bits & 0xff;
+        gz->bits >>= 8;
+        gz->numBits -= 8;
+        return c;
+    }
+    return gzipByte(gz);
+}
+
+
+void gzipAlign(texGzip *gz) {
+    gz->bits >>= gz->numBits & 7;
+    gz->numBits -= gz->numBits & 7;
+}
+
+
+int gzipBuild(texHuffman *h, const unsigned char *lengths, int n) {
+    short offs[16];
+    int next[16];
+
+    memset(h->count, 0, sizeof(h->count));
+    for (int sym = 0; sym < n; sym++)
+        h->count[lengths[sym]]++;
+    h->count[0] = 0;
+
+    // More codes than the lengths have room for
+    int left = 1;
+    for (int len = 1; len < 16; len++) {
+        left <<= 1;
+        left -= h->count[len];
+        if (left < 0)
+            return -1;
+    }
+
+    // Symbols sorted by length then value, which is the order of their canonical codes
+    offs[1] = 0;
+    for (int len = 1; len < 15; len++)
+        offs[len + 1] = offs[len] + h->count[len];
+    for (int sym = 0; sym < n; sym++) {
+        if (lengths[sym])
+            h->symbol[offs[lengths[sym]]++] = sym;
+    }
+
+    // Short codes are looked up by their bits, which arrive in reverse
+    memset(h->fast, 0, sizeof(h->fast));
+    next[1] = 0;
+    for (int len = 2; len < 16; len++)
+        next[len] = (next[len - 1] + h->count[len - 1]) << 1;
+    for (int sym = 0; sym < n; sym++) {
+        int len = lengths[sym];
+        if (len == 0)
+            continue;
+        int code = next[len]++;
+        if (len > TEX_GZIP_FAST_BITS)
+            continue;
+        for (int r = gzipReverse(code, len); r < (1 << TEX_GZIP_FAST_BITS); r += 1 << len)
+            h->fast[r] = (sym << 4) | len;
+    }
+    return 0;
+}
+
+
+int gzipDecode(texGzip *gz, texHuffman *h) {
+    // Comes up short at the very end of the input, the slow path handles that
+    gzipNeed(gz, TEX_GZIP_FAST_BITS);
+    unsigned short entry = h->fast[gz->bits & ((1 << TEX_GZIP_FAST_BITS) - 1)];
+    if (entry && (entry & 15) <= gz->numBits) {
+        gz->bits >>= entry & 15;
+        gz->numBits -= entry & 15;
+        return entry >> 4;
+    }
+
+    // Longer codes are decoded a bit at a time
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (int len = 1; len < 16; len++) {
+        int bit = gzipBits(gz, 1);
+        if (bit < 0)
+            return -1;
+        code |= bit;
+        int count = h->count[len];
+        if (code - count < first)
+            return h->symbol[index + (code - first)];
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+
+int gzipTables(texGzip *gz, int dynamic) {
+    unsigned char lengths[286 + 30];
+
+    if (!dynamic) {
+        int sym = 0;
+        for (; sym < 144; sym++)
+            lengths[sym] = 8;
+        for (; sym < 256; sym++)
+            lengths[sym] = 9;
+        for (; sym < 280; sym++)
+            lengths[sym] = 7;
+        for (; sym < 288; sym++)
+            lengths[sym] = 8;
+        gzipBuild(&gz->lit, lengths, 288);
+        memset(lengths, 5, 30);
+        gzipBuild(&gz->dist, lengths, 30);
+        return 0;
+    }
+
+    if (!gzipNeed(gz, 14))
+        return -1;
+    int numLit = gzipBits(gz, 5) + 257;
+    int numDist = gzipBits(gz, 5) + 1;
+    int numCode = gzipBits(gz, 4) + 4;
+    if (numCode < 4 || numLit > 286 || numDist > 30)
+        return -1;
+
+    // Code lengths are themselves Huffman coded, decode them with the dist table as scratch
+    memset(lengths, 0, 19);
+    for (int i = 0; i < numCode; i++) {
+        int len = gzipBits(gz, 3);
+        if (len < 0)
+            return -1;
+        lengths[GZIP_CLEN_ORDER[i]] = len;
+    }
+    if (gzipBuild(&gz->dist, lengths, 19) == -1)
+        return -1;
+
+    int index = 0;
+    while (index < numLit + numDist) {
+        int sym = gzipDecode(gz, &gz->dist);
+        if (sym < 0)
+            return -1;
+        if (sym < 16) {
+            lengths[index++] = sym;
+            continue;
+        }
+
+        // Repeat the last length, or a run of zeros
+        int len = 0;
+        int repeat;
+        if (sym == 16) {
+            if (index == 0)
+                return -1;
+            len = lengths[index - 1];
+            repeat = 3 + gzipBits(gz, 2);
+        } else if (sym == 17) {
+            repeat = 3 + gzipBits(gz, 3);
+        } else {
+            repeat = 11 + gzipBits(gz, 7);
+        }
+        if (repeat < 3 || index + repeat > numLit + numDist)
+            return -1;
+        while (repeat--)
+            lengths[index++] = len;
+    }
+
+    // A block without an end of block code can never finish
+    if (lengths[256] == 0)
+        return -1;
+    if (gzipBuild(&gz->lit, lengths, numLit) == -1 || gzipBuild(&gz->dist, &lengths[numLit], numDist) == -1)
+        return -1;
+    return 0;
+}
+
+
+int gzipHeader(texGzip *gz) {
+    int id1 = gzipByte(gz);
+    int id2 = gzipByte(gz);
+
+    // Nothing, or only padding, after the last member
+    if (gz->members > 0 && (id1 != 0x1f || id2 != 0x8b))
+        return 0;
+    if (id1 != 0x1f || id2 != 0x8b || gzipByte(gz) != 8)
+        return -1;
+
+    int flags = gzipByte(gz);
+    if (flags < 0)
+        return -1;
+    for (int i = 0; i < 6; i++) {   // Modification time, extra flags and OS
+        if (gzipByte(gz) < 0)
+            return -1;
+    }
+
+    // A header cut short anywhere fails the open, rather than skipping by a length it never had
+    if (flags & 4) {
+        int lo = gzipByte(gz);
+        int hi = gzipByte(gz);
+        if (lo < 0 || hi < 0)
+            return -1;
+        for (int len = lo | hi << 8; len > 0; len--) {
+            if (gzipByte(gz) < 0)
+                return -1;
+        }
+    }
+    // Name and comment are NULL terminated
+    for (int field = 8; field <= 16; field <<= 1) {
+        if (flags & field) {
+            int c;
+            while ((c = gzipByte(gz)) > 0)
+                ;
+            if (c < 0)
+                return -1;
+        }
+    }
+    if (flags & 2) {
+        if (gzipByte(gz) < 0 || gzipByte(gz) < 0)
+            return -1;
+    }
+
+    gz->members++;
+    return 1;
+}
+
+
+void gzipAddPoint(texGzip *gz) {
+    texGzipPoint point;
+    point.in = gz->in - (gz->bufLen - gz->bufAt);
+    point.out = gz->out;
+    point.bits = gz->bits;
+    point.numBits = gz->numBits;
+    point.window = malloc(TEX_GZIP_WINDOW);
+    if (point.window == NULL)
+        return;
+
+    // Unroll the circular window so it ends at out
+    for (int i = 0; i < TEX_GZIP_WINDOW; i++)
+        point.window[i] = gz->window[(gz->out + i) & (TEX_GZIP_WINDOW - 1)];
+
+    if (gz->pointsLock)
+        pthread_mutex_lock(gz->pointsLock);
+    texGzipPoint *points = realloc(gz->points, sizeof(texGzipPoint) * (gz->numPoints + 1));
+    if (points) {
+        gz->points = points;
+        gz->points[gz->numPoints++] = point;
+    } else {
+        free(point.window);
+    }
+    if (gz->pointsLock)
+        pthread_mutex_unlock(gz->pointsLock);
+    gz->lastPoint = gz->out;
+}
+
+
+void gzipSeek(texGzip *gz, texGzipPoint *point) {
+    gzipReset(gz);
+    gz->in = point->in;
+    gz->out = point->out;
+    gz->bits = point->bits;
+    gz->numBits = point->numBits;
+    gz->state = GZIP_BLOCK;
+    gz->members = 1;
+    gz->checked = 0;    // The start of the member was skipped, so its CRC can't be checked
+    for (int i = 0; i < TEX_GZIP_WINDOW; i++)
+        gz->window[(point->out + i) & (TEX_GZIP_WINDOW - 1)] = point->window[i];
+}
+
+
+int gzipRead(texGzip *gz, char *out, int len) {
+    unsigned char *dst = (unsigned char *)out;
+    int n = 0;
+    int crcAt = 0;  // Bytes of out already added to the CRC
+
+    while (n < len && gz->state != GZIP_DONE && gz->state != GZIP_ERROR) {
+        switch (gz->state) {
+            case GZIP_HEADER: {
+                int r = gzipHeader(gz);
+                if (r == -1)
+                    gz->state = GZIP_ERROR;
+                else if (r == 0)
+                    gz->state = GZIP_DONE;
+                else
+                    gz->state = GZIP_BLOCK;
+                break;
+            }
+
+            case GZIP_BLOCK: {
+                // A block boundary, where decoding can restart from without what came before
+                if (gz->span && gz->out - gz->lastPoint >= gz->span)
+                    gzipAddPoint(gz);
+
+                int last = gzipBits(gz, 1);
+                int type = gzipBits(gz, 2);
+                gz->last = last;
+                if (type == 0) {
+                    // Stored blocks start on a byte boundary with their length and its complement
+                    gzipAlign(gz);
+                    int lo = gzipAlignedByte(gz), hi = gzipAlignedByte(gz);
+                    int nlo = gzipAlignedByte(gz), nhi = gzipAlignedByte(gz);
+                    if (nhi < 0 || (lo | hi << 8) != (~(nlo | nhi << 8) & 0xffff)) {
+                        gz->state = GZIP_ERROR;
+                        break;
+                    }
+                    gz->stored = lo | hi << 8;
+                    gz->state = GZIP_STORED;
+                } else if ((type == 1 || type == 2) && gzipTables(gz, type == 2) == 0) {
+                    gz->state = GZIP_HUFFMAN;
+                } else {
+                    gz->state = GZIP_ERROR;
+                }
+                break;
+            }
+
+            case GZIP_STORED: {
+                if (gz->stored == 0) {
+                    gz->state = gz->last ? GZIP_TRAILER : GZIP_BLOCK;
+                    break;
+                }
+                int c = gzipByte(gz);
+                if (c < 0) {
+                    gz->state = GZIP_ERROR;
+                    break;
+                }
+                // Copy as much of the block as is already buffered
+                long long take = 1 + gz->bufLen - gz->bufAt;
+                if (take > gz->stored)
+                    take = gz->stored;
+                if (take > len - n)
+                    take = len - n;
+                gz->bufAt--;
+                for (long long i = 0; i < take; i++) {
+                    c = gz->buf[gz->bufAt++];
+                    dst[n++] = c;
+                    gz->window[gz->out++ & (TEX_GZIP_WINDOW - 1)] = c;
+                }
+                gz->stored -= take;
+                gz->memberOut += take;
+                break;
+            }
+
+            case GZIP_HUFFMAN: {
+                // Finish the match in progress before decoding more symbols
+                while (gz->copyLen && n < len) {
+                    int c = gz->window[(gz->out - gz->copyDist) & (TEX_GZIP_WINDOW - 1)];
+                    dst[n++] = c;
+                    gz->window[gz->out++ & (TEX_GZIP_WINDOW - 1)] = c;
+                    gz->memberOut++;
+                    gz->copyLen--;
+                }
+
+                while (n < len && gz->copyLen == 0) {
+                    int sym = gzipDecode(gz, &gz->lit);
+                    if (sym < 0) {
+                        gz->state = GZIP_ERROR;
+                        break;
+                    }
+                    if (sym < 256) {
+                        dst[n++] = sym;
+                        gz->window[gz->out++ & (TEX_GZIP_WINDOW - 1)] = sym;
+                        gz->memberOut++;
+                        continue;
+                    }
+                    if (sym == 256) {
+                        gz->state = gz->last ? GZIP_TRAILER : GZIP_BLOCK;
+                        break;
+                    }
+
+                    // A length, its extra bits, then a distance and its extra bits
+                    sym -= 257;
+                    int lenExtra = sym < 29 ? gzipBits(gz, GZIP_LEN_EXTRA[sym]) : -1;
+                    int dist = lenExtra < 0 ? -1 : gzipDecode(gz, &gz->dist);
+                    if (dist < 0 || dist >= 30) {
+                        gz->state = GZIP_ERROR;
+                        break;
+                    }
+                    int distExtra = gzipBits(gz, GZIP_DIST_EXTRA[dist]);
+                    gz->copyLen = GZIP_LEN_BASE[sym] + lenExtra;
+                    gz->copyDist = GZIP_DIST_BASE[dist] + distExtra;
+                    if (lenExtra < 0 || distExtra < 0 || gz->copyDist > gz->out) {
+                        gz->state = GZIP_ERROR;
+                        break;
+                    }
+                }
+                break;
+            }
+
+            case GZIP_TRAILER: {
+                // CRC and length of the member, on a byte boundary
+                gzipAlign(gz);
+                unsigned long crc = 0;
+                unsigned long size = 0;
+                int c = 0;
+                for (int i = 0; i < 4 && c >= 0; i++)
+                    crc |= (unsigned long)(c = gzipAlignedByte(gz)) << (i * 8);
+                for (int i = 0; i < 4 && c >= 0; i++)
+                    size |= (unsigned long)(c = gzipAlignedByte(gz)) << (i * 8);
+
+                gz->crc = gzipCrc(gz->crc, &dst[crcAt], n - crcAt);
+                crcAt = n;
+                if (c < 0 || (gz->checked && (crc != gz->crc || size != (gz->memberOut & 0xffffffffUL)))) {
+                    gz->state = GZIP_ERROR;
+                    break;
+                }
+                gz->crc = 0;
+                gz->memberOut = 0;
+                gz->checked = 1;
+                gz->state = GZIP_HEADER;
+                break;
+            }
+        }
+    }
+
+    if (gz->checked)
+        gz->crc = gzipCrc(gz->crc, &dst[crcAt], n - crcAt);
+    if (n == 0 && gz->state == GZIP_ERROR) {
+        errno = EINVAL;
+        return -1;
+    }
+    return n;
+}
+
+
+texDeflate *gzipWriterOpen(int fd) {
+    pthread_once(&gzipInitOnce, gzipInit);
+
+    texDeflate *z = malloc(sizeof(texDeflate));
+    if (z == NULL)
+        return NULL;
+    memset(z, 0, sizeof(texDeflate));
+
+    z->window = malloc(TEX_GZIP_WINDOW * 2);
+    z->head = malloc(sizeof(int) * TEX_DEFLATE_HASH);
+    z->prev = malloc(sizeof(int) * TEX_GZIP_WINDOW);
+    z->outBuf = malloc(TEX_GZIP_BUF);
+    if (z->window == NULL || z->head == NULL || z->prev == NULL || z->outBuf == NULL) {
+        gzipWriterClose(z);
+        return NULL;
+    }
+    for (int i = 0; i < TEX_DEFLATE_HASH; i++)
+        z->head[i] = -1;
+    z->fd = fd;
+
+    // Deflate, no name, no time, Unix
+    static const unsigned char header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3 };
+    memcpy(z->outBuf, header, sizeof(header));
+    z->outLen = sizeof(header);
+    return z;
+}
+
+
+void gzipWriterClose(texDeflate *z) {
+    if (z == NULL)
+        return;
+    free(z->window);
+    free(z->head);
+    free(z->prev);
+    free(z->outBuf);
+    free(z);
+}
+
+
+void gzipFlushOut(texDeflate *z) {
+    if (z->outLen > 0 && !z->error) {
+        if (write(z->fd, z->outBuf, z->outLen) != z->outLen)
+            z->error = 1;
+        z->written += z->outLen;
+    }
+    z->outLen = 0;
+}
+
+
+void gzipPutBits(texDeflate *z, unsigned int value, int n) {
+    z->bits |= (unsigned long long)value << z->numBits;
+    z->numBits += n;
+    while (z->numBits >= 8) {
+        z->outBuf[z->outLen++] = z->bits & 0xff;
+        z->bits >>= 8;
+        z->numBits -= 8;
+        if (z->outLen == TEX_GZIP_BUF)
+            gzipFlushOut(z);
+    }
+}
+
+
+void gzipPutLiteral(texDeflate *z, int sym) {
+    gzipPutBits(z, GZIP_FIXED_CODE[sym], GZIP_FIXED_LEN[sym]);
+}
+
+
+void gzipPutMatch(texDeflate *z, int len, int dist) {
+    int sym = 28;
+    while (GZIP_LEN_BASE[sym] > len)
+        sym--;
+    gzipPutLiteral(z, 257 + sym);
+    gzipPutBits(z, len - GZIP_LEN_BASE[sym], GZIP_LEN_EXTRA[sym]);
+
+    int d = 29;
+    while (GZIP_DIST_BASE[d] > dist)
+        d--;
+    // Distance codes are all 5 bits in the fixed code
+    gzipPutBits(z, gzipReverse(d, 5), 5);
+    gzipPutBits(z, dist - GZIP_DIST_BASE[d], GZIP_DIST_EXTRA[d]);
+}
+
+
+void gzipCompress(texDeflate *z, int flush) {
+    unsigned char *w = z->window;
+    // Leave a full match of lookahead unless this is the end of the input
+    int limit = flush ? z->end : z->end - TEX_DEFLATE_MAX_MATCH;
+    if (z->start >= limit)
+        return;
+
+    // A block with the fixed codes, which need no tables
+    gzipPutBits(z, 0, 1);
+    gzipPutBits(z, 1, 2);
+
+    int pos = z->start;
+    while (pos < limit) {
+        int best = 0;
+        int bestDist = 0;
+
+        if (pos + 2 < z->end) {
+            int h = ((w[pos] << 10) ^ (w[pos + 1] << 5) ^ w[pos + 2]) & (TEX_DEFLATE_HASH - 1);
+            int max = z->end - pos < TEX_DEFLATE_MAX_MATCH ? z->end - pos : TEX_DEFLATE_MAX_MATCH;
+            int cand = z->head[h];
+
+            // Walk a few of the earlier positions with the same hash for the longest match
+            for (int chain = 0; cand >= 0 && cand < pos && pos - cand <= TEX_GZIP_WINDOW - 1 &&
+                    chain < TEX_DEFLATE_CHAIN; chain++) {
+                if (w[cand + best] == w[pos + best]) {
+                    int len = 0;
+                    while (len < max && w[cand + len] == w[pos + len])
+                        len++;
+                    if (len > best) {
+                        best = len;
+                        bestDist = pos - cand;
+                        if (len == max)
+                            break;
+                    }
+                }
+                int older = z->prev[cand & (TEX_GZIP_WINDOW - 1)];
+                if (older >= cand)
+                    break;
+                cand = older;
+            }
+            z->prev[pos & (TEX_GZIP_WINDOW - 1)] = z->head[h];
+            z->head[h] = pos;
+        }
+
+        if (best >= 3) {
+            gzipPutMatch(z, best, bestDist);
+            // Hash the rest of the match too, so later text can refer back into it
+            for (int i = pos + 1; i < pos + best && i + 2 < z->end; i++) {
+                int h = ((w[i] << 10) ^ (w[i + 1] << 5) ^ w[i + 2]) & (TEX_DEFLATE_HASH - 1);
+                z->prev[i & (TEX_GZIP_WINDOW - 1)] = z->head[h];
+                z->head[h] = i;
+            }
+            pos += best;
+        } else {
+            gzipPutLiteral(z, w[pos]);
+            pos++;
+        }
+    }
+    gzipPutLiteral(z, 256);
+    z->start = pos;
+}
+
+
+void gzipSlide(texDeflate *z) {
+    // Keep the last window of input as history for matches
+    memmove(z->window, &z->window[TEX_GZIP_WINDOW], z->end - TEX_GZIP_WINDOW);
+    z->start -= TEX_GZIP_WINDOW;
+    z->end -= TEX_GZIP_WINDOW;
+    for (int i = 0; i < TEX_DEFLATE_HASH; i++)
+        z->head[i] = z->head[i] >= TEX_GZIP_WINDOW ? z->head[i] - TEX_GZIP_WINDOW : -1;
+    for (int i = 0; i < TEX_GZIP_WINDOW; i++)
+        z->prev[i] = z->prev[i] >= TEX_GZIP_WINDOW ? z->prev[i] - TEX_GZIP_WINDOW : -1;
+}
+
+
+int gzipWrite(texDeflate *z, const char *s, long long len) {
+    z->crc = gzipCrc(z->crc, (const unsigned char *)s, len);
+    z->total += len;
+
+    while (len > 0) {
+        int take = TEX_GZIP_WINDOW * 2 - z->end;
+        if (take > len)
+            take = len;
+        memcpy(&z->window[z->end], s, take);
+        z->end += take;
+        s += take;
+        len -= take;
+
+        if (z->end == TEX_GZIP_WINDOW * 2) {
+            gzipCompress(z, 0);
+            gzipSlide(z);
+        }
+    }
+    return z->error ? -1 : 0;
+}
+
+
+long long gzipFinish(texDeflate *z) {
+    gzipCompress(z, 1);
+
+    // An empty last block, then pad to a byte for the trailer
+    gzipPutBits(z, 1, 1);
+    gzipPutBits(z, 1, 2);
+    gzipPutLiteral(z, 256);
+    if (z->numBits > 0)
+        gzipPutBits(z, 0, 8 - z->numBits);
+
+    for (int i = 0; i < 4; i++)
+        gzipPutBits(z, (z->crc >> (i * 8)) & 0xff, 8);
+    for (int i = 0; i < 4; i++)
+        gzipPutBits(z, (z->total >> (i * 8)) & 0xff, 8);
+    gzipFlushOut(z);
+
+    long long written = z->error ? -1 : z->written;
+    gzipWriterClose(z);
+    return written;
+}
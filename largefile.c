@@ -0,0 +1,1174 @@
+#include "texcore.h"
+
+
+/*--------------------------------------------------------------------------
+                                LARGE FILES
+--------------------------------------------------------------------------*/
+
+int largeOpen(texCore *tc, char *filename, long long budget) {
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    // A gzip file's size isn't known until the scan has decompressed all of it
+    unsigned char magic[2];
+    int gzip = (pread(fd, magic, 2, 0) == 2 && magic[0] == 0x1f && magic[1] == 0x8b);
+    texGzip *gz = gzip ? gzipOpen(fd) : NULL;
+    texGzip *gzScan = gzip ? gzipOpen(fd) : NULL;
+    if (gzip && (gz == NULL || gzScan == NULL)) {
+        gzipClose(gz);
+        gzipClose(gzScan);
+        close(fd);
+        errno = ENOMEM;
+        return -1;
+    }
+    tc->gzip = gzip;
+
+    texLargeFile *lf = texAlloc(tc, sizeof(texLargeFile));
+    memset(lf, 0, sizeof(texLargeFile));
+    lf->fd = fd;
+    lf->size = st.st_size;
+    lf->diskSize = st.st_size;
+    lf->gz = gz;
+    lf->gzScan = gzScan;
+    if (gzip) {
+        lf->gzScan->span = TEX_GZIP_SPAN;
+        lf->gzScan->pointsLock = &lf->lock;
+        lf->size = 0;
+    }
+
+    // The first line starts at the top of the file
+    lf->indexCap = 1024;
+    lf->index = texAlloc(tc, sizeof(texIndexEntry) * lf->indexCap);
+    lf->index[0].line = 0;
+    lf->index[0].offset = 0;
+    lf->indexLen = 1;
+
+    // As many pages as fit in the budget, but enough for a line to span a few of them
+    lf->numPages = budget / TEX_LARGE_PAGE_SIZE;
+    if (lf->numPages < 4)
+        lf->numPages = 4;
+    lf->pages = texAlloc(tc, sizeof(texPage) * lf->numPages);
+    for (int i = 0; i < lf->numPages; i++) {
+        lf->pages[i].number = -1;
+        lf->pages[i].lastUsed = 0;
+        lf->pages[i].len = 0;
+        lf->pages[i].data = NULL;
+    }
+
+    lf->lineCap = 256;
+    lf->line = texAlloc(tc, lf->lineCap);
+
+    tc->large = lf;
+    free(tc->filename);
+    tc->filename = strdup(filename);
+    editorSelectSyntaxHighlight(tc);
+
+    // Index the file in the background, or up front if no thread can be started
+    pthread_mutex_init(&lf->lock, NULL);
+    void *(*scan)(void *) = lf->gzScan ? largeScanGzip : largeScan;
+    lf->scanThreaded = (pthread_create(&lf->scanThread, NULL, scan, lf) == 0);
+    if (!lf->scanThreaded)
+        scan(lf);
+
+    largeSync(tc, 0, 0);
+    tc->dirty = 0;
+    return 0;
+}
+
+
+void largeFree(texCore *tc) {
+    texLargeFile *lf = tc->large;
+
+    if (lf->scanThreaded) {
+        pthread_mutex_lock(&lf->lock);
+        lf->scanStop = 1;
+        pthread_mutex_unlock(&lf->lock);
+        pthread_join(lf->scanThread, NULL);
+    }
+    pthread_mutex_destroy(&lf->lock);
+
+    for (int i = 0; i < lf->winLen; i++) {
+        editorFreeRow(lf->win[i]);
+        free(lf->win[i]);
+    }
+    free(lf->win);
+    free(lf->winFile);
+
+    for (int i = 0; i < lf->numPieces; i++)
+        free(lf->pieces[i].text);
+    free(lf->pieces);
+
+    for (int i = 0; i < lf->numPages; i++)
+        free(lf->pages[i].data);
+    free(lf->pages);
+
+    free(lf->index);
+    free(lf->line);
+    gzipClose(lf->gz);
+    gzipClose(lf->gzScan);
+    close(lf->fd);
+    free(lf);
+    tc->large = NULL;
+    tc->numrows = 0;
+}
+
+
+void *largeScan(void *arg) {
+    texLargeFile *lf = arg;
+    texScanChunk chunks[TEX_LARGE_SCAN_THREADS];
+    pthread_t threads[TEX_LARGE_SCAN_THREADS];
+    int started[TEX_LARGE_SCAN_THREADS];
+    char *buf = NULL;   // Only needed when the file can't be mapped
+    long long offset = 0;
+    long long lines = 0;
+    char last = '\n';
+
+    // A chunk for each core, the first of every round is scanned on this thread
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int numChunks = cores < 1 ? 1 : cores > TEX_LARGE_SCAN_THREADS ? TEX_LARGE_SCAN_THREADS : cores;
+    int error = 0;  // Out of memory on this thread, where the core can't stop its client
+    for (int c = 0; c < numChunks; c++) {
+        chunks[c].found = malloc(sizeof(texIndexEntry) * (TEX_LARGE_SCAN_CHUNK / TEX_LARGE_INDEX_STRIDE + 1));
+        if (chunks[c].found == NULL)
+            error = ENOMEM;
+    }
+
+    while (!error && offset < lf->size) {
+        pthread_mutex_lock(&lf->lock);
+        int stop = lf->scanStop;
+        pthread_mutex_unlock(&lf->lock);
+        if (stop)
+            break;
+
+        long long roundLen = lf->size - offset;
+        if (roundLen > (long long)numChunks * TEX_LARGE_SCAN_CHUNK)
+            roundLen = (long long)numChunks * TEX_LARGE_SCAN_CHUNK;
+
+        char *map = mmap(NULL, roundLen, PROT_READ, MAP_PRIVATE, lf->fd, offset);
+        char *data = map;
+        if (map == MAP_FAILED) {
+            // Can't be mapped, read a single chunk instead
+            if (buf == NULL && (buf = malloc(TEX_LARGE_SCAN_CHUNK)) == NULL) {
+                error = ENOMEM;
+                break;
+            }
+            ssize_t n;
+            do {
+                n = pread(lf->fd, buf, roundLen < TEX_LARGE_SCAN_CHUNK ? roundLen : TEX_LARGE_SCAN_CHUNK, offset);
+            } while (n == -1 && errno == EINTR);
+            if (n <= 0)
+                break;
+            roundLen = n;
+            data = buf;
+        } else {
+            madvise(map, roundLen, MADV_SEQUENTIAL);
+        }
+
+        int n = (roundLen + TEX_LARGE_SCAN_CHUNK - 1) / TEX_LARGE_SCAN_CHUNK;
+        for (int c = 0; c < n; c++) {
+            long long at = (long long)c * TEX_LARGE_SCAN_CHUNK;
+            chunks[c].data = data + at;
+            chunks[c].offset = offset + at;
+            chunks[c].len = roundLen - at < TEX_LARGE_SCAN_CHUNK ? roundLen - at : TEX_LARGE_SCAN_CHUNK;
+        }
+
+        // Scan the chunks in parallel, falling back to this thread for any that can't get one
+        for (int c = 1; c < n; c++)
+            started[c] = (pthread_create(&threads[c], NULL, largeScanChunk, &chunks[c]) == 0);
+        largeScanChunk(&chunks[0]);
+        for (int c = 1; c < n; c++) {
+            if (started[c])
+                pthread_join(threads[c], NULL);
+            else
+                largeScanChunk(&chunks[c]);
+        }
+
+        last = data[roundLen - 1];
+        if (map != MAP_FAILED)
+            munmap(map, roundLen);
+
+        // Stitch the chunks onto the index, each numbering its lines on from the one before
+        pthread_mutex_lock(&lf->lock);
+        for (int c = 0; c < n; c++) {
+            if (!error && largeAddChunk(lf, &chunks[c], lines) == -1)
+                error = ENOMEM;
+            lines += chunks[c].lines;
+        }
+        offset += roundLen;
+        lf->lines = lines;
+        lf->scanned = offset;
+        pthread_mutex_unlock(&lf->lock);
+    }
+
+    // Last line of the file has no newline
+    if (last != '\n')
+        lines++;
+
+    pthread_mutex_lock(&lf->lock);
+    lf->lines = lines;
+    lf->scanned = offset;
+    lf->scanError = error;
+    lf->scanDone = 1;
+    pthread_mutex_unlock(&lf->lock);
+
+    for (int c = 0; c < numChunks; c++)
+        free(chunks[c].found);
+    free(buf);
+    return NULL;
+}
+
+
+void *largeScanGzip(void *arg) {
+    texLargeFile *lf = arg;
+    texScanChunk chunk;
+    long long offset = 0;
+    long long lines = 0;
+    char last = '\n';
+
+    // Out of memory on this thread, where the core can't stop its client
+    char *buf = malloc(TEX_LARGE_COPY_SIZE);
+    chunk.found = malloc(sizeof(texIndexEntry) * (TEX_LARGE_COPY_SIZE / TEX_LARGE_INDEX_STRIDE + 1));
+    int error = (buf == NULL || chunk.found == NULL) ? ENOMEM : 0;
+
+    // Deflate can only be decoded in order, so this is one thread decompressing a slice at a time
+    while (!error) {
+        pthread_mutex_lock(&lf->lock);
+        int stop = lf->scanStop;
+        pthread_mutex_unlock(&lf->lock);
+        if (stop)
+            break;
+
+        // A corrupt stream ends the file where it goes bad
+        int n = gzipRead(lf->gzScan, buf, TEX_LARGE_COPY_SIZE);
+        if (n <= 0)
+            break;
+
+        chunk.data = buf;
+        chunk.offset = offset;
+        chunk.len = n;
+        largeScanChunk(&chunk);
+        last = buf[n - 1];
+
+        pthread_mutex_lock(&lf->lock);
+        if (largeAddChunk(lf, &chunk, lines) == -1)
+            error = ENOMEM;
+        lines += chunk.lines;
+        offset += n;
+        lf->lines = lines;
+        lf->scanned = offset;
+        lf->scannedIn = lf->gzScan->in;
+        pthread_mutex_unlock(&lf->lock);
+    }
+
+    if (last != '\n')
+        lines++;
+
+    pthread_mutex_lock(&lf->lock);
+    lf->lines = lines;
+    lf->scanned = offset;
+    lf->scannedIn = lf->diskSize;
+    lf->scanError = error;
+    lf->scanDone = 1;
+    pthread_mutex_unlock(&lf->lock);
+
+    free(chunk.found);
+    free(buf);
+    return NULL;
+}
+
+
+int largeAddChunk(texLargeFile *lf, texScanChunk *chunk, long long lines) {
+    if (lf->indexLen + chunk->numFound > lf->indexCap) {
+        // Left as it was when it can't grow, so the lines before the chunk stay indexed
+        long long cap = (lf->indexLen + chunk->numFound) * 2;
+        texIndexEntry *index = realloc(lf->index, sizeof(texIndexEntry) * cap);
+        if (index == NULL)
+            return -1;
+        lf->index = index;
+        lf->indexCap = cap;
+    }
+    for (int k = 0; k < chunk->numFound; k++) {
+        lf->index[lf->indexLen].line = lines + chunk->found[k].line;
+        lf->index[lf->indexLen].offset = chunk->found[k].offset;
+        lf->indexLen++;
+    }
+    return 0;
+}
+
+
+void *largeScanChunk(void *arg) {
+    texScanChunk *chunk = arg;
+    const char *p = chunk->data;
+    const char *end = chunk->data + chunk->len;
+    long long lines = 0;
+    int numFound = 0;
+
+    // memchr() is vectorised, so skipping from newline to newline beats looking at each byte
+    while ((p = memchr(p, '\n', end - p)) != NULL) {
+        p++;
+        lines++;
+        if (lines % TEX_LARGE_INDEX_STRIDE == 0) {
+            chunk->found[numFound].line = lines;
+            chunk->found[numFound].offset = chunk->offset + (p - chunk->data);
+            numFound++;
+        }
+    }
+    chunk->lines = lines;
+    chunk->numFound = numFound;
+    return NULL;
+}
+
+
+void largeSync(texCore *tc, int first, int last) {
+    texLargeFile *lf = tc->large;
+
+    pthread_mutex_lock(&lf->lock);
+    long long lines = lf->lines;
+    if (lf->gz)
+        lf->size = lf->scanned;
+    pthread_mutex_unlock(&lf->lock);
+
+    // Lines the scan has found since are added past the end of the buffer
+    long long numrows = lines - lf->covered + lf->tableLines - lf->winPieceLines + lf->winLen;
+    tc->numrows = numrows < INT_MAX ? numrows : INT_MAX;
+
+    int end = lf->winStart + lf->winLen;
+    if (first < lf->winStart)
+        first = lf->winStart;
+    if (last > end)
+        last = end;
+    if (first >= last)
+        first = last = lf->winStart;
+    if (first == lf->winStart && last == end)
+        return;
+
+    // Edits have to be in the pieces before their rows can be freed
+    largeFlushWindow(tc);
+    for (int i = lf->winStart; i < end; i++) {
+        if (i < first || i >= last) {
+            editorFreeRow(lf->win[i - lf->winStart]);
+            free(lf->win[i - lf->winStart]);
+        }
+    }
+    memmove(lf->win, &lf->win[first - lf->winStart], sizeof(erow *) * (last - first));
+    memmove(lf->winFile, &lf->winFile[first - lf->winStart], sizeof(long long) * (last - first));
+    lf->winStart = first;
+    lf->winLen = last - first;
+    lf->winPieceLines = lf->winLen;
+}
+
+
+int largeProgress(texCore *tc) {
+    texLargeFile *lf = tc->large;
+
+    pthread_mutex_lock(&lf->lock);
+    int percent = (lf->scanDone || lf->diskSize == 0) ? 100 : lf->gz ? lf->scannedIn * 100 / lf->diskSize :
+        lf->scanned * 100 / lf->diskSize;
+    // A gzip file's input is read ahead of what's been scanned
+    if (!lf->scanDone && percent > 99)
+        percent = 99;
+    pthread_mutex_unlock(&lf->lock);
+    return percent;
+}
+
+
+int largeScanFailed(texCore *tc) {
+    texLargeFile *lf = tc->large;
+
+    pthread_mutex_lock(&lf->lock);
+    int error = lf->scanError;
+    pthread_mutex_unlock(&lf->lock);
+    if (error == 0)
+        return 0;
+    errno = error;
+    return -1;
+}
+
+
+char *largePage(texCore *tc, long long number, int *len) {
+    texLargeFile *lf = tc->large;
+    lf->clock++;
+
+    // Look for the page, and for the least recently used slot in case it isn't cached
+    int victim = 0;
+    for (int i = 0; i < lf->numPages; i++) {
+        texPage *page = &lf->pages[i];
+        if (page->number == number) {
+            page->lastUsed = lf->clock;
+            *len = page->len;
+            return page->data;
+        }
+        if (page->lastUsed < lf->pages[victim].lastUsed)
+            victim = i;
+    }
+
+    texPage *page = &lf->pages[victim];
+    if (page->data == NULL)
+        page->data = texAlloc(tc, TEX_LARGE_PAGE_SIZE);
+
+    long long n = largeRead(tc, lf->gz, page->data, TEX_LARGE_PAGE_SIZE, number * TEX_LARGE_PAGE_SIZE);
+    page->number = number;
+    page->lastUsed = lf->clock;
+    page->len = n > 0 ? n : 0;
+    *len = page->len;
+    return page->data;
+}
+
+
+long long largeLineOffset(texCore *tc, long long line) {
+    texLargeFile *lf = tc->large;
+
+    // Last indexed line at or above line
+    pthread_mutex_lock(&lf->lock);
+    long long lo = 0;
+    long long hi = lf->indexLen - 1;
+    while (lo < hi) {
+        long long mid = (lo + hi + 1) / 2;
+        if (lf->index[mid].line <= line)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    long long offset = lf->index[lo].offset;
+    long long skip = line - lf->index[lo].line;
+    pthread_mutex_unlock(&lf->lock);
+
+    // Step over the lines between the indexed one and line
+    while (skip > 0 && offset < lf->size) {
+        int len;
+        long long number = offset / TEX_LARGE_PAGE_SIZE;
+        char *page = largePage(tc, number, &len);
+        char *p = page + offset % TEX_LARGE_PAGE_SIZE;
+        char *end = page + len;
+        if (p >= end)
+            break;
+
+        while (skip > 0 && (p = memchr(p, '\n', end - p)) != NULL) {
+            p++;
+            skip--;
+        }
+        offset = number * TEX_LARGE_PAGE_SIZE + (p ? p - page : len);
+    }
+    return offset < lf->size ? offset : lf->size;
+}
+
+
+char *largeReadLine(texCore *tc, long long *offset, int *len) {
+    texLargeFile *lf = tc->large;
+    if (*offset >= lf->size)
+        return NULL;
+
+    int n = 0;
+    while (*offset < lf->size) {
+        int pageLen;
+        char *page = largePage(tc, *offset / TEX_LARGE_PAGE_SIZE, &pageLen);
+        char *p = page + *offset % TEX_LARGE_PAGE_SIZE;
+        char *end = page + pageLen;
+        if (p >= end)
+            break;
+
+        // Take up to the newline, or the rest of the page when the line goes on past it
+        char *nl = memchr(p, '\n', end - p);
+        int take = (nl ? nl : end) - p;
+        if (n + take + 1 > lf->lineCap) {
+            lf->lineCap = (n + take + 1) * 2;
+            lf->line = texRealloc(tc, lf->line, lf->lineCap);
+        }
+        memcpy(&lf->line[n], p, take);
+        n += take;
+        *offset += take;
+
+        if (nl) {
+            (*offset)++;
+            break;
+        }
+    }
+
+    while (n > 0 && lf->line[n - 1] == '\r')
+        n--;
+    lf->line[n] = '\0';
+    *len = n;
+    return lf->line;
+}
+
+
+long long largeTableLine(texCore *tc, int at) {
+    texLargeFile *lf = tc->large;
+    if (at < lf->winStart)
+        return at;
+    return at - lf->winLen + lf->winPieceLines;
+}
+
+
+void largeExtendTable(texCore *tc, long long line) {
+    texLargeFile *lf = tc->large;
+    if (line < lf->tableLines)
+        return;
+
+    long long count = line + 1 - lf->tableLines;
+    texPiece *tail = lf->numPieces ? &lf->pieces[lf->numPieces - 1] : NULL;
+
+    // Carry on the last piece if it runs up to the lines being added
+    if (tail && tail->first >= 0 && tail->first + tail->count == lf->covered) {
+        tail->count += count;
+    } else {
+        lf->pieces = texRealloc(tc, lf->pieces, sizeof(texPiece) * (lf->numPieces + 1));
+        lf->pieces[lf->numPieces].first = lf->covered;
+        lf->pieces[lf->numPieces].count = count;
+        lf->pieces[lf->numPieces].start = lf->tableLines;
+        lf->pieces[lf->numPieces].text = NULL;
+        lf->pieces[lf->numPieces].len = 0;
+        lf->numPieces++;
+    }
+    lf->covered += count;
+    lf->tableLines += count;
+}
+
+
+int largePieceAt(texCore *tc, long long line, long long *within) {
+    texLargeFile *lf = tc->large;
+
+    // Last piece starting at or before line
+    int lo = 0, hi = lf->numPieces;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (lf->pieces[mid].start <= line)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    int p = lo - 1;
+    if (p < 0 || line >= lf->pieces[p].start + lf->pieces[p].count) {
+        *within = 0;
+        return lf->numPieces;
+    }
+    *within = line - lf->pieces[p].start;
+    return p;
+}
+
+
+char *largePieceSkip(texPiece *piece, char *s, long long n) {
+    char *end = piece->text + piece->len;
+    for (; n > 0 && s < end; n--) {
+        char *nl = memchr(s, '\n', end - s);
+        s = nl ? nl + 1 : end;
+    }
+    return s;
+}
+
+
+int largeSplit(texCore *tc, long long line) {
+    texLargeFile *lf = tc->large;
+    long long within;
+    int p = largePieceAt(tc, line, &within);
+    if (p == lf->numPieces || within == 0)
+        return p;
+
+    lf->pieces = texRealloc(tc, lf->pieces, sizeof(texPiece) * (lf->numPieces + 1));
+    memmove(&lf->pieces[p + 2], &lf->pieces[p + 1], sizeof(texPiece) * (lf->numPieces - p - 1));
+    texPiece *head = &lf->pieces[p], *tail = &lf->pieces[p + 1];
+    tail->first = head->first >= 0 ? head->first + within : -1;
+    tail->count = head->count - within;
+    tail->start = head->start + within;
+    tail->text = NULL;
+    tail->len = 0;
+
+    // Lines held in memory after the split are copied out, and the head's text ends before them
+    if (head->first < 0) {
+        char *s = largePieceSkip(head, head->text, within);
+        tail->len = head->text + head->len - s;
+        tail->text = texAlloc(tc, tail->len + 1);
+        memcpy(tail->text, s, tail->len + 1);
+        head->len = s - head->text - 1;
+        head->text[head->len] = '\0';
+    }
+    head->count = within;
+    lf->numPieces++;
+    return p + 1;
+}
+
+
+void largeSplice(texCore *tc, long long first, long long last, texPiece *pieces, int n) {
+    texLargeFile *lf = tc->large;
+    if (last > lf->tableLines)
+        largeExtendTable(tc, last - 1);
+
+    int i = largeSplit(tc, first);
+    int j = largeSplit(tc, last);
+    for (int p = i; p < j; p++)
+        free(lf->pieces[p].text);
+
+    int numPieces = lf->numPieces - (j - i) + n;
+    if (numPieces > lf->numPieces)
+        lf->pieces = texRealloc(tc, lf->pieces, sizeof(texPiece) * numPieces);
+    memmove(&lf->pieces[i + n], &lf->pieces[j], sizeof(texPiece) * (lf->numPieces - j));
+    if (n > 0)
+        memcpy(&lf->pieces[i], pieces, sizeof(texPiece) * n);
+    lf->numPieces = numPieces;
+
+    // Every piece from the new ones on starts at a different line
+    long long start = first;
+    for (int p = i; p < numPieces; p++) {
+        lf->pieces[p].start = start;
+        start += lf->pieces[p].count;
+    }
+    lf->tableLines = start;
+}
+
+
+void largeLoadRows(texCore *tc, int at, int count, erow **rows, long long *fileLines) {
+    texLargeFile *lf = tc->large;
+    if (count <= 0)
+        return;
+
+    long long line = largeTableLine(tc, at);
+    largeExtendTable(tc, line + count - 1);
+
+    long long within;
+    int p = largePieceAt(tc, line, &within);
+    int n = 0;
+    while (n < count && p < lf->numPieces) {
+        texPiece *piece = &lf->pieces[p];
+
+        if (piece->first < 0) {
+            char *s = largePieceSkip(piece, piece->text, within);
+            char *end = piece->text + piece->len;
+            for (; n < count && within < piece->count; within++) {
+                char *nl = memchr(s, '\n', end - s);
+                int len = nl ? nl - s : end - s;
+                rows[n] = texAlloc(tc, sizeof(erow));
+                editorInitRow(tc, rows[n], at + n, s, len);
+                fileLines[n] = -1;
+                n++;
+                s += len + 1;
+            }
+        } else {
+            // Read the run's lines one after another from where the first one starts
+            long long offset = largeLineOffset(tc, piece->first + within);
+            for (; n < count && within < piece->count; within++) {
+                int len;
+                char *s = largeReadLine(tc, &offset, &len);
+                rows[n] = texAlloc(tc, sizeof(erow));
+                editorInitRow(tc, rows[n], at + n, s ? s : "", s ? len : 0);
+                fileLines[n] = piece->first + within;
+                n++;
+            }
+        }
+        p++;
+        within = 0;
+    }
+}
+
+
+void largeFlushWindow(texCore *tc) {
+    texLargeFile *lf = tc->large;
+    if (!lf->winDirty)
+        return;
+
+    // Unedited rows go back as runs of file lines, each run of the rest as their lines held in memory
+    texPiece *pieces = texAlloc(tc, sizeof(texPiece) * (lf->winLen + 1));
+    int n = 0;
+    for (int i = 0; i < lf->winLen;) {
+        long long line = lf->winFile[i];
+        if (line >= 0 && n > 0 && pieces[n - 1].first >= 0 && pieces[n - 1].first + pieces[n - 1].count == line) {
+            pieces[n - 1].count++;
+            i++;
+            continue;
+        }
+
+        texPiece *piece = &pieces[n++];
+        piece->first = line;
+        piece->count = 1;
+        piece->text = NULL;
+        piece->len = 0;
+        if (line >= 0) {
+            i++;
+            continue;
+        }
+
+        int j = i;
+        long long len = -1;
+        for (; j < lf->winLen && lf->winFile[j] < 0; j++)
+            len += lf->win[j]->size + 1;
+        piece->count = j - i;
+        piece->text = texAlloc(tc, len + 1);
+        piece->len = len;
+        char *s = piece->text;
+        for (; i < j; i++) {
+            memcpy(s, lf->win[i]->chars, lf->win[i]->size);
+            s += lf->win[i]->size;
+            *s++ = '\n';
+        }
+        piece->text[len] = '\0';
+    }
+
+    largeSplice(tc, lf->winStart, lf->winStart + lf->winPieceLines, pieces, n);
+    free(pieces);
+    lf->winPieceLines = lf->winLen;
+    lf->winDirty = 0;
+}
+
+
+void largeWindowReserve(texCore *tc, int n) {
+    texLargeFile *lf = tc->large;
+    if (n <= lf->winCap)
+        return;
+
+    lf->winCap = n * 2;
+    lf->win = texRealloc(tc, lf->win, sizeof(erow *) * lf->winCap);
+    lf->winFile = texRealloc(tc, lf->winFile, sizeof(long long) * lf->winCap);
+}
+
+
+void largeWindowDrop(texCore *tc, int at) {
+    texLargeFile *lf = tc->large;
+    largeFlushWindow(tc);
+    for (int i = 0; i < lf->winLen; i++) {
+        editorFreeRow(lf->win[i]);
+        free(lf->win[i]);
+    }
+    lf->winStart = at;
+    lf->winLen = 0;
+    lf->winPieceLines = 0;
+}
+
+
+void largeWindowCover(texCore *tc, int first, int last) {
+    texLargeFile *lf = tc->large;
+    int end = lf->winStart + lf->winLen;
+
+    // Too far from the window to grow it, so move it
+    if (last < lf->winStart - TEX_LARGE_GAP || first > end + TEX_LARGE_GAP)
+        largeWindowDrop(tc, first);
+
+    if (first < lf->winStart) {
+        int n = lf->winStart - first;
+        largeWindowReserve(tc, lf->winLen + n);
+        memmove(&lf->win[n], lf->win, sizeof(erow *) * lf->winLen);
+        memmove(&lf->winFile[n], lf->winFile, sizeof(long long) * lf->winLen);
+        largeLoadRows(tc, first, n, lf->win, lf->winFile);
+        lf->winStart = first;
+        lf->winLen += n;
+        lf->winPieceLines += n;
+    }
+
+    end = lf->winStart + lf->winLen;
+    if (last > end) {
+        int n = last - end;
+        largeWindowReserve(tc, lf->winLen + n);
+        largeLoadRows(tc, end, n, &lf->win[lf->winLen], &lf->winFile[lf->winLen]);
+        lf->winLen += n;
+        lf->winPieceLines += n;
+    }
+}
+
+
+void largeWalkRows(texCore *tc, int at, int last) {
+    texLargeFile *lf = tc->large;
+    if (at >= lf->winStart && at < lf->winStart + lf->winLen)
+        return;
+
+    // Read the next rows in one go, and let go of the ones already walked past
+    int end = at + TEX_LARGE_GAP < last ? at + TEX_LARGE_GAP : last;
+    largeWindowCover(tc, at, end);
+    largeSync(tc, at, end);
+}
+
+
+erow *largeRowAt(texCore *tc, int at) {
+    texLargeFile *lf = tc->large;
+    if (at < lf->winStart || at >= lf->winStart + lf->winLen)
+        largeWindowCover(tc, at, at + 1);
+    return lf->win[at - lf->winStart];
+}
+
+
+void largeInsertRow(texCore *tc, int at, char *s, size_t len) {
+    texLargeFile *lf = tc->large;
+    largeWindowCover(tc, at, at);
+    largeWindowReserve(tc, lf->winLen + 1);
+
+    int pos = at - lf->winStart;
+    memmove(&lf->win[pos + 1], &lf->win[pos], sizeof(erow *) * (lf->winLen - pos));
+    memmove(&lf->winFile[pos + 1], &lf->winFile[pos], sizeof(long long) * (lf->winLen - pos));
+    lf->winLen++;
+    for (int j = pos + 1; j < lf->winLen; j++)
+        lf->win[j]->idx++;
+
+    lf->win[pos] = texAlloc(tc, sizeof(erow));
+    editorInitRow(tc, lf->win[pos], at, s, len);
+    lf->winFile[pos] = -1;
+    lf->winDirty = 1;
+
+    tc->numrows++;
+    editorViewsSpan(tc, at, at, at + 1);
+    tc->dirty++;
+}
+
+
+void largeDelRow(texCore *tc, int at) {
+    texLargeFile *lf = tc->large;
+    largeWindowCover(tc, at, at + 1);
+
+    int pos = at - lf->winStart;
+    editorFreeRow(lf->win[pos]);
+    free(lf->win[pos]);
+    memmove(&lf->win[pos], &lf->win[pos + 1], sizeof(erow *) * (lf->winLen - pos - 1));
+    memmove(&lf->winFile[pos], &lf->winFile[pos + 1], sizeof(long long) * (lf->winLen - pos - 1));
+    lf->winLen--;
+    for (int j = pos; j < lf->winLen; j++)
+        lf->win[j]->idx--;
+    lf->winDirty = 1;
+
+    tc->numrows--;
+    editorViewsSpan(tc, at, at + 1, at);
+    tc->dirty++;
+}
+
+
+void largeInsertPieces(texCore *tc, int at, texPiece *pieces, int n) {
+    // With the window empty, rows are numbered the same as the lines of the pieces
+    largeWindowDrop(tc, at);
+    largeSplice(tc, at, at, pieces, n);
+
+    int lines = 0;
+    for (int i = 0; i < n; i++)
+        lines += pieces[i].count;
+    tc->numrows += lines;
+    editorViewsSpan(tc, at, at, at + lines);
+    tc->dirty++;
+}
+
+
+void largeInsertLines(texCore *tc, int at, const char *s, long long len, int n) {
+    // Every line goes in as the one piece, split only if an edit lands inside it
+    texPiece piece;
+    piece.first = -1;
+    piece.count = n;
+    piece.text = texAlloc(tc, len + 1);
+    memcpy(piece.text, s, len);
+    piece.text[len] = '\0';
+    piece.len = len;
+    largeInsertPieces(tc, at, &piece, 1);
+}
+
+
+void largeYankLines(texCore *tc, texYank *y, int first, int last) {
+    texLargeFile *lf = tc->large;
+    // With the window's edits back in the pieces, rows are numbered the same as their lines
+    largeFlushWindow(tc);
+
+    long long line = first;
+    long long within;
+    for (int p = largePieceAt(tc, line, &within); p < lf->numPieces && line < last; p++) {
+        texPiece *piece = &lf->pieces[p];
+        long long n = piece->count - within < last - line ? piece->count - within : last - line;
+        if (piece->first < 0) {
+            // The slice of the piece's lines ends after a newline, unless it runs to its last line
+            char *s = largePieceSkip(piece, piece->text, within);
+            char *end = largePieceSkip(piece, s, n);
+            editorYankAppend(tc, y, -1, 0, s, end - s);
+            if (within + n == piece->count)
+                editorYankAppend(tc, y, -1, 0, "\n", 1);
+        } else {
+            editorYankAppend(tc, y, piece->first + within, n, NULL, 0);
+        }
+        line += n;
+        within = 0;
+    }
+
+    // Past the pieces, rows are the file's own lines
+    if (line < last)
+        editorYankAppend(tc, y, lf->covered + (line - lf->tableLines), last - line, NULL, 0);
+}
+
+
+void largeDelRows(texCore *tc, int first, int last) {
+    largeWindowDrop(tc, first);
+    largeSplice(tc, first, last, NULL, 0);
+
+    tc->numrows -= last - first;
+    editorViewsSpan(tc, first, last, first);
+    tc->dirty++;
+}
+
+
+void largeRowEdited(texCore *tc, erow *row) {
+    texLargeFile *lf = tc->large;
+    lf->winFile[row->idx - lf->winStart] = -1;
+    lf->winDirty = 1;
+}
+
+
+int largeFindInRows(texCore *tc, const char *query, int first, int last, int wantLast) {
+    texLargeFile *lf = tc->large;
+    int found = -1;
+    int at = first;
+
+    while (at < last) {
+        int end = lf->winStart + lf->winLen;
+        if (at >= lf->winStart && at < end) {
+            erow *row = lf->win[at - lf->winStart];
+            if (strstr(row->render, query)) {
+                found = at;
+                if (!wantLast)
+                    return found;
+            }
+            at++;
+            continue;
+        }
+
+        // Rows up to the window or to last, read from the pieces without materialising them
+        int stop = (at < lf->winStart && lf->winStart < last) ? lf->winStart : last;
+        long long line = largeTableLine(tc, at);
+        largeExtendTable(tc, line + (stop - at) - 1);
+
+        long long within;
+        int p = largePieceAt(tc, line, &within);
+        while (at < stop && p < lf->numPieces) {
+            texPiece *piece = &lf->pieces[p];
+            if (piece->first < 0) {
+                char *s = largePieceSkip(piece, piece->text, within);
+                char *end = piece->text + piece->len;
+                size_t queryLen = strlen(query);
+                for (; at < stop && within < piece->count; within++, at++) {
+                    char *nl = memchr(s, '\n', end - s);
+                    long long len = nl ? nl - s : end - s;
+                    if (memmem(s, len, query, queryLen)) {
+                        found = at;
+                        if (!wantLast)
+                            return found;
+                    }
+                    s += len + 1;
+                }
+            } else {
+                long long offset = largeLineOffset(tc, piece->first + within);
+                for (; at < stop && within < piece->count; within++, at++) {
+                    int len;
+                    char *s = largeReadLine(tc, &offset, &len);
+                    if (s && strstr(s, query)) {
+                        found = at;
+                        if (!wantLast)
+                            return found;
+                    }
+                }
+            }
+            p++;
+            within = 0;
+        }
+    }
+    return found;
+}
+
+
+int largeFind(texCore *tc, const char *query, int from, int direction, int *ro) {
+    int numrows = tc->numrows;
+    int found = -1;
+    if (numrows == 0)
+        return -1;
+
+    if (direction == 1) {
+        // After from to the end, then wrap around to the top
+        found = largeFindInRows(tc, query, from + 1, numrows, 0);
+        if (found == -1)
+            found = largeFindInRows(tc, query, 0, from + 1 < numrows ? from + 1 : numrows, 0);
+    } else {
+        if (from < 0 || from > numrows)
+            from = numrows;
+        // Lines can only be read forwards, so search backwards a block at a time
+        for (int hi = from; hi > 0 && found == -1; hi -= TEX_LARGE_INDEX_STRIDE) {
+            int lo = hi - TEX_LARGE_INDEX_STRIDE > 0 ? hi - TEX_LARGE_INDEX_STRIDE : 0;
+            found = largeFindInRows(tc, query, lo, hi, 1);
+        }
+        for (int hi = numrows; hi > from && found == -1; hi -= TEX_LARGE_INDEX_STRIDE) {
+            int lo = hi - TEX_LARGE_INDEX_STRIDE > from ? hi - TEX_LARGE_INDEX_STRIDE : from;
+            found = largeFindInRows(tc, query, lo, hi, 1);
+        }
+    }
+    if (found == -1)
+        return -1;
+
+    // Lines read from the pages were matched on chars, which may differ from render around tabs
+    erow *row = editorRowAt(tc, found);
+    char *match = strstr(row->render, query);
+    if (match) {
+        *ro = match - row->render;
+    } else {
+        match = strstr(row->chars, query);
+        *ro = match ? editorRowMapIndex(row, IDX_CHARS, IDX_RENDER, match - row->chars) : 0;
+    }
+    return found;
+}
+
+
+long long largeRead(texCore *tc, texGzip *gz, char *buf, long long len, long long offset) {
+    texLargeFile *lf = tc->large;
+    if (gz == NULL) {
+        ssize_t n;
+        do {
+            n = pread(lf->fd, buf, len, offset);
+        } while (n == -1 && errno == EINTR);
+        return n;
+    }
+
+    // Closest seek point at or before offset
+    texGzipPoint point;
+    int found = 0;
+    pthread_mutex_lock(&lf->lock);
+    int lo = 0;
+    int hi = lf->gzScan->numPoints - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (lf->gzScan->points[mid].out <= offset) {
+            point = lf->gzScan->points[mid];
+            found = 1;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    pthread_mutex_unlock(&lf->lock);
+
+    // Go back to it when offset has been passed, or forward when it's closer than where gz is
+    if (offset < gz->out || (found && point.out > gz->out)) {
+        if (found)
+            gzipSeek(gz, &point);
+        else
+            gzipReset(gz);
+    }
+
+    // Decompress up to offset into buf, then what's wanted over it
+    while (gz->out < offset) {
+        int n = gzipRead(gz, buf, offset - gz->out < len ? offset - gz->out : len);
+        if (n <= 0)
+            return n;
+    }
+    long long done = 0;
+    while (done < len) {
+        int n = gzipRead(gz, &buf[done], len - done);
+        if (n == -1)
+            return -1;
+        if (n == 0)
+            break;
+        done += n;
+    }
+    return done;
+}
+
+
+int largeWrite(texDeflate *z, int fd, const char *s, long long len) {
+    if (z)
+        return gzipWrite(z, s, len) == 0;
+    return write(fd, s, len) == len;
+}
+
+
+int largeCopyLines(texCore *tc, texGzip *gz, texDeflate *z, int fd, char *buf, long long from, long long to,
+        long long *total) {
+    char last = '\n';
+
+    // Straight from the file rather than through the cache, so copying doesn't evict the pages in view
+    while (from < to) {
+        int want = to - from < TEX_LARGE_COPY_SIZE ? to - from : TEX_LARGE_COPY_SIZE;
+        long long n = largeRead(tc, gz, buf, want, from);
+        if (n == 0 && gz)   // A gzip file's end is only found by decompressing up to it
+            break;
+        if (n <= 0 || !largeWrite(z, fd, buf, n))
+            return 0;
+        last = buf[n - 1];
+        from += n;
+        *total += n;
+    }
+
+    if (last != '\n') {
+        if (!largeWrite(z, fd, "\n", 1))
+            return 0;
+        (*total)++;
+    }
+    return 1;
+}
+
+
+long long largeWriteFile(texCore *tc) {
+    texLargeFile *lf = tc->large;
+    largeFlushWindow(tc);
+
+    // Write next to the file so it can be renamed over it
+    int pathLen = strlen(tc->filename) + 8;
+    char *path = texAlloc(tc, pathLen);
+    snprintf(path, pathLen, "%s.XXXXXX", tc->filename);
+    int fd = mkostemp(path, O_CLOEXEC);
+    if (fd == -1) {
+        free(path);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(lf->fd, &st) == 0)
+        fchmod(fd, st.st_mode & 07777);
+
+    // Compressed as it's written, and copied through a decompressor of its own so the one
+    // reading pages isn't moved back and forth
+    texDeflate *z = editorSaveCompressed(tc) ? gzipWriterOpen(fd) : NULL;
+    texGzip *gz = lf->gz ? gzipOpen(lf->fd) : NULL;
+    if ((z == NULL && editorSaveCompressed(tc)) || (gz == NULL && lf->gz)) {
+        gzipWriterClose(z);
+        gzipClose(gz);
+        close(fd);
+        unlink(path);
+        free(path);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    char *buf = texAlloc(tc, TEX_LARGE_COPY_SIZE);
+    long long total = 0;
+    int ok = 1;
+    for (int p = 0; ok && p < lf->numPieces; p++) {
+        texPiece *piece = &lf->pieces[p];
+        if (piece->first < 0) {
+            ok = largeWrite(z, fd, piece->text, piece->len) && largeWrite(z, fd, "\n", 1);
+            total += piece->len + 1;
+        } else {
+            long long from = largeLineOffset(tc, piece->first);
+            long long to = largeLineOffset(tc, piece->first + piece->count);
+            ok = largeCopyLines(tc, gz, z, fd, buf, from, to, &total);
+        }
+    }
+    // The rest of the file past the pieces is unchanged
+    if (ok)
+        ok = largeCopyLines(tc, gz, z, fd, buf, largeLineOffset(tc, lf->covered), gz ? LLONG_MAX : lf->size, &total);
+    free(buf);
+    gzipClose(gz);
+    if (z) {
+        total = gzipFinish(z);
+        if (total == -1)
+            ok = 0;
+    }
+
+    if (close(fd) == -1)
+        ok = 0;
+    if (ok && rename(path, tc->filename) == -1)
+        ok = 0;
+    if (!ok) {
+        int err = errno;
+        unlink(path);
+        free(path);
+        errno = err;
+        return -1;
+    }
+
+    free(path);
+    tc->dirty = 0;
+    return total;
+}
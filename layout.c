@@ -0,0 +1,172 @@
+#include "texcore.h"
+
+
+/*--------------------------------------------------------------------------
+                                  LAYOUT
+--------------------------------------------------------------------------*/
+
+int editorRowWrapLines(texCore *tc, erow *row) {
+    // Folded away rows aren't drawn at all
+    if (row->foldUp)
+        return 0;
+    if (tc->wrapCols <= 0)
+        return 1;
+
+    // Empty rows still take up a line
+    int width = editorRowCxToRx(row, row->size);
+    if (width == 0)
+        return 1;
+    return (width + tc->wrapCols - 1) / tc->wrapCols;
+}
+
+
+void editorLayoutAddRows(texCore *tc, int *sum, int first, int last, int sign) {
+    if (last > tc->numrows)
+        last = tc->numrows;
+    for (int r = first; r < last; r++)
+        *sum += sign * tc->row[r].wrapLines;
+}
+
+
+void editorLayoutInvalidate(texCore *tc) {
+    tc->wrapValid = 0;
+}
+
+
+void editorLayoutBuild(texCore *tc) {
+    int blocks = (tc->numrows + TEX_LAYOUT_BLOCK - 1) / TEX_LAYOUT_BLOCK;
+    int size = 1;
+    while (size < blocks)
+        size *= 2;
+    tc->wrapSize = size;
+    tc->wrapTree = texRealloc(tc, tc->wrapTree, sizeof(int) * 2 * size);
+    memset(&tc->wrapTree[size], 0, sizeof(int) * size);
+
+    for (int b = 0; b < blocks; b++)
+        editorLayoutAddRows(tc, &tc->wrapTree[size + b], b * TEX_LAYOUT_BLOCK, (b + 1) * TEX_LAYOUT_BLOCK, 1);
+    for (int node = size - 1; node > 0; node--)
+        tc->wrapTree[node] = tc->wrapTree[2 * node] + tc->wrapTree[2 * node + 1];
+    tc->wrapValid = 1;
+}
+
+
+void editorLayoutUpdateRow(texCore *tc, erow *row) {
+    int lines = editorRowWrapLines(tc, row);
+    int delta = lines - row->wrapLines;
+    row->wrapLines = lines;
+
+    // Tree is rebuilt from the cached counts when it's next needed
+    if (!tc->wrapValid || delta == 0)
+        return;
+
+    for (int node = tc->wrapSize + row->idx / TEX_LAYOUT_BLOCK; node > 0; node /= 2)
+        tc->wrapTree[node] += delta;
+}
+
+
+void editorLayoutMove(texCore *tc, int at, int n) {
+    // Rows filled in after the move are counted as they're filled
+    for (int r = at; r < at + n; r++)
+        tc->row[r].wrapLines = 0;
+
+    if (!tc->wrapValid || n == 0)
+        return;
+
+    int b = TEX_LAYOUT_BLOCK;
+    int blocks = (tc->numrows + b - 1) / b;
+    int oldBlocks = (tc->numrows - n + b - 1) / b;
+    if (n >= b || -n >= b || blocks > tc->wrapSize) {
+        editorLayoutInvalidate(tc);
+        return;
+    }
+
+    // Every block from two past the one at is in gains the rows shifted into its start and loses those shifted past its end
+    int *leaf = &tc->wrapTree[tc->wrapSize];
+    int first = at / b;
+    for (int k = first + 2; k < blocks; k++) {
+        int start = k * b;
+        if (n > 0) {
+            editorLayoutAddRows(tc, &leaf[k], start, start + n, 1);
+            editorLayoutAddRows(tc, &leaf[k], start + b, start + b + n, -1);
+        } else {
+            editorLayoutAddRows(tc, &leaf[k], start + n, start, -1);
+            editorLayoutAddRows(tc, &leaf[k], start + b + n, start + b, 1);
+        }
+    }
+
+    // The block at is in and the one after it are counted again, blocks past the end are emptied
+    int last = blocks > oldBlocks ? blocks : oldBlocks;
+    for (int k = first; k < last; k++) {
+        if (k < first + 2 || k >= blocks)
+            leaf[k] = 0;
+        if (k < first + 2 && k < blocks)
+            editorLayoutAddRows(tc, &leaf[k], k * b, (k + 1) * b, 1);
+    }
+    for (int node = tc->wrapSize - 1; node > 0; node--)
+        tc->wrapTree[node] = tc->wrapTree[2 * node] + tc->wrapTree[2 * node + 1];
+}
+
+
+void editorLayoutResize(texCore *tc, int cols) {
+    int old = tc->wrapCols;
+    tc->wrapCols = cols;
+    // Paged files are never wrapped, their rows are measured as they're paged in
+    if (cols == old || tc->large)
+        return;
+
+    for (int i = 0; i < tc->numrows; i++) {
+        erow *row = &tc->row[i];
+        // A one line row stays on one line when the rows get wider, or when it fits the new width in bytes
+        if (row->wrapLines == 1 && ((old > 0 && cols >= old) || row->rSize <= cols))
+            continue;
+        editorLayoutUpdateRow(tc, row);
+    }
+}
+
+
+int editorLayoutVisualLine(texCore *tc, int at) {
+    if (!tc->wrapValid)
+        editorLayoutBuild(tc);
+
+    if (at > tc->numrows)
+        at = tc->numrows;
+
+    // Whole blocks before at come from the tree, the rest of its own block a row at a time
+    int sum = 0;
+    int lb = at / TEX_LAYOUT_BLOCK;
+    editorLayoutAddRows(tc, &sum, lb * TEX_LAYOUT_BLOCK, at, 1);
+    for (int l = tc->wrapSize, r = tc->wrapSize + lb; l < r; l /= 2, r /= 2) {
+        if (l & 1)
+            sum += tc->wrapTree[l++];
+        if (r & 1)
+            sum += tc->wrapTree[--r];
+    }
+    return sum;
+}
+
+
+int editorLayoutRowAtVisual(texCore *tc, int v, int *sub) {
+    if (!tc->wrapValid)
+        editorLayoutBuild(tc);
+
+    // Past the last visual line of the file
+    if (v >= tc->wrapTree[1]) {
+        *sub = 0;
+        return tc->numrows;
+    }
+
+    // Descend the tree to the block v falls in
+    int node = 1;
+    while (node < tc->wrapSize) {
+        node *= 2;
+        if (tc->wrapTree[node] <= v)
+            v -= tc->wrapTree[node++];
+    }
+
+    // Then walk its rows for the first one whose visual lines end after v
+    int r = (node - tc->wrapSize) * TEX_LAYOUT_BLOCK;
+    while (r < tc->numrows && tc->row[r].wrapLines <= v)
+        v -= tc->row[r++].wrapLines;
+    *sub = v;
+    return r;
+}
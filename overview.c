@@ -0,0 +1,178 @@
+#include "texcore.h"
+
+
+/*--------------------------------------------------------------------------
+                                 OVERVIEW
+--------------------------------------------------------------------------*/
+
+void editorOverviewAddRows(texCore *tc, texOverviewNode *sum, int first, int last, int sign) {
+    if (last > tc->numrows)
+        last = tc->numrows;
+    for (int r = first; r < last; r++) {
+        sum->text += sign * tc->row[r].ovText;
+        sum->comment += sign * tc->row[r].ovComment;
+        sum->edited += sign * tc->row[r].ovEdited;
+    }
+}
+
+
+void editorOverviewPull(texCore *tc, int node) {
+    texOverviewNode *l = &tc->ovTree[2 * node], *r = &tc->ovTree[2 * node + 1];
+    tc->ovTree[node].text = l->text + r->text;
+    tc->ovTree[node].comment = l->comment + r->comment;
+    tc->ovTree[node].edited = l->edited + r->edited;
+}
+
+
+void editorOverviewRow(texCore *tc, erow *row) {
+    if (tc->large)
+        return;
+
+    int comment = 0;
+    for (int s = 0; s < row->numSpans; s++) {
+        if (row->spans[s].hl == HL_COMMENT || row->spans[s].hl == HL_MLCOMMENT)
+            comment += row->spans[s].len;
+    }
+
+    texOverviewNode delta = { row->rSize - row->ovText, comment - row->ovComment, row->edited - row->ovEdited };
+    if (delta.text == 0 && delta.comment == 0 && delta.edited == 0)
+        return;
+    row->ovText = row->rSize;
+    row->ovComment = comment;
+    row->ovEdited = row->edited;
+
+    // Tree is rebuilt from the cached counts when it's next needed
+    if (!tc->ovValid)
+        return;
+
+    int node = tc->ovSize + row->idx / TEX_OVERVIEW_BLOCK;
+    for (; node > 0; node /= 2) {
+        tc->ovTree[node].text += delta.text;
+        tc->ovTree[node].comment += delta.comment;
+        tc->ovTree[node].edited += delta.edited;
+    }
+}
+
+
+void editorOverviewInvalidate(texCore *tc) {
+    tc->ovValid = 0;
+}
+
+
+void editorOverviewBuild(texCore *tc) {
+    int blocks = (tc->numrows + TEX_OVERVIEW_BLOCK - 1) / TEX_OVERVIEW_BLOCK;
+    int size = 1;
+    while (size < blocks)
+        size *= 2;
+    tc->ovSize = size;
+    tc->ovTree = texRealloc(tc, tc->ovTree, sizeof(texOverviewNode) * 2 * size);
+    memset(&tc->ovTree[size], 0, sizeof(texOverviewNode) * size);
+
+    for (int b = 0; b < blocks; b++)
+        editorOverviewAddRows(tc, &tc->ovTree[size + b], b * TEX_OVERVIEW_BLOCK, (b + 1) * TEX_OVERVIEW_BLOCK, 1);
+    for (int node = size - 1; node > 0; node--)
+        editorOverviewPull(tc, node);
+    tc->ovValid = 1;
+}
+
+
+void editorOverviewMove(texCore *tc, int at, int n) {
+    if (!tc->ovValid || n == 0)
+        return;
+
+    // Rows filled in after the move are counted as they're filled
+    for (int r = at; r < at + n; r++) {
+        tc->row[r].ovText = 0;
+        tc->row[r].ovComment = 0;
+        tc->row[r].ovEdited = 0;
+    }
+
+    int b = TEX_OVERVIEW_BLOCK;
+    int blocks = (tc->numrows + b - 1) / b;
+    int oldBlocks = (tc->numrows - n + b - 1) / b;
+    if (n >= b || -n >= b || blocks > tc->ovSize) {
+        editorOverviewInvalidate(tc);
+        return;
+    }
+
+    /*
+        Every block from two past the one at is in has just shifted by n rows, so it gains the
+        rows now at its start and loses the ones pushed past its end, or the other way around
+    */
+    texOverviewNode *leaf = &tc->ovTree[tc->ovSize];
+    int first = at / b;
+    for (int k = first + 2; k < blocks; k++) {
+        int start = k * b;
+        if (n > 0) {
+            editorOverviewAddRows(tc, &leaf[k], start, start + n, 1);
+            editorOverviewAddRows(tc, &leaf[k], start + b, start + b + n, -1);
+        } else {
+            editorOverviewAddRows(tc, &leaf[k], start + n, start, -1);
+            editorOverviewAddRows(tc, &leaf[k], start + b + n, start + b, 1);
+        }
+    }
+
+    // The block at is in and the one after it are counted again, blocks past the end are emptied
+    int last = blocks > oldBlocks ? blocks : oldBlocks;
+    for (int k = first; k < last; k++) {
+        if (k < first + 2 || k >= blocks)
+            memset(&leaf[k], 0, sizeof(texOverviewNode));
+        if (k < first + 2 && k < blocks)
+            editorOverviewAddRows(tc, &leaf[k], k * b, (k + 1) * b, 1);
+    }
+    for (int node = tc->ovSize - 1; node > 0; node--)
+        editorOverviewPull(tc, node);
+}
+
+
+void editorOverviewSum(texCore *tc, int first, int last, texOverviewNode *sum) {
+    memset(sum, 0, sizeof(*sum));
+    if (tc->large)
+        return;
+    if (!tc->ovValid)
+        editorOverviewBuild(tc);
+
+    if (first < 0)
+        first = 0;
+    if (last > tc->numrows)
+        last = tc->numrows;
+
+    // Rows of the blocks either end only partly covers are read one at a time
+    int b = TEX_OVERVIEW_BLOCK;
+    int fb = (first + b - 1) / b;
+    int lb = last / b;
+    if (fb >= lb) {
+        editorOverviewAddRows(tc, sum, first, last, 1);
+        return;
+    }
+    editorOverviewAddRows(tc, sum, first, fb * b, 1);
+    editorOverviewAddRows(tc, sum, lb * b, last, 1);
+
+    // Sum the fewest nodes that cover the whole blocks between
+    for (int l = tc->ovSize + fb, r = tc->ovSize + lb; l < r; l /= 2, r /= 2) {
+        texOverviewNode *nodes[2] = { NULL, NULL };
+        if (l & 1)
+            nodes[0] = &tc->ovTree[l++];
+        if (r & 1)
+            nodes[1] = &tc->ovTree[--r];
+        for (int i = 0; i < 2; i++) {
+            if (nodes[i] == NULL)
+                continue;
+            sum->text += nodes[i]->text;
+            sum->comment += nodes[i]->comment;
+            sum->edited += nodes[i]->edited;
+        }
+    }
+}
+
+
+void editorOverviewSaved(texCore *tc) {
+    if (tc->large)
+        return;
+    for (int r = 0; r < tc->numrows; r++) {
+        tc->row[r].edited = 0;
+        tc->row[r].ovEdited = 0;
+    }
+    for (int node = 1; tc->ovValid && node < 2 * tc->ovSize; node++)
+        tc->ovTree[node].edited = 0;
+}
@@ -0,0 +1,569 @@
+#include "texcore.h"
+
+
+/*--------------------------------------------------------------------------
+                            ROW OPERATIONS
+--------------------------------------------------------------------------*/
+
+int colStopStart(colStop *stop, int index) {
+    switch (index) {
+        case IDX_CHARS:
+            return stop->cx;
+        case IDX_RENDER:
+            return stop->ro;
+        default:
+            return stop->rx;
+    }
+}
+
+
+int colStopLen(colStop *stop, int index) {
+    switch (index) {
+        case IDX_CHARS:
+            return stop->bytes;
+        case IDX_RENDER:
+            return stop->rBytes;
+        default:
+            return stop->width;
+    }
+}
+
+
+int editorRowMapIndex(erow *row, int from, int to, int idx) {
+    // Binary search for the number of stops that start at or to the left of idx
+    int lo = 0, hi = row->numStops;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (colStopStart(&row->stops[mid], from) <= idx)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    // No stops to the left of idx, every char so far is one byte and one column
+    if (lo == 0)
+        return idx;
+
+    colStop *stop = &row->stops[lo - 1];
+    int start = colStopStart(stop, from);
+    int len = colStopLen(stop, from);
+
+    // idx lands inside the stop, only a tab's columns map one to one onto its render spaces
+    if (idx < start + len) {
+        if (len == colStopLen(stop, to))
+            return colStopStart(stop, to) + (idx - start);
+        return colStopStart(stop, to);
+    }
+
+    // Every char between the end of the closest stop and idx is one byte and one column
+    return colStopStart(stop, to) + colStopLen(stop, to) + (idx - start - len);
+}
+
+
+int editorRowCxToRx(erow *row, int cx) {
+    return editorRowMapIndex(row, IDX_CHARS, IDX_COLUMN, cx);
+}
+
+
+int editorRowRxToCx(erow *row, int rx) {
+    int cx = editorRowMapIndex(row, IDX_COLUMN, IDX_CHARS, rx);
+
+    // Stop at the end of the row when rx is past it
+    if (cx > row->size)
+        cx = row->size;
+    return cx;
+}
+
+
+int editorRowRxToRo(erow *row, int rx) {
+    int ro = editorRowMapIndex(row, IDX_COLUMN, IDX_RENDER, rx);
+
+    if (ro > row->rSize)
+        ro = row->rSize;
+    return ro;
+}
+
+
+int editorRowRoToCx(erow *row, int ro) {
+    int cx = editorRowMapIndex(row, IDX_RENDER, IDX_CHARS, ro);
+
+    if (cx > row->size)
+        cx = row->size;
+    return cx;
+}
+
+
+int editorRowNextCx(erow *row, int cx) {
+    // Binary search for a stop starting at cx
+    int lo = 0, hi = row->numStops - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (row->stops[mid].cx < cx)
+            lo = mid + 1;
+        else if (row->stops[mid].cx > cx)
+            hi = mid - 1;
+        else
+            return cx + row->stops[mid].bytes;
+    }
+    return cx + 1;
+}
+
+
+int editorRowPrevCx(erow *row, int cx) {
+    // Binary search for the number of stops that start to the left of cx
+    int lo = 0, hi = row->numStops;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (row->stops[mid].cx < cx)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    // Jump back over the whole char if the byte before cx belongs to a stop
+    if (lo > 0 && row->stops[lo - 1].cx + row->stops[lo - 1].bytes >= cx)
+        return row->stops[lo - 1].cx;
+    return cx - 1;
+}
+
+
+void editorRowRenderChanged(texCore *tc, erow *row) {
+    editorLayoutUpdateRow(tc, row);
+    editorOverviewRow(tc, row);
+    editorViewsSpan(tc, row->idx, row->idx + 1, row->idx + 1);
+    if (tc->large == NULL) {
+        row->hash = editorHashLine(row->chars, row->size);
+        editorDiffSpan(tc, row->idx, row->idx + 1, row->idx + 1);
+    }
+
+    // Rows past the exactly highlighted ones are highlighted when they're next drawn, and a
+    // batched edit highlights the rows it changed once it's done
+    if (tc->hlDeferred) {
+        row->hlGuessed = 0;
+    } else if (row->idx < tc->hlUpTo) {
+        long start = texNow();
+        editorUpdateSyntax(tc, row);
+        tc->hlTime += texNow() - start;
+    } else {
+        row->hlGuessed = 0;
+    }
+}
+
+
+void editorUpdateRow(texCore *tc, erow *row) {
+    int tabs = 0;
+    int multibyte = 0;  // Non ASCII bytes, an upper bound on the multibyte chars in the row
+    int invalid = 0;    // Bytes that aren't valid UTF-8, each drawn as a three byte replacement char
+    int j;
+
+    // Count the tabs to calc the memory required for render
+    for (j = 0; j< row->size; j++) {
+        if (row->chars[j] == '\t') {
+            tabs++;
+        } else if ((unsigned char) row->chars[j] >= 0x80) {
+            int cp;
+            int len = utf8Decode(&row->chars[j], row->size - j, &cp);
+            multibyte += len;
+            invalid += (cp == UNICODE_INVALID && len == 1);
+            j += len - 1;
+        }
+    }
+
+    // Free any previous renders, a shared render is owned by chars
+    if (!row->renderShared)
+        free(row->render);
+
+    free(row->stops);
+    row->stops = NULL;
+    row->numStops = 0;
+
+    // No tabs to expand or bytes to replace, render is identical to chars so share the same memory
+    if (tabs == 0 && invalid == 0) {
+        row->render = row->chars;
+        row->renderShared = 1;
+        row->rSize = row->size;
+        // ASCII fast path, every char is one column wide so there are no stops to build
+        if (multibyte == 0) {
+            editorRowRenderChanged(tc, row);
+            return;
+        }
+    } else {
+        row->render = texAlloc(tc, row->size + tabs * (TEX_TAB_STOP - 1) + invalid * 2 + 1); //Allocate memory for new render
+        row->renderShared = 0;
+    }
+    row->stops = texAlloc(tc, sizeof(colStop) * (tabs + multibyte));
+    
+    int idx = 0;    // Number of characters copied into row->render
+    int rx = 0;     // Column of the next char
+
+    j = 0;
+    while (j < row->size) {
+        colStop *stop = &row->stops[row->numStops];
+
+        if (row->chars[j] == '\t') {
+            stop->cx = j;
+            stop->ro = idx;
+            stop->rx = rx;
+            stop->bytes = 1;
+            stop->width = TEX_TAB_STOP - (rx % TEX_TAB_STOP);
+            stop->rBytes = stop->width;
+
+            memset(&row->render[idx], ' ', stop->width);
+            idx += stop->width;
+            rx += stop->width;
+            row->numStops++;
+            j++;
+            continue;
+        }
+
+        // ASCII char, unless a combining mark follows it
+        if ((unsigned char) row->chars[j] < 0x80 &&
+            (j + 1 == row->size || (unsigned char) row->chars[j + 1] < 0x80)) {
+            if (!row->renderShared)
+                row->render[idx] = row->chars[j];
+            idx++;
+            rx++;
+            j++;
+            continue;
+        }
+
+        // Decode a char, along with any combining marks or joined chars that follow it
+        int cp;
+        int len = utf8Decode(&row->chars[j], row->size - j, &cp);
+
+        // An invalid byte is drawn as a single column replacement char
+        if (cp == UNICODE_INVALID && len == 1) {
+            stop->cx = j;
+            stop->ro = idx;
+            stop->rx = rx;
+            stop->bytes = 1;
+            stop->rBytes = 3;
+            stop->width = 1;
+            row->numStops++;
+
+            memcpy(&row->render[idx], UNICODE_INVALID_UTF8, 3);
+            idx += 3;
+            rx++;
+            j++;
+            continue;
+        }
+
+        int width = unicodeWidth(cp);
+        int joined = (cp == UNICODE_ZWJ);
+
+        while (j + len < row->size && (unsigned char) row->chars[j + len] >= 0x80) {
+            int next;
+            int nextLen = utf8Decode(&row->chars[j + len], row->size - j - len, &next);
+            if ((!joined && unicodeWidth(next) != 0) || (next == UNICODE_INVALID && nextLen == 1) ||
+                len + nextLen > 255)
+                break;
+            len += nextLen;
+            joined = (next == UNICODE_ZWJ);
+        }
+
+        if (len > 1 || width != 1) {
+            stop->cx = j;
+            stop->ro = idx;
+            stop->rx = rx;
+            stop->bytes = len;
+            stop->rBytes = len;
+            stop->width = width;
+            row->numStops++;
+        }
+
+        if (!row->renderShared)
+            memcpy(&row->render[idx], &row->chars[j], len);
+        idx += len;
+        rx += width;
+        j += len;
+    }
+
+    if (!row->renderShared) {
+        row->render[idx] = '\0';
+        row->rSize = idx;
+    }
+
+    // Release the unused part of the upper bound
+    if (row->numStops == 0) {
+        free(row->stops);
+        row->stops = NULL;
+    } else if (row->numStops < tabs + multibyte) {
+        row->stops = texRealloc(tc, row->stops, sizeof(colStop) * row->numStops);
+    }
+
+    editorRowRenderChanged(tc, row);
+}
+
+
+erow *editorRowAt(texCore *tc, int at) {
+    if (tc->large)
+        return largeRowAt(tc, at);
+    return &tc->row[at];
+}
+
+
+void editorInitRow(texCore *tc, erow *row, int at, char *s, size_t len) {
+    row->idx = at;
+    row->size = len;
+    row->chars = texAlloc(tc, len + 1);
+
+    // Copy string into row's char array
+    memcpy(row->chars, s, len);
+    row->chars[len] = '\0';    // Add NULL terminator
+
+    // Reset rSize & render
+    row->rSize = 0;
+    row->renderShared = 0;
+    row->render = NULL;
+    row->spans = NULL;
+    row->numSpans = 0;
+    row->stops = NULL;
+    row->numStops = 0;
+    row->wrapLines = 0;
+    row->hlGuessed = 0;
+    row->hl_open_comment = 0;
+    row->brDelta = 0;
+    row->brMin = 0;
+    row->foldLines = 0;
+    row->foldUp = 0;
+    row->edited = !tc->loading;
+    row->ovEdited = 0;
+    row->ovText = 0;
+    row->ovComment = 0;
+    editorUpdateRow(tc, row);    // Update render & rSize fields with the new row content
+
+    // Rows read from the file are the file on disk
+    if (tc->loading && tc->large == NULL)
+        editorDiffAddBase(tc, row->hash);
+}
+
+
+void editorInsertRow(texCore *tc, int at, char *s, size_t len) {
+    // Validate at before inserting row
+    if (at < 0 || at > tc->numrows)
+        return;
+
+    if (tc->large) {
+        largeInsertRow(tc, at, s, len);
+        return;
+    }
+
+    // A row going in among folded ones shows them
+    editorFoldReveal(tc, at);
+
+    // Reallocate space for new row
+    tc->row = texRealloc(tc, tc->row, sizeof(erow) * (tc->numrows + 1));
+    // Make room at the specified index for the new row
+    memmove(&tc->row[at + 1], &tc->row[at], sizeof(erow) * (tc->numrows - at));
+
+    for (int j = at + 1; j <= tc->numrows; j++)
+        tc->row[j].idx++;
+
+    tc->numrows++;
+    editorLayoutMove(tc, at, 1);
+    editorBracketsMove(tc, at, 1);
+    editorOverviewMove(tc, at, 1);
+    editorDiffSpan(tc, at, at, at + 1);
+    editorViewsSpan(tc, at, at, at + 1);
+
+    // Highlight the new row straight away if it's inside the exactly highlighted rows
+    if (at < tc->hlUpTo)
+        tc->hlUpTo++;
+    editorInitRow(tc, &tc->row[at], at, s, len);
+
+    tc->dirty++;  // Increment dirty after changing text
+}
+
+
+void editorInsertLines(texCore *tc, int at, const char *s, long long len) {
+    if (at < 0 || at > tc->numrows)
+        return;
+
+    // Every line ends at a newline except the last, which ends at len
+    int n = 1;
+    for (const char *nl = s; (nl = memchr(nl, '\n', s + len - nl)) != NULL; nl++)
+        n++;
+
+    if (tc->large) {
+        largeInsertLines(tc, at, s, len, n);
+        return;
+    }
+
+    editorFoldReveal(tc, at);
+
+    // Make room for every line with a single move of the rows after at
+    tc->row = texRealloc(tc, tc->row, sizeof(erow) * (tc->numrows + n));
+    memmove(&tc->row[at + n], &tc->row[at], sizeof(erow) * (tc->numrows - at));
+    for (int j = at + n; j < tc->numrows + n; j++)
+        tc->row[j].idx += n;
+    tc->numrows += n;
+    editorLayoutMove(tc, at, n);
+    editorBracketsMove(tc, at, n);
+    editorOverviewMove(tc, at, n);
+    editorDiffSpan(tc, at, at, at + n);
+    editorViewsSpan(tc, at, at, at + n);
+
+    int deferred = tc->hlDeferred;
+    tc->hlDeferred = 1;
+    const char *end = s + len;
+    for (int i = 0; i < n; i++) {
+        const char *nl = memchr(s, '\n', end - s);
+        int lineLen = nl ? nl - s : end - s;
+        editorInitRow(tc, &tc->row[at + i], at + i, (char *) s, lineLen);
+        s += lineLen + 1;
+    }
+    // The row below was highlighted following the row above the new ones
+    tc->row[at + n - 1].hl_open_comment = (at > 0 && tc->row[at - 1].hl_open_comment);
+    tc->hlDeferred = deferred;
+
+    if (at < tc->hlUpTo)
+        tc->hlUpTo += n;
+    if (!deferred)
+        editorHighlightRange(tc, at, at + n - 1);
+    tc->dirty++;
+}
+
+
+void editorFreeRow(erow *row) {
+    if (!row->renderShared)
+        free(row->render);
+    free(row->chars);
+    free(row->spans);
+    free(row->stops);
+}
+
+
+void editorDelRow(texCore *tc, int at) {
+    // Return if row is undeletable (after EOF)
+    if (at < 0 || at >= tc->numrows)
+        return;
+
+    if (tc->large) {
+        largeDelRow(tc, at);
+        return;
+    }
+
+    editorUnfoldRows(tc, at, at + 1);
+
+    int open = tc->row[at].hl_open_comment;
+    editorFreeRow(&tc->row[at]);  // Free memory used by the row
+    // Overwrite the deleted row struct with the rest of the rows that come after it
+    memmove(&tc->row[at], &tc->row[at + 1], sizeof(erow) * (tc->numrows - at - 1));
+    
+    for (int j = at; j < tc->numrows - 1; j++)
+        tc->row[j].idx--;
+
+    tc->numrows--;    // Decrement numrows after deletion
+    editorLayoutMove(tc, at, -1);
+    editorBracketsMove(tc, at, -1);
+    editorOverviewMove(tc, at, -1);
+    editorDiffSpan(tc, at, at + 1, at);
+    editorViewsSpan(tc, at, at + 1, at);
+
+    if (at < tc->hlUpTo) {
+        tc->hlUpTo--;
+        // The row that moved into at now follows a row that may open or close a comment differently
+        int prevOpen = (at > 0 && tc->row[at - 1].hl_open_comment);
+        if (open != prevOpen && at < tc->hlUpTo)
+            editorUpdateSyntax(tc, &tc->row[at]);
+    }
+    tc->dirty++;      // Mark as modified
+}
+
+
+void editorDelRows(texCore *tc, int first, int last) {
+    if (first < 0)
+        first = 0;
+    if (last > tc->numrows)
+        last = tc->numrows;
+    if (first >= last)
+        return;
+
+    if (tc->large) {
+        largeDelRows(tc, first, last);
+        return;
+    }
+
+    // Folds losing any of their rows are shown first
+    editorUnfoldRows(tc, first, last);
+
+    int open = tc->row[last - 1].hl_open_comment;
+    for (int j = first; j < last; j++)
+        editorFreeRow(&tc->row[j]);
+    // Close the gap with a single move of the rows after it
+    int n = last - first;
+    memmove(&tc->row[first], &tc->row[last], sizeof(erow) * (tc->numrows - last));
+    tc->numrows -= n;
+    for (int j = first; j < tc->numrows; j++)
+        tc->row[j].idx -= n;
+    editorLayoutMove(tc, first, -n);
+    editorBracketsMove(tc, first, -n);
+    editorOverviewMove(tc, first, -n);
+    editorDiffSpan(tc, first, last, first);
+    editorViewsSpan(tc, first, last, first);
+
+    if (tc->hlUpTo > first) {
+        tc->hlUpTo = tc->hlUpTo > last ? tc->hlUpTo - n : first;
+        // The row that moved into first now follows a row that may open or close a comment differently
+        int prevOpen = (first > 0 && tc->row[first - 1].hl_open_comment);
+        if (open != prevOpen && first < tc->hlUpTo && !tc->hlDeferred)
+            editorUpdateSyntax(tc, &tc->row[first]);
+    }
+    tc->dirty++;
+}
+
+
+void editorRowInsertChar(texCore *tc, erow *row, int at, int c) {
+    // Validate at before assignment
+    if (at < 0 || at > row->size)
+        at = row->size;
+    
+    // Allocate extra byte for char and NULL byte
+    row->chars = texRealloc(tc, row->chars, row->size + 2);
+    // Make room for new char
+    memmove(&row->chars[at + 1], &row->chars[at], row->size - at + 1);
+    row->size++;        // Increment size
+    row->chars[at] = c; // Assign char to position in the array
+    editorUpdateRow(tc, row);   // Update render & rSize fields with the new row content
+    editorRowEdited(tc, row);
+}
+
+
+void editorRowAppendString(texCore *tc, erow *row, char *s, size_t len) {
+    // Realloc enough memory for the new string
+    row->chars = texRealloc(tc, row->chars, row->size + len + 1);
+    // memcpy the string to the end of the contents of row->chars
+    memcpy(&row->chars[row->size], s, len);
+    row->size += len;   // Increment size with length of new string
+    row->chars[row->size] = '\0';   // Add Null terminator to end
+    editorUpdateRow(tc, row);   // Update row
+    editorRowEdited(tc, row);
+}
+
+
+void editorRowDelChar(texCore *tc, erow *row, int at) {
+    // Return if undeletable
+    if (at < 0 || at >= row->size)
+        return;
+
+    // Delete every byte of a multibyte char
+    int len = editorRowNextCx(row, at) - at;
+
+    // Overwrite the char to delete with the chars that come after it
+    memmove(&row->chars[at], &row->chars[at + len], row->size - at - len + 1);
+
+    row->size -= len;   // Decrement size after removing char
+    editorUpdateRow(tc, row);   // Update row
+    editorRowEdited(tc, row);
+}
+
+
+void editorRowEdited(texCore *tc, erow *row) {
+    if (tc->large)
+        largeRowEdited(tc, row);
+    tc->dirty++;  // Mark as modified
+    if (!row->edited) {
+        row->edited = 1;
+        editorOverviewRow(tc, row);
+    }
+}
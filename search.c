@@ -0,0 +1,128 @@
+#include "texcore.h"
+
+
+/*--------------------------------------------------------------------------
+                                  SEARCH
+--------------------------------------------------------------------------*/
+
+int editorFindNext(texCore *tc, const char *query, int from, int direction, int *ro) {
+    if (tc->large)
+        return largeFind(tc, query, from, direction, ro);
+
+    int current = from;
+
+    // Loop through rows in the file, wrapping around at either end
+    for (int i = 0; i < tc->numrows; i++) {
+        current += direction;
+
+        if (current == -1)
+            current = tc->numrows - 1;
+        else if (current == tc->numrows)
+            current = 0;
+
+        erow *row = &tc->row[current];
+        // Check if query is found in the row, return pointer to the matching substring
+        char *match = strstr(row->render, query);
+        if (match) {
+            *ro = match - row->render;
+            return current;
+        }
+    }
+    return -1;
+}
+
+
+void editorSearchIndexStart(texCore *tc, texSearchIndex *ix, const char *query) {
+    // Copied first, query may be the index's own
+    char *copy = query && query[0] && tc->large == NULL ? strdup(query) : NULL;
+    free(ix->query);
+    ix->query = copy;
+    ix->numRows = 0;
+    ix->scanned = 0;
+    ix->matches = 0;
+}
+
+
+int editorSearchIndexStep(texCore *tc, texSearchIndex *ix, int n) {
+    if (ix->query == NULL)
+        return 0;
+
+    int len = strlen(ix->query);
+    int last = ix->scanned + n < tc->numrows ? ix->scanned + n : tc->numrows;
+    for (; ix->scanned < last; ix->scanned++) {
+        erow *row = &tc->row[ix->scanned];
+        char *match = strstr(row->render, ix->query);
+        if (match == NULL)
+            continue;
+
+        if (ix->numRows == ix->cap) {
+            ix->cap = ix->cap ? ix->cap * 2 : 64;
+            ix->rows = texRealloc(tc, ix->rows, sizeof(int) * ix->cap);
+        }
+        ix->rows[ix->numRows++] = ix->scanned;
+        for (; match; match = strstr(match + len, ix->query))
+            ix->matches++;
+    }
+    return ix->scanned < tc->numrows;
+}
+
+
+int editorSearchIndexDone(texCore *tc, texSearchIndex *ix) {
+    return ix->query && ix->scanned >= tc->numrows;
+}
+
+
+int editorSearchIndexFind(texSearchIndex *ix, int from, int direction) {
+    if (ix->numRows == 0)
+        return -1;
+
+    // First indexed row after from
+    int lo = 0;
+    int hi = ix->numRows;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (ix->rows[mid] <= from)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (direction > 0)
+        return ix->rows[lo < ix->numRows ? lo : 0];
+
+    // Or the last one before it, stepping back over from itself
+    int i = lo - 1;
+    if (i >= 0 && ix->rows[i] == from)
+        i--;
+    return ix->rows[i >= 0 ? i : ix->numRows - 1];
+}
+
+
+int editorSearchIndexCount(texSearchIndex *ix, int first, int last) {
+    // First indexed row at or after each end
+    int ends[2] = { first, last };
+    for (int e = 0; e < 2; e++) {
+        int lo = 0;
+        int hi = ix->numRows;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (ix->rows[mid] < ends[e])
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        ends[e] = lo;
+    }
+    return ends[1] - ends[0];
+}
+
+
+void editorSearchIndexFree(texSearchIndex *ix) {
+    free(ix->query);
+    free(ix->rows);
+    ix->query = NULL;
+    ix->rows = NULL;
+    ix->numRows = 0;
+    ix->cap = 0;
+    ix->scanned = 0;
+    ix->matches = 0;
+}
@@ -0,0 +1,218 @@
+#include "texcore.h"
+
+
+/*--------------------------------------------------------------------------
+                                SELECTION
+--------------------------------------------------------------------------*/
+
+void editorSelectStart(texCore *tc, int mode) {
+    tc->selMode = mode;
+    tc->selCx = tc->cx;
+    tc->selCy = tc->cy;
+}
+
+
+void editorSelectClear(texCore *tc) {
+    tc->selMode = SEL_NONE;
+}
+
+
+int editorSelectionBounds(texCore *tc, int *y0, int *x0, int *y1, int *x1) {
+    if (tc->selMode == SEL_NONE || tc->numrows == 0)
+        return 0;
+
+    int ay = tc->selCy, ax = tc->selCx;
+    int by = tc->cy, bx = tc->cx;
+    // The tilde line after EOF selects up to the end of the last row
+    if (ay >= tc->numrows) {
+        ay = tc->numrows - 1;
+        ax = editorRowAt(tc, ay)->size;
+    }
+    if (by >= tc->numrows) {
+        by = tc->numrows - 1;
+        bx = editorRowAt(tc, by)->size;
+    }
+
+    if (tc->selMode == SEL_COLUMN) {
+        // A column selection spans the same screen columns on every row, whatever chars are in them
+        ax = editorRowCxToRx(editorRowAt(tc, ay), ax);
+        bx = editorRowCxToRx(editorRowAt(tc, by), bx);
+        *y0 = ay < by ? ay : by;
+        *y1 = ay < by ? by : ay;
+        *x0 = ax < bx ? ax : bx;
+        *x1 = ax < bx ? bx : ax;
+        return *x0 != *x1;
+    }
+
+    if (ay < by || (ay == by && ax <= bx)) {
+        *y0 = ay, *x0 = ax, *y1 = by, *x1 = bx;
+    } else {
+        *y0 = by, *x0 = bx, *y1 = ay, *x1 = ax;
+    }
+    return *y0 != *y1 || *x0 != *x1;
+}
+
+
+int editorSelectionOnRow(texCore *tc, erow *row, int *start, int *end) {
+    int y0, x0, y1, x1;
+    if (!editorSelectionBounds(tc, &y0, &x0, &y1, &x1) || row->idx < y0 || row->idx > y1)
+        return 0;
+
+    if (tc->selMode == SEL_COLUMN) {
+        *start = editorRowRxToRo(row, x0);
+        *end = editorRowRxToRo(row, x1);
+    } else {
+        *start = row->idx == y0 ? editorRowMapIndex(row, IDX_CHARS, IDX_RENDER, x0) : 0;
+        *end = row->idx == y1 ? editorRowMapIndex(row, IDX_CHARS, IDX_RENDER, x1) : row->rSize;
+    }
+    return *start < *end;
+}
+
+
+char *editorCopySelection(texCore *tc, long long *len) {
+    int y0, x0, y1, x1;
+    *len = 0;
+    if (!editorSelectionBounds(tc, &y0, &x0, &y1, &x1))
+        return NULL;
+
+    char *buf = NULL;
+    long long cap = 0;
+    long long n = 0;
+    for (int r = y0; r <= y1; r++) {
+        if (tc->large)
+            largeWalkRows(tc, r, y1 + 1);
+        erow *row = editorRowAt(tc, r);
+        int from = r == y0 ? x0 : 0;
+        int to = r == y1 ? x1 : row->size;
+        if (tc->selMode == SEL_COLUMN) {
+            from = editorRowRxToCx(row, x0);
+            to = editorRowRxToCx(row, x1);
+        }
+
+        if (n + (to - from) + 2 > cap) {
+            cap = cap * 2 > n + (to - from) + 2 ? cap * 2 : n + (to - from) + 2;
+            buf = texRealloc(tc, buf, cap);
+        }
+        memcpy(&buf[n], &row->chars[from], to - from);
+        n += to - from;
+        if (r < y1)
+            buf[n++] = '\n';
+    }
+    buf[n] = '\0';
+    *len = n;
+    return buf;
+}
+
+
+int editorDeleteSelection(texCore *tc) {
+    int y0, x0, y1, x1;
+    if (!editorSelectionBounds(tc, &y0, &x0, &y1, &x1))
+        return 0;
+    int mode = tc->selMode;
+    tc->selMode = SEL_NONE;
+    tc->hlDeferred = 1;
+
+    if (mode == SEL_COLUMN) {
+        // Cut the columns out of each row in place, a row at a time
+        for (int r = y0; r <= y1; r++) {
+            if (tc->large)
+                largeWalkRows(tc, r, y1 + 1);
+            erow *row = editorRowAt(tc, r);
+            int from = editorRowRxToCx(row, x0);
+            int to = editorRowRxToCx(row, x1);
+            if (from == to)
+                continue;
+            memmove(&row->chars[from], &row->chars[to], row->size - to + 1);
+            row->size -= to - from;
+            editorUpdateRow(tc, row);
+            editorRowEdited(tc, row);
+        }
+        tc->hlDeferred = 0;
+        editorHighlightRange(tc, y0, y1);
+
+        if (tc->cy > y1)
+            tc->cy = y1;
+        tc->cx = editorRowRxToCx(editorRowAt(tc, tc->cy), x0);
+        return 1;
+    }
+
+    // Join what's left of the first and last rows, with the whole rows between them spliced out at once
+    erow *row = editorRowAt(tc, y1);
+    int tailLen = row->size - x1;
+    int open = row->hl_open_comment;
+    char *tail = texAlloc(tc, tailLen + 1);
+    memcpy(tail, &row->chars[x1], tailLen + 1);
+    editorDelRows(tc, y0 + 1, y1 + 1);
+
+    row = editorRowAt(tc, y0);
+    row->chars = texRealloc(tc, row->chars, x0 + tailLen + 1);
+    memcpy(&row->chars[x0], tail, tailLen + 1);
+    row->size = x0 + tailLen;
+    free(tail);
+    // The row below the joined ones was highlighted following the last of them
+    if (y1 > y0)
+        row->hl_open_comment = open;
+    editorUpdateRow(tc, row);
+    editorRowEdited(tc, row);
+
+    tc->hlDeferred = 0;
+    editorHighlightRange(tc, y0, y0);
+    tc->cx = x0;
+    tc->cy = y0;
+    return 1;
+}
+
+
+void editorIndentSelection(texCore *tc, int dedent) {
+    int y0, x0, y1, x1;
+    if (!editorSelectionBounds(tc, &y0, &x0, &y1, &x1)) {
+        y0 = y1 = tc->cy;
+    } else if (tc->selMode == SEL_LINEAR && y1 > y0 && x1 == 0) {
+        // A selection ending at the start of a row doesn't take that row with it
+        y1--;
+    }
+    if (y0 >= tc->numrows)
+        return;
+
+    tc->hlDeferred = 1;
+    for (int r = y0; r <= y1; r++) {
+        if (tc->large)
+            largeWalkRows(tc, r, y1 + 1);
+        erow *row = editorRowAt(tc, r);
+        int delta;
+
+        if (dedent) {
+            // Take away a tab, or up to a tab stop's worth of spaces
+            delta = 0;
+            if (row->size > 0 && row->chars[0] == '\t')
+                delta = 1;
+            else
+                while (delta < row->size && delta < TEX_TAB_STOP && row->chars[delta] == ' ')
+                    delta++;
+            if (delta == 0)
+                continue;
+            memmove(row->chars, &row->chars[delta], row->size - delta + 1);
+            row->size -= delta;
+            delta = -delta;
+        } else {
+            // Blank rows are left alone
+            if (row->size == 0)
+                continue;
+            row->chars = texRealloc(tc, row->chars, row->size + 2);
+            memmove(&row->chars[1], row->chars, row->size + 1);
+            row->chars[0] = '\t';
+            row->size++;
+            delta = 1;
+        }
+        editorUpdateRow(tc, row);
+        editorRowEdited(tc, row);
+
+        // Keep the cursor and the anchor on the same chars, a row selected from its start stays that way
+        if (r == tc->cy && (dedent || tc->cx > 0))
+            tc->cx = tc->cx + delta > 0 ? tc->cx + delta : 0;
+        if (r == tc->selCy && tc->selMode != SEL_NONE && (dedent || tc->selCx > 0))
+            tc->selCx = tc->selCx + delta > 0 ? tc->selCx + delta : 0;
+    }
+    tc->hlDeferred = 0;
+    editorHighlightRange(tc, y0, y1);
+}
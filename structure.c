@@ -0,0 +1,539 @@
+#include "texcore.h"
+
+
+/*--------------------------------------------------------------------------
+                                STRUCTURE
+--------------------------------------------------------------------------*/
+
+int editorBracketDelta(char c) {
+    if (c == '(' || c == '[' || c == '{')
+        return 1;
+    if (c == ')' || c == ']' || c == '}')
+        return -1;
+    return 0;
+}
+
+
+int editorRowBracket(erow *row, int i, int *s) {
+    int delta = editorBracketDelta(row->render[i]);
+    if (delta == 0 || row->numSpans == 0)
+        return delta;
+
+    // Last span starting at or before i
+    while (*s + 1 < row->numSpans && row->spans[*s + 1].start <= i)
+        (*s)++;
+    while (*s > 0 && row->spans[*s].start > i)
+        (*s)--;
+
+    hlSpan *span = &row->spans[*s];
+    if (span->start <= i && i < span->start + span->len &&
+        (span->hl == HL_STRING || span->hl == HL_COMMENT || span->hl == HL_MLCOMMENT))
+        return 0;
+    return delta;
+}
+
+
+void editorRowBrackets(texCore *tc, erow *row) {
+    int depth = 0, min = 0;
+    int s = 0;
+    for (int i = 0; i < row->rSize; i++) {
+        depth += editorRowBracket(row, i, &s);
+        if (depth < min)
+            min = depth;
+    }
+
+    if (depth == row->brDelta && min == row->brMin)
+        return;
+    row->brDelta = depth;
+    row->brMin = min;
+
+    // Tree is rebuilt from the cached sums when it's next needed, less the blocks it's already built
+    if (!tc->brValid) {
+        int b = row->idx / TEX_BRACKET_BLOCK;
+        if (b < tc->brBuilt)
+            editorBracketsLeaf(tc, tc->brSize + b, b * TEX_BRACKET_BLOCK);
+        return;
+    }
+
+    int lo;
+    int node = editorBracketsFind(tc, row->idx, &lo);
+    editorBracketsLeaf(tc, node, lo);
+    for (node /= 2; node > 0; node /= 2)
+        editorBracketsPull(tc, node);
+}
+
+
+void editorBracketsLeaf(texCore *tc, int node, int lo) {
+    texBracketNode *leaf = &tc->brTree[node];
+    leaf->sum = 0;
+    leaf->min = 0;
+    for (int r = lo; r < lo + leaf->rows; r++) {
+        if (leaf->sum + tc->row[r].brMin < leaf->min)
+            leaf->min = leaf->sum + tc->row[r].brMin;
+        leaf->sum += tc->row[r].brDelta;
+    }
+}
+
+
+void editorBracketsPull(texCore *tc, int node) {
+    // A run's lowest depth is in its first half, or in its second half starting from the first's end
+    texBracketNode *l = &tc->brTree[2 * node], *r = &tc->brTree[2 * node + 1];
+    tc->brTree[node].sum = l->sum + r->sum;
+    tc->brTree[node].min = l->min < l->sum + r->min ? l->min : l->sum + r->min;
+    tc->brTree[node].rows = l->rows + r->rows;
+}
+
+
+int editorBracketsFind(texCore *tc, int at, int *lo) {
+    int node = 1;
+    *lo = 0;
+    while (node < tc->brSize) {
+        node *= 2;
+        if (at >= *lo + tc->brTree[node].rows)
+            *lo += tc->brTree[node++].rows;
+    }
+    return node;
+}
+
+
+void editorBracketsInvalidate(texCore *tc) {
+    tc->brValid = 0;
+    tc->brBuilt = 0;
+}
+
+
+int editorBracketsBuildStep(texCore *tc, int n) {
+    if (tc->brValid)
+        return 0;
+
+    int b = TEX_BRACKET_BLOCK;
+    int blocks = (tc->numrows + b - 1) / b;
+    if (tc->brBuilt == 0 || blocks > tc->brSize) {
+        tc->brBuilt = 0;
+        int size = 1;
+        while (size < blocks)
+            size *= 2;
+        tc->brSize = size;
+        tc->brTree = texRealloc(tc, tc->brTree, sizeof(texBracketNode) * 2 * size);
+    }
+
+    for (; n > 0 && tc->brBuilt < blocks; n--, tc->brBuilt++) {
+        int lo = tc->brBuilt * b;
+        int node = tc->brSize + tc->brBuilt;
+        tc->brTree[node].rows = tc->numrows - lo < b ? tc->numrows - lo : b;
+        editorBracketsLeaf(tc, node, lo);
+    }
+    if (tc->brBuilt < blocks)
+        return 1;
+
+    // Leaves past the last row change nothing
+    memset(&tc->brTree[tc->brSize + blocks], 0, sizeof(texBracketNode) * (tc->brSize - blocks));
+    for (int node = tc->brSize - 1; node > 0; node--)
+        editorBracketsPull(tc, node);
+    tc->brValid = 1;
+    return 0;
+}
+
+
+void editorBracketsBuild(texCore *tc) {
+    editorBracketsBuildStep(tc, tc->numrows / TEX_BRACKET_BLOCK + 1);
+}
+
+
+void editorBracketsMove(texCore *tc, int at, int n) {
+    // Rows filled in after the move are summed as they're highlighted
+    for (int r = at; r < at + n; r++) {
+        tc->row[r].brDelta = 0;
+        tc->row[r].brMin = 0;
+    }
+    if (n == 0)
+        return;
+
+    // A build part way through keeps the blocks before at, unless the rows have outgrown its tree
+    int b = TEX_BRACKET_BLOCK;
+    if (!tc->brValid) {
+        if (tc->brBuilt > at / b)
+            tc->brBuilt = at / b;
+        if ((tc->numrows + b - 1) / b > tc->brSize)
+            tc->brBuilt = 0;
+        return;
+    }
+
+    int lo;
+    if (n > 0) {
+        // New rows join the block at is in, or the last block when they're added at the end
+        int node = editorBracketsFind(tc, at > 0 && at == tc->numrows - n ? at - 1 : at, &lo);
+        if (tc->brTree[node].rows + n > TEX_BRACKET_BLOCK_MAX) {
+            editorBracketsInvalidate(tc);
+            return;
+        }
+        tc->brTree[node].rows += n;
+        editorBracketsLeaf(tc, node, lo);
+        for (node /= 2; node > 0; node /= 2)
+            editorBracketsPull(tc, node);
+        return;
+    }
+
+    // Each block the deleted rows were in keeps the rest of its rows, which now follow on from at
+    for (int left = -n; left > 0;) {
+        int node = editorBracketsFind(tc, at, &lo);
+        int cut = lo + tc->brTree[node].rows - at;
+        if (cut > left)
+            cut = left;
+        tc->brTree[node].rows -= cut;
+        left -= cut;
+        editorBracketsLeaf(tc, node, lo);
+        for (node /= 2; node > 0; node /= 2)
+            editorBracketsPull(tc, node);
+    }
+}
+
+
+int editorBracketDepth(texCore *tc, int at) {
+    if (!tc->brValid)
+        editorBracketsBuild(tc);
+
+    // Sum the runs before the block at is in, then the rows of that block before it
+    int sum = 0;
+    int node = 1, lo = 0;
+    while (node < tc->brSize) {
+        node *= 2;
+        if (at >= lo + tc->brTree[node].rows) {
+            sum += tc->brTree[node].sum;
+            lo += tc->brTree[node++].rows;
+        }
+    }
+    for (int r = lo; r < at; r++)
+        sum += tc->row[r].brDelta;
+    return sum;
+}
+
+
+int editorBracketsFirst(texCore *tc, int node, int lo, int from, int target, int offset) {
+    // Nothing here is after from, or the depth never gets down to target
+    int hi = lo + tc->brTree[node].rows;
+    if (hi <= from || offset + tc->brTree[node].min > target)
+        return -1;
+
+    if (node >= tc->brSize) {
+        for (int r = lo; r < hi; r++) {
+            if (r >= from && offset + tc->row[r].brMin <= target)
+                return r;
+            offset += tc->row[r].brDelta;
+        }
+        return -1;
+    }
+
+    int found = editorBracketsFirst(tc, 2 * node, lo, from, target, offset);
+    if (found != -1)
+        return found;
+    return editorBracketsFirst(tc, 2 * node + 1, lo + tc->brTree[2 * node].rows, from, target, offset + tc->brTree[2 * node].sum);
+}
+
+
+int editorBracketsLast(texCore *tc, int node, int lo, int before, int target, int offset) {
+    if (lo >= before || offset + tc->brTree[node].min > target)
+        return -1;
+
+    if (node >= tc->brSize) {
+        int found = -1;
+        for (int r = lo; r < lo + tc->brTree[node].rows && r < before; r++) {
+            if (offset + tc->row[r].brMin <= target)
+                found = r;
+            offset += tc->row[r].brDelta;
+        }
+        return found;
+    }
+
+    int found = editorBracketsLast(tc, 2 * node + 1, lo + tc->brTree[2 * node].rows, before, target, offset + tc->brTree[2 * node].sum);
+    if (found != -1)
+        return found;
+    return editorBracketsLast(tc, 2 * node, lo, before, target, offset);
+}
+
+
+int editorRowMatchClose(erow *row, int from, int depth, int target) {
+    int s = 0;
+    for (int i = from; i < row->rSize; i++) {
+        depth += editorRowBracket(row, i, &s);
+        if (depth <= target)
+            return i;
+    }
+    return -1;
+}
+
+
+int editorRowMatchOpen(erow *row, int before, int depth, int target) {
+    int found = -1;
+    int next = depth <= target;
+    int s = 0;
+    for (int i = 0; i < before; i++) {
+        int b = editorRowBracket(row, i, &s);
+        if (b == 0)
+            continue;
+        if (next)
+            found = i;
+        next = 0;
+        depth += b;
+        if (depth <= target) {
+            next = 1;
+            found = -1;
+        }
+    }
+    return found;
+}
+
+
+int editorMatchBracket(texCore *tc, int at, int ro, int *matchRow, int *matchRo) {
+    if (tc->large || at < 0 || at >= tc->numrows)
+        return 0;
+    // Brackets inside strings and comments are only known once the row is highlighted exactly
+    if (at >= tc->hlUpTo)
+        return -1;
+
+    erow *row = &tc->row[at];
+    int s = 0;
+    if (ro < 0 || ro >= row->rSize)
+        return 0;
+    int delta = editorRowBracket(row, ro, &s);
+    if (delta == 0)
+        return 0;
+
+    // Depths are counted from the start of row at until the tree is needed
+    int depth = 0;
+    s = 0;
+    for (int i = 0; i < ro; i++)
+        depth += editorRowBracket(row, i, &s);
+
+    int r = at;
+    int d = 0;
+    int found;
+    if (delta > 0) {
+        // The first place after an opening bracket the depth drops back below it
+        int target = depth;
+        found = editorRowMatchClose(row, ro + 1, depth + 1, target);
+
+        if (found == -1) {
+            // Nearby rows are stepped over with their cached sums, the tree can be out of date
+            d = row->brDelta;
+            for (r = at + 1; r < tc->numrows && r <= at + TEX_BRACKET_NEAR; r++) {
+                if (r >= tc->hlUpTo)
+                    return -1;
+                if (d + tc->row[r].brMin <= target)
+                    break;
+                d += tc->row[r].brDelta;
+            }
+            if (r == tc->numrows)
+                return 0;
+
+            if (r > at + TEX_BRACKET_NEAR) {
+                if (!tc->brValid)
+                    return -1;
+                int base = editorBracketDepth(tc, at);
+                r = editorBracketsFirst(tc, 1, 0, r, target + base, 0);
+                if (r == -1 || r >= tc->numrows)
+                    return tc->hlUpTo < tc->numrows ? -1 : 0;
+                if (r >= tc->hlUpTo)
+                    return -1;
+                d = editorBracketDepth(tc, r) - base;
+            }
+            found = editorRowMatchClose(&tc->row[r], 0, d, target);
+        }
+    } else {
+        // The bracket straight after the last place before a closing bracket the depth was below it
+        int target = depth - 1;
+        found = editorRowMatchOpen(row, ro, 0, target);
+
+        if (found == -1) {
+            for (r = at - 1; r >= 0 && r >= at - TEX_BRACKET_NEAR; r--) {
+                d -= tc->row[r].brDelta;
+                if (d + tc->row[r].brMin <= target)
+                    break;
+            }
+            if (r < 0)
+                return 0;
+
+            if (r < at - TEX_BRACKET_NEAR) {
+                if (!tc->brValid)
+                    return -1;
+                int base = editorBracketDepth(tc, at);
+                r = editorBracketsLast(tc, 1, 0, r + 1, target + base, 0);
+                if (r == -1)
+                    return 0;
+                d = editorBracketDepth(tc, r) - base;
+            }
+            found = editorRowMatchOpen(&tc->row[r], tc->row[r].rSize, d, target);
+        }
+    }
+    if (found == -1)
+        return 0;
+
+    // Depth only counts brackets, so ( closed by ] is a mismatch rather than a match
+    const char *pairs = "()[]{}";
+    char c = tc->row[at].render[ro];
+    char m = tc->row[r].render[found];
+    char open = delta > 0 ? c : m;
+    char close = delta > 0 ? m : c;
+    const char *p = strchr(pairs, open);
+    if (p == NULL || p[1] != close)
+        return 0;
+
+    *matchRow = r;
+    *matchRo = found;
+    return 1;
+}
+
+
+int editorBracketsAhead(texCore *tc, int n) {
+    if (tc->large)
+        return 0;
+    if (!tc->brValid) {
+        editorBracketsBuildStep(tc, n);
+        return 1;
+    }
+    return editorHighlightAhead(tc, n);
+}
+
+
+int editorFoldAt(texCore *tc, int at) {
+    if (tc->large || at < 0 || at >= tc->numrows)
+        return 0;
+    if (at >= tc->hlUpTo)
+        return -1;
+
+    erow *row = &tc->row[at];
+    if (row->foldLines)
+        return 0;
+
+    // A multiline comment starting on the row folds down to the row it's closed on
+    if (row->hl_open_comment && (at == 0 || !tc->row[at - 1].hl_open_comment)) {
+        int r = at + 1;
+        while (r < tc->hlUpTo && tc->row[r].hl_open_comment)
+            r++;
+        if (r == tc->hlUpTo && r < tc->numrows)
+            return -1;
+        // One never closed folds the rest of the file
+        int last = r < tc->numrows ? r - 1 : tc->numrows - 1;
+        return last > at ? editorFoldRows(tc, at, last) : 0;
+    }
+
+    // Otherwise the leftmost { the row leaves open, the depth never gets back down to it after it
+    int open = -1;
+    int d = row->brDelta;
+    int low = row->brDelta;
+    int s = row->numSpans ? row->numSpans - 1 : 0;
+    for (int i = row->rSize - 1; i >= 0; i--) {
+        int b = editorRowBracket(row, i, &s);
+        if (b == 0)
+            continue;
+        if (b > 0 && d <= low && row->render[i] == '{')
+            open = i;
+        if (d < low)
+            low = d;
+        d -= b;
+    }
+    if (open == -1)
+        return 0;
+
+    int matchRow, matchRo;
+    int found = editorMatchBracket(tc, at, open, &matchRow, &matchRo);
+    if (found != 1)
+        return found;
+    // The row with the closing } stays visible
+    return matchRow - 1 > at ? editorFoldRows(tc, at, matchRow - 1) : 0;
+}
+
+
+int editorFoldRows(texCore *tc, int head, int last) {
+    for (int r = head; r <= last; r++) {
+        if (tc->row[r].foldLines)
+            editorUnfold(tc, r);
+    }
+
+    // Hidden rows take up no visual lines, so soft wrap skips them too
+    for (int r = head + 1; r <= last; r++) {
+        tc->row[r].foldUp = r - head;
+        editorLayoutUpdateRow(tc, &tc->row[r]);
+    }
+    tc->row[head].foldLines = last - head;
+    tc->numFolds++;
+    return last - head;
+}
+
+
+int editorUnfold(texCore *tc, int at) {
+    if (tc->large || at < 0 || at >= tc->numrows)
+        return 0;
+
+    erow *row = &tc->row[at];
+    int n = row->foldLines;
+    if (n == 0)
+        return 0;
+    row->foldLines = 0;
+    tc->numFolds--;
+
+    for (int r = at + 1; r <= at + n; r++) {
+        tc->row[r].foldUp = 0;
+        editorLayoutUpdateRow(tc, &tc->row[r]);
+    }
+    return n;
+}
+
+
+void editorUnfoldAll(texCore *tc) {
+    for (int r = 0; r < tc->numrows && tc->numFolds; r++)
+        editorUnfold(tc, r);
+}
+
+
+void editorFoldReveal(texCore *tc, int at) {
+    while (tc->numFolds && at >= 0 && at < tc->numrows && tc->row[at].foldUp)
+        editorUnfold(tc, at - tc->row[at].foldUp);
+}
+
+
+void editorUnfoldRows(texCore *tc, int first, int last) {
+    if (tc->numFolds == 0)
+        return;
+
+    // Once first is visible, any row hidden after it is hidden by a fold starting after it too
+    editorFoldReveal(tc, first);
+    for (int r = first; r < last && r < tc->numrows && tc->numFolds; r++)
+        editorUnfold(tc, r);
+}
+
+
+int editorFoldStep(texCore *tc, int at, int n) {
+    if (tc->numFolds == 0) {
+        at += n;
+        if (at < 0)
+            at = 0;
+        if (at > tc->numrows)
+            at = tc->numrows;
+        return at;
+    }
+
+    // A fold is jumped from its first row to the row after its last, or back from there to its first
+    for (; n > 0 && at < tc->numrows; n--)
+        at += 1 + tc->row[at].foldLines;
+    for (; n < 0 && at > 0; n++) {
+        at--;
+        at -= tc->row[at].foldUp;
+    }
+    return at;
+}
+
+
+int editorFoldCount(texCore *tc, int first, int last, int limit) {
+    if (tc->numFolds == 0) {
+        int n = last - first;
+        return n < 0 ? 0 : n < limit ? n : limit;
+    }
+
+    int n = 0;
+    while (first < last && n < limit) {
+        first += first < tc->numrows ? 1 + tc->row[first].foldLines : 1;
+        n++;
+    }
+    return n;
+}
@@ -0,0 +1,355 @@
+#include "texcore.h"
+
+
+/*--------------------------------------------------------------------------
+                                 FILETYPES
+--------------------------------------------------------------------------*/
+
+// Filematch extensions for C language
+static char *C_HL_extensions[] = { ".c", ".h", ".cpp", NULL };
+
+// Keywords for C language
+static char *C_HL_keywords[] = {
+    "switch", "if", "while", "for", "break", "continue", "return", "else",
+    "struct", "union", "typedef", "static", "enum", "class", "case",
+
+    "int|", "long|", "double|", "float|", "char|", "unsigned|", "signed|",
+    "void|", NULL
+};
+
+// Syntax Highlight database
+static struct editorSyntax HLDB[] = {
+    {
+        "c",
+        C_HL_extensions,
+        C_HL_keywords,
+        "//",
+        "/*",
+        "*/",
+        HL_HIGHLIGHT_NUMBERS | HL_HIGHLIGHT_STRINGS
+    },
+};
+
+#define HLDB_ENTRIES (sizeof(HLDB) / sizeof(HLDB[0]))
+
+
+/*--------------------------------------------------------------------------
+                          SYNTAX HIGHLIGHTING
+--------------------------------------------------------------------------*/
+
+int isSeparator(int c) {
+    return isspace(c) || c == '\0' || strchr(",.()+-/*=~%<>[];", c) != NULL;
+}
+
+
+void editorRowBuildSpans(texCore *tc, erow *row, unsigned char *highlight) {
+    int count = 0;
+    int i;
+
+    // Count runs of non normal chars, HL_NORMAL is implied by the gaps between spans
+    for (i = 0; i < row->rSize; i++) {
+        if (highlight[i] != HL_NORMAL && (i == 0 || highlight[i] != highlight[i - 1]))
+            count++;
+    }
+
+    free(row->spans);
+    row->spans = count ? texAlloc(tc, sizeof(hlSpan) * count) : NULL;
+    row->numSpans = count;
+
+    int s = 0;
+    i = 0;
+    while (i < row->rSize) {
+        if (highlight[i] == HL_NORMAL) {
+            i++;
+            continue;
+        }
+        // Extend the span to the end of the run
+        int start = i;
+        while (i < row->rSize && highlight[i] == highlight[start])
+            i++;
+
+        row->spans[s].start = start;
+        row->spans[s].len = i - start;
+        row->spans[s].hl = highlight[start];
+        s++;
+    }
+}
+
+
+void editorUpdateSyntax(texCore *tc, erow *row) {
+    tc->hlLast = row->idx;
+    editorViewsSpan(tc, row->idx, row->idx + 1, row->idx + 1);
+
+    // Return if no filetype is detecting, every char is HL_NORMAL
+    if (tc->syntax == NULL) {
+        free(row->spans);
+        row->spans = NULL;
+        row->numSpans = 0;
+        editorRowBrackets(tc, row);
+        editorOverviewRow(tc, row);
+        return;
+    }
+
+    // Grow scratch buffer for the new row
+    if (row->rSize > tc->hlScratchCap) {
+        tc->hlScratchCap = row->rSize * 2;
+        tc->hlScratch = texRealloc(tc, tc->hlScratch, tc->hlScratchCap);
+    }
+    unsigned char *highlight = tc->hlScratch;
+
+    // Set all characters to HL_NORMAL by default
+    memset(highlight, HL_NORMAL, row->rSize);
+
+    // Make keywords an alias for readability
+    char **keywords = tc->syntax->keywords;
+    
+    // Make aliases for readability
+    char *scs = tc->syntax->singleline_comment_start;
+    char *mcs = tc->syntax->multiline_comment_start;
+    char *mce = tc->syntax->multiline_comment_end;
+
+    // Used to determine whether to highlight or not
+    int scs_len = scs ? strlen(scs) : 0;
+    int mcs_len = mcs ? strlen(mcs) : 0;
+    int mce_len = mce ? strlen(mce) : 0;;
+
+    int prev_sep = 1;   // Mark beginning of line to be a separator
+    int in_string = 0;  // Keep track of whether char is part of a string or not
+    // Keep track of whether char is part of a multiline comment
+    int in_comment = (row->idx > 0 && editorRowAt(tc, row->idx - 1)->hl_open_comment);
+
+    // Loop through the characters and set digits to HL_NUMBER
+    int i = 0;
+    while (i < row->rSize) {
+        char c = row->render[i];
+        unsigned char prev_hl = (i > 0) ? highlight[i - 1] : HL_NORMAL;
+
+        // Check if single line comment should be highlighted (not in a string)
+        if (scs_len && !in_string && !in_comment) {
+            if (!strncmp(&row->render[i], scs, scs_len)) {
+                memset(&highlight[i], HL_COMMENT, row->rSize - i);
+                break;
+            }
+        }
+
+        // Check if multi line comment should be highlighted or not
+        if (mcs_len && mce_len && !in_string) {
+            if (in_comment) {
+                highlight[i] = HL_MLCOMMENT;
+                // Check for the end of a ML_Comment
+                if (!strncmp(&row->render[i], mce, mce_len)) {
+                    memset(&highlight[i], HL_MLCOMMENT, mce_len);
+                    i += mce_len;
+                    in_comment = 0;
+                    prev_sep = 1;
+                    continue;
+                } else {
+                    i++;
+                    continue;
+                }
+            // Check for start of a ML_Comment
+            } else if (!strncmp(&row->render[i], mcs, mcs_len)) {
+                memset(&highlight[i], HL_MLCOMMENT, mcs_len);
+                i += mcs_len;
+                in_comment = 1;
+                continue;
+            }
+        }
+
+        // Check if strings should be highlighted for the current filetype
+        if (tc->syntax->flags & HL_HIGHLIGHT_STRINGS) {
+            // String is set, highlight current character
+            if (in_string) {
+                highlight[i] = HL_STRING;
+                // Take escape quotes into account, highlight char after backslash then iterate over both
+                if (c == '\\' && i + 1 < row->rSize) {
+                    highlight[i + 1] = HL_STRING;
+                    i += 2;
+                    continue;
+                }
+
+                // Reset in_string once character is highlighted
+                if (c == in_string)
+                    in_string = 0;
+                i++;
+                prev_sep = 1;
+                continue;
+            } else {
+                // Check for the beginning of a string
+                if (c == '"' || c == '\'') {
+                    // store the quote in in_string, highlight it, then iterate over it
+                    in_string = c;
+                    highlight[i] = HL_STRING;
+                    i++;
+                    continue;
+                }
+            }
+        }
+
+        // Check if numbers should be highlighted for the current filetype
+        if (tc->syntax->flags & HL_HIGHLIGHT_NUMBERS) {
+            // Highlight Numbers
+            if ((isdigit(c) && (prev_sep || prev_hl == HL_NUMBER)) || (c == '.' && prev_hl == HL_NUMBER)) {
+                highlight[i] = HL_NUMBER;
+                i++;
+                prev_sep = 0;
+                continue;
+            }
+        }
+
+        // Check if keyword should be highlighted
+        if (prev_sep) {
+            int j;
+            for (j = 0; keywords[j]; j++) {
+                int klen = strlen(keywords[j]);
+                int types = keywords[j][klen - 1] == '|';
+                if (types)
+                    klen--;
+                // Check if there's a keyword to highlight
+                if (!strncmp(&row->render[i], keywords[j], klen) && isSeparator(row->render[i + klen])) {
+                    // Highlight the whole keyword/type at once
+                    memset(&highlight[i], types ? HL_TYPE : HL_KEYWORD, klen);
+                    i += klen;
+                    break;
+                }
+            }
+            if (keywords[j] != NULL) {
+                prev_sep = 0;
+                continue;
+            }
+        }
+
+        prev_sep = isSeparator(c);
+        i++;
+    }
+
+    editorRowBuildSpans(tc, row, highlight);
+    editorRowBrackets(tc, row);
+    editorOverviewRow(tc, row);
+
+    int changed = (row->hl_open_comment != in_comment);
+    row->hl_open_comment = in_comment;
+    if (changed && row->idx + 1 < tc->hlUpTo)
+        editorUpdateSyntax(tc, editorRowAt(tc, row->idx + 1));
+    else if (changed && row->idx + 1 == tc->hlUpTo)
+        editorHighlightStale(tc);
+}
+
+
+void editorSelectSyntaxHighlight(texCore *tc) {
+    // Every row is highlighted again with the new filetype when it's next drawn
+    tc->hlUpTo = 0;
+    for (int filerow = 0; filerow < tc->numrows && tc->large == NULL; filerow++)
+        tc->row[filerow].hlGuessed = 0;
+
+    // Set to NULL, so that if nothing matches or there's no name, there is no filetype
+    tc->syntax = NULL;
+    if (tc->filename == NULL)
+        return;
+
+    char *ext = strchr(tc->filename, '.');    // Get a pointer to the extension part of the filename
+    // A compressed file is highlighted as what it decompresses to, so log.c.gz matches .c
+    size_t extLen = ext ? strlen(ext) : 0;
+    if (extLen > 3 && !strcmp(&ext[extLen - 3], ".gz"))
+        extLen -= 3;
+
+    // Loop through HLDB
+    for (unsigned int i = 0; i < HLDB_ENTRIES; i ++) {
+        struct editorSyntax *s = &HLDB[i];
+        unsigned int j = 0;
+        // For each entrie, loop through each pattern in it's filematch array
+        while (s->filematch[j]) {
+            int is_ext = (s->filematch[j][0] == '.');
+
+            // If it ends with . check if filename ends with that extension
+            if ((is_ext && ext && strlen(s->filematch[j]) == extLen && !strncmp(ext, s->filematch[j], extLen)) ||
+            (!is_ext && strstr(tc->filename, s->filematch[j]))) {
+                tc->syntax = s;   // Set tc->syntax to the current editor syntax struct and return
+                return;
+            }
+            j++;
+        }
+    }
+}
+
+
+void editorHighlightRows(texCore *tc, int first, int last) {
+    long start = texNow();
+
+    if (last >= tc->numrows)
+        last = tc->numrows - 1;
+
+    // Close enough to the exactly highlighted rows to extend them, paged files are always guessed
+    if (last - tc->hlUpTo < TEX_HL_LOOKBACK && tc->large == NULL) {
+        int changed = 0;
+        while (tc->hlUpTo <= last) {
+            erow *row = editorRowAt(tc, tc->hlUpTo);
+            int open = row->hl_open_comment;
+            row->hlGuessed = 0;
+            editorUpdateSyntax(tc, row);
+            tc->hlUpTo++;
+            changed = (open != row->hl_open_comment);
+        }
+        // The guesses below were made from the state the last row had before
+        if (changed)
+            editorHighlightStale(tc);
+        tc->hlTime += texNow() - start;
+        return;
+    }
+
+    /*
+        Too far past the exact rows, guess the highlighting instead by starting a fixed number of
+        rows above the window. Only a multiline comment that opens further up than that is missed
+    */
+    int from = first - (tc->large ? TEX_LARGE_HL_LOOKBACK : TEX_HL_LOOKBACK);
+    if (from < tc->hlUpTo)
+        from = tc->hlUpTo;
+
+    int prevChanged = 0;
+    for (int filerow = from; filerow <= last; filerow++) {
+        erow *row = editorRowAt(tc, filerow);
+        // Redo a guessed row if the row above it now opens or closes a comment differently
+        if (row->hlGuessed && !prevChanged)
+            continue;
+
+        int open = row->hl_open_comment;
+        editorUpdateSyntax(tc, row);
+        row->hlGuessed = 1;
+        prevChanged = (open != row->hl_open_comment);
+    }
+    tc->hlTime += texNow() - start;
+}
+
+
+void editorHighlightStale(texCore *tc) {
+    // Rows below the exact ones that aren't guessed are highlighted from scratch anyway
+    if (tc->large || tc->hlUpTo >= tc->numrows || !tc->row[tc->hlUpTo].hlGuessed)
+        return;
+
+    for (int filerow = tc->hlUpTo; filerow < tc->numrows; filerow++)
+        tc->row[filerow].hlGuessed = 0;
+}
+
+
+void editorHighlightRange(texCore *tc, int first, int last) {
+    long start = texNow();
+    int done = first - 1;   // Rows up to here are already highlighted, by a comment cascading down to them
+
+    for (int r = first; r <= last && r < tc->hlUpTo; r++) {
+        if (r <= done)
+            continue;
+        editorUpdateSyntax(tc, &tc->row[r]);
+        done = tc->hlLast;
+    }
+    tc->hlTime += texNow() - start;
+}
+
+
+int editorHighlightAhead(texCore *tc, int n) {
+    // Paged files are always guessed
+    if (tc->large || tc->hlUpTo >= tc->numrows)
+        return 0;
+
+    editorHighlightRows(tc, tc->hlUpTo, tc->hlUpTo + n - 1);
+    return tc->hlUpTo < tc->numrows;
+}
@@ -15,6 +15,14 @@ void die(const char *s) {
 }
 
 
+void editorOutOfMemory(texCore *tc, size_t size) {
+    (void) tc;
+    (void) size;
+    errno = ENOMEM;
+    die("out of memory");
+}
+
+
 void disableRawMode() {
     // Error Handling
     if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &E.orig_termios) == -1)
@@ -48,29 +56,91 @@ void enableRawMode() {
 }
 
 
+int editorReadByte(char *c) {
+    if (!E.headless) {
+        int nRead = read(STDIN_FILENO, c, 1);
+        if (nRead == 1 && E.traceFp)
+            traceRecord(*c);
+        return nRead;
+    }
+
+    // Read from the scripted keys instead of the terminal
+    if (E.inputPos >= E.inputLen)
+        return 0;
+
+    // Wait until the byte was originally typed when replaying a trace in real time
+    if (E.inputTimes) {
+        long wait = E.inputStart + E.inputTimes[E.inputPos] - texNow();
+        if (wait > 0) {
+            struct timespec ts = { wait / 1000000, (wait % 1000000) * 1000 };
+            nanosleep(&ts, NULL);
+        }
+    }
+    *c = E.input[E.inputPos++];
+    return 1;
+}
+
+
+int editorKeyWaiting() {
+    if (E.headless)
+        return E.inputPos < E.inputLen;
+
+    struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+    return poll(&pfd, 1, 0) > 0;
+}
+
+
 int editorReadKey() {
     int nRead;
     char c;
-    // Read until ctrl-q
-    while ((nRead = read(STDIN_FILENO, &c, 1)) != 1) {
+    // Sleep until there's a key, then read it
+    while (1) {
+        editorWaitKey();
+        if ((nRead = editorReadByte(&c)) == 1)
+            break;
         // Handle Errors
-        if (nRead == -1 && errno != EAGAIN)
+        if (nRead == -1 && errno != EAGAIN && errno != EINTR)
             die("read");
+        // A headless script has run out of keys, return one that does nothing
+        if (E.headless)
+            return '\x1b';
     }
 
+    // Start timing the key, until the frame that shows its result is written
+    if (!E.stats.keyTime)
+        E.stats.keyTime = texNow();
+
     // Handle multi-byte keys as input
     if (c == '\x1b') {
         char seq[3];
 
-        if (read(STDIN_FILENO, &seq[0], 1) != 1)
+        if (editorReadByte(&seq[0]) != 1)
             return '\x1b';
-        if (read(STDIN_FILENO, &seq[1], 1) != 1)
+        if (editorReadByte(&seq[1]) != 1)
             return '\x1b';
         
         if (seq[0] == '[') {
             if (seq[1] >= '0' && seq[1] <= '9') {
-                if (read(STDIN_FILENO, &seq[2], 1) != 1)
+                if (editorReadByte(&seq[2]) != 1)
                     return '\x1b';
+                // Modified keys, ESC [ 1 ; 5 H is CTRL-HOME
+                if (seq[1] == '1' && seq[2] == ';') {
+                    char mod[2];
+                    if (editorReadByte(&mod[0]) != 1 || editorReadByte(&mod[1]) != 1)
+                        return '\x1b';
+                    if (mod[0] == '5' && mod[1] == 'H')
+                        return CTRL_HOME_KEY;
+                    if (mod[0] == '5' && mod[1] == 'F')
+                        return CTRL_END_KEY;
+                    // SHIFT is 2, ALT-SHIFT is 4, arrows follow ARROW_LEFT's order of D C A B
+                    const char *arrows = "DCAB";
+                    const char *arrow = strchr(arrows, mod[1]);
+                    if (arrow && mod[1] != '\0' && mod[0] == '2')
+                        return SHIFT_ARROW_LEFT + (arrow - arrows);
+                    if (arrow && mod[1] != '\0' && mod[0] == '4')
+                        return COLUMN_ARROW_LEFT + (arrow - arrows);
+                    return '\x1b';
+                }
                 if (seq[2] == '~') {
                     switch (seq[1]) {
                         case '1':
@@ -104,6 +174,8 @@ int editorReadKey() {
                         return HOME_KEY;
                     case 'F':
                         return END_KEY;
+                    case 'Z':
+                        return SHIFT_TAB;
                 }
             }
         } else if (seq[0] == 'O') {
@@ -118,7 +190,7 @@ int editorReadKey() {
         return '\x1b';
         
     } else {
-        return c;
+        return (unsigned char) c;   // Keep UTF-8 bytes positive so they can't be mistaken for keys
     }
 }
 
@@ -174,693 +246,1942 @@ int getWindowSize(int *rows, int *cols) {
 
 
 /*--------------------------------------------------------------------------
-                          SYNTAX HIGHLIGHTING
+                                EVENT LOOP
 --------------------------------------------------------------------------*/
 
-int isSeparator(int c) {
-    return isspace(c) || c == '\0' || strchr(",.()+-/*=~%<>[];", c) != NULL;
+void editorEventInit() {
+    if (pipe(E.sigPipe) == -1)
+        die("pipe");
+    // The handler can't block on a full pipe, a byte already in it will wake the loop anyway
+    for (int i = 0; i < 2; i++) {
+        fcntl(E.sigPipe[i], F_SETFL, fcntl(E.sigPipe[i], F_GETFL) | O_NONBLOCK);
+        fcntl(E.sigPipe[i], F_SETFD, FD_CLOEXEC);
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = editorSignal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    if (sigaction(SIGWINCH, &sa, NULL) == -1)
+        die("sigaction");
+
+    // Editing still works without file watches
+    E.watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    E.watchWd = -1;
 }
 
 
-void editorUpdateSyntax(erow *row) {
-    // Realloc for new row
-    row->highlight = realloc(row->highlight, row->rSize);
+void editorSignal(int sig) {
+    int saved = errno;
+    char c = sig;
+    write(E.sigPipe[1], &c, 1);
+    errno = saved;
+}
 
-    // Set all characters to HL_NORMAL by default
-    memset(row->highlight, HL_NORMAL, row->rSize);
 
-    // Return if no filetype is detecting
-    if (E.syntax == NULL)
-        return;
+void editorTimerStart(int slot, long delay, long interval, void (*fn)()) {
+    E.timers[slot].due = texNow() + delay;
+    E.timers[slot].interval = interval;
+    E.timers[slot].fn = fn;
+}
 
-    // Make keywords an alias for readability
-    char **keywords = E.syntax->keywords;
-    
-    // Make aliases for readability
-    char *scs = E.syntax->singleline_comment_start;
-    char *mcs = E.syntax->multiline_comment_start;
-    char *mce = E.syntax->multiline_comment_end;
-
-    // Used to determine whether to highlight or not
-    int scs_len = scs ? strlen(scs) : 0;
-    int mcs_len = mcs ? strlen(mcs) : 0;
-    int mce_len = mce ? strlen(mce) : 0;;
-
-    int prev_sep = 1;   // Mark beginning of line to be a separator
-    int in_string = 0;  // Keep track of whether char is part of a string or not
-    // Keep track of whether char is part of a multiline comment
-    int in_comment = (row->idx > 0 && E.row[row->idx - 1].hl_open_comment);
-
-    // Loop through the characters and set digits to HL_NUMBER
-    int i = 0;
-    while (i < row->rSize) {
-        char c = row->render[i];
-        unsigned char prev_hl = (i > 0) ? row->highlight[i - 1] : HL_NORMAL;
-
-        // Check if single line comment should be highlighted (not in a string)
-        if (scs_len && !in_string && !in_comment) {
-            if (!strncmp(&row->render[i], scs, scs_len)) {
-                memset(&row->highlight[i], HL_COMMENT, row->rSize - i);
-                break;
-            }
-        }
 
-        // Check if multi line comment should be highlighted or not
-        if (mcs_len && mce_len && !in_string) {
-            if (in_comment) {
-                row->highlight[i] = HL_MLCOMMENT;
-                // Check for the end of a ML_Comment
-                if (!strncmp(&row->render[i], mce, mce_len)) {
-                    memset(&row->highlight[i], HL_MLCOMMENT, mce_len);
-                    i += mce_len;
-                    in_comment = 0;
-                    prev_sep = 1;
-                    continue;
-                } else {
-                    i++;
-                    continue;
-                }
-            // Check for start of a ML_Comment
-            } else if (!strncmp(&row->render[i], mcs, mcs_len)) {
-                memset(&row->highlight[i], HL_MLCOMMENT, mcs_len);
-                i += mcs_len;
-                in_comment = 1;
-                continue;
-            }
-        }
+void editorTimerStop(int slot) {
+    E.timers[slot].due = 0;
+}
 
-        // Check if strings should be highlighted for the current filetype
-        if (E.syntax->flags & HL_HIGHLIGHT_STRINGS) {
-            // String is set, highlight current character
-            if (in_string) {
-                row->highlight[i] = HL_STRING;
-                // Take escape quotes into account, highlight char after backslash then iterate over both
-                if (c == '\\' && i + 1 < row->rSize) {
-                    row->highlight[i + 1] = HL_STRING;
-                    i += 2;
-                    continue;
-                }
 
-                // Reset in_string once character is highlighted
-                if (c == in_string)
-                    in_string = 0;
-                i++;
-                prev_sep = 1;
-                continue;
-            } else {
-                // Check for the beginning of a string
-                if (c == '"' || c == '\'') {
-                    // store the quote in in_string, highlight it, then iterate over it
-                    in_string = c;
-                    row->highlight[i] = HL_STRING;
-                    i++;
-                    continue;
-                }
-            }
-        }
+int editorTimerWait() {
+    long next = 0;
+    for (int i = 0; i < TIMER_COUNT; i++) {
+        if (E.timers[i].due && (next == 0 || E.timers[i].due < next))
+            next = E.timers[i].due;
+    }
+    if (next == 0)
+        return -1;
 
-        // Check if numbers should be highlighted for the current filetype
-        if (E.syntax->flags & HL_HIGHLIGHT_NUMBERS) {
-            // Highlight Numbers
-            if ((isdigit(c) && (prev_sep || prev_hl == HL_NUMBER)) || (c == '.' && prev_hl == HL_NUMBER)) {
-                row->highlight[i] = HL_NUMBER;
-                i++;
-                prev_sep = 0;
-                continue;
-            }
-        }
+    // Round up, so the poll doesn't wake just before the timer is due
+    long wait = next - texNow();
+    return wait > 0 ? (wait + 999) / 1000 : 0;
+}
 
-        // Check if keyword should be highlighted
-        if (prev_sep) {
-            int j;
-            for (j = 0; keywords[j]; j++) {
-                int klen = strlen(keywords[j]);
-                int types = keywords[j][klen - 1] == '|';
-                if (types)
-                    klen--;
-                // Check if there's a keyword to highlight
-                if (!strncmp(&row->render[i], keywords[j], klen) && isSeparator(row->render[i + klen])) {
-                    // Highlight the whole keyword/type at once
-                    memset(&row->highlight[i], types ? HL_TYPE : HL_KEYWORD, klen);
-                    i += klen;
-                    break;
-                }
-            }
-            if (keywords[j] != NULL) {
-                prev_sep = 0;
-                continue;
-            }
-        }
 
-        prev_sep = isSeparator(c);
-        i++;
-    }
+int editorTimersRun() {
+    long now = texNow();
+    int fired = 0;
 
-    int changed = (row->hl_open_comment != in_comment);
-    row->hl_open_comment = in_comment;
-    if (changed && row->idx + 1 < E.numrows)
-        editorUpdateSyntax(&E.row[row->idx + 1]);
+    for (int i = 0; i < TIMER_COUNT; i++) {
+        struct editorTimer *t = &E.timers[i];
+        if (t->due == 0 || t->due > now)
+            continue;
+        t->due = t->interval ? now + t->interval : 0;
+        if (t->fn)
+            t->fn();
+        fired++;
+    }
+    return fired;
 }
 
 
-int editorSyntaxToColour(int highlight) {
-    switch (highlight) {
-        case HL_COMMENT:
-        case HL_MLCOMMENT:
-            return 36;  // Cyan
-        
-        case HL_KEYWORD:
-            return 33;  // Yellow
-        
-        case HL_TYPE:
-            return 32;  // Green
-
-        case HL_STRING:
-            return 35;  // Magenta
+void editorWatchFile() {
+    if (E.watchFd == -1 || E.core->filename == NULL)
+        return;
 
-        case HL_NUMBER:
-            return 31;
+    // Watch the directory rather than the file, so it's still watched after a save renames over it
+    if (E.watchWd != -1)
+        inotify_rm_watch(E.watchFd, E.watchWd);
+    char *slash = strrchr(E.core->filename, '/');
+    char *dir = slash ? strndup(E.core->filename, slash == E.core->filename ? 1 : slash - E.core->filename) : strdup(".");
+    E.watchWd = inotify_add_watch(E.watchFd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM);
+    free(dir);
 
-        case HL_MATCH:
-            return 34;  // Blue
-    
-        default:
-            return 37;
-    }
+    if (stat(E.core->filename, &E.watchSt) == -1)
+        memset(&E.watchSt, 0, sizeof(E.watchSt));
 }
 
 
-void editorSelectSyntaxHighlight() {
-    // Set to NULL, so that if nothing matches or there's no name, there is no filetype
-    E.syntax = NULL;
-    if (E.filename == NULL)
-        return;
+int editorFileChanged() {
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    char *slash = E.core->filename ? strrchr(E.core->filename, '/') : NULL;
+    const char *name = slash ? slash + 1 : E.core->filename;
+    int ours = 0;
 
-    char *ext = strchr(E.filename, '.');    // Get a pointer to the extension part of the filename
-
-    // Loop through HLDB
-    for (unsigned int i = 0; i < HLDB_ENTRIES; i ++) {
-        struct editorSyntax *s = &HLDB[i];
-        unsigned int j = 0;
-        // For each entrie, loop through each pattern in it's filematch array
-        while (s->filematch[j]) {
-            int is_ext = (s->filematch[j][0] == '.');
-
-            // If it ends with . check if filename ends with that extension
-            if ((is_ext && ext && !strcmp(ext, s->filematch[j])) ||
-            (!is_ext && strstr(E.filename, s->filematch[j]))) {
-                E.syntax = s;   // Set E.syntax to the current editor syntax struct and return
-                
-                // Loop through each row in the file and call editorUpdateSyntax on it
-                for (int filerow = 0; filerow < E.numrows; filerow++) {
-                    editorUpdateSyntax(&E.row[filerow]);
-                }
-                
-                return;
-            }
-            j++;
+    ssize_t len;
+    while ((len = read(E.watchFd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + len; p += sizeof(struct inotify_event) + ((struct inotify_event *)p)->len) {
+            struct inotify_event *ev = (struct inotify_event *)p;
+            if (ev->wd == E.watchWd && ev->len && name && !strcmp(ev->name, name))
+                ours = 1;
         }
     }
+    if (!ours)
+        return 0;
+
+    // Saving from here changes the file too, but leaves it as it was remembered
+    struct stat st;
+    if (stat(E.core->filename, &st) == -1) {
+        editorSetStatusMessage("%s was deleted from disk", E.core->filename);
+        return 1;
+    }
+    if (st.st_ino == E.watchSt.st_ino && st.st_size == E.watchSt.st_size &&
+            st.st_mtim.tv_sec == E.watchSt.st_mtim.tv_sec && st.st_mtim.tv_nsec == E.watchSt.st_mtim.tv_nsec)
+        return 0;
+    E.watchSt = st;
+    editorSetStatusMessage("%s was changed on disk by another program", E.core->filename);
+    // The diff is against what's on disk now
+    editorDiffReadBase(E.core);
+    return 1;
 }
 
 
-/*--------------------------------------------------------------------------
-                            ROW OPERATIONS
---------------------------------------------------------------------------*/
+void editorResize() {
+    int rows, cols;
+    if (getWindowSize(&rows, &cols) == -1)
+        return;
 
-int editorRowCxToRx(erow *row, int cx) {
-    int rx = 0;
-    int j;
+    // Room for the status bar and message, however small the terminal gets
+    E.areaRows = rows - 2 > 1 ? rows - 2 : 1;
+    E.areaCols = cols;
+    editorPanesLayout();
 
-    for (j = 0; j < cx; j++) {
-        if (row->chars[j] == '\t')
-            // How many columns cursor is to the left of the tab stop, add to rx
-            rx += (TEX_TAB_STOP - 1) - (rx % TEX_TAB_STOP);
-        rx++;
-    }
-    return rx;
+    // Keep the top row of the window in place while its visual lines change
+    if (E.softWrap)
+        E.wrapOff = editorLayoutVisualLine(E.core, E.rowOff);
+    editorLargeSync();
 }
 
 
-int editorRowRxToCx(erow *row, int rx) {
-    int cur_rx = 0;
-    int cx;
+// Background tasks in priority order, the first with work to do gets each slice
+struct editorTask editorTasks[] = {
+    { editorLoadPending, editorLoadRun, TEX_LOAD_FRAME_US },
+    { editorAutosavePending, editorAutosaveRun, TEX_TASK_US },
+    { editorSearchPending, editorSearchRun, TEX_TASK_US },
+    { editorBracketPending, editorBracketRun, TEX_TASK_US },
+    { editorHighlightPending, editorHighlightRun, TEX_TASK_US },
+};
 
-    for (cx = 0; cx < row->size; cx++) {
-        // Stop when cur_rx hits the given rx value
-        if (row->chars[cx] == '\t')
-            cur_rx += (TEX_TAB_STOP - 1) - (cur_rx % TEX_TAB_STOP);
-        cur_rx++;
 
-        if (cur_rx > rx)
-            return cx;
-    }
-    return cx;
+int editorTaskYield(long deadline) {
+    return texNow() >= deadline || editorKeyWaiting();
 }
 
 
-void editorUpdateRow(erow *row) {
-    int tabs = 0;
-    int j;
+int editorTasksPending() {
+    for (unsigned int i = 0; i < sizeof(editorTasks) / sizeof(editorTasks[0]); i++) {
+        if (editorTasks[i].pending())
+            return 1;
+    }
+    return 0;
+}
+
 
-    // Count the tabs to calc the memory required for render
-    for (j = 0; j< row->size; j++) {
-        if (row->chars[j] == '\t')
-            tabs++;
+int editorTasksRun() {
+    for (unsigned int i = 0; i < sizeof(editorTasks) / sizeof(editorTasks[0]); i++) {
+        if (editorTasks[i].pending())
+            return editorTasks[i].run(texNow() + editorTasks[i].budget);
     }
+    return 0;
+}
 
-    free(row->render);  // Free any previous renders
-    row->render = malloc(row->size + tabs * (TEX_TAB_STOP - 1) + 1); //Allocate memory for new render
-    
-    int idx = 0;    // Number of characters copied into row->render
 
-    for (j = 0; j < row->size; j++) {
-        if (row->chars[j] == '\t') {
-            row->render[idx++] = ' ';
-            while (idx % TEX_TAB_STOP != 0)
-                row->render[idx++] = ' ';
+void editorNoteEdits() {
+    if (E.core->dirty == E.taskDirty)
+        return;
+    E.taskDirty = E.core->dirty;
+
+    // The match count no longer counts the same text, and an autosave half written is out of date
+    if (E.search.query)
+        editorSearchIndexStart(E.core, &E.search, E.search.query);
+    editorAutosaveStop(0);
+    E.autosaveDue = 0;
+    if (E.core->dirty)
+        editorTimerStart(TIMER_AUTOSAVE, TEX_AUTOSAVE_US, 0, editorAutosaveTimer);
+}
 
-        } else {
-            row->render[idx++] = row->chars[j];
-        }
-    }
-    row->render[idx] = '\0';
-    row->rSize = idx;
 
-    editorUpdateSyntax(row);
+int editorLoadPending() {
+    return E.core->load != NULL;
 }
 
 
-void editorInsertRow(int at, char *s, size_t len) {
-    // Validate at before inserting row
-    if (at < 0 || at > E.numrows)
-        return;
+int editorLoadRun(long deadline) {
+    // Drawing what's been read after each slice
+    do {
+        if (editorLoadMore(E.core, TEX_TASK_LOAD_BYTES) == -1)
+            die("read");
+    } while (E.core->load && !editorTaskYield(deadline));
+    return 1;
+}
+
+
+int editorAutosavePending() {
+    return E.autosaveDue && !E.headless && E.core->large == NULL && E.core->filename;
+}
 
-    // Reallocate space for new row
-    E.row = realloc(E.row, sizeof(erow) * (E.numrows + 1));
-    // Make room at the specified index for the new row
-    memmove(&E.row[at + 1], &E.row[at], sizeof(erow) * (E.numrows - at));
 
-    for (int j = at + 1; j <= E.numrows; j++)
-        E.row[j].idx++;
+int editorAutosaveRun(long deadline) {
+    char *path = editorAutosavePath();
+    int len = strlen(path) + 5;
+    char *tmp = malloc(len);
+    if (tmp == NULL)
+        die("malloc");
+    snprintf(tmp, len, "%s.tmp", path);
 
-    E.row[at].idx = at;
-    E.row[at].size = len;
-    E.row[at].chars = malloc(len + 1);
+    // Written beside the last complete autosave, which is only replaced once this one is done
+    if (E.autosaveFd == -1) {
+        E.autosaveFd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        E.autosaveRow = 0;
+    }
 
-    if (E.row[0].chars == NULL)
-        die("E.row.chars malloc failed");
+    int ok = E.autosaveFd != -1;
+    while (ok && E.autosaveRow < E.core->numrows && !editorTaskYield(deadline)) {
+        // A chunk of rows at a time, or a row too long for one on its own
+        char buf[TEX_AUTOSAVE_CHUNK];
+        int n = 0;
+        while (E.autosaveRow < E.core->numrows) {
+            erow *row = &E.core->row[E.autosaveRow];
+            if (n + row->size + 1 > TEX_AUTOSAVE_CHUNK) {
+                if (n == 0) {
+                    ok = write(E.autosaveFd, row->chars, row->size) == row->size && write(E.autosaveFd, "\n", 1) == 1;
+                    E.autosaveRow++;
+                }
+                break;
+            }
+            memcpy(&buf[n], row->chars, row->size);
+            buf[n + row->size] = '\n';
+            n += row->size + 1;
+            E.autosaveRow++;
+        }
+        if (ok && n)
+            ok = write(E.autosaveFd, buf, n) == n;
+    }
 
-    // Copy string into row's char array
-    memcpy(E.row[at].chars, s, len);
-    E.row[at].chars[len] = '\0';    // Add NULL terminator
+    if (!ok) {
+        editorSetStatusMessage("Can't autosave! I/O error: %s", strerror(errno));
+        editorAutosaveStop(0);
+        E.autosaveDue = 0;
+    } else if (E.autosaveRow >= E.core->numrows) {
+        close(E.autosaveFd);
+        E.autosaveFd = -1;
+        E.autosaveDue = 0;
+        if (rename(tmp, path) == -1)
+            unlink(tmp);
+    }
+    free(tmp);
+    free(path);
+    return !ok;
+}
 
-    // Reset rSize & render
-    E.row[at].rSize = 0;
-    E.row[at].render = NULL;
-    E.row[at].highlight = NULL;
-    E.row[at].hl_open_comment = 0;
-    editorUpdateRow(&E.row[at]);    // Update render & rSize fields with the new row content
 
-    E.numrows++;
-    E.dirty++;  // Increment dirty after changing text
+int editorSearchPending() {
+    return E.search.query && !editorSearchIndexDone(E.core, &E.search);
 }
 
 
-void editorFreeRow(erow *row) {
-    free(row->render);
-    free(row->chars);
-    free(row->highlight);
+int editorSearchRun(long deadline) {
+    while (editorSearchIndexStep(E.core, &E.search, TEX_TASK_SEARCH_ROWS)) {
+        if (editorTaskYield(deadline))
+            return 0;
+    }
+    // The match count appears in the status bar
+    return 1;
 }
 
 
-void editorDelRow(int at) {
-    // Return if row is undeletable (after EOF)
-    if (at < 0 || at >= E.numrows)
-        return;
+int editorBracketPending() {
+    return E.bracketWaiting;
+}
 
-    editorFreeRow(&E.row[at]);  // Free memory used by the row
-    // Overwrite the deleted row struct with the rest of the rows that come after it
-    memmove(&E.row[at], &E.row[at + 1], sizeof(erow) * (E.numrows - at - 1));
-    
-    for (int j = at; j < E.numrows - 1; j++)
-        E.row[j].idx--;
 
-    E.numrows--;    // Decrement numrows after deletion
-    E.dirty++;      // Mark as modified
+int editorBracketRun(long deadline) {
+    while (E.bracketWaiting && !editorTaskYield(deadline)) {
+        editorBracketsAhead(E.core, TEX_HL_IDLE_ROWS);
+        E.bracketCy = -1;
+        editorMatchBrackets();
+    }
+    return !E.bracketWaiting;
 }
 
 
-void editorRowInsertChar(erow *row, int at, int c) {
-    // Validate at before assignment
-    if (at < 0 || at > row->size)
-        at = row->size;
-    
-    // Allocate extra byte for char and NULL byte
-    row->chars = realloc(row->chars, row->size + 2);
-    // Make room for new char
-    memmove(&row->chars[at + 1], &row->chars[at], row->size - at + 1);
-    row->size++;        // Increment size
-    row->chars[at] = c; // Assign char to position in the array
-    editorUpdateRow(row);   // Update render & rSize fields with the new row content
-    E.dirty++;  // Increment dirty after changing text
+int editorHighlightPending() {
+    // Rows of a file without a filetype are still walked for their brackets
+    return E.core->large == NULL && E.core->hlUpTo < E.core->numrows;
 }
 
 
-void editorRowAppendString(erow *row, char *s, size_t len) {
-    // Realloc enough memory for the new string
-    row->chars = realloc(row->chars, row->size + len + 1);
-    // memcpy the string to the end of the contents of row->chars
-    memcpy(&row->chars[row->size], s, len);
-    row->size += len;   // Increment size with length of new string
-    row->chars[row->size] = '\0';   // Add Null terminator to end
-    editorUpdateRow(row);   // Update row
-    E.dirty++;  // Mark as modified
+int editorHighlightRun(long deadline) {
+    int from = E.core->hlUpTo;
+    while (editorHighlightAhead(E.core, TEX_HL_IDLE_ROWS) && !editorTaskYield(deadline))
+        ;
+    // Guessed rows on screen may have been highlighted differently, in any pane
+    if (E.numPanes > 1 && E.core->hlUpTo > from)
+        return 1;
+    return from <= E.rowOff + E.screenRows && E.core->hlUpTo > E.rowOff;
 }
 
 
-void editorRowDelChar(erow *row, int at) {
-    // Return if undeletable
-    if (at < 0 || at >= row->size)
+void editorWaitKey() {
+    editorNoteEdits();
+    if (E.headless)
         return;
 
-    // Overwrite the char to delete with the chars that come after it
-    memmove(&row->chars[at], &row->chars[at + 1], row->size - at);
+    while (1) {
+        struct pollfd fds[3] = {
+            { STDIN_FILENO, POLLIN, 0 },
+            { E.sigPipe[0], POLLIN, 0 },
+            { E.watchFd, POLLIN, 0 }
+        };
+        // Background work only runs while nothing else is waiting, otherwise sleep until something is
+        int idle = editorTasksPending();
+        int n = poll(fds, E.watchFd == -1 ? 2 : 3, idle ? 0 : editorTimerWait());
+        if (n == -1 && errno != EINTR)
+            die("poll");
+        if (n > 0 && fds[0].revents)
+            return;
 
-    row->size--;    // Decrement size after removing char
-    editorUpdateRow(row);   // Update row
-    E.dirty++;  // Mark as modified
+        int redraw = 0;
+        if (n > 0 && fds[1].revents) {
+            char sigs[64];
+            while (read(E.sigPipe[0], sigs, sizeof(sigs)) > 0)
+                ;
+            editorResize();
+            redraw = 1;
+        }
+        if (n > 0 && E.watchFd != -1 && fds[2].revents)
+            redraw |= editorFileChanged();
+        if (editorTimersRun())
+            redraw = 1;
+        if (n == 0 && idle)
+            redraw |= editorTasksRun();
+
+        if (redraw)
+            editorRefreshScreen();
+    }
 }
 
 
-/*--------------------------------------------------------------------------
-                            EDITOR OPERATIONS
---------------------------------------------------------------------------*/
+void editorIndexProgress() {
+    if (E.core->large == NULL || largeProgress(E.core) >= 100)
+        editorTimerStop(TIMER_PROGRESS);
+    // Only the lines found before it stopped can be reached
+    if (E.core->large && editorLoadMore(E.core, 0) == -1)
+        editorSetStatusMessage("Indexing stopped part way: %s", strerror(errno));
+}
 
-void editorInsertChar(int c) {
-    // Cursor is on the tilde line after EOF
-    if (E.cy == E.numrows)
-        editorInsertRow(E.numrows, "", 0); // Append new row to file before inserting char
-    
-    editorRowInsertChar(&E.row[E.cy], E.cx, c);
-    E.cx++; // Increment cursor after inserted char
+
+void editorAutosaveTimer() {
+    E.autosaveDue = E.core->dirty != 0;
 }
 
 
-void editorInsertNewLine(){
-    // If cursor is at begining of line, insert a new black row before that current line
-    if (E.cx == 0) {
-        editorInsertRow(E.cy, "", 0);
-    } else {
-        // Split the current line into two rows
-        erow *row = &E.row[E.cy];
-        // Create a new row after the current one, with the correct contents
-        editorInsertRow(E.cy + 1, &row->chars[E.cx], row->size - E.cx);
+char *editorAutosavePath() {
+    if (E.core->filename == NULL)
+        return NULL;
 
-        row = &E.row[E.cy]; // Reassign row ptr, since editorInsertRow() calls realloc()
-        row->size = E.cx;   // Truncate row, set size to cursor pos
-        row->chars[row->size] = '\0';   // Add NULL terminator
-        editorUpdateRow(row);   // Update the new row
-    }
-    // Move cursor to the start of the new line
-    E.cy++;
-    E.cx = 0;
+    // .name.autosave in the same directory as name
+    char *slash = strrchr(E.core->filename, '/');
+    int dirLen = slash ? slash + 1 - E.core->filename : 0;
+    const char *base = &E.core->filename[dirLen];
+    int len = dirLen + 1 + strlen(base) + strlen(".autosave") + 1;
+    char *path = malloc(len);
+    if (path)
+        snprintf(path, len, "%.*s.%s.autosave", dirLen, E.core->filename, base);
+    return path;
 }
 
 
-void editorDelChar() {
-    // Return if cursor is past EOF
-    if (E.cy == E.numrows)
-        return;
-        
-    // If cursor is at top left corner, there's nothing to delete, return
-    if (E.cx == 0 && E.cy == 0)
+void editorAutosaveStop(int discard) {
+    char *path = editorAutosavePath();
+    if (path == NULL)
         return;
-    
-    erow *row = &E.row[E.cy];
 
-    if (E.cx > 0) {
-        editorRowDelChar(row, E.cx - 1);
-        E.cx--;
-    } else {
-        /*
-            Set cx to the end of the contents of the previous row so the cursor ends
-            up where the two lines joined up
-        */
-        E.cx = E.row[E.cy - 1].size;
-        // Append the current row to the previous row
-        editorRowAppendString(&E.row[E.cy - 1], row->chars, row->size);
-        editorDelRow(E.cy); // Delete the row being pointed to
-        E.cy--;
+    if (E.autosaveFd != -1) {
+        close(E.autosaveFd);
+        E.autosaveFd = -1;
+        int len = strlen(path) + 5;
+        char *tmp = malloc(len);
+        if (tmp == NULL)
+            die("malloc");
+        snprintf(tmp, len, "%s.tmp", path);
+        unlink(tmp);
+        free(tmp);
     }
+    if (discard && !E.headless)
+        unlink(path);
+    free(path);
 }
 
 
 /*--------------------------------------------------------------------------
-                                 FILE IO
+                                  THEMES
 --------------------------------------------------------------------------*/
 
-char *editorRowsToString(int *buflen) {
-    int totlen = 0;
-    int j;
+int editorThemeColour(char *buf, int size, int colour, int base) {
+    if (colour == THEME_DEFAULT)
+        return snprintf(buf, size, ";%d", base + 9);
+    if (colour & 0x1000000)
+        return snprintf(buf, size, ";%d;2;%d;%d;%d", base + 8, (colour >> 16) & 0xff, (colour >> 8) & 0xff, colour & 0xff);
+    if (colour < 8)
+        return snprintf(buf, size, ";%d", base + colour);
+    if (colour < 16)
+        return snprintf(buf, size, ";%d", base + 60 + colour - 8);  // Bright colours, 90 and 100 up
+    return snprintf(buf, size, ";%d;5;%d", base + 8, colour);
+}
 
-    // Get total length, from lengths of each row of text
-    for (j = 0; j < E.numrows; j++)
-        totlen += E.row[j].size + 1;
-    
-    *buflen = totlen;   // Save total length into buflen
 
-    char *buf = malloc(totlen); // Allocate memory for the string
-    char *p = buf;
+void editorThemeSet(int cls, int fg, int bg, int attrs) {
+    E.theme[cls].fg = fg;
+    E.theme[cls].bg = bg;
+    E.theme[cls].attrs = attrs;
+}
+
 
-    for (j = 0; j < E.numrows; j++) {
-        // Copy contents of each row to the end of the buffer
-        memcpy(p, E.row[j].chars, E.row[j].size);
-        p += E.row[j].size; // Move pointer to end of line
-        *p = '\n';  // Append newline after each row
-        p++;        // Increment pointer
+void editorThemeBuild() {
+    struct editorStyle *normal = &E.theme[HL_NORMAL];
+    int fgs[THEME_COUNT], bgs[THEME_COUNT];
+    int attrsUsed = 0, fgUsed = 0, bgUsed = 0;
+
+    for (int cls = 0; cls < THEME_COUNT; cls++) {
+        fgs[cls] = E.theme[cls].fg == THEME_INHERIT ? normal->fg : E.theme[cls].fg;
+        bgs[cls] = E.theme[cls].bg == THEME_INHERIT ? normal->bg : E.theme[cls].bg;
+        if (fgs[cls] == THEME_INHERIT)
+            fgs[cls] = THEME_DEFAULT;
+        if (bgs[cls] == THEME_INHERIT)
+            bgs[cls] = THEME_DEFAULT;
+        attrsUsed |= E.theme[cls].attrs;
+        fgUsed |= (fgs[cls] != THEME_DEFAULT);
+        bgUsed |= (bgs[cls] != THEME_DEFAULT);
     }
 
-    return buf;
+    // Every attribute some class changes is set, so switching classes never resets an inverted run
+    for (int cls = 0; cls < THEME_COUNT; cls++) {
+        struct editorStyle *style = &E.theme[cls];
+        char *seq = style->seq;
+        int size = sizeof(style->seq);
+        int len = snprintf(seq, size, "\x1b[");
+        if (attrsUsed & THEME_BOLD)
+            len += snprintf(&seq[len], size - len, ";%d", style->attrs & THEME_BOLD ? 1 : 22);
+        if (attrsUsed & THEME_ITALIC)
+            len += snprintf(&seq[len], size - len, ";%d", style->attrs & THEME_ITALIC ? 3 : 23);
+        if (fgUsed)
+            len += editorThemeColour(&seq[len], size - len, fgs[cls], 30);
+        if (bgUsed)
+            len += editorThemeColour(&seq[len], size - len, bgs[cls], 40);
+
+        // Drop the first parameter's separator, or the whole escape if the theme changes nothing
+        if (len == 2) {
+            len = 0;
+        } else {
+            memmove(&seq[2], &seq[3], len - 3);
+            seq[len - 1] = 'm';
+        }
+        seq[len] = '\0';
+        style->len = len;
+    }
+    E.themePlain = (fgs[HL_NORMAL] == THEME_DEFAULT && bgs[HL_NORMAL] == THEME_DEFAULT && normal->attrs == 0);
 }
 
 
-void editorOpen(char *filename) {
-    free(E.filename);   // Free prev filename
-    E.filename = strdup(filename);  // Duplicate filename, returns identical malloc-ed string
-
-    editorSelectSyntaxHighlight();  // Detect filetype
+void editorThemeDefault() {
+    editorThemeSet(HL_NORMAL, THEME_DEFAULT, THEME_DEFAULT, 0);
+    editorThemeSet(HL_COMMENT, 6, THEME_INHERIT, 0);    // Cyan
+    editorThemeSet(HL_MLCOMMENT, 6, THEME_INHERIT, 0);
+    editorThemeSet(HL_KEYWORD, 3, THEME_INHERIT, 0);    // Yellow
+    editorThemeSet(HL_TYPE, 2, THEME_INHERIT, 0);       // Green
+    editorThemeSet(HL_STRING, 5, THEME_INHERIT, 0);     // Magenta
+    editorThemeSet(HL_NUMBER, 1, THEME_INHERIT, 0);     // Red
+    editorThemeSet(HL_MATCH, 4, THEME_INHERIT, 0);      // Blue
+    editorThemeSet(HL_BRACKET, 9, THEME_INHERIT, 0);    // Bright red
+    editorThemeSet(THEME_ADDED, 2, THEME_INHERIT, 0);
+    editorThemeSet(THEME_CHANGED, 3, THEME_INHERIT, 0);
+    editorThemeSet(THEME_DELETED, 1, THEME_INHERIT, 0);
+    editorThemeSet(THEME_LINE_NUMBER, 6, THEME_INHERIT, 0);
+    editorThemeBuild();
+}
 
-    FILE *fp = fopen(filename, "r");
-    if (!fp)
-        die("fopen");
 
-    char *line = NULL;
-    size_t linecap = 0;
-    ssize_t linelen;
+int editorThemeParseColour(const char *s, int *colour) {
+    const char *names[] = { "black", "red", "green", "yellow", "blue", "magenta", "cyan", "white" };
+    char *end;
 
-    // Read until EOFs
-    while ((linelen = getline(&line, &linecap, fp)) != -1) {
-        while (linelen > 0 && (line[linelen - 1] == '\n' || line[linelen - 1] == '\r'))
-            linelen--;
-        
-        editorInsertRow(E.numrows, line, linelen);   
+    if (!strcmp(s, "default")) {
+        *colour = THEME_DEFAULT;
+        return 0;
     }
-    free(line);
-    fclose(fp);
-    E.dirty = 0;    // Reset flag so user isn't alerted after opening file
+    for (int i = 0; i < 8; i++) {
+        if (!strcmp(s, names[i])) {
+            *colour = i;
+            return 0;
+        }
+    }
+    if (s[0] == '#') {
+        long rgb = strtol(&s[1], &end, 16);
+        if (strlen(s) != 7 || *end != '\0')
+            return -1;
+        *colour = THEME_RGB((int) (rgb >> 16), (int) (rgb >> 8) & 0xff, (int) rgb & 0xff);
+        return 0;
+    }
+    long n = strtol(s, &end, 10);
+    if (end == s || *end != '\0' || n < 0 || n > 255)
+        return -1;
+    *colour = n;
+    return 0;
 }
 
 
-void editorSave() {
-    // New file, prompt user for a filename
-    if (E.filename == NULL) {
-        E.filename = editorPrompt("Save as %s (ESC to cancel)", NULL);
-        // User presses ESC, abort save
-        if (E.filename == NULL) {
-            editorSetStatusMessage("Save aborted!");
-            return;
-        }
-        editorSelectSyntaxHighlight();
-    }
-    
-    int len;
-    char *buf = editorRowsToString(&len);
+int editorLoadTheme(const char *path, int *line) {
+    const char *classes[THEME_COUNT] = {
+        "normal", "comment", "mlcomment", "keyword", "type", "string", "number", "match", "bracket",
+        "added", "changed", "deleted", "linenumber"
+    };
+    *line = 0;
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+        return -1;
 
-    // Open/Create new file if it doesn't exist, for read&write, and with proper permissions
-    int fp = open(E.filename, O_RDWR | O_CREAT, 0644);
+    int err = 0;
+    char buf[256];
+    while (fgets(buf, sizeof(buf), fp)) {
+        (*line)++;
+        char *hash = strchr(buf, '#');
+        // A # followed by a hex colour isn't a comment
+        while (hash && hash > buf && hash[-1] == '=')
+            hash = strchr(hash + 1, '#');
+        if (hash)
+            *hash = '\0';
+
+        char *word = strtok(buf, " \t\r\n");
+        if (word == NULL)
+            continue;
+        int cls = 0;
+        while (cls < THEME_COUNT && strcmp(word, classes[cls]))
+            cls++;
+        if (cls == THEME_COUNT) {
+            err = -1;
+            break;
+        }
 
-    // Error Handling
-    if (fp != -1) {
-        if (ftruncate(fp, len) != -1){
-            if (write(fp, buf, len) == len) {
-                // Successful save
-                close(fp);
-                free(buf);
-                E.dirty = 0;    // Reset flag after saving
-                // Notify user on sucessful save
-                editorSetStatusMessage("%d bytes written to disk", len);
-                return;
+        int fg = THEME_INHERIT, bg = THEME_INHERIT, attrs = 0;
+        while ((word = strtok(NULL, " \t\r\n")) != NULL) {
+            int ok = 0;
+            if (!strcmp(word, "bold")) {
+                attrs |= THEME_BOLD;
+                ok = 1;
+            } else if (!strcmp(word, "italic")) {
+                attrs |= THEME_ITALIC;
+                ok = 1;
+            } else if (!strncmp(word, "fg=", 3)) {
+                ok = editorThemeParseColour(&word[3], &fg) == 0;
+            } else if (!strncmp(word, "bg=", 3)) {
+                ok = editorThemeParseColour(&word[3], &bg) == 0;
+            }
+            if (!ok) {
+                err = -1;
+                break;
             }
         }
-        // Close file after succesfully saving
-        close(fp);
+        if (err)
+            break;
+        editorThemeSet(cls, fg, bg, attrs);
     }
-    // Unsuccessful save
-    free(buf);
-    editorSetStatusMessage("Can't save! I/O error: %s", strerror(errno));
+    fclose(fp);
+    editorThemeBuild();
+    return err;
 }
 
 
-void editorFindCallback(char *query, int key) {
-    static int lastMatch = -1;  // -1 when there is no last match
-    static int direction = 1;   // 1 Seach forward, -1 seach backward
+/*--------------------------------------------------------------------------
+                                  PANES
+--------------------------------------------------------------------------*/
+
+void editorViewSave(struct editorView *v) {
+    v->cx = E.core->cx;
+    v->cy = E.core->cy;
+    v->rowOff = E.rowOff;
+    v->colOff = E.colOff;
+    v->wrapOff = E.wrapOff;
+    v->screenRows = E.screenRows;
+    v->screenCols = E.screenCols;
+    v->softWrap = E.softWrap;
+    v->matchRow = E.matchRow;
+    v->bracketRow[0] = E.bracketRow[0];
+    v->bracketRow[1] = E.bracketRow[1];
+    v->numCursors = E.core->numCursors;
+    v->selMode = E.core->selMode;
+}
+
+
+void editorViewLoad(const struct editorView *v) {
+    E.core->cx = v->cx;
+    E.core->cy = v->cy;
+    E.rowOff = v->rowOff;
+    E.colOff = v->colOff;
+    E.wrapOff = v->wrapOff;
+    E.screenRows = v->screenRows;
+    E.screenCols = v->screenCols;
+    E.softWrap = v->softWrap;
+    E.matchRow = v->matchRow;
+    E.bracketRow[0] = v->bracketRow[0];
+    E.bracketRow[1] = v->bracketRow[1];
+    E.core->numCursors = v->numCursors;
+    E.core->selMode = v->selMode;
+}
 
-    static int saved_hl_line;
-    static char *saved_hl = NULL;
 
-    // Save syntax highlights pripr to search
-    if (saved_hl) {
-        memcpy(E.row[saved_hl_line].highlight, saved_hl, E.row[saved_hl_line].rSize);
-        free(saved_hl); // Free incase user cancels search
-        saved_hl = NULL;
+int editorSplitAlloc() {
+    for (int i = 0; i < 2 * TEX_MAX_PANES; i++) {
+        struct editorSplit *s = &E.splits[i];
+        if (s->used)
+            continue;
+        memset(s, 0, sizeof(*s));
+        s->used = 1;
+        s->pane = -1;
+        s->child[0] = s->child[1] = -1;
+        s->parent = -1;
+        return i;
     }
+    return -1;
+}
 
-    // Exit and reset lastMatch & dir for next search
-    if (key == '\r' || key == '\x1b') {
-        lastMatch = -1;
-        direction = 1;
+
+void editorSplitLayout(int node, int top, int left, int rows, int cols) {
+    struct editorSplit *s = &E.splits[node];
+    s->top = top;
+    s->left = left;
+    s->rows = rows;
+    s->cols = cols;
+
+    if (s->pane != -1) {
+        struct editorPane *p = &E.panes[s->pane];
+        p->top = top;
+        p->left = left;
+        p->cols = cols;
+        // Only the bottom panes sit on the status bar, the others need their own
+        p->bar = (top + rows < E.areaRows && rows > 1);
+        p->rows = rows - p->bar;
         return;
-    } else if (key == ARROW_RIGHT || key == ARROW_DOWN) {   // Jump to next match found
-        direction = 1;
-    } else if (key == ARROW_LEFT || key == ARROW_UP) {      // Jump to prev match
-        direction = -1;
+    }
+
+    if (s->vertical) {
+        int first = (cols - 1) / 2;
+        editorSplitLayout(s->child[0], top, left, rows, first);
+        editorSplitLayout(s->child[1], top, left + first + 1, rows, cols - first - 1);
     } else {
-        lastMatch = -1;
-        direction = 1;
+        int first = rows / 2;
+        editorSplitLayout(s->child[0], top, left, first, cols);
+        editorSplitLayout(s->child[1], top + first, left, rows - first, cols);
     }
-    
-    if (lastMatch == -1)
-        direction = 1;
+}
 
-    int current = lastMatch;
 
-    // Loop through rows in the file
-    for (int i = 0; i < E.numrows; i++) {
-        current += direction;
+void editorPanesLayout() {
+    editorSplitLayout(E.splitRoot, 0, 0, E.areaRows, E.areaCols);
+    E.dividers = 1;
+    editorPaneFit();
+}
 
-        if (current == -1)
-            current = E.numrows - 1;
-        else if (current == E.numrows)
-            current = 0;
-        
 
-        erow *row = &E.row[current];
-        // Check if query is found in file, return pointer to the matching substring
-        char *match = strstr(row->render, query);
-
-        // String is found in file
-        if (match) {
-            lastMatch = current;
-            E.cy = current; // Jump cursor to next match row
-            // Move cursor to the substring on the row
-            E.cx = editorRowRxToCx(row, match - row->render);
-            E.rowOff = E.numrows;   // Update row offset
-            
-            // Restore previous syntax highlighting
-            saved_hl_line = current;
-            saved_hl = malloc(row->rSize);
-            memcpy(saved_hl, row->highlight, row->rSize);
-
-            memset(&row->highlight[match - row->render], HL_MATCH, strlen(query));
-            break;
-        }
-    }
+void editorPaneFit() {
+    struct editorPane *p = &E.panes[E.pane];
+    E.screenRows = p->rows > 1 ? p->rows : 1;
+    E.screenCols = p->cols - E.overview - E.gutter > 1 ? p->cols - E.overview - E.gutter : 1;
+    editorLayoutResize(E.core, E.screenCols);
 }
 
 
-void editorFind() {
-    // Save cursor location prior to search
-    int save_cx = E.cx;
-    int saved_cy = E.cy;
-    int saved_colOff = E.colOff;
-    int saved_rowOff = E.rowOff;
+int editorPaneNode(int p) {
+    for (int i = 0; i < 2 * TEX_MAX_PANES; i++) {
+        if (E.splits[i].used && E.splits[i].pane == p)
+            return i;
+    }
+    return -1;
+}
 
-    // Query user for string to search for, returns NULL on ESC key press
-    char *query = editorPrompt("Search: %s (Use Arrow keys goto next match, and ESC to exit find mode)", editorFindCallback);
 
-    if (query) {
-        free(query);
-    } else {    // Restore cursor to previous position
-        E.cx = save_cx;
-        E.cy = saved_cy;
-        E.colOff = saved_colOff;
-        E.rowOff = saved_rowOff;
-    }
+void editorPaneBlur() {
+    struct editorPane *p = &E.panes[E.pane];
+    editorClearCursors(E.core);
+    editorSelectClear(E.core);
+    E.matchRow = -1;
+
+    editorViewSave(&p->view);
+    p->view.bracketRow[0] = p->view.bracketRow[1] = -1;
+    p->wrapSub = E.softWrap ? E.wrapOff - editorLayoutVisualLine(E.core, E.rowOff) : 0;
+    // It was last drawn with the cursor's overlays
+    p->look.core = NULL;
 }
 
 
-/*--------------------------------------------------------------------------
-                               APPEND BUFFER
---------------------------------------------------------------------------*/
+void editorPaneFocus(int p) {
+    texCore *tc = E.core;
+    int softWrap = E.softWrap;
+    E.pane = p;
+    editorViewLoad(&E.panes[p].view);
+    E.softWrap = softWrap;
+    editorPaneFit();
+
+    // Rows may have been deleted from under it while it was unfocused
+    if (tc->cy > tc->numrows)
+        tc->cy = tc->numrows;
+    if (tc->cy < tc->numrows) {
+        erow *row = editorRowAt(tc, tc->cy);
+        if (tc->cx > row->size)
+            tc->cx = row->size;
+    } else {
+        tc->cx = 0;
+    }
+    if (E.rowOff > tc->numrows)
+        E.rowOff = tc->numrows;
+    if (E.softWrap)
+        E.wrapOff = editorLayoutVisualLine(tc, E.rowOff) + E.panes[p].wrapSub;
+    E.bracketCx = -1;   // Brackets are matched again at its cursor
+}
 
-void abAppend(struct aBuf *ab, const char *s, int len) {
-    char *new = realloc(ab->b, ab->len + len);  // Realloc for new string length
 
-    if (new == NULL)
+void editorSplitPane(int vertical) {
+    int node = editorPaneNode(E.pane);
+    struct editorSplit *s = &E.splits[node];
+    if (E.numPanes == TEX_MAX_PANES) {
+        editorSetStatusMessage("Can't split into more than %d panes", TEX_MAX_PANES);
         return;
-    
-    // Assign struct fields
-    memcpy(&new[ab->len], s, len);  // Copy string s after end of current buffer
-    ab->b = new;    // Update pointer
-    ab->len += len; // Update length
-}
+    }
+    // Both halves keep room for a few lines or columns, the top one less its bar
+    if ((vertical && (s->cols - 1) / 2 < TEX_PANE_MIN_COLS) || (!vertical && s->rows / 2 - 1 < TEX_PANE_MIN_ROWS)) {
+        editorSetStatusMessage("Pane is too small to split");
+        return;
+    }
 
-void abFree(struct aBuf *ab) {
-    free(ab->b);    // Free char pointer
+    // The new pane starts with the same view, less the overlays only the focused pane has
+    int n = E.numPanes++;
+    struct editorPane *p = &E.panes[n];
+    memset(p, 0, sizeof(*p));
+    editorViewSave(&p->view);
+    p->view.matchRow = -1;
+    p->view.bracketRow[0] = p->view.bracketRow[1] = -1;
+    p->view.numCursors = 0;
+    p->view.selMode = SEL_NONE;
+    p->wrapSub = E.softWrap ? E.wrapOff - editorLayoutVisualLine(E.core, E.rowOff) : 0;
+
+    int a = editorSplitAlloc();
+    int b = editorSplitAlloc();
+    E.splits[a].pane = E.pane;
+    E.splits[a].parent = node;
+    E.splits[b].pane = n;
+    E.splits[b].parent = node;
+    s->pane = -1;
+    s->vertical = vertical;
+    s->child[0] = a;
+    s->child[1] = b;
+    editorPanesLayout();
+    editorSetStatusMessage("Split %s, CTRL-A moves between panes and CTRL-Q closes one",
+        vertical ? "side by side" : "one above the other");
 }
 
 
-/*--------------------------------------------------------------------------
-                                   OUTPUT
---------------------------------------------------------------------------*/
+int editorClosePane() {
+    if (E.numPanes == 1)
+        return 0;
 
-void editorScroll() {
-    E.rx = 0;
-    // Set rx
-    if (E.cy < E.numrows) {
-        E.rx = editorRowCxToRx(&E.row[E.cy], E.cx);
+    // Its sibling takes the place of the split they were the halves of
+    int closed = E.pane;
+    int node = editorPaneNode(closed);
+    int parent = E.splits[node].parent;
+    int sibling = E.splits[parent].child[E.splits[parent].child[0] == node];
+    int grand = E.splits[parent].parent;
+    E.splits[sibling].parent = grand;
+    if (grand == -1)
+        E.splitRoot = sibling;
+    else
+        E.splits[grand].child[E.splits[grand].child[0] != parent] = sibling;
+    E.splits[node].used = 0;
+    E.splits[parent].used = 0;
+
+    // Overlays are only the focused pane's, the last pane moves into the closed one's slot
+    editorClearCursors(E.core);
+    editorSelectClear(E.core);
+    E.matchRow = -1;
+    free(E.panes[closed].lines);
+    E.numPanes--;
+    if (closed != E.numPanes) {
+        E.splits[editorPaneNode(E.numPanes)].pane = closed;
+        E.panes[closed] = E.panes[E.numPanes];
     }
 
-    // Cursor is above visible window
-    if (E.cy < E.rowOff) {
-        E.rowOff = E.cy;    // Scroll to where cursor is
-    }
+    // The focus goes to the first pane in the space it leaves
+    while (E.splits[sibling].pane == -1)
+        sibling = E.splits[sibling].child[0];
+    E.pane = E.splits[sibling].pane;
+    editorPanesLayout();
+    editorPaneFocus(E.pane);
+    return 1;
+}
 
-    // Cursor is past bottom of visible window
-    if (E.cy >= E.rowOff + E.screenRows) {
-        E.rowOff = E.cy - E.screenRows + 1; // Scroll just past bottom of screen, but not past EOF
-    }
 
-    // Cursor is left of visible window
-    if (E.rx < E.colOff) {
-        E.colOff = E.rx;
-    }
+void editorNextPane() {
+    if (E.numPanes == 1)
+        return;
 
-    // Cursor is right of visible window
-    if (E.rx >= E.colOff + E.screenCols) {
-        E.colOff = E.rx - E.screenCols + 1;
+    // Leaves of the split tree in order run left to right and top to bottom
+    int order[TEX_MAX_PANES], stack[2 * TEX_MAX_PANES];
+    int n = 0, top = 0;
+    stack[top++] = E.splitRoot;
+    while (top) {
+        struct editorSplit *s = &E.splits[stack[--top]];
+        if (s->pane != -1) {
+            order[n++] = s->pane;
+            continue;
+        }
+        stack[top++] = s->child[1];
+        stack[top++] = s->child[0];
     }
+
+    int i = 0;
+    while (order[i] != E.pane)
+        i++;
+    editorPaneBlur();
+    editorPaneFocus(order[(i + 1) % n]);
 }
 
 
-void editorDrawRows(struct aBuf *ab) {
-    int y;  // Terminal height
+void editorPanesCatchUp() {
+    texViewChanges changes;
+    editorViewsTake(E.core, &changes);
+    if (!changes.dirty && !changes.all)
+        return;
+
+    for (int i = 0; i < E.numPanes; i++) {
+        struct editorPane *p = &E.panes[i];
+        if (i == E.pane)
+            continue;
+
+        // Its view stays on the rows it showed as they move, or where they were when they're gone
+        int cy = editorViewsMapRow(&changes, p->view.cy);
+        if (cy != -1)
+            p->view.cy = cy;
+        int rowOff = editorViewsMapRow(&changes, p->view.rowOff);
+        if (rowOff != -1)
+            p->view.rowOff = rowOff;
+
+        int rows = p->look.core ? p->look.rows : 0;
+        for (int y = 0; y < rows; y++) {
+            struct editorPaneLine *line = &p->lines[y];
+            if (line->row < 0)
+                continue;
+            line->row = editorViewsMapRow(&changes, line->row);
+            if (line->row == -1)
+                line->row = -3;
+        }
+    }
+}
+
+
+void editorPaneEnter(struct editorPane *p, struct editorView *focused) {
+    texCore *tc = E.core;
+    editorViewSave(focused);
+    editorViewLoad(&p->view);
+    E.screenRows = p->rows;
+    E.screenCols = p->cols - E.overview - E.gutter > 1 ? p->cols - E.overview - E.gutter : 1;
+    E.softWrap = focused->softWrap && E.screenCols == tc->wrapCols;
+
+    // Rows may have been deleted from under it, or folded around its top
+    if (tc->cy > tc->numrows)
+        tc->cy = tc->numrows;
+    if (E.rowOff > tc->numrows)
+        E.rowOff = tc->numrows;
+    if (tc->numFolds && E.rowOff < tc->numrows)
+        E.rowOff -= editorRowAt(tc, E.rowOff)->foldUp;
+    if (E.softWrap)
+        E.wrapOff = editorLayoutVisualLine(tc, E.rowOff) + p->wrapSub;
+}
+
+
+void editorPaneLeave(struct editorPane *p, struct editorView *focused) {
+    editorViewSave(&p->view);
+    editorViewLoad(focused);
+}
+
+
+void editorPanesHighlight() {
+    // Every row that isn't folded away takes up at least one line
+    editorHighlightRows(E.core, E.rowOff, editorFoldStep(E.core, E.rowOff, E.screenRows - 1));
+
+    // A paged file's rows are only highlighted once a line of them needs drawing
+    for (int i = 0; i < E.numPanes && E.core->large == NULL; i++) {
+        struct editorPane *p = &E.panes[i];
+        if (i == E.pane)
+            continue;
+        struct editorView focused;
+        editorPaneEnter(p, &focused);
+        editorHighlightRows(E.core, E.rowOff, editorFoldStep(E.core, E.rowOff, E.screenRows - 1));
+        editorPaneLeave(p, &focused);
+    }
+}
+
+
+/*--------------------------------------------------------------------------
+                            EDITOR OPERATIONS
+--------------------------------------------------------------------------*/
+
+void editorGoToRow(int at) {
+    if (at >= E.core->numrows)
+        at = E.core->numrows - 1;
+    if (at < 0)
+        at = 0;
+
+    E.core->cy = at;
+    E.core->cx = 0;
+    editorFoldReveal(E.core, at);
+
+    // Centre the row in the window, without scrolling past the end of the file
+    E.rowOff = editorFoldStep(E.core, at, -(E.screenRows / 2));
+    int last = editorFoldStep(E.core, E.core->numrows, -E.screenRows);
+    if (E.rowOff > last)
+        E.rowOff = last;
+    if (E.softWrap) {
+        E.wrapOff = editorLayoutVisualLine(E.core, at) - E.screenRows / 2;
+        if (E.wrapOff > editorLayoutVisualLine(E.core, E.core->numrows) - E.screenRows)
+            E.wrapOff = editorLayoutVisualLine(E.core, E.core->numrows) - E.screenRows;
+        if (E.wrapOff < 0)
+            E.wrapOff = 0;
+    }
+}
+
+
+void editorGoToLine() {
+    char *query = editorPrompt("Go to line: %s (N, N%%, ^ for start, $ for end, ESC to cancel)", NULL);
+    if (query == NULL)
+        return;
+
+    char *end;
+    if (!strcmp(query, "^")) {
+        editorGoToRow(0);
+    } else if (!strcmp(query, "$")) {
+        editorGoToRow(E.core->numrows - 1);
+    } else {
+        errno = 0;
+        long n = strtol(query, &end, 10);
+        if (end == query || errno == ERANGE || (*end != '\0' && strcmp(end, "%") != 0)) {
+            editorSetStatusMessage("Not a line number: %s", query);
+        } else if (*end == '%') {
+            if (n < 0)
+                n = 0;
+            if (n > 100)
+                n = 100;
+            editorGoToRow((int) ((long long) (E.core->numrows - 1) * n / 100));
+        } else {
+            // Lines are numbered from 1, and any past the end go to the last
+            if (n > E.core->numrows)
+                n = E.core->numrows;
+            if (n < 1)
+                n = 1;
+            editorGoToRow((int) n - 1);
+        }
+    }
+    free(query);
+}
+
+
+/*--------------------------------------------------------------------------
+                                  LAYOUT
+--------------------------------------------------------------------------*/
+
+int editorLayoutCursorSub() {
+    if (E.core->cy >= E.core->numrows || E.screenCols <= 0)
+        return 0;
+
+    int sub = E.rx / E.screenCols;
+    // Cursor at the end of a row that exactly fills its last line stays on that line
+    if (sub >= editorRowAt(E.core, E.core->cy)->wrapLines)
+        sub = editorRowAt(E.core, E.core->cy)->wrapLines - 1;
+    return sub;
+}
+
+
+void editorLayoutMoveVisual(int delta) {
+    if (E.core->cy < E.core->numrows)
+        E.rx = editorRowCxToRx(editorRowAt(E.core, E.core->cy), E.core->cx);
+
+    int sub = editorLayoutCursorSub();
+    int col = E.rx - sub * E.screenCols;   // Column within the visual line, kept while moving
+
+    // Clamp to the tilde line just past the end of the file
+    int target = editorLayoutVisualLine(E.core, E.core->cy) + sub + delta;
+    int total = editorLayoutVisualLine(E.core, E.core->numrows);
+    if (target < 0)
+        target = 0;
+    if (target > total)
+        target = total;
+
+    E.core->cy = editorLayoutRowAtVisual(E.core, target, &sub);
+    E.core->cx = (E.core->cy < E.core->numrows) ? editorRowRxToCx(editorRowAt(E.core, E.core->cy), sub * E.screenCols + col) : 0;
+}
+
+
+void editorToggleSoftWrap() {
+    // Wrapping needs every row's width, which a paged file never has in memory
+    if (E.core->large) {
+        editorSetStatusMessage("Soft wrap is off for large files");
+        return;
+    }
+    E.softWrap = !E.softWrap;
+
+    if (E.softWrap) {
+        // Keep the top row of the window in place
+        E.wrapOff = editorLayoutVisualLine(E.core, E.rowOff);
+        E.colOff = 0;
+    }
+    editorSetStatusMessage("Soft wrap %s", E.softWrap ? "on" : "off");
+}
+
+
+void editorToggleOverview() {
+    // Summing the rows needs them all in memory
+    if (E.core->large) {
+        editorSetStatusMessage("The overview ruler is off for large files");
+        return;
+    }
+    if (!E.overview && E.screenCols < 2)
+        return;
+    E.overview = !E.overview;
+    E.screenCols += E.overview ? -1 : 1;
+    editorLayoutResize(E.core, E.screenCols);
+
+    // Keep the top row of the window in place while its visual lines change
+    if (E.softWrap)
+        E.wrapOff = editorLayoutVisualLine(E.core, E.rowOff);
+    editorSetStatusMessage("Overview ruler %s", E.overview ? "on" : "off");
+}
+
+
+void editorMatchBrackets() {
+    texCore *tc = E.core;
+    if (tc->cx == E.bracketCx && tc->cy == E.bracketCy && tc->dirty == E.bracketDirty)
+        return;
+    E.bracketCx = tc->cx;
+    E.bracketCy = tc->cy;
+    E.bracketDirty = tc->dirty;
+    E.bracketRow[0] = E.bracketRow[1] = -1;
+    E.bracketWaiting = 0;
+    if (tc->cy >= tc->numrows || tc->large)
+        return;
+
+    // The bracket under the cursor, or else the one just before it
+    erow *row = editorRowAt(tc, tc->cy);
+    int ro = editorRowMapIndex(row, IDX_CHARS, IDX_RENDER, tc->cx);
+    int matchRow, matchRo;
+    int found = editorMatchBracket(tc, tc->cy, ro, &matchRow, &matchRo);
+    if (found == 0 && tc->cx > 0) {
+        ro = editorRowMapIndex(row, IDX_CHARS, IDX_RENDER, editorRowPrevCx(row, tc->cx));
+        found = editorMatchBracket(tc, tc->cy, ro, &matchRow, &matchRo);
+    }
+
+    // Found once the rows down to it are highlighted, by editorBracketRun()
+    E.bracketWaiting = (found == -1);
+    if (found != 1)
+        return;
+    E.bracketRow[0] = tc->cy;
+    E.bracketRo[0] = ro;
+    E.bracketRow[1] = matchRow;
+    E.bracketRo[1] = matchRo;
+}
+
+
+void editorToggleFold() {
+    texCore *tc = E.core;
+    if (tc->large) {
+        editorSetStatusMessage("Folding is off for large files");
+        return;
+    }
+    if (tc->cy >= tc->numrows)
+        return;
+
+    int n = editorUnfold(tc, tc->cy);
+    if (n) {
+        editorSetStatusMessage("Unfolded %d line%s", n, n == 1 ? "" : "s");
+        return;
+    }
+
+    // The end of the block may be further down than the rows highlighted so far
+    while ((n = editorFoldAt(tc, tc->cy)) == -1 && editorBracketsAhead(tc, TEX_HL_LOOKBACK / 2))
+        ;
+    if (n > 0)
+        editorSetStatusMessage("Folded %d line%s, Ctrl-K again to unfold", n, n == 1 ? "" : "s");
+    else
+        editorSetStatusMessage("Nothing to fold, Ctrl-K folds a row opening a { block or a comment");
+}
+
+
+void editorToggleDiff() {
+    texCore *tc = E.core;
+    // Paged rows aren't hashed, and the file on disk is the rows
+    if (tc->large) {
+        editorSetStatusMessage("Diffing against the file on disk is off for large files");
+        return;
+    }
+    if (!E.diff && E.screenCols < 2)
+        return;
+    E.diff = !E.diff;
+    editorGutterResize();
+    if (!E.diff) {
+        editorSetStatusMessage("Diff gutter off");
+        return;
+    }
+
+    editorDiffUpdate(tc);
+    int added = 0, deleted = 0;
+    for (int i = 0; i < tc->numHunks; i++) {
+        added += tc->hunks[i].rowCount;
+        deleted += tc->hunks[i].baseCount;
+    }
+    if (tc->numHunks)
+        editorSetStatusMessage("%d change%s against disk, +%d -%d lines, Ctrl-N/Ctrl-P to jump",
+            tc->numHunks, tc->numHunks == 1 ? "" : "s", added, deleted);
+    else
+        editorSetStatusMessage("No changes against disk");
+}
+
+
+void editorGutterResize() {
+    int digits = 1;
+    for (int n = E.core->numrows; n >= 10; n /= 10)
+        digits++;
+    E.numberWidth = E.lineNumbers ? digits + 1 : 0;
+    int width = E.numberWidth + E.diff;
+    // Numbers are left out of a window too narrow for them and a column of the row
+    if (E.screenCols + E.gutter - width < 1) {
+        E.numberWidth = 0;
+        width = E.diff;
+    }
+    if (width == E.gutter)
+        return;
+
+    E.screenCols += E.gutter - width;
+    E.gutter = width;
+    editorLayoutResize(E.core, E.screenCols);
+    // Keep the top row of the window in place while its visual lines change
+    if (E.softWrap)
+        E.wrapOff = editorLayoutVisualLine(E.core, E.rowOff);
+}
+
+
+void editorToggleLineNumbers() {
+    E.lineNumbers = (E.lineNumbers + 1) % 3;
+    editorGutterResize();
+    const char *modes[] = { "off", "on", "relative to the cursor" };
+    editorSetStatusMessage("Line numbers %s", modes[E.lineNumbers]);
+}
+
+
+void editorJumpChange(int direction) {
+    texCore *tc = E.core;
+    if (tc->large)
+        return;
+    editorDiffUpdate(tc);
+
+    int i = editorDiffFind(tc, tc->cy, direction);
+    if (i == -1) {
+        editorSetStatusMessage("No changes against disk");
+        return;
+    }
+    // A deletion at the end of the file is shown on the last row
+    int row = tc->hunks[i].row < tc->numrows ? tc->hunks[i].row : tc->numrows - 1;
+    editorGoToRow(row > 0 ? row : 0);
+    editorSetStatusMessage("Change %d of %d", i + 1, tc->numHunks);
+}
+
+
+void editorLargeSync() {
+    if (E.core->large == NULL)
+        return;
+
+    // The window is always within a screen of the cursor, along with the rows highlighted above it
+    largeSync(E.core, E.core->cy - E.screenRows - TEX_LARGE_HL_LOOKBACK - 1, E.core->cy + E.screenRows + 1);
+}
+
+
+/*--------------------------------------------------------------------------
+                                 FILE IO
+--------------------------------------------------------------------------*/
+
+void editorOpenFile(char *filename, int large, long long budget) {
+    struct stat st;
+    if (!large && stat(filename, &st) == 0) {
+        long long size = editorIsGzip(filename) ? st.st_size * TEX_GZIP_RATIO : st.st_size;
+        large = size >= TEX_LARGE_FILE_MB * 1024LL * 1024;
+    }
+
+    if (large) {
+        if (largeOpen(E.core, filename, budget) == -1)
+            die("fopen");
+        // Lines are counted in the background, show how far it's got while nothing else redraws
+        editorTimerStart(TIMER_PROGRESS, TEX_PROGRESS_US, TEX_PROGRESS_US, editorIndexProgress);
+        return;
+    }
+
+    if (editorOpenStart(E.core, filename) == -1)
+        die("fopen");
+    // Benchmarks and traces need the whole file to be there from the start
+    if (editorLoadMore(E.core, E.headless ? LLONG_MAX : TEX_LOAD_SLICE) == -1)
+        die("read");
+}
+
+
+void editorSave() {
+    // New file, prompt user for a filename
+    if (E.core->filename == NULL) {
+        E.core->filename = editorPrompt("Save as %s (ESC to cancel)", NULL);
+        // User presses ESC, abort save
+        if (E.core->filename == NULL) {
+            editorSetStatusMessage("Save aborted!");
+            return;
+        }
+        editorSelectSyntaxHighlight(E.core);
+    }
+    
+    // Never write to disk from a benchmark or replayed trace
+    if (E.headless) {
+        E.core->dirty = 0;
+        editorOverviewSaved(E.core);
+        editorDiffSetBase(E.core);
+        editorSetStatusMessage("Not written to disk, running headless");
+        return;
+    }
+
+    long long len = editorWriteFile(E.core);
+    if (len != -1) {
+        editorSetStatusMessage("%lld bytes written to disk", len);    // Notify user on sucessful save
+        editorWatchFile();
+        editorAutosaveStop(1);
+    }
+    else
+        editorSetStatusMessage("Can't save! I/O error: %s", strerror(errno));
+}
+
+
+void editorFindCallback(char *query, int key) {
+    static int lastMatch = -1;  // -1 when there is no last match
+    static int direction = 1;   // 1 Seach forward, -1 seach backward
+
+    // Clear the previous match overlay, row highlighting is never modified by a search
+    E.matchRow = -1;
+
+    // Exit and reset lastMatch & dir for next search
+    if (key == '\r' || key == '\x1b') {
+        lastMatch = -1;
+        direction = 1;
+        // The matches of a search that's given up on aren't counted any more
+        if (key == '\x1b')
+            editorSearchIndexFree(&E.search);
+        return;
+    } else if (key == ARROW_RIGHT || key == ARROW_DOWN) {   // Jump to next match found
+        direction = 1;
+    } else if (key == ARROW_LEFT || key == ARROW_UP) {      // Jump to prev match
+        direction = -1;
+    } else {
+        lastMatch = -1;
+        direction = 1;
+        // Count the new query's matches in the background
+        editorSearchIndexStart(E.core, &E.search, query);
+    }
+    
+    if (lastMatch == -1)
+        direction = 1;
+
+    int ro = 0;
+    int current;
+    // Once the query's matches are indexed, step through them instead of searching row by row
+    if (editorSearchIndexDone(E.core, &E.search) && !strcmp(E.search.query, query)) {
+        current = editorSearchIndexFind(&E.search, lastMatch, direction);
+        if (current != -1)
+            ro = strstr(editorRowAt(E.core, current)->render, query) - editorRowAt(E.core, current)->render;
+    } else {
+        current = editorFindNext(E.core, query, lastMatch, direction, &ro);
+    }
+
+    // String is found in file
+    if (current != -1) {
+        lastMatch = current;
+        E.core->cy = current; // Jump cursor to next match row
+        // Move cursor to the substring on the row
+        E.core->cx = editorRowRoToCx(editorRowAt(E.core, current), ro);
+        E.rowOff = E.core->numrows;   // Update row offset
+
+        // Overlay the match on top of the row's highlighting when drawing
+        E.matchRow = current;
+        E.matchStart = ro;
+        E.matchLen = strlen(query);
+    }
+}
+
+
+void editorFind() {
+    // Save cursor location prior to search
+    int save_cx = E.core->cx;
+    int saved_cy = E.core->cy;
+    int saved_colOff = E.colOff;
+    int saved_rowOff = E.rowOff;
+
+    // Query user for string to search for, returns NULL on ESC key press
+    char *query = editorPrompt("Search: %s (Use Arrow keys goto next match, and ESC to exit find mode)", editorFindCallback);
+
+    // Kept for adding a cursor at every match
+    if (query) {
+        free(E.lastQuery);
+        E.lastQuery = query;
+    } else {    // Restore cursor to previous position
+        E.core->cx = save_cx;
+        E.core->cy = saved_cy;
+        E.colOff = saved_colOff;
+        E.rowOff = saved_rowOff;
+    }
+}
+
+
+/*--------------------------------------------------------------------------
+                              INSTRUMENTATION
+--------------------------------------------------------------------------*/
+
+int statsBucket(long value) {
+    if (value < STATS_SUB_BUCKETS * 2)
+        return value < 0 ? 0 : value;
+
+    // Find the power of two, then split it linearly into sub buckets
+    int msb = 0;
+    while ((value >> msb) > 1)
+        msb++;
+    int sub = (value >> (msb - STATS_SUB_BITS)) & (STATS_SUB_BUCKETS - 1);
+    int bucket = STATS_SUB_BUCKETS * (msb - STATS_SUB_BITS + 1) + sub;
+    return bucket < STATS_BUCKETS ? bucket : STATS_BUCKETS - 1;
+}
+
+
+long statsBucketValue(int bucket) {
+    if (bucket < STATS_SUB_BUCKETS * 2)
+        return bucket;
+
+    // Reverse of statsBucket(), returns the smallest value in the bucket
+    int msb = bucket / STATS_SUB_BUCKETS + STATS_SUB_BITS - 1;
+    long sub = bucket % STATS_SUB_BUCKETS;
+    return (1L << msb) | (sub << (msb - STATS_SUB_BITS));
+}
+
+
+void statsRecord(struct statsHist *h, long value) {
+    h->buckets[statsBucket(value)]++;
+    h->count++;
+    h->sum += value;
+    if (value > h->max)
+        h->max = value;
+}
+
+
+long statsPercentile(struct statsHist *h, int percent) {
+    if (h->count == 0)
+        return 0;
+
+    // Walk the buckets until percent of the samples have been passed
+    long target = (h->count * percent + 99) / 100;
+    long seen = 0;
+    for (int i = 0; i < STATS_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= target)
+            return statsBucketValue(i);
+    }
+    return h->max;
+}
+
+
+void statsFrame(int bytes) {
+    long now = texNow();
+
+    // Only the first frame drawn after a keypress counts towards its latency
+    if (E.stats.keyTime) {
+        statsRecord(&E.stats.latency, now - E.stats.keyTime);
+        E.stats.keyTime = 0;
+    }
+    // Take the buffer's highlighting time and allocations along with the frontend's own
+    E.stats.hlTime += E.core->hlTime;
+    E.stats.allocs += E.core->allocs;
+    E.core->hlTime = 0;
+    E.core->allocs = 0;
+
+    statsRecord(&E.stats.bytes, bytes);
+    statsRecord(&E.stats.highlight, E.stats.hlTime);
+    statsRecord(&E.stats.allocations, E.stats.allocs);
+
+    E.stats.frameBytes = bytes;
+    E.stats.frameHlTime = E.stats.hlTime;
+    E.stats.frameAllocs = E.stats.allocs;
+    E.stats.hlTime = 0;
+    E.stats.allocs = 0;
+}
+
+
+void statsSummary(FILE *fp, const char *name, struct statsHist *h) {
+    fprintf(fp, "%s: count %ld mean %ld p50 %ld p90 %ld p99 %ld max %ld\n", name, h->count,
+        h->count ? h->sum / h->count : 0, statsPercentile(h, 50), statsPercentile(h, 90),
+        statsPercentile(h, 99), h->max);
+}
+
+
+void statsDumpHist(FILE *fp, const char *name, struct statsHist *h) {
+    statsSummary(fp, name, h);
+
+    // One line per non empty bucket, starting from its smallest value
+    for (int i = 0; i < STATS_BUCKETS; i++) {
+        if (h->buckets[i])
+            fprintf(fp, "  %ld %ld\n", statsBucketValue(i), h->buckets[i]);
+    }
+}
+
+
+void statsDump() {
+    char *path = getenv("TEX_STATS");
+    if (path == NULL)
+        return;
+
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+        return;
+
+    statsDumpHist(fp, "key to frame latency (us)", &E.stats.latency);
+    statsDumpHist(fp, "bytes per frame", &E.stats.bytes);
+    statsDumpHist(fp, "highlighting per frame (us)", &E.stats.highlight);
+    statsDumpHist(fp, "allocations per frame", &E.stats.allocations);
+    statsDumpHist(fp, "key handling (us)", &E.stats.process);
+    statsDumpHist(fp, "scroll (us)", &E.stats.scroll);
+    statsDumpHist(fp, "draw (us)", &E.stats.draw);
+    statsDumpHist(fp, "write (us)", &E.stats.write);
+    fclose(fp);
+}
+
+
+void *editorMalloc(size_t size) {
+    E.stats.allocs++;
+    return malloc(size);
+}
+
+
+void *editorRealloc(void *ptr, size_t size) {
+    E.stats.allocs++;
+    return realloc(ptr, size);
+}
+
+
+void editorToggleStats() {
+    E.stats.show = !E.stats.show;
+    editorSetStatusMessage("");
+}
+
+
+/*--------------------------------------------------------------------------
+                               APPEND BUFFER
+--------------------------------------------------------------------------*/
+
+void abAppend(struct aBuf *ab, const char *s, int len) {
+    char *new = editorRealloc(ab->b, ab->len + len);  // Realloc for new string length
+
+    if (new == NULL)
+        return;
+    
+    // Assign struct fields
+    memcpy(&new[ab->len], s, len);  // Copy string s after end of current buffer
+    ab->b = new;    // Update pointer
+    ab->len += len; // Update length
+}
+
+void abFree(struct aBuf *ab) {
+    free(ab->b);    // Free char pointer
+}
+
+
+/*--------------------------------------------------------------------------
+                                   OUTPUT
+--------------------------------------------------------------------------*/
+
+void editorScroll() {
+    // A jump to a folded row shows it
+    editorFoldReveal(E.core, E.core->cy);
+
+    E.rx = 0;
+    // Set rx
+    if (E.core->cy < E.core->numrows) {
+        E.rx = editorRowCxToRx(editorRowAt(E.core, E.core->cy), E.core->cx);
+    }
+
+    // Scroll by visual lines when soft wrapping, there's nothing to scroll horizontally
+    if (E.softWrap) {
+        int sub;
+        int cv = editorLayoutVisualLine(E.core, E.core->cy) + editorLayoutCursorSub();
+        if (cv < E.wrapOff)
+            E.wrapOff = cv;
+        if (cv >= E.wrapOff + E.screenRows)
+            E.wrapOff = cv - E.screenRows + 1;
+
+        E.rowOff = editorLayoutRowAtVisual(E.core, E.wrapOff, &sub);
+        E.colOff = 0;
+        return;
+    }
+
+    // Top of the window is never inside a fold
+    if (E.core->numFolds && E.rowOff < E.core->numrows)
+        E.rowOff -= editorRowAt(E.core, E.rowOff)->foldUp;
+
+    // Cursor is above visible window
+    if (E.core->cy < E.rowOff) {
+        E.rowOff = E.core->cy;    // Scroll to where cursor is
+    }
+
+    // Cursor is past bottom of visible window, counting a fold as the one row it's drawn as
+    if (editorFoldCount(E.core, E.rowOff, E.core->cy, E.screenRows) >= E.screenRows) {
+        E.rowOff = editorFoldStep(E.core, E.core->cy, -(E.screenRows - 1)); // Scroll just past bottom of screen, but not past EOF
+    }
+
+    // Cursor is left of visible window
+    if (E.rx < E.colOff) {
+        E.colOff = E.rx;
+    }
+
+    // Cursor is right of visible window
+    if (E.rx >= E.colOff + E.screenCols) {
+        E.colOff = E.rx - E.screenCols + 1;
+    }
+}
+
+
+void editorDrawSpan(struct aBuf *ab, const char *c, int len, int hl, int *current_hl, int inverted) {
+    // Emit one style escape for the whole span, straight from the theme
+    if (hl != *current_hl) {
+        abAppend(ab, E.theme[hl].seq, E.theme[hl].len);
+        *current_hl = hl;
+    }
+
+    // Copy runs of printable chars in bulk, only breaking the copy for control chars
+    int run = 0;
+    for (int j = 0; j < len; j++) {
+        if (!iscntrl((unsigned char) c[j]))
+            continue;
+
+        abAppend(ab, &c[run], j - run);
+        run = j + 1;
+
+        // Make ctrl letters Capital and nonAlpha ?
+        // Drawn the other way round to the span, only flipping inverse so its colours stay set
+        char sym = (c[j] <= 26) ? '@' + c[j] : '?';
+        abAppend(ab, inverted ? "\x1b[27m" : "\x1b[7m", inverted ? 5 : 4);
+        abAppend(ab, &sym, 1);
+        abAppend(ab, inverted ? "\x1b[7m" : "\x1b[27m", inverted ? 4 : 5);
+    }
+    abAppend(ab, &c[run], len - run);
+}
+
+
+void editorDrawRow(struct aBuf *ab, erow *row, int colOff, int cols) {
+    int len = editorRowCxToRx(row, row->size) - colOff;
+    int eolVisible = (len >= 0 && len < cols);
+    // Set len to 0 incase its negative
+    if (len < 0)
+        len = 0;
+    if (len > cols)
+        len = cols;
+
+    // Convert the visible columns into render indices, a wide char cut by the right edge isn't drawn
+    int start = editorRowRxToRo(row, colOff);
+    int end = editorRowRxToRo(row, colOff + len);
+
+    // Pad the visible half of a wide char cut by the left edge
+    int col = colOff;
+    while (start < end && editorRowMapIndex(row, IDX_RENDER, IDX_COLUMN, start) < colOff) {
+        abAppend(ab, " ", 1);
+        start = editorRowRxToRo(row, ++col);
+    }
+
+    // Rows start out in the normal style, set after the gutter when the theme changes it
+    int current_hl = HL_NORMAL;
+
+    // Only draw the match overlay on the row it was found in
+    int mStart = end, mEnd = end;
+    if (row->idx == E.matchRow) {
+        mStart = E.matchStart;
+        mEnd = E.matchStart + E.matchLen;
+    }
+
+    // The matched brackets, which can both be on the one row
+    int b0 = row->idx == E.bracketRow[0] ? E.bracketRo[0] : end;
+    int b1 = row->idx == E.bracketRow[1] ? E.bracketRo[1] : end;
+
+    // Binary search for the first span that ends past the left edge of the window
+    int lo = 0, hi = row->numSpans;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (row->spans[mid].start + row->spans[mid].len <= start)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    int s = lo;
+
+    // Selected part of the row
+    int sStart = end, sEnd = end;
+    if (!editorSelectionOnRow(E.core, row, &sStart, &sEnd))
+        sStart = sEnd = end;
+
+    // Extra cursors are drawn inverted, the terminal only shows the primary one
+    int k = editorFirstCursorOnRow(E.core, row->idx);
+    int cStart = end, cEnd = end;
+    while (k < E.core->numCursors && E.core->cursors[k].cy == row->idx) {
+        int cx = E.core->cursors[k].cx;
+        cStart = editorRowMapIndex(row, IDX_CHARS, IDX_RENDER, cx);
+        cEnd = cx < row->size ? editorRowMapIndex(row, IDX_CHARS, IDX_RENDER, editorRowNextCx(row, cx)) : cStart;
+        if (cEnd > start || cx == row->size)
+            break;
+        k++;
+    }
+
+    // Draw the visible part of the row one run of equally coloured chars at a time
+    int pos = start;
+    while (pos < end) {
+        int next = end;
+        int hl = HL_NORMAL;
+
+        if (s < row->numSpans && row->spans[s].start <= pos) {
+            hl = row->spans[s].hl;
+            next = row->spans[s].start + row->spans[s].len;
+        } else if (s < row->numSpans && row->spans[s].start < next) {
+            next = row->spans[s].start;
+        }
+
+        // Search match takes priority over any span it overlaps
+        if (pos >= mStart && pos < mEnd) {
+            hl = HL_MATCH;
+            next = mEnd;
+        } else if (mStart > pos && mStart < next) {
+            next = mStart;
+        }
+
+        // And a matched bracket over both
+        if (pos == b0 || pos == b1) {
+            hl = HL_BRACKET;
+            next = pos + 1;
+        } else {
+            if (b0 > pos && b0 < next)
+                next = b0;
+            if (b1 > pos && b1 < next)
+                next = b1;
+        }
+
+        // Extra cursors and the selection are inverted, breaking the run wherever they start or stop
+        int inverted = (pos >= cStart && pos < cEnd) || (pos >= sStart && pos < sEnd);
+        int bounds[4] = { cStart, cEnd, sStart, sEnd };
+        for (int b = 0; b < 4; b++) {
+            if (bounds[b] > pos && bounds[b] < next)
+                next = bounds[b];
+        }
+
+        if (next > end)
+            next = end;
+
+        if (inverted)
+            abAppend(ab, "\x1b[7m", 4);
+        editorDrawSpan(ab, &row->render[pos], next - pos, hl, &current_hl, inverted);
+        if (inverted)
+            abAppend(ab, "\x1b[27m", 5);
+
+        pos = next;
+        // Move on to the next cursor on the row once this one is drawn
+        while (pos >= cEnd && cStart < cEnd) {
+            k++;
+            if (k == E.core->numCursors || E.core->cursors[k].cy != row->idx) {
+                cStart = cEnd = end;
+                break;
+            }
+            int cx = E.core->cursors[k].cx;
+            cStart = editorRowMapIndex(row, IDX_CHARS, IDX_RENDER, cx);
+            cEnd = cx < row->size ? editorRowMapIndex(row, IDX_CHARS, IDX_RENDER, editorRowNextCx(row, cx)) : cStart;
+        }
+        // Move past every span that has been fully drawn
+        while (s < row->numSpans && row->spans[s].start + row->spans[s].len <= pos)
+            s++;
+    }
+    // A cursor at the end of the row sits on the blank after it
+    if (eolVisible && cStart == cEnd && cStart == row->rSize && k < E.core->numCursors && E.core->cursors[k].cy == row->idx)
+        abAppend(ab, "\x1b[7m \x1b[27m", 9);
+    if (current_hl != HL_NORMAL)
+        abAppend(ab, E.theme[HL_NORMAL].seq, E.theme[HL_NORMAL].len);
+}
+
+
+void editorDrawFoldMarker(struct aBuf *ab, erow *row, int colOff, int cols) {
+    int len = editorRowCxToRx(row, row->size) - colOff;
+    if (len < 0)
+        len = 0;
+
+    // Built by hand, a screen of folded rows shouldn't each go through printf
+    char marker[32];
+    memcpy(marker, " ... ", 5);
+    int mLen = 5 + editorFormatDigits(&marker[5], row->foldLines);
+    memcpy(&marker[mLen], " lines", 6);
+    mLen += row->foldLines == 1 ? 5 : 6;
+    if (len + mLen > cols)
+        return;
+    abAppend(ab, E.theme[HL_COMMENT].seq, E.theme[HL_COMMENT].len);
+    abAppend(ab, marker, mLen);
+    abAppend(ab, E.theme[HL_NORMAL].seq, E.theme[HL_NORMAL].len);
+}
+
+
+void editorDrawOverview(struct aBuf *ab, int y, int first, int last) {
+    texCore *tc = E.core;
+
+    // A short file gets a line for each row, a long one spreads its rows evenly over the lines
+    int from = y, to = y + 1;
+    if (tc->numrows > E.screenRows) {
+        from = (long long) tc->numrows * y / E.screenRows;
+        to = (long long) tc->numrows * (y + 1) / E.screenRows;
+    }
+    if (from >= tc->numrows)
+        return;
+
+    texOverviewNode sum;
+    editorOverviewSum(tc, from, to, &sum);
+    char c;
+    int cls = -1;
+    if (E.search.query && editorSearchIndexCount(&E.search, from, to)) {
+        c = '=';
+        cls = HL_MATCH;
+    } else if (sum.edited) {
+        c = '+';
+        cls = THEME_ADDED;
+    } else {
+        // Shaded by how wide the rows are on average, in the comment colour when they're mostly comments
+        int width = sum.text / (to - from);
+        c = width == 0 ? ' ' : width < 16 ? '.' : width < 40 ? ':' : '|';
+        if (sum.comment * 2 > sum.text)
+            cls = HL_COMMENT;
+    }
+
+    char buf[32];
+    int len = editorFormatEscape(buf, E.panes[E.pane].left + E.gutter + E.screenCols + 1, -1, 'G');
+    abAppend(ab, buf, len);
+    if (from < last && to > first)
+        abAppend(ab, "\x1b[7m", 4);
+    if (cls != -1)
+        abAppend(ab, E.theme[cls].seq, E.theme[cls].len);
+    abAppend(ab, &c, 1);
+    abAppend(ab, "\x1b[m", 3);
+}
+
+
+void editorFormatNumber(char *buf, int width, unsigned int n) {
+    char *p = buf + width;
+    while (n >= 10 && p - buf >= 2) {
+        p -= 2;
+        memcpy(p, &E.digitPairs[(n % 100) * 2], 2);
+        n /= 100;
+    }
+    // The last odd digit, or a lone 0
+    if (p > buf && (n > 0 || p == buf + width))
+        *--p = '0' + n % 10;
+    memset(buf, ' ', p - buf);
+}
+
+
+int editorFormatDigits(char *buf, unsigned int n) {
+    int digits = 1;
+    for (unsigned int left = n; left >= 10; left /= 10)
+        digits++;
+    editorFormatNumber(buf, digits, n);
+    return digits;
+}
+
+
+int editorFormatEscape(char *buf, unsigned int n, int m, char final) {
+    memcpy(buf, "\x1b[", 2);
+    int len = 2 + editorFormatDigits(&buf[2], n);
+    if (m >= 0) {
+        buf[len++] = ';';
+        len += editorFormatDigits(&buf[len], m);
+    }
+    buf[len++] = final;
+    return len;
+}
+
+
+unsigned int editorGutterNumber(int fileRow) {
+    // Relative numbers count the rows to the cursor's, which is numbered itself
+    if (E.lineNumbers == LINES_RELATIVE && fileRow != E.core->cy)
+        return fileRow > E.core->cy ? fileRow - E.core->cy : E.core->cy - fileRow;
+    return fileRow + 1;
+}
+
+
+void editorDrawGutter(struct aBuf *ab, int fileRow, int sub) {
+    if (E.numberWidth) {
+        char buf[16];
+        int width = E.numberWidth < (int) sizeof(buf) ? E.numberWidth : (int) sizeof(buf);
+        int numbered = (sub == 0 && fileRow < E.core->numrows);
+        if (!numbered) {
+            memset(buf, ' ', width);
+            abAppend(ab, buf, width);
+        } else {
+            int current = (fileRow == E.core->cy);
+            editorFormatNumber(buf, width - 1, editorGutterNumber(fileRow));
+            buf[width - 1] = ' ';
+            // The cursor's row stands out in the normal style
+            int cls = current ? HL_NORMAL : THEME_LINE_NUMBER;
+            abAppend(ab, E.theme[cls].seq, E.theme[cls].len);
+            abAppend(ab, buf, width);
+            abAppend(ab, "\x1b[m", 3);
+        }
+    }
+    if (!E.diff)
+        return;
+
+    char c = ' ';
+    int cls = -1;
+    if (sub == 0 && fileRow < E.core->numrows) {
+        switch (editorDiffAt(E.core, fileRow)) {
+            case DIFF_ADDED:
+                c = '+';
+                cls = THEME_ADDED;
+                break;
+            case DIFF_CHANGED:
+                c = '~';
+                cls = THEME_CHANGED;
+                break;
+            case DIFF_DELETED:
+                c = '-';
+                cls = THEME_DELETED;
+                break;
+        }
+    }
+    if (cls == -1) {
+        abAppend(ab, &c, 1);
+        return;
+    }
+    abAppend(ab, E.theme[cls].seq, E.theme[cls].len);
+    abAppend(ab, &c, 1);
+    abAppend(ab, "\x1b[m", 3);
+}
+
+
+void editorDrawRows(struct aBuf *ab, struct editorPane *p, struct editorPaneLine *lines) {
+    texCore *tc = E.core;
+    int y;  // Terminal height
+    int fileRow = E.rowOff;
+    int sub = 0;    // Visual line within fileRow when soft wrapping
+
+    if (E.softWrap)
+        fileRow = editorLayoutRowAtVisual(tc, E.wrapOff, &sub);
+
+    // Rows in the window, which the overview ruler marks
+    int first = fileRow;
+    int last = editorFoldStep(tc, E.rowOff, E.screenRows);
+    if (E.softWrap) {
+        int lastSub;
+        last = editorLayoutRowAtVisual(tc, E.wrapOff + E.screenRows - 1, &lastSub) + 1;
+    }
+
+    // A lone pane draws down the screen as it always has, panes are drawn a line at a time where they are
+    int alone = (E.numPanes == 1);
+    // Clearing to the end of the line would clear the pane to the right too
+    int edge = (p->left + p->cols >= E.areaCols);
+    int highlighted = (lines == NULL || tc->large == NULL);
+    char buf[32];
+
     // Draw rows of ~ for entire terminal window
     for(y = 0; y < E.screenRows; y++) {
-        int fileRow = y + E.rowOff;
-        if (fileRow >= E.numrows) {
-            if (E.numrows == 0 && y == E.screenRows / 3) {
+        // An unfocused pane only needs the row to step over folds and wrapped lines, or to draw it
+        erow *row = NULL;
+        if (fileRow < tc->numrows && (lines == NULL || E.softWrap || tc->numFolds))
+            row = editorRowAt(tc, fileRow);
+
+        if (lines) {
+            struct editorPaneLine line;
+            memset(&line, 0, sizeof(line));
+            line.row = fileRow < tc->numrows ? fileRow : (tc->numrows == 0 && y == E.screenRows / 3) ? -2 : -1;
+            line.sub = sub;
+            if (line.row >= 0 && sub == 0) {
+                line.number = E.numberWidth ? editorGutterNumber(fileRow) : 0;
+                line.current = (fileRow == tc->cy);
+                line.diff = E.diff ? editorDiffAt(tc, fileRow) : DIFF_NONE;
+            }
+            line.foldLines = row ? row->foldLines : 0;
+            int same = !memcmp(&line, &lines[y], sizeof(line));
+            lines[y] = line;
+            if (same) {
+                if (row && E.softWrap && sub + 1 < row->wrapLines)
+                    sub++;
+                else if (fileRow < tc->numrows) {
+                    fileRow += 1 + (row ? row->foldLines : 0);
+                    sub = 0;
+                }
+                continue;
+            }
+            if (!highlighted) {
+                editorHighlightRows(tc, E.rowOff, editorFoldStep(tc, E.rowOff, E.screenRows - 1));
+                highlighted = 1;
+            }
+            if (fileRow < tc->numrows)
+                row = editorRowAt(tc, fileRow);
+        }
+
+        if (!alone) {
+            int len = editorFormatEscape(buf, p->top + y + 1, p->left + 1, 'H');
+            abAppend(ab, buf, len);
+        }
+        if (!edge) {
+            if (!E.themePlain)
+                abAppend(ab, E.theme[HL_NORMAL].seq, E.theme[HL_NORMAL].len);
+            int len = editorFormatEscape(buf, p->cols, -1, 'X');
+            abAppend(ab, buf, len);
+        }
+        editorDrawGutter(ab, fileRow, sub);
+        if (!E.themePlain)
+            abAppend(ab, E.theme[HL_NORMAL].seq, E.theme[HL_NORMAL].len);
+        if (fileRow >= tc->numrows) {
+            if (tc->numrows == 0 && y == E.screenRows / 3) {
                 // Display welcome message
                 char welcome[80];
                 int welcomeLen = snprintf(welcome, sizeof(welcome), "\tTex Editor -- version: %s", TEX_VERSION);
@@ -881,80 +2202,152 @@ void editorDrawRows(struct aBuf *ab) {
                 abAppend(ab, "~", 1);   //Append line tildes
             }
         } else {
-            int len = E.row[fileRow].rSize - E.colOff;
-            // Set len to 0 incase its negative
-            if (len < 0)
-                len = 0;
-            if (len > E.screenCols)
-                len = E.screenCols;
-            
-            char *c = &E.row[fileRow].render[E.colOff];
-            unsigned char *highlight = &E.row[fileRow].highlight[E.colOff];
-            int current_colour = -1;
-
-            for (int j = 0; j < len; j++) {
-                // Check if input is a control character
-                if (iscntrl(c[j])) {
-                    // Make ctrl letters Capital and nonAlpha ?
-                    char sym = (c[j] <= 26) ? '@' + c[j] : '?';
-                    abAppend(ab, "\x1b[7m", 4);
-                    abAppend(ab, &sym, 1);
-                    abAppend(ab, "\x1b[m", 3);
-                    if (current_colour != -1) {
-                        char buf[16];
-                        int clen = snprintf(buf, sizeof(buf), "\x1b[%dm", current_colour);
-                        abAppend(ab, buf, clen);
-                    }
-                }
-                // Print normal characters without highlighting
-                else if (highlight[j] == HL_NORMAL) {
-                    if (current_colour != -1) {
-                        abAppend(ab, "\x1b[39m", 5);
-                        current_colour = -1;
-                    }
-                    abAppend(ab, &c[j], 1);
-                } else {
-                    int colour = editorSyntaxToColour(highlight[j]);
-
-                    if (colour != current_colour) {
-                        current_colour = colour;
-                        char buf[16];
-                        int clen = snprintf(buf, sizeof(buf), "\x1b[%dm", colour);
-                        abAppend(ab, buf, clen);
-                    }
-                    abAppend(ab, &c[j], 1);
+            if (E.softWrap) {
+                // Draw one screen width of the row, moving to the next row after its last visual line
+                editorDrawRow(ab, row, sub * E.screenCols, E.screenCols);
+                if (++sub >= row->wrapLines) {
+                    if (row->foldLines)
+                        editorDrawFoldMarker(ab, row, (sub - 1) * E.screenCols, E.screenCols);
+                    fileRow += 1 + row->foldLines;
+                    sub = 0;
                 }
+            } else {
+                editorDrawRow(ab, row, E.colOff, E.screenCols);
+                if (row->foldLines)
+                    editorDrawFoldMarker(ab, row, E.colOff, E.screenCols);
+                // A fold is skipped over in one step, however many rows it hides
+                fileRow += 1 + row->foldLines;
             }
-            abAppend(ab, "\x1b[39m", 5);
         }
 
-        abAppend(ab, "\x1b[K", 3);  // Escaape K sequence at end of each line
+        if (edge)
+            abAppend(ab, "\x1b[K", 3);  // Escaape K sequence at end of each line
+        // The normal style's background fills the rest of the line, then stops short of the ruler
+        if (!E.themePlain)
+            abAppend(ab, "\x1b[m", 3);
+        if (lines == NULL && E.overview)
+            editorDrawOverview(ab, y, first, last);
         // Make the last line an exception for the carriage return and newline
         
-        abAppend(ab, "\r\n", 2);
+        if (alone)
+            abAppend(ab, "\r\n", 2);
         
     }
 }
 
 
+void editorDrawPane(struct aBuf *ab, struct editorPane *p) {
+    // Squeezed out of a tiny terminal
+    if (p->rows < 1)
+        return;
+    struct editorView focused;
+    editorPaneEnter(p, &focused);
+
+    struct editorPaneLook look;
+    memset(&look, 0, sizeof(look));
+    look.core = E.core;
+    look.top = p->top;
+    look.left = p->left;
+    look.rows = p->rows;
+    look.cols = p->cols;
+    look.screenCols = E.screenCols;
+    look.colOff = E.colOff;
+    look.softWrap = E.softWrap;
+    look.gutter = E.gutter;
+    look.numberWidth = E.numberWidth;
+    look.lineNumbers = E.lineNumbers;
+    look.diff = E.diff;
+    if (memcmp(&look, &p->look, sizeof(look))) {
+        p->lines = editorRealloc(p->lines, sizeof(struct editorPaneLine) * p->rows);
+        memset(p->lines, 0, sizeof(struct editorPaneLine) * p->rows);
+        for (int y = 0; y < p->rows; y++)
+            p->lines[y].row = -3;
+        p->look = look;
+    }
+
+    editorDrawRows(ab, p, p->lines);
+    editorPaneLeave(p, &focused);
+}
+
+
+void editorDrawDividers(struct aBuf *ab) {
+    char buf[32];
+    // A column between the halves of a split side by side, which neither pane draws over
+    for (int i = 0; E.dividers && i < 2 * TEX_MAX_PANES; i++) {
+        struct editorSplit *s = &E.splits[i];
+        if (!s->used || s->pane != -1 || !s->vertical)
+            continue;
+        int col = s->left + (s->cols - 1) / 2;
+        for (int y = 0; y < s->rows; y++) {
+            int len = editorFormatEscape(buf, s->top + y + 1, col + 1, 'H');
+            abAppend(ab, buf, len);
+            abAppend(ab, "\x1b[7m \x1b[m", 8);
+        }
+    }
+
+    // And the bar under each pane above another, like the status bar but with less in it
+    for (int i = 0; i < E.numPanes; i++) {
+        struct editorPane *p = &E.panes[i];
+        if (!p->bar)
+            continue;
+        char text[sizeof(p->barText)];
+        int len = snprintf(text, sizeof(text), "%.20s - %d/%d",
+            E.core->filename ? E.core->filename : "[No Name]",
+            (i == E.pane ? E.core->cy : p->view.cy) + 1, E.core->numrows);
+        if (len >= (int) sizeof(text))
+            len = sizeof(text) - 1;
+        if (len > p->cols)
+            len = p->cols;
+        if (!E.dividers && len == p->barLen && !memcmp(text, p->barText, len))
+            continue;
+        memcpy(p->barText, text, len);
+        p->barLen = len;
+
+        int n = snprintf(buf, sizeof(buf), "\x1b[%d;%dH\x1b[7m", p->top + p->rows + 1, p->left + 1);
+        abAppend(ab, buf, n);
+        abAppend(ab, text, len);
+        for (; len < p->cols; len++)
+            abAppend(ab, " ", 1);
+        abAppend(ab, "\x1b[m", 3);
+    }
+    E.dividers = 0;
+}
+
+
 void editorDrawStatusBar(struct aBuf *ab) {
     abAppend(ab, "\x1b[7m", 4);     // Invert status bar colours [7m
     char status[80], rStatus[80];
     // Cut string short if it doesn't fit, display [No Name] if there's no filename
     int len = snprintf(status, sizeof(status), "%.20s - %d lines %s",
-        E.filename ? E.filename: "[No Name]", E.numrows,
-        E.dirty ? "(modified)" : "");   // Alert user when file is modified since last save
+        E.core->filename ? E.core->filename: "[No Name]", E.core->numrows,
+        E.core->dirty ? "(modified)" : "");   // Alert user when file is modified since last save
+
+    // Lines are still being counted in a paged file
+    int indexed = E.core->large ? largeProgress(E.core) : 100;
+    if (indexed < 100)
+        len += snprintf(&status[len], sizeof(status) - len, "(indexing %d%%)", indexed);
+    // Or the rest of a file is still being read in
+    if (E.core->load)
+        len += snprintf(&status[len], sizeof(status) - len, "(loading %d%%)", editorLoadProgress(E.core));
+    // Every cursor is typed at, so keep it clear there's more than one
+    if (E.core->numCursors)
+        len += snprintf(&status[len], sizeof(status) - len, "(%d cursors)", E.core->numCursors + 1);
+    // Matches of the search, once they've all been counted
+    if (editorSearchIndexDone(E.core, &E.search))
+        len += snprintf(&status[len], sizeof(status) - len, "(%d matches)", E.search.matches);
     
     int rLen = snprintf(rStatus, sizeof(rStatus), "%s | %d/%d",
-        E.syntax ? E.syntax->filetype : "no ft", E.cy + 1, E.numrows);
+        E.core->syntax ? E.core->syntax->filetype : "no ft", E.core->cy + 1, E.core->numrows);
 
-    if (len > E.screenCols)
-        len = E.screenCols;
+    // Across every pane, with the gutter and the overview ruler's column too
+    int cols = E.areaCols;
+    if (len > cols)
+        len = cols;
     abAppend(ab, status, len);
     
-    while (len < E.screenCols) {
+    while (len < cols) {
         // Display current line number on right edge
-        if (E.screenCols - len == rLen) {
+        if (cols - len == rLen) {
             abAppend(ab, rStatus, rLen);
             break;
         } else {
@@ -973,14 +2366,29 @@ void editorSetStatusMessage(const char *fmt, ...) {
     vsnprintf(E.statusmsg, sizeof(E.statusmsg), fmt, ap);
     va_end(ap);
     E.statusmsgTime = time(NULL);
+    // Wake to clear it once it's old, the poll would sleep through that otherwise
+    editorTimerStart(TIMER_STATUS, TEX_STATUS_US, 0, NULL);
 }
 
 
 void editorDrawMessageBar(struct aBuf *ab) {
     abAppend(ab, "\x1b[K", 3);  // Clear the message bar
+
+    // Stats overlay replaces the status message while it's on, prompts are still shown
+    if (E.stats.show && (E.statusmsg[0] == '\0' || time(NULL) - E.statusmsgTime >= 5)) {
+        char stats[128];
+        int len = snprintf(stats, sizeof(stats),
+            "key->frame p50 %ldus p99 %ldus | %ldB/frame | hl %ldus | %ld allocs",
+            statsPercentile(&E.stats.latency, 50), statsPercentile(&E.stats.latency, 99),
+            E.stats.frameBytes, E.stats.frameHlTime, E.stats.frameAllocs);
+        if (len > E.areaCols)
+            len = E.areaCols;
+        abAppend(ab, stats, len);
+        return;
+    }
     int msglen = strlen(E.statusmsg);
-    if (msglen > E.screenCols)
-        msglen = E.screenCols;
+    if (msglen > E.areaCols)
+        msglen = E.areaCols;
     // Display msg to bar if its less than 5 secs old
     if (msglen && time(NULL) - E.statusmsgTime < 5)
         abAppend(ab, E.statusmsg, msglen);
@@ -988,24 +2396,67 @@ void editorDrawMessageBar(struct aBuf *ab) {
 
 
 void editorRefreshScreen() {
+    long start = texNow();
+    // Time spent handling the key since it was read
+    if (E.stats.keyTime)
+        statsRecord(&E.stats.process, start - E.stats.keyTime);
+
+    editorLargeSync();
+    editorGutterResize();   // Rows added or deleted may need another digit
     editorScroll();
+    long scrolled = texNow();
+
+    // Other panes follow the edits before the rows they show are highlighted, then any rows that changed
+    editorPanesCatchUp();
+    editorPanesHighlight();
+    editorMatchBrackets();
+    if (E.diff)
+        editorDiffUpdate(E.core);
+    editorPanesCatchUp();
 
     struct aBuf ab = ABUF_INIT;
 
     abAppend(&ab, "\x1b[?25l", 6);  // Show Mouse Cursor
     abAppend(&ab, "\x1b[H", 3);  // Reposition cursor to top left
 
-    editorDrawRows(&ab);        // Draw Rows
+    // The focused pane is drawn whole, the others only where they've changed
+    struct editorPane *p = &E.panes[E.pane];
+    editorDrawRows(&ab, p, NULL);        // Draw Rows
+    for (int i = 0; i < E.numPanes; i++) {
+        if (i != E.pane)
+            editorDrawPane(&ab, &E.panes[i]);
+    }
+    editorDrawDividers(&ab);
+
+    char buf[32];
+    if (E.numPanes > 1) {
+        int len = snprintf(buf, sizeof(buf), "\x1b[%d;1H", E.areaRows + 1);
+        abAppend(&ab, buf, len);
+    }
     editorDrawStatusBar(&ab);   // Draw Status bar
     editorDrawMessageBar(&ab);  // Update status bar message
 
-    char buf[32];
-    snprintf(buf, sizeof(buf), "\x1b[%d;%dH", (E.cy - E.rowOff) + 1, (E.rx - E.colOff) + 1);  // Add 1 to convert from 0 based C to 1 based terminal
+    // Cursor position on screen
+    int y = editorFoldCount(E.core, E.rowOff, E.core->cy, E.screenRows);
+    int x = E.rx - E.colOff;
+    if (E.softWrap) {
+        int sub = editorLayoutCursorSub();
+        y = editorLayoutVisualLine(E.core, E.core->cy) + sub - E.wrapOff;
+        x = E.rx - sub * E.screenCols;
+    }
+
+    snprintf(buf, sizeof(buf), "\x1b[%d;%dH", p->top + y + 1, p->left + E.gutter + x + 1);  // Add 1 to convert from 0 based C to 1 based terminal
     abAppend(&ab, buf, strlen(buf));
 
     abAppend(&ab, "\x1b[?25h", 6);  // Hide Mouse Cursor
 
-    write(STDOUT_FILENO, ab.b, ab.len);
+    long drawn = texNow();
+    write(E.outFd, ab.b, ab.len);
+
+    statsRecord(&E.stats.scroll, scrolled - start);
+    statsRecord(&E.stats.draw, drawn - scrolled);
+    statsRecord(&E.stats.write, texNow() - drawn);
+    statsFrame(ab.len);
     abFree(&ab);
 }
 
@@ -1016,7 +2467,7 @@ void editorRefreshScreen() {
 
 char *editorPrompt(char *prompt, void (*callback)(char *, int)) {
     size_t bufsize = 128;
-    char *buf = malloc(bufsize);    // Stores user input
+    char *buf = editorMalloc(bufsize);    // Stores user input
 
     size_t buflen = 0;
     buf[0] = '\0';  // Initialize buf with a NULL terminator
@@ -1048,11 +2499,11 @@ char *editorPrompt(char *prompt, void (*callback)(char *, int)) {
                     callback(buf, c);
                 return buf;
             }
-        } else if(!iscntrl(c) && c < 128) {     // Ensure key isn't a special key defined in editorKey enum
+        } else if(!iscntrl(c) && c < 256) {     // Ensure key isn't a special key defined in editorKey enum
             // buflen has reached the maximum capacity
             if (buflen == bufsize - 1) {
                 bufsize *= 2;   // double the bufsize
-                buf = realloc(buf, bufsize);    // realloc to account for new size
+                buf = editorRealloc(buf, bufsize);    // realloc to account for new size
             }
             buf[buflen++] = c;  // Append char to buf
             buf[buflen] = '\0'; // Add NULL terminator
@@ -1063,126 +2514,434 @@ char *editorPrompt(char *prompt, void (*callback)(char *, int)) {
 }
 
 
-void editorMoveCursor(int key) {
-    erow *row = (E.cy >= E.numrows) ? NULL : &E.row[E.cy];
+void editorStepCursor(int key, int *cx, int *cy) {
+    erow *row = (*cy >= E.core->numrows) ? NULL : editorRowAt(E.core, *cy);
+    // Column the cursor is drawn at, kept when moving between lines
+    int rx = row ? editorRowCxToRx(row, *cx) : 0;
 
     switch (key)
     {
         case ARROW_LEFT:
-            // Move cursor left
-            if (E.cx != 0) {
-                E.cx--;
+            // Move cursor left over a whole char
+            if (*cx != 0) {
+                *cx = editorRowPrevCx(row, *cx);
             // If at start of line, go to end of prev line
-            } else if (E.cy > 0) {
-                E.cy--;
-                E.cx = E.row[E.cy].size;
+            } else if (*cy > 0) {
+                *cy = editorFoldStep(E.core, *cy, -1);
+                *cx = editorRowAt(E.core, *cy)->size;
             }
-            break;
+            return;
         case ARROW_RIGHT:
             // Check if cursor is to the left of the end of the line
-            // Move cursor right
-            if (row && E.cx < row->size) {
-                E.cx++;
+            // Move cursor right over a whole char
+            if (row && *cx < row->size) {
+                *cx = editorRowNextCx(row, *cx);
             // Move cursor to beginning of next line
-            } else if (row && E.cx == row->size) {
-                E.cy++;
-                E.cx = 0;
+            } else if (row && *cx == row->size) {
+                *cy = editorFoldStep(E.core, *cy, 1);
+                *cx = 0;
             }
-            break;
+            return;
         case ARROW_UP:
-            // Move cursor up a line
-            if (E.cy != 0) {
-                E.cy--;
-            }
+            // Move cursor up a line, over any fold above it
+            *cy = editorFoldStep(E.core, *cy, -1);
             break;
         case ARROW_DOWN:
             // Move cursor down a line
-            if (E.cy < E.numrows)
-                E.cy++;
+            *cy = editorFoldStep(E.core, *cy, 1);
             break;
     }
 
-    // Snap cursor to end of line in case it ends up past it
-    row = (E.cy >= E.numrows) ? NULL : &E.row[E.cy];
-    int rowLen = row ? row->size : 0;
-    if (E.cx > rowLen)
-        E.cx = rowLen;
+    // Keep the cursor in the same column, snapped to the start of a char and the end of the line
+    row = (*cy >= E.core->numrows) ? NULL : editorRowAt(E.core, *cy);
+    *cx = row ? editorRowRxToCx(row, rx) : 0;
+}
+
+
+void editorMoveCursor(int key) {
+    // Move cursor up or down a visual line when soft wrapping
+    if (E.softWrap && (key == ARROW_UP || key == ARROW_DOWN))
+        editorLayoutMoveVisual(key == ARROW_UP ? -1 : 1);
+    else
+        editorStepCursor(key, &E.core->cx, &E.core->cy);
+
+    // The extra cursors move a row at a time, and merge if they meet
+    for (int i = 0; i < E.core->numCursors; i++)
+        editorStepCursor(key, &E.core->cursors[i].cx, &E.core->cursors[i].cy);
+    if (E.core->numCursors)
+        editorNormalizeCursors(E.core);
+}
+
+
+void editorAddCursors() {
+    if (E.lastQuery == NULL) {
+        editorSetStatusMessage("Search with Ctrl-F first, then Ctrl-D adds a cursor at every match");
+        return;
+    }
+
+    int added = editorAddCursorsAtMatches(E.core, E.lastQuery);
+    if (added == -1)
+        editorSetStatusMessage("Paged files can't have more than one cursor");
+    else
+        editorSetStatusMessage("%d cursors, ESC to go back to one", E.core->numCursors + 1);
+}
+
+
+void editorSelectMove(int key, int mode) {
+    if (E.core->selMode != mode)
+        editorSelectStart(E.core, mode);
+    editorMoveCursor(key);
+}
+
+
+void editorOsc52(const char *s, long long len) {
+    static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    long long outLen = 7 + (len + 2) / 3 * 4 + 1;
+    char *out = malloc(outLen);
+    if (out == NULL)
+        return;
+
+    // Base64, padded out to a whole number of 4 char groups
+    memcpy(out, "\x1b]52;c;", 7);
+    char *o = &out[7];
+    for (long long i = 0; i < len; i += 3) {
+        unsigned int v = (unsigned char)s[i] << 16;
+        if (i + 1 < len)
+            v |= (unsigned char)s[i + 1] << 8;
+        if (i + 2 < len)
+            v |= (unsigned char)s[i + 2];
+        *o++ = digits[v >> 18 & 0x3f];
+        *o++ = digits[v >> 12 & 0x3f];
+        *o++ = i + 1 < len ? digits[v >> 6 & 0x3f] : '=';
+        *o++ = i + 2 < len ? digits[v & 0x3f] : '=';
+    }
+    *o = '\x07';
+
+    write(E.outFd, out, outLen);
+    free(out);
+}
+
+
+void editorCopy(int cut) {
+    if (!editorYank(E.core)) {
+        editorSetStatusMessage("Nothing selected, hold SHIFT or ALT-SHIFT and use the arrow keys");
+        return;
+    }
+
+    texYank *y = editorYankAt(E.core, 0);
+    int synced = 0;
+    if (E.osc52 && y->len <= TEX_OSC52_MAX) {
+        long long len;
+        char *text = editorYankText(E.core, y, &len);
+        editorOsc52(text, len);
+        free(text);
+        synced = 1;
+    }
+    if (cut)
+        editorDeleteSelection(E.core);
+    editorSetStatusMessage("%s %lld bytes%s", cut ? "Cut" : "Copied", y->len,
+        E.osc52 && !synced ? ", too many for the terminal's clipboard" : "");
+}
+
+
+void editorPasteBack(int back) {
+    texYank *y = editorYankAt(E.core, back);
+    if (y == NULL) {
+        editorSetStatusMessage("Nothing to paste, copy with Ctrl-C or cut with Ctrl-X first");
+        return;
+    }
+    editorDeleteSelection(E.core);
+
+    E.pasteCx = E.core->cx;
+    E.pasteCy = E.core->cy;
+    editorPasteYank(E.core, y);
+    // A block isn't one span of text, so there's nothing to take back out for CTRL-Y
+    E.pasted = !y->column;
+    E.pasteBack = back;
+}
+
+
+void editorPaste() {
+    editorPasteBack(0);
+}
+
+
+void editorYankPop(int pasted) {
+    if (!pasted) {
+        editorSetStatusMessage("Ctrl-Y swaps what was just pasted for an older copy, paste with Ctrl-V first");
+        return;
+    }
+
+    // Select the paste so the older yank goes in its place
+    E.core->selMode = SEL_LINEAR;
+    E.core->selCx = E.pasteCx;
+    E.core->selCy = E.pasteCy;
+    int back = (E.pasteBack + 1) % E.core->numYanks;
+    editorPasteBack(back);
+    editorSetStatusMessage("Pasted copy %d of %d", back + 1, E.core->numYanks);
+}
+
+
+void editorFilter() {
+    texCore *tc = E.core;
+    // The rows the selection covers, or else the whole file
+    int first = 0, last = INT_MAX;
+    int y0, x0, y1, x1;
+    if (editorSelectionBounds(tc, &y0, &x0, &y1, &x1)) {
+        first = y0;
+        // A selection ending at the start of a row leaves that row out
+        last = (y1 > y0 && x1 == 0 && tc->selMode != SEL_COLUMN) ? y1 - 1 : y1;
+    }
+
+    // Every row it covers has to be counted first
+    if (tc->large && largeProgress(tc) < 100) {
+        editorSetStatusMessage("Can't filter until the lines are counted");
+        return;
+    }
+
+    char *command = editorPrompt("Filter through: %s (ESC to cancel)", NULL);
+    if (command == NULL)
+        return;
+    editorSelectClear(tc);
+    editorClearCursors(tc);
+    if (editorFilterStart(tc, command, first, last) == -1) {
+        editorSetStatusMessage("Can't run %.40s: %s", command, strerror(errno));
+        free(command);
+        return;
+    }
+    tc->cy = first;
+    tc->cx = 0;
+
+    // Sleeps until a pipe is ready, or a key stops it. Other keys are dropped until it's done
+    long shown = texNow();
+    int stopped = 0;
+    while (editorFilterPump(tc)) {
+        texFilter *f = tc->filter;
+        struct pollfd fds[4] = {
+            { f->inFd, POLLOUT, 0 },
+            { f->outFd, POLLIN, 0 },
+            { f->errFd, POLLIN, 0 },
+            { STDIN_FILENO, POLLIN, 0 }
+        };
+        // Once its pipes are closed it's only waited on to exit
+        int closed = (f->inFd == -1 && f->outFd == -1 && f->errFd == -1);
+        int n = poll(fds, E.headless ? 3 : 4, closed ? 1 : TEX_PROGRESS_US / 1000);
+        if (n == -1 && errno != EINTR)
+            die("poll");
+        if (n > 0 && !E.headless && fds[3].revents) {
+            int c = editorReadKey();
+            if (c == '\x1b' || c == CTRL_KEY('c')) {
+                stopped = 1;
+                break;
+            }
+        }
+        if (texNow() - shown >= TEX_PROGRESS_US) {
+            editorSetStatusMessage("Filtering through %.40s, %lld KB in, %lld KB out (ESC to stop)",
+                command, f->bytesIn / 1024, f->bytesOut / 1024);
+            editorRefreshScreen();
+            shown = texNow();
+        }
+    }
 
+    texFilter *f = tc->filter;
+    if (stopped) {
+        editorFilterCancel(tc);
+        editorSetStatusMessage("Filter stopped, the rows are as they were");
+    } else if (WIFEXITED(f->status) && WEXITSTATUS(f->status) == 0) {
+        editorSetStatusMessage("Filtered %d rows through %.40s into %d", f->last - f->first + 1, command, f->added);
+    } else {
+        // The first line of its errors says why, when it wrote any
+        char *nl = strchr(f->err, '\n');
+        if (nl)
+            *nl = '\0';
+        if (f->err[0])
+            editorSetStatusMessage("%.40s failed: %s", command, f->err);
+        else if (WIFEXITED(f->status))
+            editorSetStatusMessage("%.40s exited with status %d", command, WEXITSTATUS(f->status));
+        else
+            editorSetStatusMessage("%.40s was stopped", command);
+    }
+    editorFilterFree(tc);
+    free(command);
 }
 
 
 void editorProcessKeyPress() {
     static int quitCount = TEX_QUIT_AMOUNT;    // Track amount of quit keypresses
     int c = editorReadKey();
+    editorLargeSync();
+    int pasted = E.pasted;
+    E.pasted = 0;
+
+    // Moving the cursor without SHIFT lets go of the selection
+    if ((c >= ARROW_LEFT && c <= CTRL_END_KEY && c != DEL_KEY) || c == '\r')
+        editorSelectClear(E.core);
 
     switch (c) {
         // ENTER key is pressed, insert newline
         case '\r':
-            editorInsertNewLine();
+            editorInsertNewLine(E.core);
             break;
 
         // CTRL-Q sucessful exit
         case CTRL_KEY('q'):
+            // Or only close the focused pane, when there are others
+            if (editorClosePane())
+                break;
             // Require confimation to exit with unsaved changes
-            if (E.dirty && quitCount > 0) {
+            if (E.core->dirty && quitCount > 0) {
                 // Warn User
                 editorSetStatusMessage("WARNING! %s has unsaved changes."
-                    "Press Ctrl-Q %d more times to quit.", E.filename, quitCount);
+                    "Press Ctrl-Q %d more times to quit.", E.core->filename, quitCount);
                 quitCount--;
                 return;
             }
+            // End a headless script instead of exiting, so its results can be reported
+            if (E.headless) {
+                E.inputPos = E.inputLen;
+                return;
+            }
+            // Changes thrown away on purpose aren't kept for recovery, an earlier session's are
+            editorAutosaveStop(E.core->dirty != 0);
             // Clear screen
             write(STDOUT_FILENO, "\x1b[2J", 4);
             write(STDOUT_FILENO, "\x1b[H", 3);
             exit(EXIT_SUCCESS);
             break;
 
+        // CTRL-B Split the pane one above the other, CTRL-\ side by side
+        case CTRL_KEY('b'):
+            editorSplitPane(0);
+            break;
+        case CTRL_KEY('\\'):
+            editorSplitPane(1);
+            break;
+
+        // CTRL-A Move to the next pane
+        case CTRL_KEY('a'):
+            editorNextPane();
+            break;
+
+        // CTRL-U Pipe the selected rows, or the whole file, through a shell command
+        case CTRL_KEY('u'):
+            editorFilter();
+            break;
+
         // CTRL-S Save editor
         case CTRL_KEY('s'):
             editorSave();
             break;
 
         case HOME_KEY:
-            E.cx = 0;   // Move cursor to left edge
+            E.core->cx = 0;   // Move cursor to left edge
+            for (int i = 0; i < E.core->numCursors; i++)
+                E.core->cursors[i].cx = 0;
+            editorNormalizeCursors(E.core);
             break;
         case END_KEY:
-            if (E.cy < E.numrows)
-                E.cx = E.row[E.cy].size;
+            if (E.core->cy < E.core->numrows)
+                E.core->cx = editorRowAt(E.core, E.core->cy)->size;
+            // Past any row's end, so every cursor is clamped to the end of its own row
+            for (int i = 0; i < E.core->numCursors; i++)
+                E.core->cursors[i].cx = INT_MAX;
+            editorNormalizeCursors(E.core);
             break;
         
         // CTRL-f Search Feature
         case CTRL_KEY('f'):
             editorFind();
             break;
+
+        // CTRL-d Add a cursor at every match of the last search
+        case CTRL_KEY('d'):
+            editorAddCursors();
+            break;
+
+        // CTRL-g Go to line
+        case CTRL_KEY('g'):
+            editorGoToLine();
+            break;
+
+        // CTRL-t Toggle the performance stats overlay
+        case CTRL_KEY('t'):
+            editorToggleStats();
+            break;
+
+        // CTRL-w Toggle soft wrap
+        case CTRL_KEY('w'):
+            editorToggleSoftWrap();
+            break;
+
+        // CTRL-k Fold or unfold the block or comment starting on the cursor's row
+        case CTRL_KEY('k'):
+            editorToggleFold();
+            break;
+
+        // CTRL-o Toggle the overview ruler
+        case CTRL_KEY('o'):
+            editorToggleOverview();
+            break;
+
+        // CTRL-e Toggle the diff gutter, CTRL-n and CTRL-p jump to the next and previous change
+        case CTRL_KEY('e'):
+            editorToggleDiff();
+            break;
+        case CTRL_KEY('n'):
+            editorJumpChange(1);
+            break;
+        case CTRL_KEY('p'):
+            editorJumpChange(-1);
+            break;
+
+        // CTRL-r Step line numbers through off, on and relative to the cursor
+        case CTRL_KEY('r'):
+            editorToggleLineNumbers();
+            break;
         
         case BACKSPACE:         // Delete char to the left of the cursor
         case CTRL_KEY('h'):     // Delete char to the left of the cursor
         case DEL_KEY:
+            // Or delete the whole selection instead
+            if (editorDeleteSelection(E.core))
+                break;
+            editorSelectClear(E.core);
             // Delete the character to the right of the cursor
             if (c == DEL_KEY)
                 editorMoveCursor(ARROW_RIGHT);
-            editorDelChar();
+            editorDelChar(E.core);
             break;
 
         case PAGE_UP:   // Move cursor to top edge
         case PAGE_DOWN: // Move cursor to bottom edge
             {
-                // Scroll Entire Page
-                if (c == PAGE_UP) {
-                    E.cy = E.rowOff;
-                } else if (c == PAGE_DOWN) {
-                    E.cy = E.rowOff + E.screenRows - 1;
-                    if (E.cy > E.numrows)
-                        E.cy = E.numrows;
+                // Scroll a page of visual lines at once when soft wrapping
+                if (E.softWrap) {
+                    int delta = (c == PAGE_UP) ? -E.screenRows : E.screenRows;
+                    E.wrapOff += delta;
+                    if (E.wrapOff < 0)
+                        E.wrapOff = 0;
+                    editorLayoutMoveVisual(delta);
+                    break;
                 }
 
-                // Scroll to bottom of page
-                int times = E.screenRows;
-                while (times--)
-                    editorMoveCursor(c == PAGE_UP ? ARROW_UP : ARROW_DOWN);
+                // Jump a page straight to the target row, keeping the cursor's column
+                int rx = (E.core->cy < E.core->numrows) ? editorRowCxToRx(editorRowAt(E.core, E.core->cy), E.core->cx) : 0;
+                if (c == PAGE_UP)
+                    E.core->cy = editorFoldStep(E.core, E.rowOff, -E.screenRows);
+                else if (c == PAGE_DOWN)
+                    E.core->cy = editorFoldStep(E.core, E.rowOff, 2 * E.screenRows - 1);
+                E.core->cx = (E.core->cy < E.core->numrows) ? editorRowRxToCx(editorRowAt(E.core, E.core->cy), rx) : 0;
             }
             break;
 
+        // Jump to the start or end of the file
+        case CTRL_HOME_KEY:
+            editorGoToRow(0);
+            break;
+        case CTRL_END_KEY:
+            editorGoToRow(E.core->numrows - 1);
+            break;
+
         // Arrow navigation
         case ARROW_UP:
         case ARROW_DOWN:
@@ -1191,61 +2950,601 @@ void editorProcessKeyPress() {
             editorMoveCursor(c);
             break;
 
-        case CTRL_KEY('l'):
+        // Selecting
+        case SHIFT_ARROW_LEFT:
+        case SHIFT_ARROW_RIGHT:
+        case SHIFT_ARROW_UP:
+        case SHIFT_ARROW_DOWN:
+            editorSelectMove(c - SHIFT_ARROW_LEFT + ARROW_LEFT, SEL_LINEAR);
+            break;
+        case COLUMN_ARROW_LEFT:
+        case COLUMN_ARROW_RIGHT:
+        case COLUMN_ARROW_UP:
+        case COLUMN_ARROW_DOWN:
+            editorSelectMove(c - COLUMN_ARROW_LEFT + ARROW_LEFT, SEL_COLUMN);
+            break;
+
+        // CTRL-c Copy, CTRL-x Cut and CTRL-v Paste
+        case CTRL_KEY('c'):
+            editorCopy(0);
+            break;
+        case CTRL_KEY('x'):
+            editorCopy(1);
+            break;
+        case CTRL_KEY('v'):
+            editorPaste();
+            break;
+        // CTRL-y Swap the paste for the copy before it
+        case CTRL_KEY('y'):
+            editorYankPop(pasted);
+            break;
+
+        // TAB indents the selected rows, SHIFT-TAB dedents them or the cursor's row
+        case '\t':
+            if (E.core->selMode == SEL_NONE)
+                editorInsertChar(E.core, c);
+            else
+                editorIndentSelection(E.core, 0);
+            break;
+        case SHIFT_TAB:
+            editorIndentSelection(E.core, 1);
+            break;
+
+        // ESC Go back to a single cursor, and drop the selection
         case '\x1b':
+            editorClearCursors(E.core);
+            editorSelectClear(E.core);
+            editorSearchIndexFree(&E.search);
+            break;
+
+        case CTRL_KEY('l'):
             break;
         
         // Allow any unmapped keypress to be inserted directly into the text being edited. 
         default:
-            editorInsertChar(c);
+            editorSelectClear(E.core);
+            editorInsertChar(E.core, c);
             break;
     }
     quitCount = TEX_QUIT_AMOUNT;   // Rest quit counter
 }
 
 
+/*--------------------------------------------------------------------------
+                                 BENCHMARK
+--------------------------------------------------------------------------*/
+
+void benchGenerateFile(const char *path, int lines) {
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+        die("fopen");
+
+    // A mix of short code lines, tabs, strings, comments and the occasional very long line
+    for (int i = 0; i < lines; i++) {
+        switch (i % 8) {
+            case 0:
+                fprintf(fp, "/* Block %d of generated source\n", i / 8);
+                break;
+            case 1:
+                fprintf(fp, "   spans two lines */\n");
+                break;
+            case 2:
+                fprintf(fp, "static int value%d = %d;\n", i, i * 7);
+                break;
+            case 3:
+                fprintf(fp, "\tif (value%d > %d) {\n", i - 1, i % 97);
+                break;
+            case 4:
+                fprintf(fp, "\t\treturn \"string %d\"; // trailing comment\n", i);
+                break;
+            case 5:
+                fprintf(fp, "\t}\n");
+                break;
+            case 6:
+                // Long log style line
+                for (int j = 0; j < 40; j++)
+                    fprintf(fp, "field%d=%d ", j, i + j);
+                fprintf(fp, "\n");
+                break;
+            default:
+                fprintf(fp, "\n");
+                break;
+        }
+    }
+    fclose(fp);
+}
+
+
+void benchTypingScript(struct aBuf *ab) {
+    abAppend(ab, "\x07" "50%\r", 5);   // Go to the middle of the file
+
+    // Type lines of code, pressing Enter at the end of each
+    const char *line = "for (int i = 0; i < 10; i++) { total += i; } // typed";
+    for (int i = 0; i < 40; i++) {
+        abAppend(ab, line, strlen(line));
+        abAppend(ab, "\r", 1);
+    }
+
+    // Backspace over part of it again
+    for (int i = 0; i < 200; i++)
+        abAppend(ab, "\x7f", 1);
+}
+
+
+void benchPasteScript(struct aBuf *ab) {
+    abAppend(ab, "\x07" "25%\r", 5);
+
+    // A burst of text as a terminal delivers a paste, long lines and newlines
+    for (int i = 0; i < 200; i++) {
+        char buf[64];
+        int len = snprintf(buf, sizeof(buf), "pasted line %d\twith a tab and \"a string\"", i);
+        abAppend(ab, buf, len);
+        if (i % 3 == 0)
+            abAppend(ab, "\r", 1);
+    }
+}
+
+
+void benchSearchScript(struct aBuf *ab) {
+    abAppend(ab, "\x1b[1;5H", 6);     // Start of file
+
+    // Incremental search, then step through matches with the arrow keys
+    abAppend(ab, "\x06", 1);
+    abAppend(ab, "value1", 6);
+    for (int i = 0; i < 100; i++)
+        abAppend(ab, "\x1b[B", 3);
+    abAppend(ab, "\r", 1);
+
+    // A query that's never found scans the whole file for each key
+    abAppend(ab, "\x06" "zzzz\x1b", 6);
+}
+
+
+void benchScrollScript(struct aBuf *ab) {
+    abAppend(ab, "\x1b[1;5H", 6);
+
+    for (int i = 0; i < 300; i++)
+        abAppend(ab, "\x1b[6~", 4);   // Page down
+    for (int i = 0; i < 300; i++)
+        abAppend(ab, "\x1b[5~", 4);   // Page up
+    for (int i = 0; i < 1000; i++)
+        abAppend(ab, "\x1b[B", 3);    // Arrow down
+
+    // Jump to the ends of the file, then scroll the long lines sideways
+    abAppend(ab, "\x1b[1;5F", 6);
+    abAppend(ab, "\x1b[1;5H", 6);
+    for (int i = 0; i < 7; i++)
+        abAppend(ab, "\x1b[B", 3);
+    abAppend(ab, "\x1b[F", 3);
+    abAppend(ab, "\x1b[H", 3);
+
+    // Same again, soft wrapped
+    abAppend(ab, "\x17", 1);
+    for (int i = 0; i < 300; i++)
+        abAppend(ab, "\x1b[6~", 4);
+    for (int i = 0; i < 1000; i++)
+        abAppend(ab, "\x1b[A", 3);
+    abAppend(ab, "\x17", 1);
+}
+
+
+void benchNumbersScript(struct aBuf *ab) {
+    // Relative numbers, which change on every row whenever the cursor moves
+    abAppend(ab, "\x12\x12", 2);
+    benchScrollScript(ab);
+    abAppend(ab, "\x12", 1);
+}
+
+
+void benchSplitScript(struct aBuf *ab) {
+    // Split into three panes onto the same rows, type in one and close the others again
+    abAppend(ab, "\x02\x1c", 2);
+    benchTypingScript(ab);
+    abAppend(ab, "\x11\x11", 2);
+}
+
+
+void benchFilterScript(struct aBuf *ab) {
+    // The whole file through sort, then a thousand rows from the middle back through cat
+    abAppend(ab, "\x15" "sort\r", 6);
+    abAppend(ab, "\x07" "50%\r", 5);
+    for (int i = 0; i < 1000; i++)
+        abAppend(ab, "\x1b[1;2B", 6);
+    abAppend(ab, "\x15" "cat\r", 5);
+}
+
+
+void benchThemeTruecolour() {
+    editorThemeSet(HL_NORMAL, THEME_RGB(220, 220, 204), THEME_RGB(30, 30, 30), 0);
+    editorThemeSet(HL_COMMENT, THEME_RGB(106, 153, 85), THEME_INHERIT, THEME_ITALIC);
+    editorThemeSet(HL_MLCOMMENT, THEME_RGB(106, 153, 85), THEME_INHERIT, THEME_ITALIC);
+    editorThemeSet(HL_KEYWORD, THEME_RGB(197, 134, 192), THEME_INHERIT, THEME_BOLD);
+    editorThemeSet(HL_TYPE, THEME_RGB(78, 201, 176), THEME_INHERIT, 0);
+    editorThemeSet(HL_STRING, THEME_RGB(206, 145, 120), THEME_INHERIT, 0);
+    editorThemeSet(HL_NUMBER, THEME_RGB(181, 206, 168), THEME_INHERIT, 0);
+    editorThemeBuild();
+}
+
+
+void benchRun(const char *name, void (*script)(struct aBuf *)) {
+    struct aBuf ab = ABUF_INIT;
+    script(&ab);
+
+    // Start each scenario with empty histograms
+    memset(&E.stats, 0, sizeof(E.stats));
+    E.input = ab.b;
+    E.inputLen = ab.len;
+    E.inputPos = 0;
+
+    long start = texNow();
+
+    // Same loop as main(), until the script runs out of keys
+    while (E.inputPos < E.inputLen) {
+        editorProcessKeyPress();
+        editorRefreshScreen();
+    }
+
+    long elapsed = texNow() - start;
+    if (elapsed == 0)
+        elapsed = 1;
+
+    // Prompts draw their own frames, so count frames from the stats
+    long frames = E.stats.bytes.count;
+    long bytes = E.stats.bytes.sum;
+    printf("%-8s %7d bytes in %7ld frames %9.2f ms %10.0f frames/s %8.2f MB/s out  latency p50 %6ldus p99 %6ldus max %6ldus\n",
+        name, ab.len, frames, elapsed / 1000.0, frames * 1000000.0 / elapsed,
+        bytes / (double) elapsed, statsPercentile(&E.stats.latency, 50),
+        statsPercentile(&E.stats.latency, 99), E.stats.latency.max);
+
+    E.input = NULL;
+    E.inputLen = 0;
+    abFree(&ab);
+}
+
+
+int benchMain(int lines) {
+    E.headless = 1;
+    initEditor();
+
+    char path[] = "/tmp/texbenchXXXXXX.c";
+    int fd = mkstemps(path, 2);
+    if (fd == -1)
+        die("mkstemps");
+    close(fd);
+    benchGenerateFile(path, lines);
+
+    long start = texNow();
+    if (editorOpen(E.core, path) == -1)
+        die("fopen");
+    long elapsed = texNow() - start;
+    unlink(path);
+
+    printf("Tex %s headless benchmark, %d lines, %dx%d window\n", TEX_VERSION, E.core->numrows,
+        E.areaCols, E.areaRows + 2);
+    printf("%-8s %9.2f ms\n", "open", elapsed / 1000.0);
+
+    benchRun("typing", benchTypingScript);
+    benchRun("paste", benchPasteScript);
+    benchRun("search", benchSearchScript);
+    benchRun("scroll", benchScrollScript);
+    // Scrolled again with line numbers on, over rows the first scroll already highlighted
+    benchRun("numbers", benchNumbersScript);
+    // Typed again with the window split, the other panes only draw the lines that moved
+    benchRun("split", benchSplitScript);
+    // Piped through commands and back, a frame for each
+    benchRun("filter", benchFilterScript);
+    // And with every colour change a 24 bit escape
+    benchThemeTruecolour();
+    benchRun("theme", benchScrollScript);
+    editorThemeDefault();
+    return 0;
+}
+
+
+/*--------------------------------------------------------------------------
+                                   TRACE
+--------------------------------------------------------------------------*/
+
+void traceWriteVarint(FILE *fp, unsigned long value) {
+    // 7 bits per byte, high bit set on every byte but the last
+    while (value >= 0x80) {
+        fputc((value & 0x7f) | 0x80, fp);
+        value >>= 7;
+    }
+    fputc(value, fp);
+}
+
+
+int traceReadVarint(FILE *fp, unsigned long *value) {
+    int c;
+    int shift = 0;
+    *value = 0;
+
+    while ((c = fgetc(fp)) != EOF) {
+        *value |= (unsigned long) (c & 0x7f) << shift;
+        if (!(c & 0x80))
+            return 0;
+        shift += 7;
+        if (shift > 56)
+            return -1;
+    }
+    return -1;
+}
+
+
+void traceStopRecording() {
+    if (E.traceFp) {
+        fclose(E.traceFp);
+        E.traceFp = NULL;
+    }
+}
+
+
+void traceStartRecording(const char *path) {
+    E.traceFp = fopen(path, "wb");
+    if (!E.traceFp)
+        die("fopen");
+    fcntl(fileno(E.traceFp), F_SETFD, FD_CLOEXEC);  // Not handed on to a filter command
+
+    // Header, the window size the trace was recorded at
+    fwrite(TRACE_MAGIC, 1, 4, E.traceFp);
+    fputc(TRACE_VERSION, E.traceFp);
+    traceWriteVarint(E.traceFp, E.areaRows + 2);
+    traceWriteVarint(E.traceFp, E.areaCols);
+
+    E.traceLast = texNow();
+    atexit(traceStopRecording);
+}
+
+
+void traceRecord(char c) {
+    // Each record is the microseconds since the previous byte, then the byte
+    long now = texNow();
+    traceWriteVarint(E.traceFp, now - E.traceLast);
+    fputc((unsigned char) c, E.traceFp);
+    E.traceLast = now;
+}
+
+
+int traceReplay(const char *path, char *filename, int realtime) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        die("fopen");
+
+    char magic[4];
+    unsigned long rows, cols;
+    if (fread(magic, 1, 4, fp) != 4 || memcmp(magic, TRACE_MAGIC, 4) != 0 ||
+        fgetc(fp) != TRACE_VERSION || traceReadVarint(fp, &rows) || traceReadVarint(fp, &cols)) {
+        fprintf(stderr, "%s: not a Tex trace\n", path);
+        fclose(fp);
+        return EXIT_FAILURE;
+    }
+    // Room for a row of text above the status and message bars, and no bigger than a winsize holds
+    if (rows < 3 || cols < 1 || rows > USHRT_MAX || cols > USHRT_MAX) {
+        fprintf(stderr, "%s: recorded at a %lux%lu window, which can't be replayed\n", path, cols, rows);
+        fclose(fp);
+        return EXIT_FAILURE;
+    }
+
+    // Load every byte along with the time it was typed, relative to the start of the trace
+    int cap = 4096;
+    char *input = malloc(cap);
+    long *times = malloc(sizeof(long) * cap);
+    if (input == NULL || times == NULL)
+        die("malloc");
+    int len = 0;
+    long elapsed = 0;
+    unsigned long delta;
+    int c;
+
+    while (traceReadVarint(fp, &delta) == 0 && (c = fgetc(fp)) != EOF) {
+        if (len == cap) {
+            cap *= 2;
+            input = realloc(input, cap);
+            times = realloc(times, sizeof(long) * cap);
+            if (input == NULL || times == NULL)
+                die("realloc");
+        }
+        elapsed += delta;
+        input[len] = c;
+        times[len] = elapsed;
+        len++;
+    }
+    fclose(fp);
+
+    // Replay at the window size the trace was recorded at
+    E.headless = 1;
+    initEditor();
+    E.areaRows = rows - 2;
+    E.areaCols = cols;
+    editorPanesLayout();
+    if (filename)
+        editorOpenFile(filename, 0, TEX_CACHE_MB * 1024LL * 1024);
+
+    memset(&E.stats, 0, sizeof(E.stats));
+    E.input = input;
+    E.inputLen = len;
+    E.inputPos = 0;
+    E.inputTimes = realtime ? times : NULL;
+
+    long start = texNow();
+    E.inputStart = start;
+
+    // Same loop as main(), until the trace runs out or quits
+    while (E.inputPos < E.inputLen) {
+        editorRefreshScreen();
+        editorProcessKeyPress();
+    }
+    editorRefreshScreen();
+
+    long wall = texNow() - start;
+    printf("Replayed %d bytes of %s in %.2f ms (recorded over %.2f ms), %ld frames at %lux%lu\n",
+        len, path, wall / 1000.0, elapsed / 1000.0, E.stats.bytes.count, cols, rows);
+    statsSummary(stdout, "key to frame latency (us)", &E.stats.latency);
+    statsSummary(stdout, "key handling (us)", &E.stats.process);
+    statsSummary(stdout, "scroll (us)", &E.stats.scroll);
+    statsSummary(stdout, "draw (us)", &E.stats.draw);
+    statsSummary(stdout, "write (us)", &E.stats.write);
+    statsSummary(stdout, "highlighting per frame (us)", &E.stats.highlight);
+    statsSummary(stdout, "bytes per frame", &E.stats.bytes);
+    statsSummary(stdout, "allocations per frame", &E.stats.allocations);
+
+    free(input);
+    free(times);
+    return 0;
+}
+
+
 /*--------------------------------------------------------------------------
                                    INIT
 --------------------------------------------------------------------------*/
 
 void initEditor() {
-    // Set Cursor pos to top left
-    E.cx = 0;
-    E.cy = 0;
+    // Empty buffer with the cursor at the top left
+    E.core = texCoreNew();
+    if (E.core == NULL)
+        die("texCoreNew");
+    E.core->outOfMemory = editorOutOfMemory;
     E.rx = 0;
 
     // Default scroll to top left
     E.rowOff = 0;
     E.colOff = 0;
 
-    E.numrows = 0;
-    E.row = NULL;
-    E.dirty = 0;
-
     // Initialize Status bar
-    E.filename = NULL;
     E.statusmsg[0] = '\0';
     E.statusmsgTime = 0;
 
-    E.syntax = NULL;    // No current filetype, no highlighting
-
-    // Error Handling
-    if (getWindowSize(&E.screenRows, &E.screenCols) == -1)
-        die("getWindowSize");
+    E.matchRow = -1;    // No search match to overlay
+    E.bracketRow[0] = E.bracketRow[1] = -1;  // Nor brackets, until they're first matched
+    E.bracketCx = E.bracketCy = -1;
+    E.bracketDirty = -1;
+    E.bracketWaiting = 0;
+    E.lastQuery = NULL;
+    E.osc52 = 0;    // Copies stay in the editor unless --osc52 is given
+    E.pasted = 0;   // Nothing pasted yet for CTRL-Y to swap
+    E.pasteBack = 0;
+
+    // Soft wrap is off, layout is built when it's turned on
+    E.softWrap = 0;
+    E.wrapOff = 0;
+    E.overview = 0;
+    E.gutter = 0;
+    E.diff = 0;
+    E.lineNumbers = LINES_OFF;
+    E.numberWidth = 0;
+    for (int i = 0; i < 100; i++) {
+        E.digitPairs[2 * i] = '0' + i / 10;
+        E.digitPairs[2 * i + 1] = '0' + i % 10;
+    }
+    editorThemeDefault();   // Built in colours until a theme file is loaded
+
+    // Nothing to wake for until the event loop is set up
+    E.sigPipe[0] = E.sigPipe[1] = -1;
+    E.watchFd = -1;
+    E.watchWd = -1;
+    memset(E.timers, 0, sizeof(E.timers));
+    E.taskDirty = 0;
+    memset(&E.search, 0, sizeof(E.search));    // No search to count the matches of
+    E.autosaveFd = -1;
+    E.autosaveRow = 0;
+    E.autosaveDue = 0;
+
+    if (E.headless) {
+        // No terminal to size or draw to, frames are written to a sink
+        E.screenRows = TEX_HEADLESS_ROWS;
+        E.screenCols = TEX_HEADLESS_COLS;
+        E.outFd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+        if (E.outFd == -1)
+            die("open");
+    } else {
+        E.outFd = STDOUT_FILENO;
+        // Error Handling
+        if (getWindowSize(&E.screenRows, &E.screenCols) == -1)
+            die("getWindowSize");
+    }
 
     E.screenRows -= 2;  // Make room for the status bar & status message
+
+    // One pane over the whole screen above the status bar, until it's split
+    E.areaRows = E.screenRows;
+    E.areaCols = E.screenCols;
+    memset(E.panes, 0, sizeof(E.panes));
+    memset(E.splits, 0, sizeof(E.splits));
+    E.numPanes = 1;
+    E.pane = 0;
+    E.splitRoot = editorSplitAlloc();
+    E.splits[E.splitRoot].pane = 0;
+    editorPanesLayout();
 }
 
 
 int main(int argc, char *argv[]) {
+    char *filename = NULL;
+    char *record = NULL;
+    char *replay = NULL;
+    int realtime = 0;
+    int large = 0;
+    long long budget = TEX_CACHE_MB * 1024LL * 1024;
+    int osc52 = 0;
+    char *theme = getenv("TEX_THEME");
+
+    for (int i = 1; i < argc; i++) {
+        // Run the benchmark without a terminal, optionally with the number of lines to generate
+        if (!strcmp(argv[i], "--bench"))
+            return benchMain(i + 1 < argc ? atoi(argv[i + 1]) : TEX_BENCH_LINES);
+        else if (!strcmp(argv[i], "--record") && i + 1 < argc)
+            record = argv[++i];
+        else if (!strcmp(argv[i], "--replay") && i + 1 < argc)
+            replay = argv[++i];
+        else if (!strcmp(argv[i], "--realtime"))
+            realtime = 1;
+        // Page the file in from disk however big it is, with a cache of the given size in MB
+        else if (!strcmp(argv[i], "--large"))
+            large = 1;
+        else if (!strcmp(argv[i], "--cache") && i + 1 < argc)
+            budget = atoll(argv[++i]) * 1024 * 1024;
+        // Copy into the terminal's clipboard too, through OSC 52
+        else if (!strcmp(argv[i], "--osc52"))
+            osc52 = 1;
+        // Colours from a theme file, over $TEX_THEME
+        else if (!strcmp(argv[i], "--theme") && i + 1 < argc)
+            theme = argv[++i];
+        else
+            filename = argv[i];
+    }
+
+    // Replay a recorded trace without a terminal, and report how long each stage took
+    if (replay)
+        return traceReplay(replay, filename, realtime);
+
     enableRawMode();
     initEditor();
-    if (argc >= 2) {
-        editorOpen(argv[1]);
+    E.osc52 = osc52;
+    editorEventInit();
+    atexit(statsDump);  // Write histograms to $TEX_STATS on exit
+    if (filename) {
+        editorOpenFile(filename, large, budget);
+        editorWatchFile();
     }
+    // Time the first key from when the file is ready to edit
+    if (record)
+        traceStartRecording(record);
 
     // Set initial status message
     editorSetStatusMessage("HELP: CTRL-S 'save' | CTRL-F 'find' | Ctrl-Q 'quit'");
+    // Changes left unsaved by a session that never quit are kept in the autosave
+    char *autosave = editorAutosavePath();
+    if (autosave && access(autosave, F_OK) == 0)
+        editorSetStatusMessage("Unsaved changes from an earlier session are in %s", autosave);
+    free(autosave);
+    int themeLine;
+    if (theme && editorLoadTheme(theme, &themeLine) == -1) {
+        if (themeLine == 0)
+            editorSetStatusMessage("Can't open theme %s: %s", theme, strerror(errno));
+        else
+            editorSetStatusMessage("Bad theme %s, line %d", theme, themeLine);
+    }
 
     while (1) {
         editorRefreshScreen();
@@ -1,19 +1,12 @@
-#define _DEFAULT_SOURCE
-#define _BSD_SOURCE
-#define _GNU_SOURCE
+#include "texcore.h"
 
 #include <termios.h>
-#include <unistd.h>
-#include <stdlib.h>
-#include <ctype.h>
-#include <stdio.h>
-#include <errno.h>
 #include <sys/ioctl.h>
-#include <sys/types.h>
-#include <string.h>
-#include <time.h>
 #include <stdarg.h>
-#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/inotify.h>
+#include <sys/wait.h>
 
 
 // Version number
@@ -26,12 +19,58 @@
 //0001 1111, Mirrors ctrl key in terminal, strips bits 5&6 from key pressed with ctrl, and sends that
 #define CTRL_KEY(k) ((k) &0x1f)
 
-// Tab Stop Constant
-#define TEX_TAB_STOP 8
+// Window size used when running headless, without a terminal
+#define TEX_HEADLESS_ROWS 24
+#define TEX_HEADLESS_COLS 80
+
+// Lines in the file generated by the benchmark
+#define TEX_BENCH_LINES 200000
+
+// Files at least this big are paged in from disk instead of loaded, as are any opened with --large
+#define TEX_LARGE_FILE_MB 256
+
+// Default page cache budget for paged files, set with --cache
+#define TEX_CACHE_MB 64
+
+// Microseconds spent reading in the rest of a file between frames, while no key is waiting
+#define TEX_LOAD_FRAME_US 30000
+
+// Microseconds a status message is shown for
+#define TEX_STATUS_US 5000000
+
+// Microseconds between redraws of a paged file's indexing progress
+#define TEX_PROGRESS_US 100000
+
+// Microseconds a background task runs for at a time, before the event loop polls again
+#define TEX_TASK_US 10000
+
+/*
+    Work a background task does between checks for a key, each well under a millisecond so
+    typing stays responsive. Rows are highlighted ahead below TEX_HL_LOOKBACK so they're exact
+*/
+#define TEX_TASK_LOAD_BYTES (16 * 1024)
+#define TEX_HL_IDLE_ROWS 32
+#define TEX_TASK_SEARCH_ROWS 1024
+#define TEX_AUTOSAVE_CHUNK (64 * 1024)
+
+// Microseconds after the last edit that a buffer is autosaved
+#define TEX_AUTOSAVE_US 2000000
+
+// Most bytes of a copy sent to the terminal's clipboard with --osc52, terminals drop longer ones
+#define TEX_OSC52_MAX 100000
+
+// Trace file header
+#define TRACE_MAGIC "TEXT"
+#define TRACE_VERSION 1
 
 // Quit confirmation, Force user to press CTRL-Q 3 times to quit with unsaved changes
 #define TEX_QUIT_AMOUNT 3
 
+// Most panes the screen can be split into, and the smallest a split can leave each half
+#define TEX_MAX_PANES 8
+#define TEX_PANE_MIN_ROWS 3
+#define TEX_PANE_MIN_COLS 20
+
 // Arrow Key constants
 enum editorKey {
     BACKSPACE = 127,
@@ -43,54 +82,169 @@ enum editorKey {
     HOME_KEY,
     END_KEY,
     PAGE_UP,
-    PAGE_DOWN
-};
-
-enum editorHighlight {
-    HL_NORMAL = 0,  // Hightlight keywords
-    HL_COMMENT,     // Highlight comments
-    HL_MLCOMMENT,   // Highlight multiline comments
-    HL_KEYWORD,     // Highlight keywords
-    HL_TYPE,        // Highlight common types
-    HL_STRING,      // Highlight strings
-    HL_NUMBER,      // Highlight numbers
-    HL_MATCH        // Highlights search results
+    PAGE_DOWN,
+    CTRL_HOME_KEY,
+    CTRL_END_KEY,
+    SHIFT_ARROW_LEFT,   // Extend a selection
+    SHIFT_ARROW_RIGHT,
+    SHIFT_ARROW_UP,
+    SHIFT_ARROW_DOWN,
+    COLUMN_ARROW_LEFT,  // Extend a column selection, ALT-SHIFT and an arrow
+    COLUMN_ARROW_RIGHT,
+    COLUMN_ARROW_UP,
+    COLUMN_ARROW_DOWN,
+    SHIFT_TAB
 };
 
-// Highlight bitflags
-#define HL_HIGHLIGHT_NUMBERS (1<<0)
-#define HL_HIGHLIGHT_STRINGS (1<<1)
 
 /*--------------------------------------------------------------------------
                                    DATA
 --------------------------------------------------------------------------*/
 
-// Contains highlighting information for a particular filetype
-struct editorSyntax {
-    char *filetype;     // Name of the full displayed in the status bar
-    char **filematch;   // array of strings that contain a pattern to match against
-    char **keywords;    // array of strings that contain a language's keywords
-    char *singleline_comment_start; // string to hold the start of single line comments, since they differ in langs
-    char *multiline_comment_start;  // string to hold the start of a multiline comment identifer
-    char *multiline_comment_end;    // string to hold the end of a multiline comment identifer
-    int flags;          // bitfield to flag whether to highlight numbers and strings for that filetype
+// Timers run by the event loop, each one kept in its own slot
+enum editorTimerSlot {
+    TIMER_STATUS = 0,   // Clears the status message once it's old
+    TIMER_PROGRESS,     // Redraws a paged file's indexing progress
+    TIMER_AUTOSAVE,     // Marks the buffer due for an autosave, once it's been left alone
+    TIMER_COUNT
 };
 
+// Styles of a theme, the highlight classes then the rest of what's drawn in colour
+enum editorThemeClass {
+    THEME_ADDED = HL_BRACKET + 1,   // Diff gutter marks
+    THEME_CHANGED,
+    THEME_DELETED,
+    THEME_LINE_NUMBER,  // Numbers besides the cursor's row
+    THEME_COUNT
+};
 
-// Stors a row of text in the editor
-typedef struct erow {
-    int idx;    // Index within the file
-    int size;
-    int rSize;  // Size of the contents of render
-    char *chars;
-    char *render;
-    unsigned char *highlight;
-    int hl_open_comment;
-} erow;
+// Theme colours, a palette index from 0 to 255, an RGB colour, the terminal's own, or the normal style's
+#define THEME_DEFAULT -1
+#define THEME_INHERIT -2
+#define THEME_RGB(r, g, b) (0x1000000 | (r) << 16 | (g) << 8 | (b))
+#define THEME_BOLD (1<<0)
+#define THEME_ITALIC (1<<1)
+#define THEME_SEQ_MAX 64    // Longest escape a style needs, RGB foreground and background included
+
+// A style, and the escape sequence setting every attribute the theme changes anywhere, inverse aside
+struct editorStyle {
+    int fg, bg, attrs;
+    char seq[THEME_SEQ_MAX];
+    int len;
+};
 
-struct editorConfig {
-    // Cursor Pos
+// A pane's own view of the buffer, which is in E and the buffer while the pane has the focus
+struct editorView {
     int cx, cy;
+    int rowOff, colOff;
+    int wrapOff;
+    int screenRows, screenCols;
+    int softWrap;
+    // Overlays only the focused pane draws, so they're empty in any other's
+    int matchRow;
+    int bracketRow[2];
+    int numCursors;
+    int selMode;
+};
+
+// A line of an unfocused pane as it was last drawn, it's drawn again only when this changes
+struct editorPaneLine {
+    int row;        // File row, moved along with edits above it. -1 past the end, -2 the welcome, -3 to draw again
+    int sub;        // Visual line within the row
+    int number;     // Number in the gutter, and whether it's the pane's cursor row
+    int current;
+    int diff;       // editorDiffKind mark in the gutter
+    int foldLines;  // Rows folded under the row, which its marker counts
+};
+
+// What every line of an unfocused pane was drawn with, they're all drawn again when it changes
+struct editorPaneLook {
+    texCore *core;  // NULL to draw them all again
+    int top, left, rows, cols;
+    int screenCols, colOff;
+    int softWrap;
+    int gutter, numberWidth, lineNumbers, diff;
+};
+
+// A window onto the buffer with its own scroll and cursor, the panes tile the screen above the status bar
+struct editorPane {
+    int top, left;  // Screen position of its top left, 0 based
+    int rows, cols; // Lines of text, and columns with the gutter and ruler
+    int bar;        // A status bar of its own is drawn under it, when it's above another pane
+    struct editorView view; // Its view, while another pane has the focus
+    int wrapSub;    // Visual line of its top row that it starts at, when soft wrapping
+    struct editorPaneLine *lines;   // Each line as it was last drawn unfocused
+    struct editorPaneLook look;
+    char barText[80];   // Status bar as it was last drawn
+    int barLen;
+};
+
+// Node of the tree of splits the panes are laid out by, a pane or two halves
+struct editorSplit {
+    int used;
+    int pane;       // Pane it is, -1 when it's split in two
+    int vertical;   // Halves are side by side with a divider between, rather than one above the other
+    int child[2];
+    int parent;     // -1 at the root
+    int top, left, rows, cols;  // Screen it covers
+};
+
+// Line numbers drawn in the gutter
+enum editorLineNumbers {
+    LINES_OFF = 0,
+    LINES_ABSOLUTE,
+    LINES_RELATIVE  // Rows counted up and down from the cursor's, which shows its own number
+};
+
+struct editorTimer {
+    long due;       // texNow() time it next fires, 0 when it's stopped
+    long interval;  // Microseconds between firings, 0 to fire once
+    void (*fn)();   // Called when it fires, before the screen is redrawn. May be NULL
+};
+
+// Background work run between keys, a slice at a time
+struct editorTask {
+    int (*pending)();           // Returns 1 when it has work to do
+    int (*run)(long deadline);  // Works until deadline or a key is waiting, returns 1 when the screen changed
+    long budget;                // Microseconds it's given at a time
+};
+
+
+// Log-linear histogram, every power of two is split into STATS_SUB_BUCKETS linear buckets
+#define STATS_SUB_BITS 2
+#define STATS_SUB_BUCKETS (1 << STATS_SUB_BITS)
+#define STATS_BUCKETS 128
+
+struct statsHist {
+    long count;
+    long sum;
+    long max;
+    long buckets[STATS_BUCKETS];
+};
+
+// Frame timings and counters, collected for every frame and shown by the stats overlay
+struct editorStats {
+    int show;           // Draw the overlay in the message bar
+    long keyTime;       // When the last undrawn key was read, 0 once its frame is written
+    long hlTime;        // Microseconds spent highlighting since the last frame
+    long allocs;        // Allocations since the last frame
+    // Values for the last frame drawn
+    long frameBytes;
+    long frameHlTime;
+    long frameAllocs;
+    struct statsHist latency;       // Key read to frame written, in microseconds
+    struct statsHist bytes;         // Bytes written per frame
+    struct statsHist highlight;     // Microseconds highlighting per frame
+    struct statsHist allocations;   // Allocations per frame
+    // Time spent in each stage of a frame, in microseconds
+    struct statsHist process;       // Key read to the start of the refresh
+    struct statsHist scroll;
+    struct statsHist draw;          // Building the frame in the append buffer
+    struct statsHist write;
+};
+
+struct editorConfig {
+    texCore *core;  // Buffer being edited, holds the rows and the cursor position within them
     // When no tabs on current line, rx = cx, when line has tabs, rx will be greater by the num of spaces the tabs take up
     int rx;
     // Terminal Size
@@ -99,54 +253,83 @@ struct editorConfig {
     // Row & Column Offset
     int rowOff;
     int colOff;
-    // Editor Rows
-    int numrows;
-    erow *row;
-    int dirty;   // modified since opening flag
+    // Soft wrap
+    int softWrap;   // Wrap rows at the screen width instead of scrolling horizontally
+    int wrapOff;    // Visual line at the top of the window when soft wrapping
+    // Overview ruler, drawn in the rightmost column, which screenCols leaves out while it's on
+    int overview;
+    // Gutter drawn left of the rows, which screenCols leaves out too
+    int gutter;     // Columns it takes up
+    int diff;       // Rows are marked where they differ from the file on disk
+    int lineNumbers;    // editorLineNumbers mode
+    int numberWidth;    // Columns of the gutter taken by line numbers, enough for numrows and a space
+    char digitPairs[200];   // "00" to "99", so a line number is written two digits at a time
     // Status Bar
-    char *filename; // Filename, for status bar
     char statusmsg[80];
     time_t statusmsgTime;
-
-    struct editorSyntax *syntax;    // Ptr to current editorSyntax struct
+    // Search match overlay, drawn over the row's spans without modifying them
+    int matchRow;   // -1 when there is no match to draw
+    int matchStart;
+    int matchLen;
+    char *lastQuery;    // Last search made, NULL before the first one
+    // Bracket at the cursor and the one matching it, drawn as HL_BRACKET
+    int bracketRow[2];  // -1 when there is none to draw
+    int bracketRo[2];
+    int bracketCx, bracketCy;   // Cursor they were matched for, -1 to match them again
+    int bracketDirty;   // core->dirty when they were matched
+    int bracketWaiting; // The match may be past the exactly highlighted rows
+    // Copies also go to the terminal's clipboard, through OSC 52
+    int osc52;
+    // Panes onto the buffer, laid out by a tree of splits over the screen above the status bar
+    struct editorPane panes[TEX_MAX_PANES];
+    int numPanes;
+    int pane;       // Pane with the focus, its view is the one in E and the buffer
+    struct editorSplit splits[2 * TEX_MAX_PANES];
+    int splitRoot;
+    int areaRows, areaCols; // Screen the panes share
+    int dividers;   // Dividers and the panes' bars are drawn again, after the layout changes
+    // Colours, each class's escape built once when the theme is set
+    struct editorStyle theme[THEME_COUNT];
+    int themePlain; // HL_NORMAL is the terminal's own style, so rows needn't set it
+    // Last paste, while CTRL-Y can still swap it for an older yank
+    int pasted;     // Set until the next key
+    int pasteBack;  // Yanks back from the newest it came from
+    int pasteCx, pasteCy;   // Where it starts
+
+    struct editorStats stats;
+
+    // Headless mode, keys are read from a script and frames written to a sink instead of a terminal
+    int headless;
+    int outFd;      // Where frames are written
+    char *input;    // Scripted keys
+    int inputLen;
+    int inputPos;
+    long *inputTimes;   // When each scripted key is due, relative to inputStart. NULL to feed them at full speed
+    long inputStart;
+
+    // Event loop, sleeping in poll() until a key, signal, timer or file change needs it
+    int sigPipe[2];     // Written to by the signal handler, so a signal wakes the poll
+    int watchFd;        // inotify instance, -1 when files can't be watched
+    int watchWd;        // Watch on the file's directory, -1 when no file is watched
+    struct stat watchSt;    // The file as it was last opened or saved, to tell saves apart from other writes
+    struct editorTimer timers[TIMER_COUNT];
+
+    // Background tasks
+    int taskDirty;      // core->dirty when the tasks last looked, they start over after an edit
+    texSearchIndex search;  // Rows the current search matches, for the match count and stepping through them
+    int autosaveFd;     // Autosave being written, -1 when none is
+    int autosaveRow;    // Next row to write to it
+    int autosaveDue;    // The buffer's been left alone long enough to be autosaved
+
+    // Input trace being recorded, NULL when not recording
+    FILE *traceFp;
+    long traceLast; // When the last byte was recorded
 
     struct termios orig_termios;
 };
 
 struct editorConfig E;
 
-
-/*--------------------------------------------------------------------------
-                                 FILETYPES
---------------------------------------------------------------------------*/
-
-// Filematch extensions for C language
-char *C_HL_extensions[] = { ".c", ".h", ".cpp", NULL };
-
-// Keywords for C language
-char *C_HL_keywords[] = {
-    "switch", "if", "while", "for", "break", "continue", "return", "else",
-    "struct", "union", "typedef", "static", "enum", "class", "case",
-
-    "int|", "long|", "double|", "float|", "char|", "unsigned|", "signed|",
-    "void|", NULL
-};
-
-// Syntax Highlight database
-struct editorSyntax HLDB[] = {
-    {
-        "c",
-        C_HL_extensions,
-        C_HL_keywords,
-        "//",
-        "/*",
-        "*/",
-        HL_HIGHLIGHT_NUMBERS | HL_HIGHLIGHT_STRINGS
-    },
-};
-
-#define HLDB_ENTRIES (sizeof(HLDB) / sizeof(HLDB[0]))
-
 /*--------------------------------------------------------------------------
                                   TERMINAL
 --------------------------------------------------------------------------*/
@@ -169,6 +352,24 @@ void disableRawMode();
 */
 void die(const char *s);
 
+
+/*
+    Restores the terminal and exits when the core runs out of memory
+*/
+void editorOutOfMemory(texCore *tc, size_t size);
+
+/*
+    Reads a byte of input from the terminal, or from the scripted keys when headless
+*/
+int editorReadByte(char *c);
+
+
+/*
+    Returns true if a key is waiting to be read, without waiting for one
+*/
+int editorKeyWaiting();
+
+
 /*
     Waits for a keypress, and returns it
 */
@@ -188,92 +389,310 @@ int getCursorPosition(int *rows, int *cols);
 int getWindowSize(int *rows, int *cols);
 
 /*--------------------------------------------------------------------------
-                          SYNTAX HIGHLIGHTING
+                                EVENT LOOP
 --------------------------------------------------------------------------*/
 
 /*
-    Takes in a character and returns true if it's considered a separator character
+    Sets up the self-pipe and SIGWINCH handler, and the inotify instance for file watches
 */
-int isSeparator(int c);
+void editorEventInit();
 
 
 /*
+    Signal handler, passes the signal on to the event loop through the self-pipe
+*/
+void editorSignal(int sig);
+
+
+/*
+    Starts a timer in its slot to fire after delay microseconds, then every interval if it's
+    not 0, replacing whatever was in the slot
+*/
+void editorTimerStart(int slot, long delay, long interval, void (*fn)());
 
+
+/*
+    Stops the timer in a slot
+*/
+void editorTimerStop(int slot);
+
+
+/*
+    Returns milliseconds until the next timer is due, for poll(), or -1 when none are running
 */
-void editorUpdateSyntax(erow *row);
+int editorTimerWait();
 
 
 /*
-    Maps values in highlight to the ANSI colour code to draw them with
+    Fires the timers that are due. Returns the number fired
 */
-int editorSyntaxToColour(int highlight);
+int editorTimersRun();
 
 
 /*
-    Mathces the current filename to one of the filematch fields in the HLDB. If one matches,
-    it'll set E.syntax to that filetype
+    Watches the file being edited for changes made by other programs, remembering it as it is now.
+    Called after it's opened and each time it's saved
 */
-void editorSelectSyntaxHighlight();
+void editorWatchFile();
+
+
+/*
+    Reads the watch's events, and says so in the status bar when the file was changed or
+    deleted by something else. Returns 1 when it did
+*/
+int editorFileChanged();
+
+
+/*
+    Takes the terminal's new size, laying out again only the rows that wrap differently.
+    Called on SIGWINCH
+*/
+void editorResize();
+
+
+/*
+    Returns 1 when a background task needs to stop, because the time it was given is up or a
+    key is waiting. Tasks check it between each small piece of work
+*/
+int editorTaskYield(long deadline);
+
+
+/*
+    Returns 1 when any background task has work to do
+*/
+int editorTasksPending();
+
+
+/*
+    Gives a slice of time to the first task in priority order with work to do. Returns 1 when
+    what's on screen changed
+*/
+int editorTasksRun();
+
+
+/*
+    Starts the tasks that depend on the buffer's text over when it's been edited since they
+    last looked, and puts off the autosave
+*/
+void editorNoteEdits();
+
+
+/*
+    Task reading in the rest of a file that's still loading
+*/
+int editorLoadPending();
+int editorLoadRun(long deadline);
+
+
+/*
+    Task writing the buffer to its autosave file a chunk at a time, moving it into place once
+    it's all written
+*/
+int editorAutosavePending();
+int editorAutosaveRun(long deadline);
+
+
+/*
+    Task indexing the rows the current search matches
+*/
+int editorSearchPending();
+int editorSearchRun(long deadline);
+
+
+/*
+    Task highlighting rows ahead of the cursor's bracket until its match is found, when it's
+    further down than the exactly highlighted rows
+*/
+int editorBracketPending();
+int editorBracketRun(long deadline);
+
+
+/*
+    Task highlighting rows below the window ahead of time, so jumping down the file later shows
+    exact highlighting straight away
+*/
+int editorHighlightPending();
+int editorHighlightRun(long deadline);
+
+
+/*
+    Sleeps until a key can be read, handling signals, timers and file changes meanwhile and
+    doing background work while nothing else needs doing. Redraws the screen when any of them
+    change it. Returns straight away when headless
+*/
+void editorWaitKey();
+
+
+/*
+    Redraws a paged file's indexing progress, stopping its timer once the file is indexed
+*/
+void editorIndexProgress();
+
+
+/*
+    Marks the buffer due for an autosave, if it still has unsaved changes
+*/
+void editorAutosaveTimer();
+
+
+/*
+    Returns the autosave file's path for the file being edited, a hidden file beside it, or
+    NULL when the buffer has no name. Caller frees it
+*/
+char *editorAutosavePath();
+
+
+/*
+    Stops writing an autosave, deleting the part written. When discard is set the last
+    complete autosave is deleted as well, after a save or a deliberate quit
+*/
+void editorAutosaveStop(int discard);
+
+
+/*--------------------------------------------------------------------------
+                                  THEMES
+--------------------------------------------------------------------------*/
+
+/*
+    Appends the SGR parameters for a colour to buf, base being 30 for the foreground or 40 for
+    the background. The first 16 palette colours use the basic codes every terminal knows
+*/
+int editorThemeColour(char *buf, int size, int colour, int base);
+
+
+/*
+    Sets the style of class cls to foreground fg, background bg, and THEME_BOLD and THEME_ITALIC
+    attrs. Its escape sequence is built by the next editorThemeBuild
+*/
+void editorThemeSet(int cls, int fg, int bg, int attrs);
+
+
+/*
+    Builds every class's escape sequence, so drawing a style is a copy. Attributes no class
+    changes are left out, so the built in theme draws with the plain colour codes
+*/
+void editorThemeBuild();
+
+
+/*
+    Sets the built in 8 colour theme
+*/
+void editorThemeDefault();
+
+
+/*
+    Parses a colour, #rrggbb, a palette index, a basic colour's name or default. -1 if it isn't one
+*/
+int editorThemeParseColour(const char *s, int *colour);
+
+
+/*
+    Loads a theme file over the built in theme. Each line names a class, then any of fg=colour,
+    bg=colour, bold and italic, and # starts a comment. Colours left out are the normal style's.
+    Returns -1 and sets *line to the line number on an error, keeping the styles read before it
+*/
+int editorLoadTheme(const char *path, int *line);
 
 
 /*--------------------------------------------------------------------------
-                            ROW OPERATIONS
+                                  PANES
 --------------------------------------------------------------------------*/
 
 /*
-    Converts a chars index to a render index, loops through all chars to the left of cx,
-    to figure out how many spaces each tab takes up
+    Copies the view in E and the buffer to v, or back from it
 */
-int editorRowCxToRx(erow *row, int cx);
+void editorViewSave(struct editorView *v);
+void editorViewLoad(const struct editorView *v);
 
 
 /*
-    Coverts a render index to a char index, essentially does the opposite of editorRowCxToRx()
+    Takes an unused node of the split tree, -1 when there are none
 */
-int editorRowRxToCx(erow *row, int rx);
+int editorSplitAlloc();
 
 
 /*
-    Uses the chars string of an erow to fill in the contents of the render string
+    Lays out the panes under node over rows by cols of the screen at top, left. Halves side by
+    side share a divider column, and a pane above another has its last line for a status bar
 */
-void editorUpdateRow(erow *row);
+void editorSplitLayout(int node, int top, int left, int rows, int cols);
 
 
 /*
+    Lays out every pane over the screen the panes share, and fits the focused one's view to it
+*/
+void editorPanesLayout();
+
+
+/*
+    Sizes the window to the focused pane, less the gutter and the ruler
+*/
+void editorPaneFit();
 
+
+/*
+    Node of the split tree that is pane p
+*/
+int editorPaneNode(int p);
+
+
+/*
+    Takes the focus from the focused pane, keeping its view. The extra cursors, the selection
+    and the search match are dropped, only the focused pane has them
 */
-void editorInsertRow(int at, char *s, size_t len);
+void editorPaneBlur();
 
 
 /*
-    Frees an erow, used when deleting an erow
+    Gives pane p the focus, moving its view into E and the buffer
 */
-void editorFreeRow(erow *row);
+void editorPaneFocus(int p);
 
 
 /*
-    Deletes an erow
+    Splits the focused pane into two views of the buffer, side by side when vertical or else
+    one above the other. The focus stays in the top or left one
 */
-void editorDelRow(int at);
+void editorSplitPane(int vertical);
 
 
 /*
-    Inserts a single character into an erow, at a given position
+    Closes the focused pane, its space goes to the pane or panes it was split from, and the
+    focus to the first of them. 0 when it's the only pane
 */
-void editorRowInsertChar(erow *row, int at, int c);
+int editorClosePane();
 
 
 /*
-    Appends a string to the end of a row, used primarily the user backspaces at the
-    start of a line, appending the row to the previous one.
+    Moves the focus to the next pane, left to right and top to bottom
 */
-void editorRowAppendString(erow *row, char *s, size_t len);
+void editorNextPane();
 
 
 /*
-    Deletes a char in an erow
+    Moves the unfocused panes' views and lines along with the rows changed since the last frame,
+    so only the lines showing changed rows are drawn again
 */
-void editorRowDelChar(erow *row, int at);
+void editorPanesCatchUp();
+
+
+/*
+    Moves pane p's view into E to draw it unfocused, saving the focused one in focused. It's
+    soft wrapped only when it's as wide as the focused pane, which the layout is wrapped at
+*/
+void editorPaneEnter(struct editorPane *p, struct editorView *focused);
+
+
+/*
+    Moves pane p's view back out of E, and the focused one's in
+*/
+void editorPaneLeave(struct editorPane *p, struct editorView *focused);
+
+
+/*
+    Highlights the rows every pane shows, before any are drawn so the changes are seen by all
+*/
+void editorPanesHighlight();
 
 
 /*--------------------------------------------------------------------------
@@ -281,45 +700,107 @@ void editorRowDelChar(erow *row, int at);
 --------------------------------------------------------------------------*/
 
 /*
-    Takes a character and uses editorRowInsertChar() to insert that character into the
-    cursor's position.
+    Moves the cursor to the start of a row, and centres it in the window
 */
-void editorInsertChar(int c);
+void editorGoToRow(int at);
 
 
 /*
-    Handles Enter keypresses by inserting a new line
+    Prompts for a line number, a percentage through the file, or ^ and $ for the start and
+    end, then jumps straight to it
 */
-void editorInsertNewLine();
+void editorGoToLine();
 
 
+/*--------------------------------------------------------------------------
+                                  LAYOUT
+--------------------------------------------------------------------------*/
+
 /*
-    Uses editorRowDelChar() to delete the character to the left of the cursor
+    Returns the visual line within the current row that the cursor is on
 */
-void editorDelChar();
+int editorLayoutCursorSub();
 
 
+/*
+    Moves the cursor up or down by a number of visual lines, keeping its column on screen
+*/
+void editorLayoutMoveVisual(int delta);
 
 
-/*--------------------------------------------------------------------------
-                                 FILE IO
---------------------------------------------------------------------------*/
+/*
+    Turns soft wrap on or off
+*/
+void editorToggleSoftWrap();
+
 
 /*
-    Converts array of erow structs into a single string ready to be written to a file.
-    Returns: buf - char *buf - Caller expected to free
+    Turns the overview ruler on or off, giving its column to the rows or taking it back
 */
-char *editorRowsToString(int *buflen);
+void editorToggleOverview();
 
 
 /*
-    Opens and reads a file from disk
+    Finds the bracket matching one at or just before the cursor, unless the cursor and the
+    text haven't changed since it was last found
 */
-void editorOpen(char *filename);
+void editorMatchBrackets();
 
 
 /*
-    Writes the string returned by editorRowsToString() to disk
+    Folds the block or comment starting on the cursor's row, or unfolds it when it's folded
+*/
+void editorToggleFold();
+
+
+/*
+    Turns marking the rows that differ from the file on disk on or off, in a column of the gutter
+*/
+void editorToggleDiff();
+
+
+/*
+    Moves the cursor to the start of the next change against the file on disk, or the previous
+    one when direction is -1
+*/
+void editorJumpChange(int direction);
+
+
+/*
+    Sets the gutter's width for what it shows, and gives the columns it takes or frees to the
+    rows. Line numbers only widen it when numrows gains a digit
+*/
+void editorGutterResize();
+
+
+/*
+    Steps line numbers from off to absolute to relative to the cursor, and back off
+*/
+void editorToggleLineNumbers();
+
+
+/*
+    Catches a paged file's numrows up with its line index, and frees its rows that are far
+    from the cursor. Called before each key and each frame, when no rows are held
+*/
+void editorLargeSync();
+
+
+/*--------------------------------------------------------------------------
+                                 FILE IO
+--------------------------------------------------------------------------*/
+
+/*
+    Opens a file into the buffer, paging it in from disk with a cache of budget bytes when large
+    is set or the file is at least TEX_LARGE_FILE_MB, guessing the size of a gzip file from
+    TEX_GZIP_RATIO. Otherwise only the first slice is read, so the first screen can be drawn
+    while a background task reads the rest. Dies when it can't be opened
+*/
+void editorOpenFile(char *filename, int large, long long budget);
+
+
+/*
+    Writes the buffer to disk, prompting for a filename if it doesn't have one yet
 */
 void editorSave();
 
@@ -336,6 +817,72 @@ void editorFindCallback(char *query, int key);
 */
 void editorFind();
 
+/*--------------------------------------------------------------------------
+                              INSTRUMENTATION
+--------------------------------------------------------------------------*/
+
+
+/*
+    Returns the histogram bucket a value falls into
+*/
+int statsBucket(long value);
+
+
+/*
+    Returns the smallest value that falls into a histogram bucket
+*/
+long statsBucketValue(int bucket);
+
+
+/*
+    Adds a value to a histogram
+*/
+void statsRecord(struct statsHist *h, long value);
+
+
+/*
+    Returns the smallest value of the bucket that percent of a histogram's samples fall at or below
+*/
+long statsPercentile(struct statsHist *h, int percent);
+
+
+/*
+    Records the counters for a frame that was just written, and resets them for the next one
+*/
+void statsFrame(int bytes);
+
+
+/*
+    Writes a summary line of the count, mean, percentiles and max of a histogram to a file
+*/
+void statsSummary(FILE *fp, const char *name, struct statsHist *h);
+
+
+/*
+    Writes a summary line and the non empty buckets of a histogram to a file
+*/
+void statsDumpHist(FILE *fp, const char *name, struct statsHist *h);
+
+
+/*
+    Writes every histogram to the file named by $TEX_STATS, called on exit
+*/
+void statsDump();
+
+
+/*
+    malloc() and realloc() that count allocations for the stats overlay
+*/
+void *editorMalloc(size_t size);
+void *editorRealloc(void *ptr, size_t size);
+
+
+/*
+    Turns the stats overlay in the message bar on or off
+*/
+void editorToggleStats();
+
+
 /*--------------------------------------------------------------------------
                                APPEND BUFFER
 --------------------------------------------------------------------------*/
@@ -374,11 +921,89 @@ void abFree(struct aBuf *ab);
 void editorScroll();
 
 
+/*
+    Draws len chars of highlight class hl, emitting at most one style escape and copying the
+    chars in bulk. current_hl tracks the class the terminal is currently set to. Control chars
+    are drawn inverted, or not when the span already is
+*/
+void editorDrawSpan(struct aBuf *ab, const char *c, int len, int hl, int *current_hl, int inverted);
+
+
+/*
+    Draws cols columns of a row, starting from column colOff
+*/
+void editorDrawRow(struct aBuf *ab, erow *row, int colOff, int cols);
+
+
+/*
+    Draws how many rows a folded row hides after the end of it, when there's room
+*/
+void editorDrawFoldMarker(struct aBuf *ab, erow *row, int colOff, int cols);
+
+
+/*
+    Draws line y of the overview ruler, standing for an equal share of the file's rows. It's
+    marked for search matches or edited rows there, or else shaded for how full and how
+    commented the rows are, and inverted while they overlap the visible rows from first up to
+    last. Summed from the overview tree, so it costs the same however big the file is
+*/
+void editorDrawOverview(struct aBuf *ab, int y, int first, int last);
+
+
+/*
+    Writes n right aligned into the width chars at buf, padded with spaces, from digitPairs.
+    Only the lowest digits fit when there are more than width of them
+*/
+void editorFormatNumber(char *buf, int width, unsigned int n);
+
+
+/*
+    Writes n into buf without padding, from digitPairs, and returns the number of digits
+*/
+int editorFormatDigits(char *buf, unsigned int n);
+
+
+/*
+    Writes the escape sequence ESC [ n final into buf, or ESC [ n ; m final when m isn't
+    negative, and returns its length. Needs room for 24 chars
+*/
+int editorFormatEscape(char *buf, unsigned int n, int m, char final);
+
+
+/*
+    Number fileRow has in the gutter, counted from the cursor's row when they're relative
+*/
+unsigned int editorGutterNumber(int fileRow);
+
+
+/*
+    Draws the gutter for a line of the window, fileRow's number and how it differs from the file
+    on disk on its first line. sub is the visual line within the row, fileRow is past the last
+    row for the lines after the end of the file
+*/
+void editorDrawGutter(struct aBuf *ab, int fileRow, int sub);
+
+
 /*
     Handles drawing each row of the buffer of text being edited.
-    Current fraw a tilde ~ in each row, that row is not part of the file and can't contain text
+    Current fraw a tilde ~ in each row, that row is not part of the file and can't contain text.
+    Draws pane p's lines, all of them and the ruler when lines is NULL for the focused pane, or
+    else only those that differ from lines, which are updated
+*/
+void editorDrawRows(struct aBuf *ab, struct editorPane *p, struct editorPaneLine *lines);
+
+
+/*
+    Draws the lines of unfocused pane p that differ from when it was last drawn
+*/
+void editorDrawPane(struct aBuf *ab, struct editorPane *p);
+
+
+/*
+    Draws the dividers between panes side by side when the layout has changed, and the status
+    bars under panes when they've changed
 */
-void editorDrawRows(struct aBuf *ab);
+void editorDrawDividers(struct aBuf *ab);
 
 
 /*
@@ -418,17 +1043,158 @@ char *editorPrompt(char *prompt, void (*callback)(char *, int));
 
 
 /*
-    Allows the user move the curor using WASD keys
+    Moves the cursor at cx, cy for an arrow key, a whole multibyte char at a time.
+    Moving between lines keeps the cursor in the same screen column
+*/
+void editorStepCursor(int key, int *cx, int *cy);
+
+
+/*
+    Allows the user move the curor using the arrow keys. Moves a visual line up or down when soft
+    wrapping, and every extra cursor along with it a row at a time
 */
 void editorMoveCursor(int key);
 
 
+/*
+    Adds a cursor at every match of the last search, so typing once edits all of them
+*/
+void editorAddCursors();
+
+
+/*
+    Moves the cursor for an arrow key, selecting in the given editorSelection mode from where
+    it was if nothing is selected in that mode yet
+*/
+void editorSelectMove(int key, int mode);
+
+
+/*
+    Sends len chars of text to the terminal's clipboard as an OSC 52 escape sequence
+*/
+void editorOsc52(const char *s, long long len);
+
+
+/*
+    Yanks the selection into the yank ring, deleting it too when cutting
+*/
+void editorCopy(int cut);
+
+
+/*
+    Inserts the yank back places from the newest at the cursor, in place of the selection if
+    there is one
+*/
+void editorPasteBack(int back);
+
+
+/*
+    Inserts the newest yank at the cursor, in place of the selection if there is one
+*/
+void editorPaste();
+
+
+/*
+    Swaps the paste just made for the yank before it in the ring, going round to the newest
+    after the oldest. pasted is whether the last key pasted
+*/
+void editorYankPop(int pasted);
+
+
+/*
+    Prompts for a shell command and pipes the selected rows, or every row, through it, replacing
+    them with its output once it exits successfully. ESC or CTRL-C stops it, leaving them be
+*/
+void editorFilter();
+
+
 /*
     Waits for a keypress, then handles it
 */
 void editorProcessKeyPress();
 
 
+/*--------------------------------------------------------------------------
+                                 BENCHMARK
+--------------------------------------------------------------------------*/
+
+/*
+    Writes a synthetic C like file with a number of lines to path
+*/
+void benchGenerateFile(const char *path, int lines);
+
+
+/*
+    Append the keys for each benchmark scenario to a buffer
+*/
+void benchTypingScript(struct aBuf *ab);
+void benchPasteScript(struct aBuf *ab);
+void benchSearchScript(struct aBuf *ab);
+void benchScrollScript(struct aBuf *ab);
+void benchNumbersScript(struct aBuf *ab);
+
+
+/*
+    Sets a 24 bit theme with a background and bold keywords, the most a theme's escapes can cost
+*/
+void benchThemeTruecolour();
+
+
+/*
+    Runs the keys from a script through the editor headless, refreshing the screen after
+    each one like main() does, and prints the throughput and latency
+*/
+void benchRun(const char *name, void (*script)(struct aBuf *));
+
+
+/*
+    Opens a generated file without a terminal, and runs every benchmark scenario against it
+*/
+int benchMain(int lines);
+
+
+/*--------------------------------------------------------------------------
+                                   TRACE
+--------------------------------------------------------------------------*/
+
+/*
+    Writes an unsigned LEB128 varint, small values take a single byte
+*/
+void traceWriteVarint(FILE *fp, unsigned long value);
+
+
+/*
+    Reads an unsigned LEB128 varint, returns -1 at the end of the file
+*/
+int traceReadVarint(FILE *fp, unsigned long *value);
+
+
+/*
+    Starts recording every byte read from the terminal to a trace file, after a header
+    with the window size
+*/
+void traceStartRecording(const char *path);
+
+
+/*
+    Flushes and closes the trace file, called on exit
+*/
+void traceStopRecording();
+
+
+/*
+    Appends a byte of input to the trace, along with the microseconds since the last one
+*/
+void traceRecord(char c);
+
+
+/*
+    Replays a trace against a file without a terminal, at full speed or at the original
+    typing speed, and prints how long each stage of a frame took
+*/
+int traceReplay(const char *path, char *filename, int realtime);
+
+
 /*--------------------------------------------------------------------------
                                    INIT
 --------------------------------------------------------------------------*/
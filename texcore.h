@@ -0,0 +1,2003 @@
+#ifndef TEXCORE_H
+#define TEXCORE_H
+
+#define _DEFAULT_SOURCE
+#define _BSD_SOURCE
+#define _GNU_SOURCE
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <pthread.h>
+
+/*
+    libtexcore, the text buffer behind Tex. Holds the rows of a file along with their rendering,
+    highlighting and soft wrap layout, and edits, searches, loads and saves them. All of its state
+    lives in a texCore context passed to every call, nothing is drawn and no terminal is needed
+*/
+
+/*--------------------------------------------------------------------------
+                                DEFINTIONS
+--------------------------------------------------------------------------*/
+
+// Tab Stop Constant
+#define TEX_TAB_STOP 8
+
+// Rows highlighted above the window when jumping far past the highlighted part of the file
+#define TEX_HL_LOOKBACK 1000
+
+// Rows a batched edit highlights straight away, past this they're highlighted again when drawn or idle
+#define TEX_HL_TOUCHED 256
+
+// Rows either side of a bracket searched for its match from their own sums, before the bracket tree
+#define TEX_BRACKET_NEAR 256
+#define TEX_BRACKET_BLOCK 64        // Rows summed by each leaf of the bracket tree when it's built
+#define TEX_BRACKET_BLOCK_MAX 256   // Rows a leaf grows to with rows inserted into it before the tree is rebuilt
+
+// Rows summed by each leaf of the overview tree
+#define TEX_OVERVIEW_BLOCK 64
+
+// Rows whose visual lines are summed by each leaf of the layout tree
+#define TEX_LAYOUT_BLOCK 64
+
+// Line diff against the file on disk
+#define TEX_HASH_SEED 14695981039346656037ULL  // FNV-1a's offset basis
+#define TEX_HASH_PRIME 1099511628211ULL         // And its prime, multiplied in a word at a time
+#define TEX_DIFF_MYERS_ROWS 128     // Lines on both sides of a region small enough to diff with Myers
+#define TEX_DIFF_MAX_D 512          // Edits Myers looks for before a region is one change
+#define TEX_DIFF_MAX_CHAIN 64       // Lines more common than this are only split at in a region too big for Myers
+
+// Large-file mode, where a file is paged in from disk instead of loaded
+#define TEX_LARGE_PAGE_SIZE (256 * 1024)    // Bytes read into the page cache at a time
+#define TEX_LARGE_SCAN_CHUNK (16 * 1024 * 1024)   // Bytes each thread of the line index scan maps at a time
+#define TEX_LARGE_SCAN_THREADS 16       // Most threads the line index scan runs at once
+#define TEX_LARGE_COPY_SIZE (1024 * 1024)   // Bytes copied at a time from the old file when saving
+#define TEX_LARGE_INDEX_STRIDE 1024     // Lines between entries of the sparse line index
+#define TEX_LARGE_GAP 4096              // Rows the window grows by to reach a row before moving instead
+#define TEX_LARGE_HL_LOOKBACK 64        // TEX_HL_LOOKBACK for paged files, which are always guessed
+
+// Copies and cuts kept in the yank ring, the oldest is dropped for a new one
+#define TEX_YANK_RING 16
+
+// Bytes read from disk at a time while a file is loaded in the background
+#define TEX_LOAD_SLICE (256 * 1024)
+
+// Bytes passed to a filter command at a time, and of its output gathered up before it's added as rows
+#define TEX_FILTER_SLICE (64 * 1024)
+#define TEX_FILTER_BATCH (1024 * 1024)
+#define TEX_FILTER_GRACE_US 200000  // Time a stopped command gets to exit on SIGTERM before SIGKILL
+
+// Gzip compressed files
+#define TEX_GZIP_BUF (64 * 1024)        // Bytes of compressed data read or written at a time
+#define TEX_GZIP_WINDOW (32 * 1024)     // History deflate can refer back into, a power of 2
+#define TEX_GZIP_FAST_BITS 9            // Huffman codes up to this long are decoded by a single lookup
+#define TEX_GZIP_SPAN (4 * 1024 * 1024) // Decompressed bytes between the seek points of a paged file
+#define TEX_GZIP_RATIO 4                // Rough decompressed size of a byte of gzip, to guess a file's size
+#define TEX_DEFLATE_HASH (1 << 15)      // Buckets of the compressor's hash of 3 byte strings
+#define TEX_DEFLATE_CHAIN 16            // Earlier strings with the same hash tried for a match
+#define TEX_DEFLATE_MAX_MATCH 258
+
+enum editorHighlight {
+    HL_NORMAL = 0,  // Hightlight keywords
+    HL_COMMENT,     // Highlight comments
+    HL_MLCOMMENT,   // Highlight multiline comments
+    HL_KEYWORD,     // Highlight keywords
+    HL_TYPE,        // Highlight common types
+    HL_STRING,      // Highlight strings
+    HL_NUMBER,      // Highlight numbers
+    HL_MATCH,       // Highlights search results
+    HL_BRACKET      // Highlights the bracket matching the one at the cursor
+};
+
+// Highlight bitflags
+#define HL_HIGHLIGHT_NUMBERS (1<<0)
+#define HL_HIGHLIGHT_STRINGS (1<<1)
+
+/*--------------------------------------------------------------------------
+                                   DATA
+--------------------------------------------------------------------------*/
+
+// Contains highlighting information for a particular filetype
+struct editorSyntax {
+    char *filetype;     // Name of the full displayed in the status bar
+    char **filematch;   // array of strings that contain a pattern to match against
+    char **keywords;    // array of strings that contain a language's keywords
+    char *singleline_comment_start; // string to hold the start of single line comments, since they differ in langs
+    char *multiline_comment_start;  // string to hold the start of a multiline comment identifer
+    char *multiline_comment_end;    // string to hold the end of a multiline comment identifer
+    int flags;          // bitfield to flag whether to highlight numbers and strings for that filetype
+};
+
+
+// A run of rendered characters sharing one highlight class, chars outside of every span are HL_NORMAL
+typedef struct hlSpan {
+    int start;  // Index of the first char within render
+    int len;
+    unsigned char hl;   // editorHighlight class of the run
+} hlSpan;
+
+
+// A char that isn't drawn as a single one byte column, used to convert between chars, render and screen columns without walking the row
+typedef struct colStop {
+    int cx;     // Index of the char within chars
+    int ro;     // Index of the char within render
+    int rx;     // Column the char starts at on screen
+    unsigned char bytes;    // Length of the char within chars
+    unsigned char rBytes;   // Length of the char within render, a tab expands to spaces
+    unsigned char width;    // Columns the char takes up on screen
+} colStop;
+
+// Indices that a position within a row can be expressed in
+enum editorIndex {
+    IDX_CHARS = 0,  // Byte within chars
+    IDX_RENDER,     // Byte within render
+    IDX_COLUMN      // Column on screen
+};
+
+
+// Ways text can be selected
+enum editorSelection {
+    SEL_NONE = 0,
+    SEL_LINEAR,     // Everything from the anchor to the cursor
+    SEL_COLUMN      // The same screen columns on every row from the anchor's to the cursor's
+};
+
+
+// Stors a row of text in the editor
+typedef struct erow {
+    int idx;    // Index within the file
+    int size;
+    int rSize;  // Size of the contents of render
+    int renderShared;   // render aliases chars, set when the row needs no tab expansion
+    char *chars;
+    char *render;
+    hlSpan *spans;  // Highlighted runs of render, sorted by start
+    int numSpans;
+    int wrapLines;  // Visual lines the row takes up when soft wrapped
+    colStop *stops; // Tabs and multibyte chars, sorted by cx. NULL when every char is one byte and one column
+    int numStops;
+    unsigned char hl_open_comment;
+    unsigned char hlGuessed;    // Past hlUpTo, spans are up to date but assume no comment is open above them
+    int brDelta;    // Brackets the row opens less those it closes, outside of strings and comments
+    int brMin;      // Lowest the bracket depth gets within the row relative to its start, 0 or less
+    int foldLines;  // Rows folded away below this one, 0 when it doesn't start a fold
+    int foldUp;     // Rows up to the start of the fold hiding this one, 0 when it's visible
+    unsigned char edited;   // Changed since the file was opened or last saved
+    unsigned char ovEdited; // edited, rSize and the chars inside comments as the overview tree counts them
+    int ovText;
+    int ovComment;
+    unsigned long long hash;    // Hash of chars, compared against the lines of the file on disk
+} erow;
+
+// A run of lines in a paged file's buffer, either straight from the file or held in memory
+typedef struct texPiece {
+    long long first;    // First line of the run within the file, -1 for lines held in memory
+    long long count;    // Lines in the run
+    long long start;    // Line of the pieces the run starts at, set by largeSplice()
+    char *text;     // NULL terminated lines held in memory, a newline between each
+    long long len;
+} texPiece;
+
+// An entry of a paged file's sparse line index
+typedef struct texIndexEntry {
+    long long line;
+    long long offset;   // Offset the line starts at within the file
+} texIndexEntry;
+
+// Part of a paged file scanned for newlines by one thread, the scan stitches the chunks together
+typedef struct texScanChunk {
+    const char *data;
+    long long offset;   // Offset of data within the file
+    long long len;
+    long long lines;    // Newlines found
+    texIndexEntry *found;   // Every TEX_LARGE_INDEX_STRIDE th line, numbered from the start of the chunk
+    int numFound;
+} texScanChunk;
+
+// Decoding table of a Huffman code
+typedef struct texHuffman {
+    unsigned short fast[1 << TEX_GZIP_FAST_BITS];   // Symbol << 4 | length, indexed by the next bits of input
+    short count[16];    // Codes of each length
+    short symbol[288];  // Symbols in canonical order, for codes too long for fast
+} texHuffman;
+
+// Place a gzip stream can be decoded from without decoding what comes before it
+typedef struct texGzipPoint {
+    long long in;       // Offset of the next compressed byte
+    long long out;      // Decompressed offset
+    unsigned long long bits;    // Bits left over from the bytes before in
+    int numBits;
+    unsigned char *window;  // The TEX_GZIP_WINDOW bytes decompressed before out
+} texGzipPoint;
+
+enum gzipState {
+    GZIP_HEADER = 0,    // Expecting a member header
+    GZIP_BLOCK,         // Expecting a block header
+    GZIP_STORED,        // Copying an uncompressed block
+    GZIP_HUFFMAN,       // Decoding a compressed block
+    GZIP_TRAILER,       // Expecting a member's CRC and length
+    GZIP_DONE,
+    GZIP_ERROR
+};
+
+// Streaming gzip decompressor, reads the file with pread() so it can be moved around it
+typedef struct texGzip {
+    int fd;
+    long long in;   // Offset of the next read
+    unsigned char *buf;
+    int bufLen;
+    int bufAt;
+    unsigned long long bits;    // Input bits not used yet, the next one lowest
+    int numBits;
+
+    int state;
+    int last;       // Current block is the last of its member
+    long long stored;   // Bytes left in a stored block
+    int copyLen;    // Bytes left of a match
+    int copyDist;
+    texHuffman lit;
+    texHuffman dist;
+    unsigned char *window;  // Circular history, out indexes it
+    long long out;  // Bytes decompressed
+
+    int members;    // Members started, a file can be several gzip files concatenated
+    unsigned long crc;
+    long long memberOut;
+    int checked;    // The member was decoded from its start, so its CRC can be checked
+
+    // Seek points, recorded every span bytes when span is set
+    long long span;
+    texGzipPoint *points;
+    int numPoints;
+    long long lastPoint;
+    pthread_mutex_t *pointsLock;    // Held while adding points, when another thread reads them
+} texGzip;
+
+// Streaming gzip compressor, matches strings within its window and codes them with the fixed Huffman codes
+typedef struct texDeflate {
+    int fd;
+    unsigned char *window;  // Two TEX_GZIP_WINDOW halves, the first is history once the second fills
+    int start;      // Next byte to compress
+    int end;        // End of the input
+    int *head;      // Last position of each hash of 3 bytes
+    int *prev;      // Position before each one with the same hash
+    unsigned char *outBuf;
+    int outLen;
+    unsigned long long bits;
+    int numBits;
+    unsigned long crc;
+    long long total;    // Bytes compressed
+    long long written;  // Bytes written to fd
+    int error;
+} texDeflate;
+
+// A file being read into the buffer a slice at a time
+typedef struct texLoader {
+    int fd;
+    long long size; // Size of the file on disk
+    texGzip *gz;    // Set for a gzip file
+    char *buf;      // Slice being split into lines, the start of it a line carried over from the last slice
+    int len;
+    int cap;
+} texLoader;
+
+// Rows being piped through a shell command, streamed both ways so neither side waits on the other
+typedef struct texFilter {
+    pid_t pid;
+    int inFd, outFd, errFd; // Command's stdin, stdout and stderr, -1 once closed
+    int first, last;    // Rows being filtered, the output is added below last until the command is done
+    int next;       // Next row to write
+    char *in;       // Rows waiting to be written, from inPos up to inLen
+    int inPos, inLen, inCap;
+    char *out;      // Output not yet added as rows, ending in a partial line
+    int outLen, outCap;
+    int added;      // Rows of output added so far
+    long long bytesIn, bytesOut;
+    char err[128];  // Start of what the command wrote to stderr
+    int errLen;
+    int running;    // Cleared once its output has replaced the rows, or been dropped
+    int status;     // waitpid() status once it's exited, -1 when it was stopped or lost
+    void (*sigpipe)(int);   // SIGPIPE handler while it's ignored, a write to a command that's exited fails instead
+} texFilter;
+
+// A page of a paged file held in the cache
+typedef struct texPage {
+    long long number;   // Index of the page within the file, -1 for an empty slot
+    long long lastUsed; // Cache clock when the page was last looked up, the oldest page is evicted first
+    int len;    // Bytes read, short for the last page of the file
+    char *data;
+} texPage;
+
+/*
+    A file paged in from disk rather than loaded. Its buffer is the file's lines with the pieces
+    laid over the start of them, and a window of materialised rows laid over part of that
+*/
+typedef struct texLargeFile {
+    int fd;
+    long long size;     // Decompressed size of a gzip file, which grows as the scan gets through it
+    long long diskSize;
+
+    // Decompressors of a gzip file, one for reading pages and one for the scan
+    texGzip *gz;
+    texGzip *gzScan;
+
+    // Sparse line index, built by a background scan while the file is being edited
+    pthread_t scanThread;
+    int scanThreaded;   // The scan runs on scanThread rather than having run up front
+    pthread_mutex_t lock;   // Guards every field the scan writes
+    texIndexEntry *index;   // Sorted, at most about TEX_LARGE_INDEX_STRIDE lines apart
+    long long indexLen;
+    long long indexCap;
+    long long lines;    // Lines found so far
+    long long scanned;  // Bytes scanned so far
+    long long scannedIn;    // Bytes of a gzip file scanned so far
+    int scanDone;
+    int scanStop;   // Set to make the scan give up early
+    int scanError;  // errno the scan gave up with, the lines found before it are still indexed
+
+    // LRU page cache, sized to the memory budget
+    texPage *pages;
+    int numPages;
+    long long clock;
+
+    // Overlay of edits, the first covered lines of the file rewritten as pieces
+    texPiece *pieces;
+    int numPieces;
+    long long tableLines;   // Lines in the pieces
+    long long covered;
+
+    // Rows being viewed or edited, standing in for lines winStart on of the pieces
+    erow **win;
+    long long *winFile; // Line each row was read from, -1 once it's edited or when it wasn't read from the file
+    int winStart;
+    int winLen;
+    int winCap;
+    long long winPieceLines;    // Lines of the pieces the window stands in for
+    int winDirty;   // Edited since it was last written back to the pieces
+
+    char *line; // Scratch for reading lines that span pages
+    int lineCap;
+} texLargeFile;
+
+// Part of a yanked text, either held in memory or a run of whole lines of a paged file left on disk
+typedef struct texYankPart {
+    long long first;    // First line of the run within the file, -1 for text held in memory
+    long long count;    // Lines in the run, each followed by a newline
+    char *text;
+    long long len;      // Bytes of the part, read from the file's line index for a run
+    long long cap;
+} texYankPart;
+
+// Rows a query is found in, searched for a slice at a time so a client can build it between keys
+typedef struct texSearchIndex {
+    char *query;    // NULL when nothing is indexed
+    int *rows;      // Rows containing query, in order
+    int numRows;
+    int cap;
+    int scanned;    // Rows searched so far, it's complete once they all are
+    int matches;    // Every match, counting each one in a row
+} texSearchIndex;
+
+// Text copied or cut into the yank ring, never changed once it's made
+typedef struct texYank {
+    texYankPart *parts;
+    int numParts;
+    int partsCap;
+    long long len;  // Bytes of the whole text
+    int column;     // Copied from a column selection, so it's pasted as a block
+} texYank;
+
+// Node of the bracket tree, covering a run of rows
+typedef struct texBracketNode {
+    int sum;    // brDelta of every row in the run
+    int min;    // Lowest the bracket depth gets in the run, relative to its start
+    int rows;   // Rows in the run, a leaf's block grows and shrinks as rows are inserted and deleted
+} texBracketNode;
+
+// Node of the overview tree, summing a run of rows
+typedef struct texOverviewNode {
+    int text;       // Rendered chars
+    int comment;    // Rendered chars inside comments
+    int edited;     // Rows changed since the file was opened or last saved
+} texOverviewNode;
+
+// Lines of the file on disk replaced by rows of the buffer, one of the counts is 0 for lines added or deleted
+typedef struct texDiffHunk {
+    int base, baseCount;    // Lines of the file on disk
+    int row, rowCount;
+} texDiffHunk;
+
+// Rows changed since the client's views of the buffer last caught up, one record shared by every view
+typedef struct texViewChanges {
+    int dirty;  // Rows lo up to hi have changed
+    int lo, hi;
+    int shift;  // Rows the ones past hi have moved
+    int all;    // Every row may have changed
+} texViewChanges;
+
+// How a row differs from the file on disk
+enum editorDiffKind {
+    DIFF_NONE = 0,
+    DIFF_ADDED,
+    DIFF_CHANGED,
+    DIFF_DELETED    // Lines were deleted just above the row
+};
+
+// A cursor besides the buffer's own one at cx, cy
+typedef struct texCursor {
+    int cx, cy;
+} texCursor;
+
+// A buffer being edited, every core function takes one of these
+typedef struct texCore {
+    // Cursor position within the file, as a row and an index into its chars
+    int cx, cy;
+    // Rows
+    int numrows;
+    erow *row;
+    int dirty;      // modified since opening flag
+    char *filename;
+
+    struct editorSyntax *syntax;    // Ptr to current editorSyntax struct, NULL for no highlighting
+    int hlUpTo;     // Every row before this one is highlighted exactly, the rest are highlighted on request
+    unsigned char *hlScratch;   // One class per rendered char, shared by every row and compressed into spans
+    int hlScratchCap;
+    int hlDeferred; // Set during a batched edit, which highlights the rows it changed once at the end
+    int hlLast;     // Last row editorUpdateSyntax() highlighted, where a comment cascading down stopped
+
+    // Soft wrap layout
+    int wrapCols;   // Width rows are wrapped at, set by the client to its window width
+    int *wrapTree;  // Segment tree over the rows' wrapLines summed TEX_LAYOUT_BLOCK rows to a leaf
+    int wrapSize;   // Leaves of wrapTree, a power of 2 at least the blocks of rows
+    int wrapValid;  // wrapTree matches the rows, cleared when too many rows are moved at once
+
+    // Bracket structure, a segment tree over each row's brDelta and brMin summed a block of rows to a leaf
+    texBracketNode *brTree;
+    int brSize;     // Leaves of brTree, a power of 2 at least the blocks of rows when it was built
+    int brValid;    // brTree matches the rows, cleared when a block grows too big or every row is moved
+    int brBuilt;    // Leaves built so far while brTree isn't valid, the build is resumed from here
+    int numFolds;
+
+    // Overview, a segment tree over the rows summed TEX_OVERVIEW_BLOCK rows to a leaf
+    texOverviewNode *ovTree;
+    int ovSize;     // Leaves of ovTree, a power of 2 at least the blocks of rows
+    int ovValid;    // ovTree matches the rows, cleared when too many rows are moved at once
+
+    // Diff against the file on disk, kept as the hash of each of its lines
+    unsigned long long *diskHash;
+    int numDisk;
+    int diskCap;
+    texDiffHunk *hunks;     // Sorted, and never touching each other
+    int numHunks;
+    int hunksCap;
+    int diffDirty;  // Rows diffLo up to diffHi have changed since the hunks were found
+    int diffLo, diffHi;
+    int diffShift;  // Rows the ones past diffHi have moved since then
+    int diffAll;    // The whole file is diffed again, after the file on disk changed
+
+    // Rows changed since the client last drew, so a view it isn't redrawing draws only those again
+    texViewChanges changes;
+
+    // Counters for the client's stats, it reads and resets them
+    long hlTime;    // Microseconds spent highlighting
+    long allocs;    // Allocations made
+
+    // Set by the client, called when an allocation fails. The core can't go on if it returns
+    void (*outOfMemory)(struct texCore *tc, size_t size);
+
+    texLargeFile *large;    // Set when the file is paged in from disk, row is unused then
+    texLoader *load;    // Set while the rest of the file is still being read in
+    texFilter *filter;  // Set while rows are piped through a command, until it's freed
+    int gzip;       // File is gzip compressed, and is compressed again when saved
+    int loading;    // Set while rows read from the file are added, which aren't edits
+
+    // Extra cursors, sorted by row then column. Every edit applies at each of them in one batch
+    texCursor *cursors;
+    int numCursors;
+    int cursorsCap;
+
+    // Selection between the anchor at selCx, selCy and the cursor
+    int selMode;    // editorSelection mode, SEL_NONE when nothing is selected
+    int selCx, selCy;
+
+    // Yank ring, the newest entry just before yankNext
+    texYank yanks[TEX_YANK_RING];
+    int numYanks;
+    int yankNext;
+} texCore;
+
+
+/*--------------------------------------------------------------------------
+                                 CONTEXT
+--------------------------------------------------------------------------*/
+
+/*
+    Allocates an empty buffer with no filename, returns NULL when out of memory
+*/
+texCore *texCoreNew();
+
+
+/*
+    Frees a buffer along with every row in it
+*/
+void texCoreFree(texCore *tc);
+
+
+/*
+    Calls the client's outOfMemory for a failed allocation of size bytes, then aborts
+*/
+void texOutOfMemory(texCore *tc, size_t size);
+
+
+/*
+    malloc() and realloc() that count allocations in the buffer's counters. Running out of memory
+    isn't reported through the API, it calls the client's outOfMemory and aborts if that returns
+*/
+void *texAlloc(texCore *tc, size_t size);
+void *texRealloc(texCore *tc, void *ptr, size_t size);
+
+
+/*
+    Returns a monotonic timestamp in microseconds
+*/
+long texNow();
+
+
+/*--------------------------------------------------------------------------
+                                  UNICODE
+--------------------------------------------------------------------------*/
+
+// Code point substituted for bytes that aren't valid UTF-8, and how it's drawn
+#define UNICODE_INVALID 0xfffd
+#define UNICODE_INVALID_UTF8 "\xef\xbf\xbd"
+
+// Zero width joiner, glues the chars on either side of it into a single emoji
+#define UNICODE_ZWJ 0x200d
+
+// Inclusive range of code points
+struct unicodeRange {
+    int first;
+    int last;
+};
+
+
+/*
+    Decodes the UTF-8 sequence at the start of s into cp, and returns its length in bytes.
+    Invalid, truncated, overlong or surrogate sequences and code points past U+10FFFF decode as
+    a single byte UNICODE_INVALID
+*/
+int utf8Decode(const char *s, int len, int *cp);
+
+
+/*
+    Returns true if the code point falls inside one of the sorted ranges of a table
+*/
+int unicodeInTable(int cp, const struct unicodeRange *table, int size);
+
+
+/*
+    Returns the number of columns a code point is drawn with, 0 for combining marks and
+    2 for wide chars
+*/
+int unicodeWidth(int cp);
+
+
+/*--------------------------------------------------------------------------
+                          SYNTAX HIGHLIGHTING
+--------------------------------------------------------------------------*/
+
+/*
+    Takes in a character and returns true if it's considered a separator character
+*/
+int isSeparator(int c);
+
+
+/*
+    Compresses a per-char array of highlight classes into the row's list of spans
+*/
+void editorRowBuildSpans(texCore *tc, erow *row, unsigned char *highlight);
+
+
+/*
+    Highlights the render string of a row, and stores the result as spans. Updates the
+    next row too if this row opens or closes a multiline comment
+*/
+void editorUpdateSyntax(texCore *tc, erow *row);
+
+
+/*
+    Mathces the current filename to one of the filematch fields in the HLDB. If one matches,
+    it'll set the buffer's syntax to that filetype
+*/
+void editorSelectSyntaxHighlight(texCore *tc);
+
+
+/*
+    Highlights every row from first to last that isn't up to date. Extends the exactly
+    highlighted rows when they're close, otherwise guesses from TEX_HL_LOOKBACK rows above
+    first so a jump to the end of a huge file doesn't highlight the whole file
+*/
+void editorHighlightRows(texCore *tc, int first, int last);
+
+
+/*
+    Marks every guessed row from hlUpTo on to be highlighted again, once the comment state the
+    exact rows end with has changed under them
+*/
+void editorHighlightStale(texCore *tc);
+
+
+/*
+    Extends the exactly highlighted rows by up to n rows, less than TEX_HL_LOOKBACK, so rows a
+    client jumps to later don't have to be guessed. A buffer without a filetype is still
+    walked, for its brackets. Returns 0 once there are no more rows to highlight, or the
+    buffer is paged
+*/
+int editorHighlightAhead(texCore *tc, int n);
+
+
+/*
+    Highlights the exactly highlighted rows from first to last once a batched edit has
+    changed them, skipping any a comment cascading down from above has already reached
+*/
+void editorHighlightRange(texCore *tc, int first, int last);
+
+
+/*--------------------------------------------------------------------------
+                            ROW OPERATIONS
+--------------------------------------------------------------------------*/
+
+/*
+    Returns the start of a colStop in the given editorIndex
+*/
+int colStopStart(colStop *stop, int index);
+
+
+/*
+    Returns the length of a colStop in the given editorIndex
+*/
+int colStopLen(colStop *stop, int index);
+
+
+/*
+    Converts a position within a row from one editorIndex to another. Binary searches the
+    row's column stops for the closest one to the left of idx, and counts single byte, single
+    column chars from there. A position inside a multibyte or wide char maps to its start
+*/
+int editorRowMapIndex(erow *row, int from, int to, int idx);
+
+
+/*
+    Converts a chars index to a screen column
+*/
+int editorRowCxToRx(erow *row, int cx);
+
+
+/*
+    Coverts a screen column to a char index, essentially does the opposite of editorRowCxToRx()
+*/
+int editorRowRxToCx(erow *row, int rx);
+
+
+/*
+    Converts a screen column to a render index, used to find the visible part of render
+*/
+int editorRowRxToRo(erow *row, int rx);
+
+
+/*
+    Converts a render index to a chars index, used to place the cursor on a search match
+*/
+int editorRowRoToCx(erow *row, int ro);
+
+
+/*
+    Returns the chars index of the char after the one at cx, a multibyte char along with
+    its combining marks is stepped over as one
+*/
+int editorRowNextCx(erow *row, int cx);
+
+
+/*
+    Returns the chars index of the char before cx
+*/
+int editorRowPrevCx(erow *row, int cx);
+
+
+/*
+    Returns row at, use this rather than indexing row since a paged file reads rows in on
+    demand. Rows next to each other can be held at once, but a row may be freed when a far
+    away one is asked for
+*/
+erow *editorRowAt(texCore *tc, int at);
+
+
+/*
+    Updates the layout and highlighting of a row after its render changes. Rows past
+    hlUpTo are only marked for highlighting
+*/
+void editorRowRenderChanged(texCore *tc, erow *row);
+
+
+/*
+    Uses the chars string of an erow to fill in the contents of the render string, and builds
+    the row's column stops. Rows without tabs render byte for byte, so render is pointed at
+    chars instead of copied, and ASCII rows skip UTF-8 decoding entirely
+*/
+void editorUpdateRow(texCore *tc, erow *row);
+
+
+/*
+    Fills in a new row with a copy of the len chars of s, and renders it
+*/
+void editorInitRow(texCore *tc, erow *row, int at, char *s, size_t len);
+
+
+/*
+    Inserts a new row at index at, holding a copy of the len chars of s
+*/
+void editorInsertRow(texCore *tc, int at, char *s, size_t len);
+
+
+/*
+    Inserts a row at index at for every line of the len chars of s, split at newlines, with a
+    single move of the rows after them. They're highlighted once at the end, or left to the
+    caller during a batched edit
+*/
+void editorInsertLines(texCore *tc, int at, const char *s, long long len);
+
+
+/*
+    Frees an erow, used when deleting an erow
+*/
+void editorFreeRow(erow *row);
+
+
+/*
+    Deletes an erow
+*/
+void editorDelRow(texCore *tc, int at);
+
+
+/*
+    Deletes rows first up to last with a single move of the rows after them
+*/
+void editorDelRows(texCore *tc, int first, int last);
+
+
+/*
+    Inserts a single character into an erow, at a given position
+*/
+void editorRowInsertChar(texCore *tc, erow *row, int at, int c);
+
+
+/*
+    Appends a string to the end of a row, used primarily the user backspaces at the
+    start of a line, appending the row to the previous one.
+*/
+void editorRowAppendString(texCore *tc, erow *row, char *s, size_t len);
+
+
+/*
+    Deletes a char in an erow, along with every byte of a multibyte char
+*/
+void editorRowDelChar(texCore *tc, erow *row, int at);
+
+
+/*
+    Marks the buffer and the row as modified after the row's chars are changed
+*/
+void editorRowEdited(texCore *tc, erow *row);
+
+
+/*--------------------------------------------------------------------------
+                            EDITOR OPERATIONS
+--------------------------------------------------------------------------*/
+
+/*
+    Takes a character and uses editorRowInsertChar() to insert that character into the
+    cursor's position.
+*/
+void editorInsertChar(texCore *tc, int c);
+
+
+/*
+    Handles Enter keypresses by inserting a new line
+*/
+void editorInsertNewLine(texCore *tc);
+
+
+/*
+    Uses editorRowDelChar() to delete the character to the left of the cursor
+*/
+void editorDelChar(texCore *tc);
+
+
+/*
+    Inserts len chars of text at the cursor and moves the cursor past them. The cursor's row
+    is split once, and the lines between go in with editorInsertLines()
+*/
+void editorInsertText(texCore *tc, const char *s, long long len);
+
+
+/*--------------------------------------------------------------------------
+                            MULTIPLE CURSORS
+--------------------------------------------------------------------------*/
+
+/*
+    Orders cursors by row then column, for qsort()
+*/
+int editorCursorCmp(const void *a, const void *b);
+
+
+/*
+    Adds a cursor besides the buffer's own one. Returns -1 for a paged file, where only the
+    rows near the cursor are in memory
+*/
+int editorAddCursor(texCore *tc, int cy, int cx);
+
+
+/*
+    Removes every extra cursor, leaving the buffer's own one
+*/
+void editorClearCursors(texCore *tc);
+
+
+/*
+    Clamps the extra cursors to the text, sorts them, and merges any that ended up in the
+    same place as another or as the buffer's own cursor
+*/
+void editorNormalizeCursors(texCore *tc);
+
+
+/*
+    Adds a cursor at the start of every match of query. Returns the matches found, or -1 for
+    a paged file
+*/
+int editorAddCursorsAtMatches(texCore *tc, const char *query);
+
+
+/*
+    Returns the index of the first extra cursor on row at or after it, by binary search
+*/
+int editorFirstCursorOnRow(texCore *tc, int at);
+
+
+/*
+    Returns every cursor in order in a new array, with the buffer's own one at index primary
+*/
+texCursor *editorGatherCursors(texCore *tc, int *n, int *primary);
+
+
+/*
+    Moves the cursors back from an array made by editorGatherCursors() after editing, and frees it
+*/
+void editorScatterCursors(texCore *tc, texCursor *all, int n, int primary);
+
+
+/*
+    Highlights the exactly highlighted rows among the sorted rows a batched edit changed. A
+    row already reached by a comment cascading down from one above it isn't done again. More
+    than TEX_HL_TOUCHED rows aren't highlighted now, the exact rows end at the first of them
+*/
+void editorHighlightTouched(texCore *tc, int *rows, int n);
+
+
+/*
+    editorInsertChar(), editorInsertNewLine() and editorDelChar() at every cursor at once. Each
+    changed row is rebuilt and rendered once however many cursors it has, rows are inserted
+    or removed in a single pass over the buffer, and highlighting is deferred until every
+    row is done
+*/
+void editorCursorsInsertChar(texCore *tc, int c);
+void editorCursorsInsertNewLine(texCore *tc);
+void editorCursorsDelChar(texCore *tc);
+
+
+/*--------------------------------------------------------------------------
+                                SELECTION
+--------------------------------------------------------------------------*/
+
+/*
+    Starts selecting in an editorSelection mode, anchored at the cursor
+*/
+void editorSelectStart(texCore *tc, int mode);
+
+
+/*
+    Drops the selection, leaving the text as it is
+*/
+void editorSelectClear(texCore *tc);
+
+
+/*
+    Gets the selection's first and last rows, and where it starts and ends on them as indices
+    into chars. A column selection gives the screen columns it covers instead. Returns 0 when
+    nothing is selected
+*/
+int editorSelectionBounds(texCore *tc, int *y0, int *x0, int *y1, int *x1);
+
+
+/*
+    Gets the part of row that's selected as indices into its render, to draw it. Returns 0 when
+    none of it is
+*/
+int editorSelectionOnRow(texCore *tc, erow *row, int *start, int *end);
+
+
+/*
+    Returns the selected text in a new string of len chars, rows separated by newlines, or NULL
+    when nothing is selected. The rows of a paged file are read a block at a time
+*/
+char *editorCopySelection(texCore *tc, long long *len);
+
+
+/*
+    Deletes the selected text and drops the selection. The rows between the first and last
+    are removed with a single splice however many there are, and highlighted in one pass.
+    Returns 0 when nothing was selected
+*/
+int editorDeleteSelection(texCore *tc);
+
+
+/*
+    Indents every selected row by a tab, or dedents it by a tab or a tab stop's worth of
+    spaces. Works on the cursor's row when nothing is selected
+*/
+void editorIndentSelection(texCore *tc, int dedent);
+
+
+/*--------------------------------------------------------------------------
+                                YANK RING
+--------------------------------------------------------------------------*/
+
+/*
+    Frees the text of a yank, leaving it empty
+*/
+void editorYankFree(texYank *y);
+
+
+/*
+    Adds to the end of a yank, either len chars of text or a run of count whole lines of a
+    paged file starting at line first. Joins onto the last part when it can
+*/
+void editorYankAppend(texCore *tc, texYank *y, long long first, long long count, const char *text, long long len);
+
+
+/*
+    Yanks the selection into the ring as its newest entry. The whole lines of a paged file it
+    covers are kept as runs of the lines on disk instead of copies, so yanking most of a huge
+    file takes next to no memory. Returns 0 when nothing is selected
+*/
+int editorYank(texCore *tc);
+
+
+/*
+    Returns the entry back places before the newest one in the ring, or NULL
+*/
+texYank *editorYankAt(texCore *tc, int back);
+
+
+/*
+    Returns a yank's whole text in a new string of len chars, reading any runs of lines from disk
+*/
+char *editorYankText(texCore *tc, texYank *y, long long *len);
+
+
+/*
+    Pastes a column yank as a block, each of its lines at the cursor's screen column on the rows
+    from the cursor down, padding short rows and adding rows past the end as needed
+*/
+void editorPasteColumn(texCore *tc, texYank *y);
+
+
+/*
+    Makes pieces for the parts of a yank from *part on that are whole lines, a piece for each
+    run and each text holding its lines, stopping at one that isn't and leaving *part there. Returns the
+    number of pieces, in a new array at *pieces
+*/
+int editorYankPieces(texCore *tc, texYank *y, int *part, texPiece **pieces);
+
+
+/*
+    Inserts a yank at the cursor and moves the cursor past it. Runs of lines go back into a
+    paged file as a single splice each without being read, and a column yank is pasted as a
+    block at the cursor's screen column
+*/
+void editorPasteYank(texCore *tc, texYank *y);
+
+
+/*--------------------------------------------------------------------------
+                                  LAYOUT
+--------------------------------------------------------------------------*/
+
+/*
+    Returns the number of visual lines a row is split into when soft wrapped at wrapCols
+*/
+int editorRowWrapLines(texCore *tc, erow *row);
+
+
+/*
+    Adds sign times the wrapLines of rows first up to last to sum
+*/
+void editorLayoutAddRows(texCore *tc, int *sum, int first, int last, int sign);
+
+
+/*
+    Builds the layout tree from each row's cached wrapLines, or marks it out of date so it's
+    built when it's next needed
+*/
+void editorLayoutInvalidate(texCore *tc);
+void editorLayoutBuild(texCore *tc);
+
+
+/*
+    Recomputes a row's wrapLines after an edit, and adds the difference to the layout tree
+    in O(log n)
+*/
+void editorLayoutUpdateRow(texCore *tc, erow *row);
+
+
+/*
+    Shifts the layout tree after n rows are inserted at at, or -n deleted from it. The new rows
+    count nothing until they're measured, and every later block is moved along by the rows
+    crossing its edges, in O(blocks). Moving a whole block of rows or more rebuilds the tree
+*/
+void editorLayoutMove(texCore *tc, int at, int n);
+
+
+/*
+    Changes the width rows are wrapped at to cols. Only rows that can wrap differently are
+    measured again, those already on one line narrower than both widths are left alone, and
+    their differences are added to the layout tree
+*/
+void editorLayoutResize(texCore *tc, int cols);
+
+
+/*
+    Returns the visual line that row at starts on, the sum of the visual lines of every row
+    before it
+*/
+int editorLayoutVisualLine(texCore *tc, int at);
+
+
+/*
+    Returns the row that visual line v falls in, and sets sub to the visual line within
+    that row. Returns numrows when v is past the end of the file
+*/
+int editorLayoutRowAtVisual(texCore *tc, int v, int *sub);
+
+
+/*--------------------------------------------------------------------------
+                                STRUCTURE
+--------------------------------------------------------------------------*/
+
+/*
+    Returns 1 for an opening bracket, -1 for a closing one and 0 for anything else
+*/
+int editorBracketDelta(char c);
+
+
+/*
+    Returns the bracket delta of the render char at i, 0 when it's inside a string or comment.
+    s is the index of a span near i, moved to the span i falls in so a walk along the row in
+    either direction looks each span up once
+*/
+int editorRowBracket(erow *row, int i, int *s);
+
+
+/*
+    Sums up the brackets of a row once it's been highlighted into brDelta and brMin, and sums
+    its block of the bracket tree again in O(TEX_BRACKET_BLOCK + log n)
+*/
+void editorRowBrackets(texCore *tc, erow *row);
+
+
+/*
+    Sums the rows of a leaf of the bracket tree, starting from row lo, into it
+*/
+void editorBracketsLeaf(texCore *tc, int node, int lo);
+
+
+/*
+    Recomputes a node of the bracket tree from its two children
+*/
+void editorBracketsPull(texCore *tc, int node);
+
+
+/*
+    Returns the leaf of the bracket tree row at is in, and sets lo to the leaf's first row
+*/
+int editorBracketsFind(texCore *tc, int at, int *lo);
+
+
+/*
+    Marks the bracket tree as out of date, so it's built again from the start
+*/
+void editorBracketsInvalidate(texCore *tc);
+
+
+/*
+    Builds up to n more leaves of the bracket tree from each row's cached sums, carrying on from
+    where the last call left off. Returns whether there are more to build
+*/
+int editorBracketsBuildStep(texCore *tc, int n);
+
+
+/*
+    Builds the rest of the bracket tree in one go, in O(n)
+*/
+void editorBracketsBuild(texCore *tc);
+
+
+/*
+    Updates the bracket tree after n rows are inserted at at, or -n deleted from it. Inserted
+    rows join the leaf at is in and deleted ones leave theirs, so only those leaves are summed
+    again, and the rows after them keep their leaves. A leaf grown past TEX_BRACKET_BLOCK_MAX
+    rows has the tree built again. A build part way through keeps the leaves before at
+*/
+void editorBracketsMove(texCore *tc, int at, int n);
+
+
+/*
+    Returns the bracket depth at the start of row at, the brDelta of every row before it
+*/
+int editorBracketDepth(texCore *tc, int at);
+
+
+/*
+    Descends the bracket tree below node, whose rows start at lo and which starts at depth
+    offset, for the first row from from on, or the last row before before, where the depth
+    gets down to target or lower. Returns -1 when there's none
+*/
+int editorBracketsFirst(texCore *tc, int node, int lo, int from, int target, int offset);
+int editorBracketsLast(texCore *tc, int node, int lo, int before, int target, int offset);
+
+
+/*
+    Returns the index of the first bracket from index from taking the depth down to target, or
+    the bracket after the last place before index before the depth was down to target, when
+    the row starts at depth. -1 when there's none
+*/
+int editorRowMatchClose(erow *row, int from, int depth, int target);
+int editorRowMatchOpen(erow *row, int before, int depth, int target);
+
+
+/*
+    Finds the bracket matching the one at render index ro of row at. Whole rows are stepped over
+    with their sums, then with the bracket tree past TEX_BRACKET_NEAR rows, only the rows the
+    brackets are on are read. Returns 1 and sets matchRow and matchRo, 0 when there's no
+    bracket there or it isn't matched, or -1 when the match may be past the exactly highlighted
+    rows or the tree is out of date. Always 0 for a paged file
+*/
+int editorMatchBracket(texCore *tc, int at, int ro, int *matchRow, int *matchRo);
+
+
+/*
+    Does the work a -1 from editorMatchBracket() or editorFoldAt() is waiting on, building up to
+    n more leaves of the bracket tree or highlighting up to n more rows. Returns whether there
+    may be more to do
+*/
+int editorBracketsAhead(texCore *tc, int n);
+
+
+/*
+    Folds the {} block opened on row at, or the multiline comment started on it, down to the
+    row it closes on. Returns the rows folded, 0 when there's nothing to fold, or -1 when the
+    end may be past the exactly highlighted rows
+*/
+int editorFoldAt(texCore *tc, int at);
+
+
+/*
+    Hides rows head + 1 up to last under row head, unfolding any folds inside them first
+*/
+int editorFoldRows(texCore *tc, int head, int last);
+
+
+/*
+    Unfolds the fold started by row at, returns the rows shown again
+*/
+int editorUnfold(texCore *tc, int at);
+void editorUnfoldAll(texCore *tc);
+
+
+/*
+    Unfolds whatever fold hides row at, and every fold with a row from first up to last. Called
+    before rows are inserted or deleted among them
+*/
+void editorFoldReveal(texCore *tc, int at);
+void editorUnfoldRows(texCore *tc, int first, int last);
+
+
+/*
+    Returns the row n visible rows after at, or before it when n is negative, jumping each fold
+    in one step. Stays within row 0 and the tilde line at numrows
+*/
+int editorFoldStep(texCore *tc, int at, int n);
+
+
+/*
+    Returns the visible rows from first up to last, counting no further than limit
+*/
+int editorFoldCount(texCore *tc, int first, int last, int limit);
+
+
+/*--------------------------------------------------------------------------
+                                 OVERVIEW
+--------------------------------------------------------------------------*/
+
+/*
+    Adds the counts of rows first up to last to sum, or takes them away when sign is -1
+*/
+void editorOverviewAddRows(texCore *tc, texOverviewNode *sum, int first, int last, int sign);
+
+
+/*
+    Sets a node of the overview tree to the sum of its two children
+*/
+void editorOverviewPull(texCore *tc, int node);
+
+
+/*
+    Counts the row again after it's rendered, highlighted or marked edited, and updates its leaf
+    of the overview tree and the nodes above it
+*/
+void editorOverviewRow(texCore *tc, erow *row);
+
+
+/*
+    Builds the overview tree from each row's cached counts, or marks it out of date so it's
+    built when it's next needed
+*/
+void editorOverviewInvalidate(texCore *tc);
+void editorOverviewBuild(texCore *tc);
+
+
+/*
+    Shifts the tree's blocks after rows from at on moved n rows down, or up when n is negative.
+    Called once numrows is updated, before the n rows inserted at at are filled in. Only the
+    rows crossing each block's edges are read, unless n is a whole block or more
+*/
+void editorOverviewMove(texCore *tc, int at, int n);
+
+
+/*
+    Sets sum to the counts of rows first up to last, from the tree's nodes and the rows of the
+    blocks at either end. Empty for a paged file
+*/
+void editorOverviewSum(texCore *tc, int first, int last, texOverviewNode *sum);
+
+
+/*
+    Marks every row unedited, after the file is saved
+*/
+void editorOverviewSaved(texCore *tc);
+
+
+/*--------------------------------------------------------------------------
+                                   DIFF
+--------------------------------------------------------------------------*/
+
+/*
+    Hashes a line of len bytes, a word at a time, for comparing rows against the file on disk
+*/
+unsigned long long editorHashLine(const char *s, int len);
+
+
+/*
+    Adds a line's hash to the end of the file on disk, as the file is loaded
+*/
+void editorDiffAddBase(texCore *tc, unsigned long long hash);
+
+
+/*
+    Takes the rows as the file on disk, after it's opened or saved
+*/
+void editorDiffSetBase(texCore *tc);
+
+
+/*
+    Reads the file on disk again, after another program changed it, and diffs the whole file
+    against it when it's next updated. -1 if it couldn't be read, or is still being loaded
+*/
+int editorDiffReadBase(texCore *tc);
+
+
+/*
+    Marks the whole file to be diffed again when the diff is next updated
+*/
+void editorDiffInvalidate(texCore *tc);
+
+
+/*
+    Records that rows first up to oldEnd were replaced by rows first up to newEnd, so only they
+    and the hunks touching them are diffed again
+*/
+void editorDiffSpan(texCore *tc, int first, int oldEnd, int newEnd);
+
+
+/*
+    Appends a hunk to a growing array of them
+*/
+void editorDiffAddHunk(texCore *tc, texDiffHunk **hunks, int *num, int *cap, int base, int baseCount, int row, int rowCount);
+
+
+/*
+    Diffs lines a0 up to a1 of the file on disk against rows b0 up to b1 with Myers' algorithm,
+    adding a hunk for each line added or deleted. 0 without adding any if it takes more than
+    TEX_DIFF_MAX_D of them
+*/
+int editorDiffMyers(texCore *tc, int a0, int a1, int b0, int b1, texDiffHunk **hunks, int *num, int *cap);
+
+
+/*
+    qsort() comparison of hunks, by row then line of the file on disk
+*/
+int editorDiffCompare(const void *a, const void *b);
+
+
+/*
+    Diffs lines a0 up to a1 of the file on disk against rows b0 up to b1 into hunks, sorted
+    and joined, and returns how many. Regions are split at lines once on both sides, as
+    patience diff does, or else at the row whose line is rarest on disk, as histogram diff
+    does, until they're small enough for Myers
+*/
+int editorDiffRegion(texCore *tc, int a0, int a1, int b0, int b1, texDiffHunk **hunks, int *cap);
+
+
+/*
+    Diffs the rows changed since the last update, along with the hunks they touch, and splices
+    the result into the hunks. 1 if anything was diffed
+*/
+int editorDiffUpdate(texCore *tc);
+
+
+/*
+    Index of the first hunk ending past row at, or deleting lines just above it
+*/
+int editorDiffFindRow(texCore *tc, int at);
+
+
+/*
+    editorDiffKind of row at, by the hunks as they were last updated
+*/
+int editorDiffAt(texCore *tc, int at);
+
+
+/*
+    Index of the next hunk starting after row from, or the previous one starting before it when
+    direction is -1, wrapping around the file. -1 when nothing differs
+*/
+int editorDiffFind(texCore *tc, int from, int direction);
+
+
+/*--------------------------------------------------------------------------
+                                  VIEWS
+--------------------------------------------------------------------------*/
+
+/*
+    Records that rows first up to oldEnd were replaced by rows first up to newEnd, or had their
+    highlighting changed when the ends are the same, for every view showing them
+*/
+void editorViewsSpan(texCore *tc, int first, int oldEnd, int newEnd);
+
+
+/*
+    Marks every row as changed, after the buffer is filled from a file
+*/
+void editorViewsInvalidate(texCore *tc);
+
+
+/*
+    Copies the changes recorded since the last call into changes, and starts recording afresh
+*/
+void editorViewsTake(texCore *tc, texViewChanges *changes);
+
+
+/*
+    Where a row drawn before changes is now, or -1 if the row itself changed
+*/
+int editorViewsMapRow(const texViewChanges *changes, int row);
+
+
+/*--------------------------------------------------------------------------
+                                  FILTER
+--------------------------------------------------------------------------*/
+
+/*
+    Starts piping rows first to last through command, run by /bin/sh, after loading the rest of
+    the file. A paged file's lines must all be counted. A last past the end takes every row from
+    first on. Its output goes in as rows below last as it comes, and replaces the rows once it
+    exits successfully. Returns -1 with errno set when it can't be started. The editor's own
+    files are opened close-on-exec, so the command gets only the three pipes
+*/
+int editorFilterStart(texCore *tc, const char *command, int first, int last);
+
+
+/*
+    Fills in with the next slice of rows to write, a whole number of them with a newline after
+    each. Returns its length, 0 once every row is written
+*/
+int editorFilterFill(texCore *tc);
+
+
+/*
+    Adds the len chars of s as rows below the output added so far, split at newlines
+*/
+void editorFilterAdd(texCore *tc, const char *s, long long len);
+
+
+/*
+    Adds every whole line of the output read so far, keeping the partial one at the end
+*/
+void editorFilterFlush(texCore *tc);
+
+
+/*
+    Closes the pipes, and replaces the rows with the output when ok or else drops the output
+*/
+void editorFilterEnd(texCore *tc, int ok);
+
+
+/*
+    Writes what the command's stdin will take and reads what's waiting on its stdout and stderr,
+    without blocking. Output is added a batch of whole lines at a time, so neither the rows nor
+    the output are ever copied whole. Returns 1 while it's running, 0 once it's done
+*/
+int editorFilterPump(texCore *tc);
+
+
+/*
+    Stops the command, dropping the output added so far and keeping the rows. It gets
+    TEX_FILTER_GRACE_US to exit on SIGTERM, then its whole process group is killed
+*/
+void editorFilterCancel(texCore *tc);
+
+
+/*
+    Frees the finished filter, once its status has been read
+*/
+void editorFilterFree(texCore *tc);
+
+
+/*--------------------------------------------------------------------------
+                                  SEARCH
+--------------------------------------------------------------------------*/
+
+/*
+    Searches the rows after from for query, stepping in direction (1 or -1) and wrapping
+    around the ends of the file. Returns the row of the first match and sets ro to its
+    render index, or returns -1 when no row contains query
+*/
+int editorFindNext(texCore *tc, const char *query, int from, int direction, int *ro);
+
+
+/*
+    Starts indexing the rows query is found in, dropping what was indexed before. A NULL query,
+    or a paged file, leaves the index empty
+*/
+void editorSearchIndexStart(texCore *tc, texSearchIndex *ix, const char *query);
+
+
+/*
+    Searches up to n more rows for the index's query. Returns 1 while there are rows left
+*/
+int editorSearchIndexStep(texCore *tc, texSearchIndex *ix, int n);
+
+
+/*
+    Returns 1 when every row has been searched for the index's query
+*/
+int editorSearchIndexDone(texCore *tc, texSearchIndex *ix);
+
+
+/*
+    Returns the first indexed row after from in direction (1 or -1), wrapping around the ends
+    of the file like editorFindNext(), or -1 when there are none. Only for a complete index
+*/
+int editorSearchIndexFind(texSearchIndex *ix, int from, int direction);
+
+
+/*
+    Returns the rows indexed so far from first up to last
+*/
+int editorSearchIndexCount(texSearchIndex *ix, int first, int last);
+
+
+/*
+    Frees the index, leaving it empty
+*/
+void editorSearchIndexFree(texSearchIndex *ix);
+
+
+/*--------------------------------------------------------------------------
+                                 FILE IO
+--------------------------------------------------------------------------*/
+
+/*
+    Converts array of erow structs into a single string ready to be written to a file. Not
+    for paged files, which may not fit in memory.
+    Returns: buf - char *buf - Caller expected to free
+*/
+char *editorRowsToString(texCore *tc, int *buflen);
+
+
+/*
+    Opens and reads a file from disk into the end of the buffer, and detects its filetype.
+    Returns -1 with errno set when the file can't be opened
+*/
+int editorOpen(texCore *tc, char *filename);
+
+
+/*
+    Opens a file to be read into the buffer by editorLoadMore(), so a client can show the
+    start of it while the rest loads. Returns -1 with errno set when the file can't be opened
+*/
+int editorOpenStart(texCore *tc, char *filename);
+
+
+/*
+    Reads about bytes more of the file being loaded, decompressing a gzip file, and appends its
+    complete lines to the buffer. Returns 1 while there's more to read, 0 once the file is loaded
+    and load is freed, or -1 with errno set on a read error. A paged file returns -1 once its
+    line scan has failed
+*/
+int editorLoadMore(texCore *tc, long long bytes);
+
+
+/*
+    Closes the file being loaded and frees load
+*/
+void editorLoadDone(texCore *tc);
+
+
+/*
+    Returns how much of the file being loaded has been read, as a percentage of its size on disk
+*/
+int editorLoadProgress(texCore *tc);
+
+
+/*
+    Writes the string returned by editorRowsToString() to the buffer's filename, and clears
+    dirty. Gzip files, and files named .gz, are compressed as the rows are written. Finishes
+    loading the file first. Returns the number of bytes written, or -1 with errno set on an
+    I/O error
+*/
+long long editorWriteFile(texCore *tc);
+
+
+/*
+    Writes the rows to fd through a compressor, a row at a time. Returns the compressed size or -1
+*/
+long long editorWriteGzip(texCore *tc, int fd);
+
+
+/*--------------------------------------------------------------------------
+                                   GZIP
+--------------------------------------------------------------------------*/
+
+/*
+    Fills in the CRC-32 table and the fixed Huffman codes, run once
+*/
+void gzipInit();
+
+
+/*
+    Reverses the order of the low len bits of code, Huffman codes are sent most significant
+    bit first and everything else least
+*/
+unsigned int gzipReverse(unsigned int code, int len);
+
+
+/*
+    Updates a CRC-32 with len more bytes
+*/
+unsigned long gzipCrc(unsigned long crc, const unsigned char *s, long long len);
+
+
+/*
+    Returns true if a file starts with the gzip magic bytes
+*/
+int editorIsGzip(const char *filename);
+
+
+/*
+    Returns true if the buffer is saved compressed, when it was opened from a gzip file or
+    is named .gz
+*/
+int editorSaveCompressed(texCore *tc);
+
+
+/*
+    Allocates a decompressor reading the gzip stream in fd from the start, returns NULL when out
+    of memory. The fd isn't closed by gzipClose()
+*/
+texGzip *gzipOpen(int fd);
+void gzipClose(texGzip *gz);
+
+
+/*
+    Moves a decompressor back to the start of the stream, its seek points are kept
+*/
+void gzipReset(texGzip *gz);
+
+
+/*
+    Returns the next byte of input, or -1 at EOF
+*/
+int gzipByte(texGzip *gz);
+
+
+/*
+    Reads the next byte from a byte boundary, taking whole bytes left in the bit buffer first
+*/
+int gzipAlignedByte(texGzip *gz);
+
+
+/*
+    Drops the bits up to the next byte boundary
+*/
+void gzipAlign(texGzip *gz);
+
+
+/*
+    Makes sure at least n bits are in the bit buffer, returns 0 when the input runs out first
+*/
+int gzipNeed(texGzip *gz, int n);
+
+
+/*
+    Takes the next n bits of input, returns -1 when the input runs out
+*/
+int gzipBits(texGzip *gz, int n);
+
+
+/*
+    Builds the decoding table of the canonical Huffman code with the given code lengths,
+    returns -1 when the lengths are oversubscribed
+*/
+int gzipBuild(texHuffman *h, const unsigned char *lengths, int n);
+
+
+/*
+    Decodes the next symbol of a Huffman code, returns -1 on bad or missing input
+*/
+int gzipDecode(texGzip *gz, texHuffman *h);
+
+
+/*
+    Builds the fixed literal and distance tables, or reads the dynamic ones of a block
+*/
+int gzipTables(texGzip *gz, int dynamic);
+
+
+/*
+    Reads a member header. Returns 1, 0 when there are no more members, or -1 when it's bad
+*/
+int gzipHeader(texGzip *gz);
+
+
+/*
+    Records a seek point at the current block boundary
+*/
+void gzipAddPoint(texGzip *gz);
+
+
+/*
+    Moves a decompressor to a seek point
+*/
+void gzipSeek(texGzip *gz, texGzipPoint *point);
+
+
+/*
+    Decompresses up to len bytes into out. Returns the bytes decompressed, 0 at the end of the
+    stream, or -1 with errno set to EINVAL when the stream is corrupt
+*/
+int gzipRead(texGzip *gz, char *out, int len);
+
+
+/*
+    Allocates a compressor writing to fd, and queues the gzip header. Returns NULL when out of
+    memory. The fd isn't closed by gzipFinish()
+*/
+texDeflate *gzipWriterOpen(int fd);
+void gzipWriterClose(texDeflate *z);
+
+
+/*
+    Writes the compressed bytes queued so far to fd
+*/
+void gzipFlushOut(texDeflate *z);
+
+
+/*
+    Queues n bits of output, least significant bit first
+*/
+void gzipPutBits(texDeflate *z, unsigned int value, int n);
+
+
+/*
+    Queues a literal or length symbol, or a match of len bytes dist back, in the fixed codes
+*/
+void gzipPutLiteral(texDeflate *z, int sym);
+void gzipPutMatch(texDeflate *z, int len, int dist);
+
+
+/*
+    Compresses the input in the window as one block, leaving a match's worth of lookahead
+    unless flush is set
+*/
+void gzipCompress(texDeflate *z, int flush);
+
+
+/*
+    Moves the second half of the window to the first once it's full
+*/
+void gzipSlide(texDeflate *z);
+
+
+/*
+    Compresses len more bytes, returns -1 once a write has failed
+*/
+int gzipWrite(texDeflate *z, const char *s, long long len);
+
+
+/*
+    Compresses what's left, writes the trailer and frees the compressor. Returns the compressed
+    size, or -1 when a write failed
+*/
+long long gzipFinish(texDeflate *z);
+
+
+/*--------------------------------------------------------------------------
+                                LARGE FILES
+--------------------------------------------------------------------------*/
+
+/*
+    Opens a file to be paged in from disk rather than loaded, for files bigger than memory.
+    Only pages of up to budget bytes are cached, and only rows near the ones asked for are
+    materialised. Lines are indexed by a background scan, so numrows grows until it's done.
+    Returns -1 with errno set when the file can't be opened
+*/
+int largeOpen(texCore *tc, char *filename, long long budget);
+
+
+/*
+    Stops the scan and frees everything held for a paged file
+*/
+void largeFree(texCore *tc);
+
+
+/*
+    Scan thread, counts the file's lines and records the offset of every
+    TEX_LARGE_INDEX_STRIDE th one. Maps the file a round at a time, splits each round into a
+    chunk per core, and scans the chunks in parallel before stitching them onto the index
+*/
+void *largeScan(void *arg);
+
+
+/*
+    largeScan() for gzip files, decompresses the file a slice at a time and scans each slice,
+    recording seek points as it goes
+*/
+void *largeScanGzip(void *arg);
+
+
+/*
+    Adds the lines a chunk found to the index, numbered on from lines. Called with lock held.
+    Returns -1 when the index can't grow, leaving it as it was
+*/
+int largeAddChunk(texLargeFile *lf, texScanChunk *chunk, long long lines);
+
+
+/*
+    Counts the newlines in a texScanChunk with memchr(), recording the start of every
+    TEX_LARGE_INDEX_STRIDE th line. Runs on its own thread
+*/
+void *largeScanChunk(void *arg);
+
+
+/*
+    Catches numrows up with the scan, and frees the rows outside of first to last. Called
+    by the client between edits, when it holds no rows
+*/
+void largeSync(texCore *tc, int first, int last);
+
+
+/*
+    Returns how much of the file the scan has indexed, as a percentage of its size on disk
+*/
+int largeProgress(texCore *tc);
+
+
+/*
+    Returns -1 with errno set if the scan gave up on an error, otherwise 0
+*/
+int largeScanFailed(texCore *tc);
+
+
+/*
+    Returns the page of the file with the given number and sets len to the bytes in it,
+    reading it in over the least recently used page when it isn't cached
+*/
+char *largePage(texCore *tc, long long number, int *len);
+
+
+/*
+    Returns the offset of a line of the file, from the closest indexed line above it found
+    by binary search
+*/
+long long largeLineOffset(texCore *tc, long long line);
+
+
+/*
+    Reads the line starting at offset and moves offset past it. Returns the line without
+    its line ending in a scratch buffer, and sets len to its length. Returns NULL at EOF
+*/
+char *largeReadLine(texCore *tc, long long *offset, int *len);
+
+
+/*
+    Maps a row outside of the window to its line within the pieces
+*/
+long long largeTableLine(texCore *tc, int at);
+
+
+/*
+    Adds lines of the file to the end of the pieces until they hold line
+*/
+void largeExtendTable(texCore *tc, long long line);
+
+
+/*
+    Returns the piece holding a line of the pieces, and sets within to the line's index within
+    it, in O(log n) from where each piece starts. Returns numPieces for a line past the end
+*/
+int largePieceAt(texCore *tc, long long line, long long *within);
+
+
+/*
+    Returns where the line n lines on from the one starting at s starts in a piece's lines held
+    in memory, or the end of its text when n runs past its last line
+*/
+char *largePieceSkip(texPiece *piece, char *s, long long n);
+
+
+/*
+    Splits the piece holding a line of the pieces so a piece starts at it, and returns that piece
+*/
+int largeSplit(texCore *tc, long long line);
+
+
+/*
+    Replaces lines first to last of the pieces with n new pieces, and sets where each piece
+    from them on starts
+*/
+void largeSplice(texCore *tc, long long first, long long last, texPiece *pieces, int n);
+
+
+/*
+    Reads count rows starting at row at into rows, and the lines they came from into
+    fileLines. The rows must all be on the same side of the window
+*/
+void largeLoadRows(texCore *tc, int at, int count, erow **rows, long long *fileLines);
+
+
+/*
+    Writes the window's rows back into the pieces if they've been edited
+*/
+void largeFlushWindow(texCore *tc);
+
+
+/*
+    Grows the window's arrays to hold n rows
+*/
+void largeWindowReserve(texCore *tc, int n);
+
+
+/*
+    Writes the window back into the pieces and frees its rows, leaving it empty at row at
+*/
+void largeWindowDrop(texCore *tc, int at);
+
+
+/*
+    Makes the window hold rows first to last, growing it when it's close and moving it when
+    it isn't. The rows held before are freed when it moves
+*/
+void largeWindowCover(texCore *tc, int first, int last);
+
+
+/*
+    Keeps the window over row at while rows up to last are walked through in order, reading
+    them TEX_LARGE_GAP at a time and freeing the ones behind, so walking a huge range of rows
+    doesn't hold all of them at once
+*/
+void largeWalkRows(texCore *tc, int at, int last);
+
+
+/*
+    editorRowAt(), editorInsertRow(), editorDelRow() and editorRowEdited() for paged files
+*/
+erow *largeRowAt(texCore *tc, int at);
+void largeInsertRow(texCore *tc, int at, char *s, size_t len);
+void largeDelRow(texCore *tc, int at);
+void largeRowEdited(texCore *tc, erow *row);
+
+
+/*
+    Inserts rows at index at for pieces, file runs or lines held in memory, with a single splice
+*/
+void largeInsertPieces(texCore *tc, int at, texPiece *pieces, int n);
+
+
+/*
+    Appends rows first up to last to a yank, as runs of the file's lines wherever they haven't
+    been edited and copies of the lines that have
+*/
+void largeYankLines(texCore *tc, texYank *y, int first, int last);
+
+
+/*
+    editorInsertLines() and editorDelRows() for paged files. Either is a single splice of the
+    pieces, however many lines it covers, so cutting a million lines doesn't read any of them
+*/
+void largeInsertLines(texCore *tc, int at, const char *s, long long len, int n);
+void largeDelRows(texCore *tc, int first, int last);
+
+
+/*
+    Returns the first or last row from first to last that contains query, or -1. Lines
+    outside the window are searched straight from the pages without being materialised
+*/
+int largeFindInRows(texCore *tc, const char *query, int first, int last, int wantLast);
+
+
+/*
+    editorFindNext() for paged files
+*/
+int largeFind(texCore *tc, const char *query, int from, int direction, int *ro);
+
+
+/*
+    Reads len bytes of the file at offset into buf. A gzip file is decompressed through gz,
+    which starts from the closest seek point when offset is behind it or far ahead of it.
+    Returns the bytes read, or -1
+*/
+long long largeRead(texCore *tc, texGzip *gz, char *buf, long long len, long long offset);
+
+
+/*
+    Writes to fd, through z when the file is compressed. Returns 0 on an I/O error
+*/
+int largeWrite(texDeflate *z, int fd, const char *s, long long len);
+
+
+/*
+    Copies bytes from to to of the file into fd, adding a newline if they don't end with one.
+    Adds the bytes written to total, and returns 0 on an I/O error
+*/
+int largeCopyLines(texCore *tc, texGzip *gz, texDeflate *z, int fd, char *buf, long long from, long long to,
+    long long *total);
+
+
+/*
+    Writes the buffer to a temporary file next to it, copying unedited lines straight from
+    the old file, then renames it over the old one. The old file stays open, so the pieces
+    still point into it. Gzip files are compressed again as they're written. Returns the number
+    of bytes written, or -1 with errno set
+*/
+long long largeWriteFile(texCore *tc);
+
+
+#endif
@@ -0,0 +1,159 @@
+#include "texcore.h"
+
+
+/*--------------------------------------------------------------------------
+                                  UNICODE
+--------------------------------------------------------------------------*/
+
+/*
+    The width tables are kept by hand from Unicode 13.0, UnicodeData.txt for the zero width general
+    categories and EastAsianWidth.txt for the W and F chars, with emoji presentation added
+*/
+
+// Combining marks, joiners and variation selectors, drawn on top of the char before them (Unicode Mn, Me & Cf)
+static const struct unicodeRange UNICODE_ZERO_WIDTH[] = {
+    { 0x0300, 0x036f }, { 0x0483, 0x0489 }, { 0x0591, 0x05bd }, { 0x05bf, 0x05bf },
+    { 0x05c1, 0x05c2 }, { 0x05c4, 0x05c5 }, { 0x05c7, 0x05c7 }, { 0x0600, 0x0605 },
+    { 0x0610, 0x061a }, { 0x061c, 0x061c }, { 0x064b, 0x065f }, { 0x0670, 0x0670 },
+    { 0x06d6, 0x06dd }, { 0x06df, 0x06e4 }, { 0x06e7, 0x06e8 }, { 0x06ea, 0x06ed },
+    { 0x070f, 0x070f }, { 0x0711, 0x0711 }, { 0x0730, 0x074a }, { 0x07a6, 0x07b0 },
+    { 0x07eb, 0x07f3 }, { 0x0816, 0x0819 }, { 0x081b, 0x0823 }, { 0x0825, 0x0827 },
+    { 0x0829, 0x082d }, { 0x0859, 0x085b }, { 0x08d3, 0x0902 }, { 0x093a, 0x093a },
+    { 0x093c, 0x093c }, { 0x0941, 0x0948 }, { 0x094d, 0x094d }, { 0x0951, 0x0957 },
+    { 0x0962, 0x0963 }, { 0x0981, 0x0981 }, { 0x09bc, 0x09bc }, { 0x09c1, 0x09c4 },
+    { 0x09cd, 0x09cd }, { 0x09e2, 0x09e3 }, { 0x0a01, 0x0a02 }, { 0x0a3c, 0x0a3c },
+    { 0x0a41, 0x0a51 }, { 0x0a70, 0x0a71 }, { 0x0a75, 0x0a75 }, { 0x0a81, 0x0a82 },
+    { 0x0abc, 0x0abc }, { 0x0ac1, 0x0ac8 }, { 0x0acd, 0x0acd }, { 0x0ae2, 0x0ae3 },
+    { 0x0b01, 0x0b01 }, { 0x0b3c, 0x0b3c }, { 0x0b3f, 0x0b3f }, { 0x0b41, 0x0b44 },
+    { 0x0b4d, 0x0b4d }, { 0x0b56, 0x0b56 }, { 0x0b62, 0x0b63 }, { 0x0b82, 0x0b82 },
+    { 0x0bc0, 0x0bc0 }, { 0x0bcd, 0x0bcd }, { 0x0c00, 0x0c00 }, { 0x0c3e, 0x0c40 },
+    { 0x0c46, 0x0c56 }, { 0x0c62, 0x0c63 }, { 0x0cbc, 0x0cbc }, { 0x0ccc, 0x0ccd },
+    { 0x0ce2, 0x0ce3 }, { 0x0d00, 0x0d01 }, { 0x0d41, 0x0d44 }, { 0x0d4d, 0x0d4d },
+    { 0x0d62, 0x0d63 }, { 0x0dca, 0x0dca }, { 0x0dd2, 0x0dd6 }, { 0x0e31, 0x0e31 },
+    { 0x0e34, 0x0e3a }, { 0x0e47, 0x0e4e }, { 0x0eb1, 0x0eb1 }, { 0x0eb4, 0x0ebc },
+    { 0x0ec8, 0x0ecd }, { 0x0f18, 0x0f19 }, { 0x0f35, 0x0f35 }, { 0x0f37, 0x0f37 },
+    { 0x0f39, 0x0f39 }, { 0x0f71, 0x0f7e }, { 0x0f80, 0x0f84 }, { 0x0f86, 0x0f87 },
+    { 0x0f8d, 0x0fbc }, { 0x0fc6, 0x0fc6 }, { 0x102d, 0x1030 }, { 0x1032, 0x1037 },
+    { 0x1039, 0x103a }, { 0x103d, 0x103e }, { 0x1058, 0x1059 }, { 0x105e, 0x1060 },
+    { 0x1160, 0x11ff }, { 0x135d, 0x135f }, { 0x1712, 0x1714 }, { 0x1732, 0x1734 },
+    { 0x17b4, 0x17b5 }, { 0x17b7, 0x17bd }, { 0x17c6, 0x17c6 }, { 0x17c9, 0x17d3 },
+    { 0x180b, 0x180e }, { 0x18a9, 0x18a9 }, { 0x1920, 0x1922 }, { 0x1a17, 0x1a18 },
+    { 0x1ab0, 0x1aff }, { 0x1b00, 0x1b03 }, { 0x1b34, 0x1b34 }, { 0x1b36, 0x1b3a },
+    { 0x1b6b, 0x1b73 }, { 0x1dc0, 0x1dff }, { 0x200b, 0x200f }, { 0x202a, 0x202e },
+    { 0x2060, 0x2064 }, { 0x20d0, 0x20f0 }, { 0x2cef, 0x2cf1 }, { 0x2de0, 0x2dff },
+    { 0x302a, 0x302d }, { 0x3099, 0x309a }, { 0xa66f, 0xa672 }, { 0xa674, 0xa67d },
+    { 0xa69e, 0xa69f }, { 0xa6f0, 0xa6f1 }, { 0xa802, 0xa802 }, { 0xa806, 0xa806 },
+    { 0xa80b, 0xa80b }, { 0xa825, 0xa826 }, { 0xa8c4, 0xa8c5 }, { 0xa8e0, 0xa8f1 },
+    { 0xfb1e, 0xfb1e }, { 0xfe00, 0xfe0f }, { 0xfe20, 0xfe2f }, { 0xfeff, 0xfeff },
+    { 0xfff9, 0xfffb }, { 0x1d167, 0x1d169 }, { 0x1d173, 0x1d182 }, { 0x1d185, 0x1d18b },
+    { 0x1d1aa, 0x1d1ad }, { 0x1f3fb, 0x1f3ff }, { 0xe0001, 0xe0001 }, { 0xe0020, 0xe007f },
+    { 0xe0100, 0xe01ef }
+};
+
+// East Asian Wide and Fullwidth chars and emoji, drawn two columns wide
+static const struct unicodeRange UNICODE_WIDE[] = {
+    { 0x1100, 0x115f }, { 0x231a, 0x231b }, { 0x2329, 0x232a }, { 0x23e9, 0x23ec },
+    { 0x23f0, 0x23f0 }, { 0x23f3, 0x23f3 }, { 0x25fd, 0x25fe }, { 0x2614, 0x2615 },
+    { 0x2648, 0x2653 }, { 0x267f, 0x267f }, { 0x2693, 0x2693 }, { 0x26a1, 0x26a1 },
+    { 0x26aa, 0x26ab }, { 0x26bd, 0x26be }, { 0x26c4, 0x26c5 }, { 0x26ce, 0x26ce },
+    { 0x26d4, 0x26d4 }, { 0x26ea, 0x26ea }, { 0x26f2, 0x26f3 }, { 0x26f5, 0x26f5 },
+    { 0x26fa, 0x26fa }, { 0x26fd, 0x26fd }, { 0x2705, 0x2705 }, { 0x270a, 0x270b },
+    { 0x2728, 0x2728 }, { 0x274c, 0x274c }, { 0x274e, 0x274e }, { 0x2753, 0x2755 },
+    { 0x2757, 0x2757 }, { 0x2795, 0x2797 }, { 0x27b0, 0x27b0 }, { 0x27bf, 0x27bf },
+    { 0x2b1b, 0x2b1c }, { 0x2b50, 0x2b50 }, { 0x2b55, 0x2b55 }, { 0x2e80, 0x303e },
+    { 0x3041, 0x3247 }, { 0x3250, 0x4dbf }, { 0x4e00, 0xa4cf }, { 0xa960, 0xa97f },
+    { 0xac00, 0xd7a3 }, { 0xf900, 0xfaff }, { 0xfe10, 0xfe19 }, { 0xfe30, 0xfe6f },
+    { 0xff00, 0xff60 }, { 0xffe0, 0xffe6 }, { 0x16fe0, 0x16fe4 }, { 0x17000, 0x18cff },
+    { 0x1b000, 0x1b2ff }, { 0x1f004, 0x1f004 }, { 0x1f0cf, 0x1f0cf }, { 0x1f18e, 0x1f18e },
+    { 0x1f191, 0x1f19a }, { 0x1f200, 0x1f251 }, { 0x1f260, 0x1f265 }, { 0x1f300, 0x1f320 },
+    { 0x1f32d, 0x1f335 }, { 0x1f337, 0x1f37c }, { 0x1f37e, 0x1f393 }, { 0x1f3a0, 0x1f3ca },
+    { 0x1f3cf, 0x1f3d3 }, { 0x1f3e0, 0x1f3f0 }, { 0x1f3f4, 0x1f3f4 }, { 0x1f3f8, 0x1f3fa },
+    { 0x1f400, 0x1f43e }, { 0x1f440, 0x1f440 }, { 0x1f442, 0x1f4fc }, { 0x1f4ff, 0x1f53d },
+    { 0x1f54b, 0x1f54e }, { 0x1f550, 0x1f567 }, { 0x1f57a, 0x1f57a }, { 0x1f595, 0x1f596 },
+    { 0x1f5a4, 0x1f5a4 }, { 0x1f5fb, 0x1f64f }, { 0x1f680, 0x1f6c5 }, { 0x1f6cc, 0x1f6cc },
+    { 0x1f6d0, 0x1f6d2 }, { 0x1f6d5, 0x1f6d7 }, { 0x1f6eb, 0x1f6ec }, { 0x1f6f4, 0x1f6fc },
+    { 0x1f7e0, 0x1f7eb }, { 0x1f90c, 0x1f93a }, { 0x1f93c, 0x1f945 }, { 0x1f947, 0x1f9ff },
+    { 0x1fa70, 0x1faff }, { 0x20000, 0x2fffd }, { 0x30000, 0x3fffd }
+};
+
+#define UNICODE_ZERO_WIDTH_ENTRIES ((int) (sizeof(UNICODE_ZERO_WIDTH) / sizeof(UNICODE_ZERO_WIDTH[0])))
+#define UNICODE_WIDE_ENTRIES ((int) (sizeof(UNICODE_WIDE) / sizeof(UNICODE_WIDE[0])))
+
+
+int utf8Decode(const char *s, int len, int *cp) {
+    unsigned char c = s[0];
+    int bytes;
+
+    // Number of bytes in the sequence, from the lead byte
+    if (c < 0x80) {
+        *cp = c;
+        return 1;
+    } else if ((c & 0xe0) == 0xc0) {
+        bytes = 2;
+        *cp = c & 0x1f;
+    } else if ((c & 0xf0) == 0xe0) {
+        bytes = 3;
+        *cp = c & 0x0f;
+    } else if ((c & 0xf8) == 0xf0) {
+        bytes = 4;
+        *cp = c & 0x07;
+    } else {
+        *cp = UNICODE_INVALID;  // Stray continuation byte or invalid lead byte
+        return 1;
+    }
+
+    if (bytes > len) {
+        *cp = UNICODE_INVALID;  // Sequence cut short by the end of the row
+        return 1;
+    }
+
+    for (int i = 1; i < bytes; i++) {
+        if ((s[i] & 0xc0) != 0x80) {
+            *cp = UNICODE_INVALID;
+            return 1;
+        }
+        *cp = (*cp << 6) | (s[i] & 0x3f);
+    }
+
+    // Overlong forms, surrogates and anything past the last code point aren't valid either
+    static const int least[5] = { 0, 0, 0x80, 0x800, 0x10000 };
+    if (*cp < least[bytes] || (*cp >= 0xd800 && *cp <= 0xdfff) || *cp > 0x10ffff) {
+        *cp = UNICODE_INVALID;
+        return 1;
+    }
+    return bytes;
+}
+
+
+int unicodeInTable(int cp, const struct unicodeRange *table, int size) {
+    // Binary search the sorted ranges
+    int lo = 0, hi = size - 1;
+    if (cp < table[0].first || cp > table[hi].last)
+        return 0;
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (cp > table[mid].last)
+            lo = mid + 1;
+        else if (cp < table[mid].first)
+            hi = mid - 1;
+        else
+            return 1;
+    }
+    return 0;
+}
+
+
+int unicodeWidth(int cp) {
+    // Fast path, nothing below the first combining mark is zero or double width
+    if (cp < 0x300)
+        return 1;
+
+    if (unicodeInTable(cp, UNICODE_ZERO_WIDTH, UNICODE_ZERO_WIDTH_ENTRIES))
+        return 0;
+
+    if (unicodeInTable(cp, UNICODE_WIDE, UNICODE_WIDE_ENTRIES))
+        return 2;
+
+    return 1;
+}
@@ -0,0 +1,50 @@
+#include "texcore.h"
+
+
+/*--------------------------------------------------------------------------
+                                  VIEWS
+--------------------------------------------------------------------------*/
+
+void editorViewsSpan(texCore *tc, int first, int oldEnd, int newEnd) {
+    texViewChanges *c = &tc->changes;
+    if (c->all)
+        return;
+
+    if (!c->dirty) {
+        c->lo = first;
+        c->hi = newEnd;
+        c->shift = newEnd - oldEnd;
+        c->dirty = 1;
+        return;
+    }
+
+    // Rows from the end of the span on move with it, and it's never cut off from the rows already dirty
+    int moved = newEnd - oldEnd;
+    if (first < c->lo)
+        c->lo = first;
+    c->hi = c->hi + moved > newEnd ? c->hi + moved : newEnd;
+    c->shift += moved;
+}
+
+
+void editorViewsInvalidate(texCore *tc) {
+    tc->changes.all = 1;
+}
+
+
+void editorViewsTake(texCore *tc, texViewChanges *changes) {
+    *changes = tc->changes;
+    memset(&tc->changes, 0, sizeof(tc->changes));
+}
+
+
+int editorViewsMapRow(const texViewChanges *changes, int row) {
+    if (changes->all)
+        return -1;
+    if (!changes->dirty || row < changes->lo)
+        return row;
+    // Past the end of the span as it was before, so only moved
+    if (row >= changes->hi - changes->shift)
+        return row + changes->shift;
+    return -1;
+}
@@ -0,0 +1,250 @@
+#include "texcore.h"
+
+
+/*--------------------------------------------------------------------------
+                                YANK RING
+--------------------------------------------------------------------------*/
+
+void editorYankFree(texYank *y) {
+    for (int i = 0; i < y->numParts; i++)
+        free(y->parts[i].text);
+    free(y->parts);
+    y->parts = NULL;
+    y->numParts = 0;
+    y->partsCap = 0;
+    y->len = 0;
+    y->column = 0;
+}
+
+
+void editorYankAppend(texCore *tc, texYank *y, long long first, long long count, const char *text, long long len) {
+    if (first >= 0) {
+        if (count == 0)
+            return;
+        len = largeLineOffset(tc, first + count) - largeLineOffset(tc, first);
+    } else if (len == 0) {
+        return;
+    }
+    y->len += len;
+
+    // Text onto text, or a run carrying straight on from the last one, joins it
+    texYankPart *last = y->numParts ? &y->parts[y->numParts - 1] : NULL;
+    if (last && first < 0 && last->first < 0) {
+        if (last->len + len + 1 > last->cap) {
+            last->cap = last->cap * 2 > last->len + len + 1 ? last->cap * 2 : last->len + len + 1;
+            last->text = texRealloc(tc, last->text, last->cap);
+        }
+        memcpy(&last->text[last->len], text, len);
+        last->len += len;
+        last->text[last->len] = '\0';
+        return;
+    }
+    if (last && first >= 0 && last->first >= 0 && last->first + last->count == first) {
+        last->count += count;
+        last->len += len;
+        return;
+    }
+
+    if (y->numParts == y->partsCap) {
+        y->partsCap = y->partsCap ? y->partsCap * 2 : 4;
+        y->parts = texRealloc(tc, y->parts, sizeof(texYankPart) * y->partsCap);
+    }
+    texYankPart *part = &y->parts[y->numParts++];
+    part->first = first;
+    part->count = count;
+    part->len = len;
+    part->text = NULL;
+    part->cap = 0;
+    if (first < 0) {
+        part->cap = len + 1;
+        part->text = texAlloc(tc, part->cap);
+        memcpy(part->text, text, len);
+        part->text[len] = '\0';
+    }
+}
+
+
+int editorYank(texCore *tc) {
+    int y0, x0, y1, x1;
+    if (!editorSelectionBounds(tc, &y0, &x0, &y1, &x1))
+        return 0;
+
+    // Newest entry takes the place of the oldest once the ring is full
+    texYank *y = &tc->yanks[tc->yankNext];
+    editorYankFree(y);
+    tc->yankNext = (tc->yankNext + 1) % TEX_YANK_RING;
+    if (tc->numYanks < TEX_YANK_RING)
+        tc->numYanks++;
+    y->column = tc->selMode == SEL_COLUMN;
+
+    // In memory the rows can change under the yank at any time, so it's a copy
+    if (tc->large == NULL || y->column || y1 - y0 < 2) {
+        long long len;
+        char *text = editorCopySelection(tc, &len);
+        editorYankAppend(tc, y, -1, 0, text, len);
+        free(text);
+        return 1;
+    }
+
+    // Paged rows between the first and last are left on disk wherever they're the file's own lines
+    largeWalkRows(tc, y0, y0 + 1);
+    erow *row = editorRowAt(tc, y0);
+    editorYankAppend(tc, y, -1, 0, &row->chars[x0], row->size - x0);
+    editorYankAppend(tc, y, -1, 0, "\n", 1);
+
+    largeYankLines(tc, y, y0 + 1, y1);
+
+    largeWalkRows(tc, y1, y1 + 1);
+    row = editorRowAt(tc, y1);
+    editorYankAppend(tc, y, -1, 0, row->chars, x1);
+    return 1;
+}
+
+
+texYank *editorYankAt(texCore *tc, int back) {
+    if (back < 0 || back >= tc->numYanks)
+        return NULL;
+    return &tc->yanks[(tc->yankNext - 1 - back + TEX_YANK_RING) % TEX_YANK_RING];
+}
+
+
+char *editorYankText(texCore *tc, texYank *y, long long *len) {
+    // Room for a newline ending each run, in case one ends on a last line without its own
+    char *buf = texAlloc(tc, y->len + y->numParts + 1);
+    long long n = 0;
+
+    for (int i = 0; i < y->numParts; i++) {
+        texYankPart *part = &y->parts[i];
+        if (part->first < 0) {
+            memcpy(&buf[n], part->text, part->len);
+            n += part->len;
+            continue;
+        }
+
+        long long from = largeLineOffset(tc, part->first);
+        long long done = 0;
+        while (done < part->len) {
+            long long got = largeRead(tc, tc->large->gz, &buf[n + done], part->len - done, from + done);
+            if (got <= 0)
+                break;
+            done += got;
+        }
+        n += done;
+        if (n == 0 || buf[n - 1] != '\n')
+            buf[n++] = '\n';
+    }
+    buf[n] = '\0';
+    *len = n;
+    return buf;
+}
+
+
+void editorPasteColumn(texCore *tc, texYank *y) {
+    long long len;
+    char *text = editorYankText(tc, y, &len);
+    erow *row = tc->cy < tc->numrows ? editorRowAt(tc, tc->cy) : NULL;
+    int rx = row ? editorRowCxToRx(row, tc->cx) : 0;
+    int first = tc->cy;
+    int r = first;
+
+    // Each line of the block goes in at the same screen column of a row of its own
+    tc->hlDeferred = 1;
+    for (char *s = text; s <= text + len; r++) {
+        char *nl = memchr(s, '\n', text + len - s);
+        int lineLen = nl ? nl - s : text + len - s;
+
+        if (tc->large && r < tc->numrows)
+            largeWalkRows(tc, r, r + 1);
+        if (r == tc->numrows)
+            editorInsertRow(tc, tc->numrows, "", 0);
+        row = editorRowAt(tc, r);
+
+        // Rows too short to reach the column are padded out to it with spaces
+        int at = editorRowRxToCx(row, rx);
+        int pad = rx - editorRowCxToRx(row, at);
+        if (pad < 0)
+            pad = 0;
+        row->chars = texRealloc(tc, row->chars, row->size + pad + lineLen + 1);
+        memmove(&row->chars[at + pad + lineLen], &row->chars[at], row->size - at + 1);
+        memset(&row->chars[at], ' ', pad);
+        memcpy(&row->chars[at + pad], s, lineLen);
+        row->size += pad + lineLen;
+        editorUpdateRow(tc, row);
+        editorRowEdited(tc, row);
+
+        if (r == first)
+            tc->cx = at + pad + lineLen;
+        s += lineLen + 1;
+    }
+    tc->hlDeferred = 0;
+    editorHighlightRange(tc, first, r - 1);
+    free(text);
+}
+
+
+int editorYankPieces(texCore *tc, texYank *y, int *part, texPiece **pieces) {
+    int n = 0;
+    int cap = 0;
+    *pieces = NULL;
+
+    for (; *part < y->numParts; (*part)++) {
+        texYankPart *p = &y->parts[*part];
+        if (p->first < 0 && p->text[p->len - 1] != '\n')
+            break;
+
+        if (n == cap) {
+            cap = cap ? cap * 2 : 16;
+            *pieces = texRealloc(tc, *pieces, sizeof(texPiece) * cap);
+        }
+        texPiece *piece = &(*pieces)[n++];
+        piece->first = p->first;
+        piece->count = p->count;
+        piece->text = NULL;
+        piece->len = 0;
+        if (p->first >= 0)
+            continue;
+
+        // Text stays whole, its lines held in the one piece without the newline ending the last
+        piece->count = 0;
+        for (const char *nl = p->text; (nl = memchr(nl, '\n', p->text + p->len - nl)) != NULL; nl++)
+            piece->count++;
+        piece->len = p->len - 1;
+        piece->text = texAlloc(tc, piece->len + 1);
+        memcpy(piece->text, p->text, piece->len);
+        piece->text[piece->len] = '\0';
+    }
+    return n;
+}
+
+
+void editorPasteYank(texCore *tc, texYank *y) {
+    if (y->column) {
+        editorPasteColumn(tc, y);
+        return;
+    }
+
+    for (int i = 0; i < y->numParts;) {
+        texYankPart *part = &y->parts[i];
+        int whole = part->first >= 0 || part->text[part->len - 1] == '\n';
+
+        if (tc->large && tc->cx == 0 && whole) {
+            // Whole lines at the start of a row go into the file with one splice, leaving runs unread
+            texPiece *pieces;
+            int n = editorYankPieces(tc, y, &i, &pieces);
+            largeInsertPieces(tc, tc->cy, pieces, n);
+            for (int j = 0; j < n; j++)
+                tc->cy += pieces[j].count;
+            free(pieces);
+        } else if (part->first < 0) {
+            editorInsertText(tc, part->text, part->len);
+            i++;
+        } else {
+            texYank run = {part, 1, 1, part->len, 0};
+            long long len;
+            char *text = editorYankText(tc, &run, &len);
+            editorInsertText(tc, text, len);
+            free(text);
+            i++;
+        }
+    }
+}